@@ -0,0 +1,6 @@
+# 区間平均プログラムのコンパイル
+mkdir -p out
+g++ -O2 -std=c++17 -pthread cpp/average.cpp -o "out/average.out"
+
+# data/range.csv の各区間の平均を計算し results/result.csv へ書き出す (-s で標準偏差の列も追加)
+./out/average.out -r data/range.csv -d sheets -o results/result.csv
@@ -0,0 +1,486 @@
+/**************************************************************/
+// Program name : Average
+// Author       : Masatsugu Kitadai
+// Date         : 2023/5/7
+// Description  : 風洞試験シートの区間平均の計算 (programs/average.py の C++ 版)
+//
+//   ./out/average.out [-r 区間ファイル] [-d シートのディレクトリ] [-o 出力ファイル] [-s] [-j 並列数]
+//     既定値 : -r data/range.csv, -d sheets, -o results/result.csv (FW/ で実行)
+//     区間ファイルの各行 (case, cal_min, cal_max, zero_min, zero_max, ave_min, ave_max) について
+//       cal_average, zero_average, dv_average : sum の区間平均
+//       v_average                             : v の ave 区間の平均
+//       dv0_average ~ dv3_average             : dv0 ~ dv3 の ave 区間の 0 を除いた平均
+//     を計算し、区間ファイルの列の後ろに追加して書き出す (-s で各区間の標準偏差の列も追加)
+//
+//   シートは1回だけ読み込み、列ごとの累積和 (値・二乗・有効数) を作っておく
+//   区間の端は昇順の s 列の二分探索で求め、平均・分散は累積和の差から O(log n) で計算する
+//   シート単位で並列に処理する
+/**************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <sys/stat.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <thread>
+#include <atomic>
+#include <numeric>
+#include <algorithm>
+#include <charconv>
+#include "../../common/data_reader.h"
+#include "../../common/metrics.h"
+using namespace std;
+mode_t dir_mode = S_IRUSR | S_IWUSR | S_IXUSR | S_IRGRP | S_IWGRP | S_IXGRP | S_IROTH | S_IXOTH | S_IXOTH;
+
+/** 集計する列 **/
+enum Column_id
+{
+    column_sum,
+    column_v,
+    column_dv0,
+    column_dv1,
+    column_dv2,
+    column_dv3,
+    n_columns
+};
+const char *column_names[n_columns] = {"sum", "v", "dv0", "dv1", "dv2", "dv3"};
+
+/** 区間平均・標準偏差 **/
+struct Window_stats
+{
+    double mean = NAN; // 平均値
+    double std = NAN;  // 標準偏差 (不偏)
+};
+
+/** 1列の累積和 (先頭に 0 を置いた n+1 点) **/
+struct Prefix_sums
+{
+    vector<long double> sum;    // 値の累積和 (NaN は 0)
+    vector<long double> sum2;   // 二乗の累積和
+    vector<long> count;         // 有効数 (NaN を除く) の累積
+    vector<long> count_nonzero; // 有効かつ 0 でない数の累積
+    double shift = 0;           // 桁落ちを避けるため全体から差し引く値 (列の平均)
+};
+
+/** 1シート **/
+struct Sheet
+{
+    string name;                    // ケース名
+    vector<double> s;               // 時刻 [s] (昇順)
+    Prefix_sums columns[n_columns]; // 集計する列の累積和
+};
+
+/** 区間ファイルの1行 **/
+struct Range_row
+{
+    vector<string> fields; // 区間ファイルの各列 (書き出し用にそのまま保持)
+    string name;           // ケース名
+    double cal_min, cal_max, zero_min, zero_max, ave_min, ave_max;
+    Window_stats cal, zero, dv, v, dv_n[4]; // 計算結果
+};
+
+/** プロトタイプ宣言 **/
+vector<string> Split_csv(const string &line);
+bool Read_ranges(const char *filename, vector<string> &header, vector<Range_row> &rows);
+bool Read_sheet(const string &filename, Sheet &sheet);
+Window_stats Window(const Sheet &sheet, int column, double lower, double upper, bool nonzero);
+void Write_value(FILE *fp, double value);
+
+/**************************************************************/
+// Function name : main
+// Description   : メイン
+/**************************************************************/
+int main(int argc, char *argv[])
+{
+    /** 引数の読み取り **/
+    const char *range_file = "data/range.csv";
+    const char *sheet_dir = "sheets";
+    const char *output = "results/result.csv";
+    bool with_std = false;
+    int workers = thread::hardware_concurrency();
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+        {
+            range_file = argv[++i];
+        }
+        else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc)
+        {
+            sheet_dir = argv[++i];
+        }
+        else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+        {
+            output = argv[++i];
+        }
+        else if (strcmp(argv[i], "-s") == 0)
+        {
+            with_std = true;
+        }
+        else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+        {
+            workers = atoi(argv[++i]);
+        }
+        else
+        {
+            printf("Unknown option: %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    Metrics_start("Average");
+
+    /** 区間ファイルの読み込み **/
+    vector<string> header;
+    vector<Range_row> rows;
+    if (!Read_ranges(range_file, header, rows))
+    {
+        return 1;
+    }
+
+    /** ケースごとに区間ファイルの行をまとめる (同じシートは1回だけ読み込む) **/
+    map<string, vector<size_t>> cases;
+    for (size_t r = 0; r < rows.size(); r++)
+    {
+        cases[rows[r].name].push_back(r);
+    }
+    vector<pair<string, vector<size_t>>> tasks(cases.begin(), cases.end());
+
+    /** 並列処理 (シート単位で割り当て) **/
+    Metrics_timer timer_compute("compute");
+    atomic<size_t> next(0);
+    atomic<int> failed(0);
+    auto worker = [&]()
+    {
+        size_t k;
+        while ((k = next++) < tasks.size())
+        {
+            Sheet sheet;
+            sheet.name = tasks[k].first;
+            if (!Read_sheet(string(sheet_dir) + "/" + sheet.name + ".csv", sheet))
+            {
+                failed++;
+                continue;
+            }
+            for (size_t r : tasks[k].second)
+            {
+                Range_row &row = rows[r];
+                row.cal = Window(sheet, column_sum, row.cal_min, row.cal_max, false);
+                row.zero = Window(sheet, column_sum, row.zero_min, row.zero_max, false);
+                row.dv = Window(sheet, column_sum, row.ave_min, row.ave_max, false);
+                row.v = Window(sheet, column_v, row.ave_min, row.ave_max, false);
+                for (int c = 0; c < 4; c++)
+                {
+                    row.dv_n[c] = Window(sheet, column_dv0 + c, row.ave_min, row.ave_max, true);
+                }
+            }
+        }
+    };
+    vector<thread> threads;
+    for (int k = 0; k < max(1, min(workers, (int)tasks.size())); k++)
+    {
+        threads.emplace_back(worker);
+    }
+    for (thread &th : threads)
+    {
+        th.join();
+    }
+    timer_compute.Stop();
+    Metrics_add("sheets", tasks.size());
+    Metrics_add("ranges", rows.size());
+
+    /** 書き出し (区間ファイルの列 + 計算結果) **/
+    const string output_dir = string(output).substr(0, string(output).find_last_of('/') + 1);
+    if (!output_dir.empty())
+    {
+        mkdir(output_dir.c_str(), dir_mode);
+    }
+    FILE *fp = fopen(output, "w");
+    if (fp == NULL)
+    {
+        printf("Cannot open: %s\n", output);
+        return 1;
+    }
+    const char *result_names[] = {"cal", "zero", "dv", "v", "dv0", "dv1", "dv2", "dv3"};
+    for (size_t j = 0; j < header.size(); j++)
+    {
+        fprintf(fp, "%s%s", j > 0 ? "," : "", header[j].c_str());
+    }
+    for (const char *name : result_names)
+    {
+        fprintf(fp, ",%s_average", name);
+    }
+    if (with_std)
+    {
+        for (const char *name : result_names)
+        {
+            fprintf(fp, ",%s_std", name);
+        }
+    }
+    fprintf(fp, "\n");
+    for (const Range_row &row : rows)
+    {
+        const Window_stats *results[] = {&row.cal, &row.zero, &row.dv, &row.v, &row.dv_n[0], &row.dv_n[1], &row.dv_n[2], &row.dv_n[3]};
+        for (size_t j = 0; j < row.fields.size(); j++)
+        {
+            fprintf(fp, "%s%s", j > 0 ? "," : "", row.fields[j].c_str());
+        }
+        for (const Window_stats *result : results)
+        {
+            Write_value(fp, result->mean);
+        }
+        if (with_std)
+        {
+            for (const Window_stats *result : results)
+            {
+                Write_value(fp, result->std);
+            }
+        }
+        fprintf(fp, "\n");
+    }
+    Metrics_fclose(fp);
+
+    printf("%ld ranges / %ld sheets -> %s\n", (long)rows.size(), (long)tasks.size(), output);
+    return failed == 0 ? 0 : 1;
+}
+
+/**************************************************************/
+// Function name : Split_csv
+// Description   : カンマ区切りの1行の分割 (行末の改行・CR は除く)
+/**************************************************************/
+vector<string> Split_csv(const string &line)
+{
+    vector<string> fields;
+    size_t begin = 0;
+    size_t end = line.find_last_not_of("\r\n");
+    end = end == string::npos ? 0 : end + 1;
+    while (begin <= end)
+    {
+        size_t comma = line.find(',', begin);
+        if (comma == string::npos || comma > end)
+        {
+            comma = end;
+        }
+        fields.push_back(line.substr(begin, comma - begin));
+        begin = comma + 1;
+    }
+    return fields;
+}
+
+/**************************************************************/
+// Function name : Read_ranges
+// Description   : 区間ファイルの読み込み (列は見出しの名前で探す)
+/**************************************************************/
+bool Read_ranges(const char *filename, vector<string> &header, vector<Range_row> &rows)
+{
+    FILE *fp = fopen(filename, "r");
+    if (fp == NULL)
+    {
+        printf("Cannot open: %s\n", filename);
+        return false;
+    }
+
+    char buf[4096];
+    if (fgets(buf, sizeof(buf), fp) == NULL)
+    {
+        fclose(fp);
+        return false;
+    }
+    header = Split_csv(buf);
+
+    /** 必要な列の位置 **/
+    const char *names[] = {"case", "cal_min", "cal_max", "zero_min", "zero_max", "ave_min", "ave_max"};
+    int index[7];
+    for (int c = 0; c < 7; c++)
+    {
+        index[c] = find(header.begin(), header.end(), names[c]) - header.begin();
+        if (index[c] == (int)header.size())
+        {
+            printf("%s: column '%s' not found\n", filename, names[c]);
+            fclose(fp);
+            return false;
+        }
+    }
+
+    while (fgets(buf, sizeof(buf), fp) != NULL)
+    {
+        Range_row row;
+        row.fields = Split_csv(buf);
+        if (row.fields.size() < header.size() || row.fields[0].empty())
+        {
+            continue; // 空行
+        }
+        row.name = row.fields[index[0]];
+        double *bounds[] = {&row.cal_min, &row.cal_max, &row.zero_min, &row.zero_max, &row.ave_min, &row.ave_max};
+        for (int c = 0; c < 6; c++)
+        {
+            *bounds[c] = atof(row.fields[index[c + 1]].c_str());
+        }
+        rows.push_back(row);
+    }
+    fclose(fp);
+    return true;
+}
+
+/**************************************************************/
+// Function name : Read_sheet
+// Description   : シートの読み込みと累積和の作成 (s が昇順でない場合は s で並べ替える)
+/**************************************************************/
+bool Read_sheet(const string &filename, Sheet &sheet)
+{
+    /** 見出し行から列の位置を決める **/
+    FILE *fp = fopen(filename.c_str(), "r");
+    if (fp == NULL)
+    {
+        printf("Cannot open: %s\n", filename.c_str());
+        return false;
+    }
+    char buf[4096];
+    const bool has_header = fgets(buf, sizeof(buf), fp) != NULL;
+    fclose(fp);
+    if (!has_header)
+    {
+        return false;
+    }
+    const vector<string> header = Split_csv(buf);
+    auto column_of = [&](const char *name)
+    {
+        return (int)(find(header.begin(), header.end(), name) - header.begin());
+    };
+    const int index_s = column_of("s");
+    int index[n_columns];
+    for (int c = 0; c < n_columns; c++)
+    {
+        index[c] = column_of(column_names[c]);
+    }
+
+    Data_table<double> table;
+    if (!Read_table(filename.c_str(), table, 0, header.size()))
+    {
+        return false;
+    }
+    if (index_s == (int)header.size())
+    {
+        printf("%s: column 's' not found\n", filename.c_str());
+        return false;
+    }
+
+    /** s の昇順の並び (通常は既に昇順) **/
+    const size_t n = table.rows;
+    const double *s = table.Column(index_s);
+    vector<size_t> order(n);
+    iota(order.begin(), order.end(), 0);
+    if (!is_sorted(s, s + n))
+    {
+        stable_sort(order.begin(), order.end(), [&](size_t a, size_t b)
+                    { return s[a] < s[b]; });
+    }
+    sheet.s.resize(n);
+    for (size_t i = 0; i < n; i++)
+    {
+        sheet.s[i] = s[order[i]];
+    }
+
+    /** 列ごとの累積和 (列が無い場合は全て NaN として扱う) **/
+    for (int c = 0; c < n_columns; c++)
+    {
+        Prefix_sums &ps = sheet.columns[c];
+        ps.sum.assign(n + 1, 0.0L);
+        ps.sum2.assign(n + 1, 0.0L);
+        ps.count.assign(n + 1, 0);
+        ps.count_nonzero.assign(n + 1, 0);
+        if (index[c] == (int)header.size())
+        {
+            continue;
+        }
+        const double *x = table.Column(index[c]);
+
+        double total = 0;
+        long valid = 0;
+        for (size_t i = 0; i < n; i++)
+        {
+            if (!isnan(x[i]))
+            {
+                total += x[i];
+                valid++;
+            }
+        }
+        ps.shift = valid > 0 ? total / valid : 0;
+
+        for (size_t i = 0; i < n; i++)
+        {
+            const double value = x[order[i]];
+            const bool ok = !isnan(value);
+            const long double d = ok ? (long double)value - ps.shift : 0.0L;
+            ps.sum[i + 1] = ps.sum[i] + d;
+            ps.sum2[i + 1] = ps.sum2[i] + d * d;
+            ps.count[i + 1] = ps.count[i] + (ok ? 1 : 0);
+            ps.count_nonzero[i + 1] = ps.count_nonzero[i] + (ok && value != 0 ? 1 : 0);
+        }
+    }
+    return true;
+}
+
+/**************************************************************/
+// Function name : Window
+// Description   : lower <= s <= upper の区間の平均・標準偏差 (nonzero で 0 を除外, 該当なしは NaN)
+/**************************************************************/
+Window_stats Window(const Sheet &sheet, int column, double lower, double upper, bool nonzero)
+{
+    Window_stats result;
+    const size_t lo = lower_bound(sheet.s.begin(), sheet.s.end(), lower) - sheet.s.begin();
+    const size_t hi = upper_bound(sheet.s.begin(), sheet.s.end(), upper) - sheet.s.begin();
+    if (hi <= lo)
+    {
+        return result;
+    }
+
+    const Prefix_sums &ps = sheet.columns[column];
+    long double sum = ps.sum[hi] - ps.sum[lo];
+    long double sum2 = ps.sum2[hi] - ps.sum2[lo];
+    long count = ps.count[hi] - ps.count[lo];
+    if (nonzero)
+    {
+        /** 0 の値は差分 -shift として累積されているため、その分を取り除く **/
+        const long zeros = count - (ps.count_nonzero[hi] - ps.count_nonzero[lo]);
+        sum += (long double)zeros * ps.shift;
+        sum2 -= (long double)zeros * ps.shift * ps.shift;
+        count -= zeros;
+    }
+    if (count <= 0)
+    {
+        return result;
+    }
+
+    const long double mean = sum / count;
+    result.mean = (double)(mean + ps.shift);
+    if (count > 1)
+    {
+        const long double var = (sum2 - sum * mean) / (count - 1);
+        result.std = (double)sqrtl(var > 0 ? var : 0);
+    }
+    return result;
+}
+
+/**************************************************************/
+// Function name : Write_value
+// Description   : 1値の書き出し (最短の往復可能な表記, NaN は空欄 : pandas の to_csv と同じ)
+/**************************************************************/
+void Write_value(FILE *fp, double value)
+{
+    if (isnan(value))
+    {
+        fprintf(fp, ",");
+        return;
+    }
+    char buf[64];
+    char *end = to_chars(buf, buf + sizeof(buf), value).ptr;
+    *end = '\0';
+    if (strpbrk(buf, ".en") == NULL)
+    {
+        strcpy(end, ".0"); // 整数値も浮動小数点数として書く
+    }
+    fprintf(fp, ",%s", buf);
+}
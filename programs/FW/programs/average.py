@@ -1,6 +1,27 @@
 import os
+import numpy as np
 import pandas as pd
 
+# 同じ計算の C++ 版 (シート数・区間数が多い場合) : cpp/average.cpp (./allrun_average.sh)
+
+# C++ の計算モジュール (cmake -DGRANDELFINO_PYTHON=ON でビルドし PYTHONPATH に追加), 無い場合は pandas で計算
+try:
+    import grandelfino
+except ImportError:
+    grandelfino = None
+
+
+def range_mean(df, column, lower, upper, nonzero=False):
+    # lower <= s <= upper の区間の column の平均値 (nonzero で 0 を除外)
+    if grandelfino is not None:
+        s = np.ascontiguousarray(df["s"].to_numpy(dtype=np.float64))
+        v = np.ascontiguousarray(df[column].to_numpy(dtype=np.float64))
+        return grandelfino.range_mean(s, v, lower, upper, nonzero)
+    selected = df[(df["s"] >= lower) & (df["s"] <= upper)][column]
+    if nonzero:
+        selected = selected[selected != 0]
+    return selected.mean()
+
 
 def generate_file_paths(range_df_path, base_path="sheets/"):
     # Read the range dataframe
@@ -27,28 +48,16 @@ def calculate_averages(file_paths, range_df_path):
         target_df = dataframes[df_index]
 
         # Calculate the average for cal range
-        cal_avg = target_df[
-            (target_df["s"] >= row["cal_min"]) & (target_df["s"] <= row["cal_max"])
-        ]["sum"].mean()
-        cal_averages.append(cal_avg)
+        cal_averages.append(range_mean(target_df, "sum", row["cal_min"], row["cal_max"]))
 
         # Calculate the average for zero range
-        zero_avg = target_df[
-            (target_df["s"] >= row["zero_min"]) & (target_df["s"] <= row["zero_max"])
-        ]["sum"].mean()
-        zero_averages.append(zero_avg)
+        zero_averages.append(range_mean(target_df, "sum", row["zero_min"], row["zero_max"]))
 
         # Calculate the average for ave range (added functionality)
-        dv_avg = target_df[
-            (target_df["s"] >= row["ave_min"]) & (target_df["s"] <= row["ave_max"])
-        ]["sum"].mean()
-        dv_averages.append(dv_avg)
+        dv_averages.append(range_mean(target_df, "sum", row["ave_min"], row["ave_max"]))
 
         # Calculate the v for ave range (added functionality)
-        v_avg = target_df[
-            (target_df["s"] >= row["ave_min"]) & (target_df["s"] <= row["ave_max"])
-        ]["v"].mean()
-        v_averages.append(v_avg)
+        v_averages.append(range_mean(target_df, "v", row["ave_min"], row["ave_max"]))
 
     range_df["cal_average"] = cal_averages
     range_df["zero_average"] = zero_averages
@@ -62,15 +71,10 @@ def calculate_averages(file_paths, range_df_path):
         df_index = file_paths.index(f"sheets/{df_name}.csv")
         target_df = dataframes[df_index]
 
-        # Filter the dataframe for the ave range
-        ave_df = target_df[
-            (target_df["s"] >= row["ave_min"]) & (target_df["s"] <= row["ave_max"])
-        ]
-
         # Calculate the average for non-zero values for each dv column
         dv_cols = ["dv0", "dv1", "dv2", "dv3"]
         for col in dv_cols:
-            avg = ave_df[ave_df[col] != 0][col].mean()
+            avg = range_mean(target_df, col, row["ave_min"], row["ave_max"], nonzero=True)
             locals()[f"{col}_averages"].append(avg)
 
     range_df["dv0_average"] = dv0_averages
@@ -0,0 +1,7 @@
+# Allan 偏差プログラムのコンパイル
+mkdir -p out result
+g++ -O2 -std=c++17 -pthread cpp/Allan_deviation.cpp -o "out/Allan_deviation.out"
+
+# 静止状態のログの Allan 偏差と雑音係数
+# (サンプリング周期は時刻列の間隔の中央値 (約 31 [ms]) から求め、欠測の位置で区間を区切る。欠測を補間しないため Resample は通さない)
+./out/Allan_deviation.out data/data.csv -o result/allan.dat
@@ -0,0 +1,9 @@
+# 等間隔化プログラムのコンパイル
+mkdir -p out result
+g++ -O2 -std=c++17 -pthread cpp/Resample.cpp -o "out/Resample.out"
+
+# ロガーの公称周期 (時刻列の間隔の中央値, 約 31 [ms]) の等間隔データへ変換 (欠測区間には出力しない)
+./out/Resample.out data/data.csv result/data_resampled.csv 0 cubic
+
+# 欠測区間も補間で埋める場合
+# ./out/Resample.out data/data.csv result/data_resampled.csv 0 cubic -fill
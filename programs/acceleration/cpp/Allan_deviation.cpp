@@ -0,0 +1,285 @@
+/**************************************************************/
+// Program name : Allan_deviation
+// Author       : Masatsugu Kitadai
+// Date         : 2023/10/28
+// Description  : 静止状態の長時間ログのオーバーラップ Allan 偏差と雑音係数 (ARW・バイアス不安定性・RRW) の計算
+//
+//   ./out/Allan_deviation.out <入力 CSV> [-o 出力ファイル] [-hz サンプリング周波数 [Hz]] [-tau_max 最大平均時間 [s]] [-d 1桁あたりの点数] [-j 並列数]
+//     入力は 1 列目が時刻 [ms] (MPU6050 ロガー・Resample の出力と同じ), 2 列目以降が各チャンネル
+//     -hz を指定しない場合はサンプリング周期を時刻列の間隔の中央値 (公称周期) から求める
+//     公称周期の 1.5 倍を超える間隔 (欠測) で区間を区切り、区間をまたぐ平均は使わない (欠測を補間しないため Resample は不要)
+//     入力はブロックごとに読み込むため、ファイルの大きさはメモリに依存しない (使用量は最大平均時間に比例)
+//     出力ファイル (既定 result/allan.dat) : tau [s], 平均点数, 項数, 各チャンネルの Allan 偏差
+//     標準出力 : チャンネルごとの N (ランダムウォーク)・B (バイアス不安定性)・K (レートランダムウォーク)
+//     雑音係数の読み取りには m <= N/4 の τ だけを使う (それより長い τ は推定のばらつきが大きい)
+/**************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+#include <vector>
+#include <thread>
+#include "../../common/data_reader.h"
+#include "../../common/allan_variance.h"
+#include "../../common/resample.h"
+#include "../../common/metrics.h"
+using namespace std;
+
+/** パラメータ **/
+const size_t block = 65536;         // 1回に読み込む行数 [-]
+const size_t buffer_size = 1 << 22; // 読み込みバッファ [byte]
+const double gap_factor = 1.5;      // 欠測と判定する間隔 (公称周期に対する倍率) [-]
+
+/** ブロック単位の CSV の読み込み **/
+struct Csv_stream
+{
+    FILE *fp = NULL;           // 入力ファイル
+    vector<char> buffer;       // 読み込みバッファ
+    size_t begin = 0, end = 0; // バッファ内の未処理の範囲
+    bool eof = false;          // ファイル末尾に達したか
+    size_t cols = 0;           // 列数 (時刻 + チャンネル) [-]
+    uint64_t skipped = 0;      // 解析できなかった行数 [-]
+};
+
+/** プロトタイプ宣言 **/
+size_t Read_block(Csv_stream &cs, vector<double> &times, vector<double> &rows);
+
+/**************************************************************/
+// Function name : main
+// Description   : メインプログラム
+/**************************************************************/
+int main(int argc, char *argv[])
+{
+    /** 引数の読み取り **/
+    const char *readfile = NULL;
+    const char *writefile = "result/allan.dat";
+    double hz = 0;
+    double tau_max = 3600.0;
+    int per_decade = 10;
+    int workers = thread::hardware_concurrency();
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+        {
+            writefile = argv[++i];
+        }
+        else if (strcmp(argv[i], "-hz") == 0 && i + 1 < argc)
+        {
+            hz = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-tau_max") == 0 && i + 1 < argc)
+        {
+            tau_max = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc)
+        {
+            per_decade = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+        {
+            workers = atoi(argv[++i]);
+        }
+        else
+        {
+            readfile = argv[i];
+        }
+    }
+    if (readfile == NULL)
+    {
+        printf("usage: %s <input.csv> [-o output] [-hz hz] [-tau_max s] [-d per_decade] [-j workers]\n", argv[0]);
+        return 1;
+    }
+
+    Metrics_start("Allan_deviation");
+
+    /** 見出し行 (チャンネル名) **/
+    Csv_stream cs;
+    cs.fp = fopen(readfile, "r");
+    if (cs.fp == NULL)
+    {
+        printf("Cannot open: %s\n", readfile);
+        return 1;
+    }
+    cs.buffer.resize(buffer_size);
+    char line[4096];
+    if (fgets(line, sizeof(line), cs.fp) == NULL)
+    {
+        return 1;
+    }
+    vector<string> names;
+    for (char *p = strtok(line, ",\t \r\n"); p != NULL; p = strtok(NULL, ",\t \r\n"))
+    {
+        names.push_back(p);
+    }
+    if (names.size() < 2)
+    {
+        printf("%s: no channels\n", readfile);
+        return 1;
+    }
+    names.erase(names.begin()); // 時刻列
+    const int channels = names.size();
+    cs.cols = channels + 1;
+
+    /** 最初のブロックからサンプリング周期を決めて初期化 **/
+    vector<double> times, rows;
+    size_t count = Read_block(cs, times, rows);
+    if (count < 2)
+    {
+        printf("%s: too few samples\n", readfile);
+        return 1;
+    }
+    const double dt_nominal = hz > 0 ? 1000.0 / hz : Resample_nominal_interval(times.data(), count); // 公称周期 [ms]
+    if (dt_nominal <= 0)
+    {
+        printf("%s: cannot estimate the sampling interval\n", readfile);
+        return 1;
+    }
+    double tau0 = dt_nominal / 1000.0; // サンプリング周期 [s]
+    Allan_variance av;
+    Allan_init(av, channels, max(1L, (long)(tau_max / tau0)), per_decade, block);
+
+    /** ブロックごとの更新 (欠測の位置で区間を区切って追加) **/
+    Metrics_timer timer_compute("compute");
+    double t_prev = NAN;      // 前のサンプルの時刻 [ms]
+    double span = 0;          // 区間内の間隔の合計 [ms]
+    uint64_t intervals = 0;   // 区間内の間隔の数 [-]
+    long gaps = 0;            // 欠測の数 [-]
+    double gap_time = 0;      // 欠測の合計時間 [ms]
+    while (count > 0)
+    {
+        size_t begin = 0;
+        for (size_t k = 0; k < count; k++)
+        {
+            const double d = times[k] - t_prev;
+            t_prev = times[k];
+            if (isnan(d))
+            {
+                continue; // 先頭のサンプル
+            }
+            if (d > gap_factor * dt_nominal || d <= 0)
+            {
+                Allan_push(av, &rows[begin * channels], k - begin, workers);
+                Allan_break(av);
+                begin = k;
+                gaps += 1;
+                gap_time += d > 0 ? d : 0;
+                continue;
+            }
+            span += d;
+            intervals += 1;
+        }
+        Allan_push(av, &rows[begin * channels], count - begin, workers);
+        count = Read_block(cs, times, rows);
+    }
+    fclose(cs.fp);
+    timer_compute.Stop();
+    Metrics_add("samples", av.n);
+    Metrics_add("taus", av.m.size());
+
+    /** 区間内の平均間隔でサンプリング周期を確定 (欠測の時間を含めない) **/
+    if (hz <= 0 && intervals > 0)
+    {
+        tau0 = span / intervals / 1000.0;
+    }
+
+    /** 書き出し **/
+    FILE *fp = fopen(writefile, "w");
+    if (fp == NULL)
+    {
+        printf("Cannot open: %s\n", writefile);
+        return 1;
+    }
+    fprintf(fp, "# tau[s]\tm[-]\tterms[-]");
+    for (const string &name : names)
+    {
+        fprintf(fp, "\t%s", name.c_str());
+    }
+    fprintf(fp, "\n");
+    vector<vector<double>> fit_tau(channels), fit_adev(channels);
+    for (size_t k = 0; k < av.m.size(); k++)
+    {
+        if (av.terms[k] == 0)
+        {
+            break;
+        }
+        const double tau = av.m[k] * tau0;
+        fprintf(fp, "%.6g\t%ld\t%ld", tau, av.m[k], (long)av.terms[k]);
+        for (int c = 0; c < channels; c++)
+        {
+            const double adev = Allan_deviation(av, k, c);
+            fprintf(fp, "\t%.6e", adev);
+            if ((uint64_t)av.m[k] * 4 <= av.longest && adev > 0)
+            {
+                fit_tau[c].push_back(tau);
+                fit_adev[c].push_back(adev);
+            }
+        }
+        fprintf(fp, "\n");
+    }
+    Metrics_fclose(fp);
+
+    /** 雑音係数 **/
+    printf("samples = %ld\ttau0 = %.6f [s]\tduration = %.1f [s]\tskipped = %ld\n", (long)av.n, tau0, av.n * tau0, (long)cs.skipped);
+    printf("segments = %ld (longest %.1f [s])\tgaps = %ld (%.1f [s] excluded)\n", av.segments, av.longest * tau0, gaps, gap_time / 1000.0);
+    printf("# channel\tN[/sqrt(s)]\tB[-]\ttau_B[s]\tK[/s/sqrt(s)]\n");
+    for (int c = 0; c < channels; c++)
+    {
+        const Allan_coefficients co = Allan_fit(fit_tau[c], fit_adev[c]);
+        printf("%s\t%.4e\t%.4e\t%.3g\t%.4e\n", names[c].c_str(), co.arw, co.bias, co.tau_b, co.rrw);
+    }
+
+    return 0;
+}
+
+/**************************************************************/
+// Function name : Read_block
+// Description   : 最大 block 行の読み込み (解析できない行は読み飛ばす) | 戻り値は行数
+/**************************************************************/
+size_t Read_block(Csv_stream &cs, vector<double> &times, vector<double> &rows)
+{
+    const int channels = cs.cols - 1;
+    times.resize(block);
+    rows.resize(block * channels);
+    vector<double> row(cs.cols);
+    size_t count = 0;
+    while (count < block)
+    {
+        /** 1行分がバッファにない場合は補充 **/
+        char *data = cs.buffer.data();
+        char *nl = (char *)memchr(data + cs.begin, '\n', cs.end - cs.begin);
+        if (nl == NULL && !cs.eof)
+        {
+            memmove(data, data + cs.begin, cs.end - cs.begin);
+            cs.end -= cs.begin;
+            cs.begin = 0;
+            const size_t n = fread(data + cs.end, 1, cs.buffer.size() - cs.end, cs.fp);
+            cs.end += n;
+            cs.eof = n == 0;
+            continue;
+        }
+        if (cs.begin >= cs.end)
+        {
+            break;
+        }
+        const char *line_end = nl != NULL ? nl : data + cs.end;
+
+        /** 1行の解析 **/
+        if (Parse_line(data + cs.begin, line_end, row.data(), cs.cols, 1) == cs.cols)
+        {
+            times[count] = row[0];
+            for (int c = 0; c < channels; c++)
+            {
+                rows[count * channels + c] = row[c + 1];
+            }
+            count++;
+        }
+        else if (line_end > data + cs.begin)
+        {
+            cs.skipped++; // 書き込み途中で壊れた行
+        }
+        cs.begin = nl != NULL ? nl - data + 1 : cs.end;
+    }
+    return count;
+}
@@ -0,0 +1,179 @@
+/**************************************************************/
+// Program name : Resample
+// Author       : Masatsugu Kitadai
+// Date         : 2023/10/23
+// Description  : MPU6050 ロガーの CSV を等間隔の時刻列へ補間
+//
+//   ./out/Resample.out <入力 CSV> <出力 CSV> [出力周波数 [Hz]] [linear|cubic|polyphase] [入力の公称周波数 [Hz]] [-fill]
+//     入力の公称周波数を省略した場合は先頭 probe 行の時刻列の間隔の中央値から求める (millis() のロガーは 20 [ms] 指定でも実測は約 31 [ms])
+//     出力周波数を省略または 0 とした場合は入力の公称周波数で出力する
+//     欠測 (dropped) は公称間隔の 1.5 倍を超える間隔から数え、欠測区間には出力しない (-fill の場合のみ補間で埋める)
+//     入力は1行ずつ読みながら補間して書き出すため、ファイルの大きさはメモリに依存しない
+//     時刻 [ms] は double で扱う (float では約 4.7 時間を超えると 1 [ms] を区別できない)
+/**************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+#include "../../common/data_reader.h"
+#include "../../common/resample.h"
+#include "../../common/metrics.h"
+using namespace std;
+
+/** パラメータ **/
+const int channels = 6;     // チャンネル数 (rax, ray, raz, rgx, rgy, rgz) [-]
+const size_t probe = 4096;  // 公称周波数の推定に使う先頭の行数 [-]
+const int line_size = 4096; // 1行の最大長 [byte]
+
+/**************************************************************/
+// Function name : main
+// Description   : メインプログラム
+/**************************************************************/
+int main(int argc, char *argv[])
+{
+    /** 引数の読み取り (-fill は位置によらない) **/
+    const char *args[5] = {NULL, NULL, NULL, NULL, NULL};
+    int n_args = 0;
+    bool fill_gaps = false;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-fill") == 0)
+        {
+            fill_gaps = true;
+        }
+        else if (n_args < 5)
+        {
+            args[n_args++] = argv[i];
+        }
+    }
+    if (n_args < 2)
+    {
+        printf("usage: %s <input.csv> <output.csv> [hz] [linear|cubic|polyphase] [hz_in] [-fill]\n", argv[0]);
+        return 1;
+    }
+    const char *readfile = args[0];
+    const char *writefile = args[1];
+    double hz = n_args >= 3 ? atof(args[2]) : 0;    // 出力周波数 [Hz]
+    double hz_in = n_args >= 5 ? atof(args[4]) : 0; // 入力の公称周波数 [Hz]
+
+    Resample_method method = resample_cubic;
+    if (n_args >= 4)
+    {
+        if (strcmp(args[3], "linear") == 0)
+        {
+            method = resample_linear;
+        }
+        else if (strcmp(args[3], "polyphase") == 0)
+        {
+            method = resample_polyphase;
+        }
+    }
+
+    Metrics_start("Resample");
+
+    FILE *in = fopen(readfile, "r");
+    if (in == NULL)
+    {
+        printf("Cannot open: %s\n", readfile);
+        return 1;
+    }
+
+    /** 1行の読み込み (ヘッダ行・書き込み途中で壊れた行は読み飛ばす) **/
+    char line[line_size];
+    double row[channels + 1]; // 時刻 [ms] + 各チャンネル
+    long skipped = 0;         // 読み飛ばした壊れた行数 [-]
+    auto read_row = [&]()
+    {
+        while (fgets(line, sizeof(line), in) != NULL)
+        {
+            const size_t cols = Parse_line(line, line + strlen(line), row, channels + 1, 1);
+            if (cols == channels + 1)
+            {
+                return true;
+            }
+            skipped += cols > 0 ? 1 : 0; // 先頭列が数値でない行 (ヘッダ) は数えない
+        }
+        return false;
+    };
+
+    /** 先頭 probe 行の先読みと入力の公称周波数 (時刻は [ms]) **/
+    Metrics_timer timer_read("read");
+    vector<double> head; // 先読みした行 (行優先)
+    while (head.size() < probe * (channels + 1) && read_row())
+    {
+        head.insert(head.end(), row, row + channels + 1);
+    }
+    timer_read.Stop();
+    const size_t head_rows = head.size() / (channels + 1);
+    if (hz_in <= 0)
+    {
+        vector<double> t_head(head_rows);
+        for (size_t i = 0; i < head_rows; i++)
+        {
+            t_head[i] = head[i * (channels + 1)];
+        }
+        const double dt_in = Resample_nominal_interval(t_head.data(), head_rows);
+        if (dt_in <= 0)
+        {
+            printf("%s: cannot estimate the sampling interval\n", readfile);
+            return 1;
+        }
+        hz_in = 1000.0 / dt_in;
+    }
+    if (hz <= 0)
+    {
+        hz = hz_in;
+    }
+
+    FILE *fp = fopen(writefile, "w");
+    if (fp == NULL)
+    {
+        printf("Cannot open: %s\n", writefile);
+        return 1;
+    }
+    fprintf(fp, "Time,rax,ray,raz,rgx,rgy,rgz\n");
+
+    /** 補間 (時刻は [ms] のまま扱う, 読み込み・書き出しを含む) **/
+    Metrics_timer timer_compute("compute");
+    Resampler rs;
+    Resampler_init(rs, channels, hz / 1000.0, method, hz_in / 1000.0);
+    rs.fill_gaps = fill_gaps;
+
+    auto output = [&](double t, const float *v)
+    {
+        fprintf(fp, "%.3f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f\n", t, v[0], v[1], v[2], v[3], v[4], v[5]);
+    };
+    float values[channels];
+    auto push = [&](const double *r)
+    {
+        for (int c = 0; c < channels; c++)
+        {
+            values[c] = r[c + 1];
+        }
+        Resampler_push(rs, r[0], values, output);
+    };
+
+    for (size_t i = 0; i < head_rows; i++)
+    {
+        push(&head[i * (channels + 1)]);
+    }
+    while (read_row())
+    {
+        push(row);
+    }
+    Resampler_flush(rs, output);
+    fclose(in);
+    timer_compute.Stop();
+    Metrics_add("samples", rs.stats.input);
+    Metrics_fclose(fp);
+
+    /** 入力の異常の報告 **/
+    const Resample_stats &st = rs.stats;
+    printf("input = %ld (%.3f [Hz], %.1f [ms])\toutput = %ld (%.3f [Hz])\tskipped = %ld\n", st.input, hz_in, 1000.0 / hz_in, st.output, hz, skipped);
+    printf("duplicated = %ld\treversed = %ld\tdropped = %ld (%ld gaps)\tfilled = %ld (%s)\n", st.duplicated, st.reversed, st.dropped, st.gaps, st.filled,
+           fill_gaps ? "-fill" : "gaps are left empty");
+
+    return 0;
+}
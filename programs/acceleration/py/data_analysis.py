@@ -1,7 +1,14 @@
 import pandas as pd
+import numpy as np
 import os
 import matplotlib.pyplot as plt
 
+# C++ の計算モジュール (cmake -DGRANDELFINO_PYTHON=ON でビルドし PYTHONPATH に追加), 無い場合は pandas で計算
+try:
+    import grandelfino
+except ImportError:
+    grandelfino = None
+
 
 def extract_columns_to_arrays_updated(df, convert_time_to_seconds=True):
     if convert_time_to_seconds and "Time" in df.columns:
@@ -12,11 +19,20 @@ def extract_columns_to_arrays_updated(df, convert_time_to_seconds=True):
     return arrays
 
 
+def column_to_float64(data, col):
+    # C++ の計算モジュールへコピーせずに渡せる float64 の連続した配列
+    return np.ascontiguousarray(data[col].to_numpy(dtype=np.float64))
+
+
 def compute_moving_averages(data, window_size=5):
     columns_to_average = [col for col in data.columns if col != "Time"]
     moving_averages = {}
     for col in columns_to_average:
-        moving_averages[col] = data[col].rolling(window=window_size).mean()
+        if grandelfino is not None:
+            values = grandelfino.moving_average(column_to_float64(data, col), window_size)
+            moving_averages[col] = pd.Series(np.asarray(values), index=data.index)
+        else:
+            moving_averages[col] = data[col].rolling(window=window_size).mean()
     return moving_averages
 
 
@@ -24,7 +40,11 @@ def compute_exponential_moving_averages(data, span=5):
     columns_to_average = [col for col in data.columns if col != "Time"]
     ema_data = {}
     for col in columns_to_average:
-        ema_data[col] = data[col].ewm(span=span, adjust=False).mean()
+        if grandelfino is not None:
+            values = grandelfino.ema(column_to_float64(data, col), span)
+            ema_data[col] = pd.Series(np.asarray(values), index=data.index)
+        else:
+            ema_data[col] = data[col].ewm(span=span, adjust=False).mean()
     return ema_data
 
 
@@ -0,0 +1,15 @@
+# 翼型処理プログラムのコンパイル
+mkdir -p out
+g++ -O2 -std=c++17 -pthread cpp/airfoil_size.cpp -o "out/airfoil_size.out"
+g++ -O2 -std=c++17 -pthread cpp/panel_method.cpp -o "out/panel_method.out"
+
+# airfoil/ の全翼型の翼厚・キャンバーの計算と、コサイン間隔 (上下面 80 分割) への再配置
+mkdir -p resampled
+./out/airfoil_size.out airfoil -n 80 -o resampled | tee resampled/summary.txt
+
+# パネル法による airfoil/ の全翼型の揚力曲線・圧力分布 (迎角 -4 ~ 12 [deg], 1 [deg] 刻み)
+mkdir -p polar
+./out/panel_method.out airfoil -n 80 -a -4 12 1 -o polar > polar/polar.txt
+
+# 翼弦長 0.3 [m]・迎角 5 [deg] の座標の作成
+# ./out/airfoil_size.out airfoil/naca2412.dat -c 0.3 -a 5 -o scaled
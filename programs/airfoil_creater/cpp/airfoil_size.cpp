@@ -1,225 +1,183 @@
 /**************************************************************/
-// Program name : Estimate_position
+// Program name : Airfoil_size
 // Author       : Masatsugu Kitadai
 // Date         : 2023/4/23
-// Description  :
+// Description  : 翼型座標ファイル (Selig / Lednicer 形式) の正規化・再配置と翼厚・キャンバーの計算
+//
+//   ./out/airfoil_size.out <座標ファイル・ディレクトリ・データ名>... [-n 分割数] [-c 翼弦長 [m]] [-a 迎角 [deg]] [-o 出力ディレクトリ] [-j 並列数]
+//     データ名のみの場合は airfoil/<データ名>.dat を読み込む
+//     ディレクトリの場合は中の全ての .dat を並列に処理する
+//     -o を指定した場合は、上下面 n+1 点 (コサイン間隔) に再配置し、翼弦長・迎角を適用した座標を <出力ディレクトリ>/<ファイル名>.dat へ書き出す
 /**************************************************************/
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 #include <sys/stat.h>
+#include <string>
 #include <vector>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <filesystem>
+#include "../../common/airfoil.h"
+#include "../../common/metrics.h"
 using namespace std;
-FILE *fp;
 mode_t dir_mode = S_IRUSR | S_IWUSR | S_IXUSR | S_IRGRP | S_IWGRP | S_IXGRP | S_IROTH | S_IXOTH | S_IXOTH;
 
 /** パラメータ **/
-const float hz_gps = 2.0; // サンプリング周期 [Hz]
+int n_panel = 80;       // 上下面それぞれの分割数 [-]
+double chord = 1.0;     // 出力の翼弦長 [m]
+double angle = 0.0;     // 出力の迎角 [deg]
+const char *dir = NULL; // 出力ディレクトリ (NULL の場合は書き出さない)
 
-/** 変数宣言 **/
-vector<float> x; // x方向位置 [m]
-vector<float> y; // y方向位置 [m]
+/** 処理結果 **/
+struct Result
+{
+    string path;          // 座標ファイル
+    string name;          // 翼型名
+    size_t points = 0;    // 読み込んだ点数 [-]
+    Airfoil_geometry geo; // 翼厚・キャンバー
+    bool ok = false;      // 処理の成否
+};
 
 /** プロトタイプ宣言 **/
-int Estimate_position();
-void Moving_Average(vector<float> &data);
-void Write_data(int num);
-void Gnuplot(int n);
+void Airfoil_size(Result &result);
 
 /**************************************************************/
 // Function name : main
 // Description   : メイン
 /**************************************************************/
-int main()
+int main(int argc, char *argv[])
 {
-    /** ディレクトリの作成 **/
-    const char dir_0[] = "Estimate_position_GPS";
-    const char dir_1[] = "Estimate_position_GPS/position";
-    const char dir_2[] = "Estimate_position_GPS/route";
-    const char dir_3[] = "Estimate_position_GPS/graph";
-
-    mkdir(dir_0, dir_mode);
-    mkdir(dir_1, dir_mode);
-    mkdir(dir_2, dir_mode);
-    mkdir(dir_3, dir_mode);
-
-    int data_length = Estimate_position();
-
-    for (int i = 0; i < data_length; i++)
+    /** 引数の読み取り **/
+    int workers = thread::hardware_concurrency();
+    vector<string> sources;
+    for (int i = 1; i < argc; i++)
     {
-        Write_data(i);
-        if (i % 10 == 0)
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+        {
+            n_panel = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc)
+        {
+            chord = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-a") == 0 && i + 1 < argc)
         {
-            Gnuplot(i);
+            angle = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+        {
+            dir = argv[++i];
+        }
+        else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+        {
+            workers = atoi(argv[++i]);
+        }
+        else
+        {
+            sources.push_back(argv[i]);
         }
     }
 
-    return 0;
-}
-
-/**************************************************************/
-// Function name : Estimate_position
-// Description   : 自己位置推定
-/**************************************************************/
-int Estimate_position()
-{
-    /** データ名の読み取り **/
-    string name_str;
-    cout << "Data Name:";
-    cin >> name_str;
-    const char *name = name_str.c_str();
-
-    /** 変数設定 **/
-    vector<float> t;         // 時刻 [s]
-    vector<float> longitude; // 経度情報 [m]
-    vector<float> latitude;  // 緯度情報 [m]
-
-    float tmp[8];    // 一時保存用バッファ [-]
-    int data_length; // データの長さ [-]
-
-    /** ファイルの読み込み **/
-    char filename[] = "Simulation/data/data.dat";
-    fp = fopen(filename, "r");
-    while ((fscanf(fp, "%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f", &tmp[0], &tmp[1], &tmp[2], &tmp[3], &tmp[4], &tmp[5], &tmp[6], &tmp[7], &tmp[8])) != EOF)
+    /** データ名の読み取り (引数がない場合は入力) **/
+    if (sources.empty())
     {
-        if (tmp[0] % == 0)
+        char name[100];
+        printf("Data Name:");
+        if (scanf("%99s", name) != 1)
         {
-            t.push_back(tmp[0]);
-            longitude.push_back(tmp[7]);
-            latitude.push_back(tmp[8]);
+            return 1;
         }
-
-        data_length += 1;
+        sources.push_back(name);
     }
-    fclose(fp);
-
-    /** 配列のサイズ変更 **/
-    x.resize(data_length);
-    y.resize(data_length);
-
-    /** 位置の積算 **/
-    const float dt = 1.0 / hz_gps; // サンプリング間隔 [s]
-    float u = 0;                   // x方向車両速度 [m/s]
-    float v = 0;                   // y方向車両速度 [m/s]
-    float theta = 0;               // 車両の角度 [rad]
-    float x_tmp = 0;
-    float y_tmp = 0;
-
-    for (int i = 0; i < data_length; i++)
+    if (n_panel < 4)
     {
-        /** 速度・角度の積算 **/
-        theta += omega_z[i] * dt;
-
-        u += -1.0 * (acc_x[i] * sin(theta) + acc_y[i] * cos(theta)) * dt; // 絶対座標系のx方向速度 [m/s]
-        v += -1.0 * (acc_x[i] * cos(theta) + acc_y[i] * sin(theta)) * dt; // 絶対座標系のy方向速度 [m/s]
-
-        /** 速度・角度の積算 **/
-        x[i] = x_tmp + u * dt;
-        y[i] = y_tmp + v * dt;
-
-        x_tmp = x[i]; // 積算したx方向位置 [m]
-        y_tmp = y[i]; // 積算したy方向位置 [m]
+        printf("-n must be >= 4\n");
+        return 1;
     }
 
-    return data_length;
-}
+    Metrics_start("Airfoil_size");
 
-/**************************************************************/
-// Function name : Moving_Average
-// Description   : 移動平均値を計算
-/**************************************************************/
-void Moving_Average(vector<float> &data)
-{
-    const int n = 5.0;              // 移動平均で使用するデータ数
-    vector<float> ave(data.size()); // 移動平均値用の配列
+    /** 座標ファイルの一覧 **/
+    vector<Result> results;
+    for (const string &path : Airfoil_files(sources))
+    {
+        results.push_back(Result());
+        results.back().path = path;
+    }
+    if (dir != NULL)
+    {
+        mkdir(dir, dir_mode);
+    }
 
-    /** 移動平均の計算 **/
-    for (int i = n / 2.0; i < data.size() - n / 2.0; i++)
-        for (int j = i - n / 2.0; j <= i + n / 2.0; j++)
+    /** 並列処理 (ファイル単位で割り当て) **/
+    Metrics_timer timer_compute("compute");
+    atomic<size_t> next(0);
+    auto worker = [&]()
+    {
+        size_t i;
+        while ((i = next++) < results.size())
         {
-            ave[i] += data[j]; // 合計値の計算
+            Airfoil_size(results[i]);
         }
-
-    /** 算出値の代入 **/
-    for (int i = n / 2.0; i < data.size() - n / 2.0; i++)
+    };
+    vector<thread> threads;
+    for (int k = 0; k < max(1, min(workers, (int)results.size())); k++)
     {
-        data[i] = float(ave[i] / n + 1);
+        threads.emplace_back(worker);
     }
-}
-
-/**************************************************************/
-// Function name : Write_data
-// Description   : 車両の位置を計算
-/**************************************************************/
-void Write_data(int n)
-{
-    const float t = n / hz_gps;
-
-    /** 走行位置の書き出し **/
-    char filename[100];
-    sprintf(filename, "Estimate_position_GPS/position/%d.dat", n);
-    fp = fopen(filename, "w");
-    fprintf(fp, "%f\t%f\t%f\n", t, x[n], y[n]);
-    fclose(fp);
+    for (thread &th : threads)
+    {
+        th.join();
+    }
+    timer_compute.Stop();
+    Metrics_add("profiles", results.size());
 
-    /** 走行経路の書き出し **/
-    sprintf(filename, "Estimate_position_GPS/route/%d.dat", n);
-    fp = fopen(filename, "w");
-    for (int i = 0; i <= n; i++)
+    /** 結果の表示 **/
+    int failed = 0;
+    printf("# file\tname\tpoints\tthickness[%%]\tx_thickness[-]\tcamber[%%]\tx_camber[-]\tte_gap[%%]\n");
+    for (const Result &result : results)
     {
-        float t_tmp = i / hz_gps;
-        fprintf(fp, "%f\t%f\t%f\n", t_tmp, x[i], y[i]);
+        if (!result.ok)
+        {
+            failed++;
+            continue;
+        }
+        printf("%s\t%s\t%ld\t%.3f\t%.4f\t%.3f\t%.4f\t%.3f\n", result.path.c_str(), result.name.c_str(), (long)result.points,
+               result.geo.thickness * 100.0, result.geo.x_thickness, result.geo.camber * 100.0, result.geo.x_camber, result.geo.te_gap * 100.0);
     }
-    fclose(fp);
+
+    return failed == 0 ? 0 : 1;
 }
 
 /**************************************************************/
-// Function name : Gnuplot
-// Description  :
+// Function name : Airfoil_size
+// Description   : 1ファイルの読み込み・正規化・再配置・形状の計算
 /**************************************************************/
-void Gnuplot(int n)
+void Airfoil_size(Result &result)
 {
-    FILE *gp;
-
-    /** Gnuplot 初期設定 **/
-    const float t = n / hz_gps;
-    const float x_max = 20.0;
-    const float x_min = -20.0;
-    const float y_max = 25.0;
-    const float y_min = -5.0;
-
-    /** Gnuplot ファイル名の設定 **/
-    char graphname[100], filename_1[100], filename_2[100];
-    sprintf(filename_1, "Estimate_position_GPS/position/%d.dat", n);
-    sprintf(filename_2, "Estimate_position_GPS/route/%d.dat", n);
-    sprintf(graphname, "Estimate_position_GPS/graph/%04d.png", n);
-
-    /** Gnuplot 呼び出し **/
-    if ((gp = popen("gnuplot", "w")) == NULL)
+    Airfoil af;
+    if (!Airfoil_load(result.path.c_str(), af))
     {
-        printf("gnuplot is not here!\n");
-        exit(0); // gnuplotが無い場合、異常ある場合は終了
+        return;
     }
+    result.name = af.name;
+    result.points = af.x.size();
 
-    /** Gnuplot 描画設定 **/
-    fprintf(gp, "set terminal png size 800, 600 font 'Times New Roman, 16'\n");
-    fprintf(gp, "set size ratio -1\n");
-    fprintf(gp, "set output '%s'\n", graphname);                                             // 出力ファイル
-    fprintf(gp, "unset key\n");                                                              // 凡例非表示
-    fprintf(gp, "set xrange [%.3f:%.3f]\n", x_min, x_max);                                   // x軸の描画範囲
-    fprintf(gp, "set yrange [%.3f:%.3f]\n", y_min, y_max);                                   // y軸の描画範囲
-    fprintf(gp, "set title 'Estimated Position + MA : {/Times-Italic t} = %1.3f [s]'\n", t); // グラフタイトル
-    fprintf(gp, "set xlabel '{/Times-Italic x} [m]' offset 0.0, 0.0\n");                     // x軸のラベル
-    fprintf(gp, "set ylabel '{/Times-Italic y} [m]' offset 1.0, 0.0\n");                     // y軸のラベル
-    fprintf(gp, "set xtics 5.0 offset 0.0, 0.0\n");                                          // x軸の間隔
-    fprintf(gp, "set ytics 5.0 offset 0.0, 0.0\n");                                          // y軸の間隔
-
-    /** Gnuplot 書き出し **/
-    fprintf(gp, "plot '%s' using 2:3 with lines lc 'grey50' notitle, '%s' using 2:3 with points lc 'red' ps 3 pt 7 notitle\n", filename_2, filename_1);
+    /** 正規化・コサイン間隔への再配置 **/
+    Airfoil_normalize(af);
+    Airfoil resampled = Airfoil_resample(af, n_panel);
+    result.geo = Airfoil_measure(resampled);
+    result.ok = true;
 
-    /** Gnuplot 終了 **/
-    fflush(gp);            // Clean up Data
-    fprintf(gp, "exit\n"); // Quit gnuplot
-    pclose(gp);
-}
\ No newline at end of file
+    /** 翼弦長・迎角を適用して書き出し **/
+    if (dir != NULL)
+    {
+        Airfoil_transform(resampled, chord, angle);
+        const string filename = string(dir) + "/" + filesystem::path(result.path).filename().string();
+        result.ok = Airfoil_write(filename.c_str(), resampled);
+    }
+}
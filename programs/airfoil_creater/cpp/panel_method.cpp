@@ -0,0 +1,256 @@
+/**************************************************************/
+// Program name : Panel_method
+// Author       : Masatsugu Kitadai
+// Date         : 2023/4/30
+// Description  : 線形分布渦パネル法による翼型の揚力係数・モーメント係数・圧力分布の一括計算 (風洞試験前の翼型の絞り込み)
+//
+//   ./out/panel_method.out <座標ファイル・ディレクトリ・データ名>... [-n 分割数] [-a 最小迎角 最大迎角 刻み [deg]] [-o 出力ディレクトリ] [-j 並列数]
+//     座標ファイルの指定は airfoil_size と同じ (ディレクトリの場合は中の全ての .dat)
+//     翼型ごとに上下面 n 分割 (コサイン間隔) に再配置し、影響係数行列の LU 分解を1回だけ行って全迎角を解く
+//     標準出力に各翼型・迎角の Cl・Cm を出力する
+//     -o を指定した場合は <出力ディレクトリ>/<ファイル名>_polar.dat (迎角, Cl, Cm) と
+//     <出力ディレクトリ>/<ファイル名>_cp.dat (迎角ごとのブロック : x, y, Cp) を書き出す
+/**************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <sys/stat.h>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <filesystem>
+#include "../../common/airfoil.h"
+#include "../../common/panel_method.h"
+#include "../../common/metrics.h"
+using namespace std;
+mode_t dir_mode = S_IRUSR | S_IWUSR | S_IXUSR | S_IRGRP | S_IWGRP | S_IXGRP | S_IROTH | S_IXOTH | S_IXOTH;
+
+/** パラメータ **/
+int n_panel = 80;       // 上下面それぞれの分割数 [-]
+double alpha_min = -4;  // 最小迎角 [deg]
+double alpha_max = 12;  // 最大迎角 [deg]
+double alpha_step = 1;  // 迎角の刻み [deg]
+const char *dir = NULL; // 出力ディレクトリ (NULL の場合は書き出さない)
+
+/** 処理結果 **/
+struct Result
+{
+    string path;                // 座標ファイル
+    string name;                // 翼型名
+    vector<Panel_result> polar; // 迎角ごとの解
+    bool ok = false;            // 処理の成否
+};
+
+/** プロトタイプ宣言 **/
+void Panel_method(Result &result, const vector<double> &alphas);
+bool Write_result(const Result &result, const Panel_solver &ps);
+
+/**************************************************************/
+// Function name : main
+// Description   : メイン
+/**************************************************************/
+int main(int argc, char *argv[])
+{
+    /** 引数の読み取り **/
+    int workers = thread::hardware_concurrency();
+    vector<string> sources;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+        {
+            n_panel = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-a") == 0 && i + 3 < argc)
+        {
+            alpha_min = atof(argv[++i]);
+            alpha_max = atof(argv[++i]);
+            alpha_step = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+        {
+            dir = argv[++i];
+        }
+        else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+        {
+            workers = atoi(argv[++i]);
+        }
+        else
+        {
+            sources.push_back(argv[i]);
+        }
+    }
+
+    /** データ名の読み取り (引数がない場合は入力) **/
+    if (sources.empty())
+    {
+        char name[100];
+        printf("Data Name:");
+        if (scanf("%99s", name) != 1)
+        {
+            return 1;
+        }
+        sources.push_back(name);
+    }
+    if (n_panel < 4)
+    {
+        printf("-n must be >= 4\n");
+        return 1;
+    }
+    if (alpha_step <= 0 || alpha_max < alpha_min)
+    {
+        printf("-a must be min <= max and step > 0\n");
+        return 1;
+    }
+
+    Metrics_start("Panel_method");
+
+    /** 迎角の一覧 **/
+    vector<double> alphas;
+    for (int k = 0; alpha_min + k * alpha_step <= alpha_max + 1e-9; k++)
+    {
+        alphas.push_back(alpha_min + k * alpha_step);
+    }
+
+    /** 座標ファイルの一覧 **/
+    vector<Result> results;
+    for (const string &path : Airfoil_files(sources))
+    {
+        results.push_back(Result());
+        results.back().path = path;
+    }
+    if (dir != NULL)
+    {
+        mkdir(dir, dir_mode);
+    }
+
+    /** 並列処理 (翼型単位で割り当て, 迎角は同じ分解を再利用するため同一スレッドで解く) **/
+    const double time_start = Metrics_time();
+    Metrics_timer timer_compute("compute");
+    atomic<size_t> next(0);
+    auto worker = [&]()
+    {
+        size_t i;
+        while ((i = next++) < results.size())
+        {
+            Panel_method(results[i], alphas);
+        }
+    };
+    vector<thread> threads;
+    for (int k = 0; k < max(1, min(workers, (int)results.size())); k++)
+    {
+        threads.emplace_back(worker);
+    }
+    for (thread &th : threads)
+    {
+        th.join();
+    }
+    timer_compute.Stop();
+    const double time_compute = Metrics_time() - time_start;
+    Metrics_add("profiles", results.size());
+    Metrics_add("solutions", results.size() * alphas.size());
+
+    /** 結果の表示 **/
+    int failed = 0;
+    printf("# file\tname\talpha[deg]\tcl[-]\tcm[-]\n");
+    for (const Result &result : results)
+    {
+        if (!result.ok)
+        {
+            failed++;
+            printf("# %s : failed\n", result.path.c_str());
+            continue;
+        }
+        for (const Panel_result &solution : result.polar)
+        {
+            printf("%s\t%s\t%.2f\t%.4f\t%.4f\n", result.path.c_str(), result.name.c_str(), solution.alpha, solution.cl, solution.cm);
+        }
+    }
+    fprintf(stderr, "%ld airfoils x %ld angles (%d panels) : %.3f [s]\n", (long)results.size(), (long)alphas.size(), 2 * n_panel, time_compute);
+
+    return failed == 0 ? 0 : 1;
+}
+
+/**************************************************************/
+// Function name : Panel_method
+// Description   : 1翼型の読み込み・再配置・影響係数行列の分解と全迎角の求解
+/**************************************************************/
+void Panel_method(Result &result, const vector<double> &alphas)
+{
+    Airfoil af;
+    if (!Airfoil_load(result.path.c_str(), af))
+    {
+        return;
+    }
+    result.name = af.name;
+    Airfoil_normalize(af);
+    const Airfoil resampled = Airfoil_resample(af, n_panel);
+
+    /** 影響係数行列の分解 (翼型ごとに1回) **/
+    Panel_solver ps;
+    if (!Panel_init(ps, resampled))
+    {
+        return;
+    }
+
+    /** 迎角ごとの求解 (前進・後退代入のみ) **/
+    result.polar.resize(alphas.size());
+    for (size_t k = 0; k < alphas.size(); k++)
+    {
+        Panel_solve(ps, alphas[k], result.polar[k]);
+    }
+    result.ok = true;
+
+    /** 書き出し (書き出さない場合は Cp を保持しない) **/
+    if (dir != NULL)
+    {
+        result.ok = Write_result(result, ps);
+    }
+    for (Panel_result &solution : result.polar)
+    {
+        vector<double>().swap(solution.cp);
+    }
+}
+
+/**************************************************************/
+// Function name : Write_result
+// Description   : 揚力曲線と圧力分布の書き出し
+/**************************************************************/
+bool Write_result(const Result &result, const Panel_solver &ps)
+{
+    const string stem = string(dir) + "/" + filesystem::path(result.path).stem().string();
+
+    /** 揚力曲線 **/
+    FILE *fp = fopen((stem + "_polar.dat").c_str(), "w");
+    if (fp == NULL)
+    {
+        return false;
+    }
+    fprintf(fp, "# %s\n# alpha[deg]\tcl[-]\tcm[-]\n", result.name.c_str());
+    for (const Panel_result &solution : result.polar)
+    {
+        fprintf(fp, "%.2f\t%.6f\t%.6f\n", solution.alpha, solution.cl, solution.cm);
+    }
+    fclose(fp);
+
+    /** 圧力分布 (gnuplot の index で迎角を選択できるよう 2 行の空行で区切る) **/
+    fp = fopen((stem + "_cp.dat").c_str(), "w");
+    if (fp == NULL)
+    {
+        return false;
+    }
+    for (const Panel_result &solution : result.polar)
+    {
+        fprintf(fp, "# alpha = %.2f [deg]\n# x[-]\ty[-]\tcp[-]\n", solution.alpha);
+        for (int i = 0; i < ps.n; i++)
+        {
+            fprintf(fp, "%.6f\t%.6f\t%.6f\n", ps.xm[i], ps.ym[i], solution.cp[i]);
+        }
+        fprintf(fp, "\n\n");
+    }
+    fclose(fp);
+    return true;
+}
@@ -0,0 +1,140 @@
+#!/bin/bash
+#**************************************************************#
+# File name   : bench.sh
+# Author      : Masatsugu Kitadai
+# Description : ビルド構成ごとの実行時間の比較
+#
+#   ./bench.sh                   release / native / lto / pgo をすべて計測
+#   ./bench.sh release lto       指定した構成のみ
+#
+#   BENCH_REPEAT=5               繰り返し回数 (最小値を採用, 既定 3)
+#   BENCH_PLOT=1                 gnuplot の描画も計測に含める (既定は描画を省略)
+#**************************************************************#
+
+set -e
+cd "$(dirname "$0")"
+root=$(pwd)
+bench=$root/_bench
+configs=${*:-release native lto pgo}
+repeat=${BENCH_REPEAT:-3}
+
+# 計測するプログラム (ディレクトリ:プログラム名:引数) | 上から順に実行 (前の出力を次の入力に使用、引数は作業ディレクトリで展開)
+# 乱数を使うプログラムは種を固定して構成間で同じデータを計測し、Simulation_track は Simulation/ を上書きするため最後に実行
+workloads=(
+    "estimate_position:Simulation:-seed 1"
+    "estimate_position:Estimate_position:"
+    "estimate_position:Estimate_position_IMU:"
+    "estimate_position:Estimate_position_GPS:"
+    "estimate_position:Estimate_position_IMU+GPS:"
+    "estimate_position:Estimate_position_stream:Simulation/data/data.dat"
+    "estimate_position:RMSE:"
+    'estimate_position:Lap_timing:Simulation/route/$(ls Simulation/route | sort -n | tail -1) -1.0 11.111 1.0 11.111 1.0 result/laps.dat'
+    "acceleration:Resample:data/data.csv result/data_resampled.csv"
+    "acceleration:Allan_deviation:data/data.csv -o result/allan.dat"
+    "gnss_data:GNSS_position:"
+    "measurement_DF:DFT:"
+    "measurement_DF:bandpass_filter:"
+    "measurement_DF:IDFT:"
+    "noise_removal_with_FT:noise_simulation:-seed 1"
+    "noise_removal_with_FT:DFT:"
+    "noise_removal_with_FT:bandpass_filter:"
+    "noise_removal_with_FT:IDFT:"
+    "sensor_log:Convert_log:sim ../estimate_position/Simulation/data/data.dat data/simulation.slog"
+    "airfoil_creater:airfoil_size:airfoil -n 80 -o result"
+    "airfoil_creater:panel_method:airfoil -n 80 -a -4 12 1 -o result"
+    "FW:average:-r data/range.csv -d sheets -o result/result.csv"
+    "estimate_position:Simulation_track:track/oval.txt -seed 1"
+)
+
+#** 構成ごとの CMake オプション **#
+options() {
+    case $1 in
+    release) echo "" ;;
+    native) echo "-DGRANDELFINO_NATIVE=ON" ;;
+    lto) echo "-DGRANDELFINO_LTO=ON" ;;
+    pgo) echo "-DGRANDELFINO_NATIVE=ON -DGRANDELFINO_LTO=ON" ;;
+    *)
+        echo "Unknown configuration: $1" >&2
+        exit 1
+        ;;
+    esac
+}
+
+#** ビルド **#
+build() {
+    cmake -S "$root" -B "$bench/build/$1" -DCMAKE_BUILD_TYPE=Release $(options $1) "${@:2}" >/dev/null
+    cmake --build "$bench/build/$1" -j"$(nproc)" >/dev/null
+}
+
+#** 入力データを複製した作業ディレクトリで全プログラムを実行 (結果は $2/<ディレクトリ>.<プログラム名>.json) **#
+run() {
+    local work=$bench/work
+    rm -rf "$work"
+    mkdir -p "$work" "$2"
+    for area in estimate_position acceleration gnss_data measurement_DF noise_removal_with_FT sensor_log airfoil_creater FW; do
+        mkdir -p "$work/$area/result" "$work/$area/data"
+        for input in data GNSS_data track airfoil sheets; do
+            if [ -d "$root/$area/$input" ]; then
+                cp -r "$root/$area/$input" "$work/$area/"
+            fi
+        done
+    done
+
+    for workload in "${workloads[@]}"; do
+        IFS=: read -r area name args <<<"$workload"
+        local program=$bench/build/$1/$area/out/$name.out json=$2/$area.$name.json
+        (cd "$work/$area" && eval "set -- $args" && METRICS_JSON="$json" "$program" "$@" >/dev/null 2>&1 </dev/null) ||
+            echo "Failed: $1 $area/$name" >&2
+    done
+}
+
+#** 描画の省略 (何もしない gnuplot を PATH の先頭に置く) **#
+if [ "$BENCH_PLOT" != "1" ]; then
+    mkdir -p "$bench/bin"
+    printf '#!/bin/sh\ncat >/dev/null\n' >"$bench/bin/gnuplot"
+    chmod +x "$bench/bin/gnuplot"
+    export PATH=$bench/bin:$PATH
+fi
+
+#** 計測 **#
+rm -rf "$bench/result"
+for config in $configs; do
+    echo "Building: $config" >&2
+    if [ "$config" = "pgo" ]; then
+        # 計測用ビルドで1回実行してから、同じビルドディレクトリでプロファイルを使って再ビルド
+        rm -rf "$bench/build/pgo"
+        build pgo -DGRANDELFINO_PGO=GENERATE -DGRANDELFINO_PGO_DIR="$bench/build/pgo/profile"
+        run pgo "$bench/result/training"
+        if command -v llvm-profdata >/dev/null && ls "$bench/build/pgo/profile"/*.profraw >/dev/null 2>&1; then
+            llvm-profdata merge -o "$bench/build/pgo/profile/default.profdata" "$bench/build/pgo/profile"/*.profraw
+        fi
+        build pgo -DGRANDELFINO_PGO=USE
+    else
+        build $config
+    fi
+
+    echo "Running: $config" >&2
+    for i in $(seq $repeat); do
+        run $config "$bench/result/$config/$i"
+    done
+done
+
+#** 結果の表示 (各プログラムの経過時間の最小値 [s]) **#
+elapsed() {
+    sed -n 's/.*"elapsed": \([0-9.]*\).*/\1/p' "$bench/result/$1"/*/"$2.json" 2>/dev/null | sort -g | head -1
+}
+
+printf "%-44s" "program"
+for config in $configs; do
+    printf "%12s" "$config"
+done
+printf "\n"
+for workload in "${workloads[@]}"; do
+    IFS=: read -r area name args <<<"$workload"
+    printf "%-44s" "$area/$name"
+    for config in $configs; do
+        value=$(elapsed $config $area.$name)
+        printf "%12s" "${value:--}"
+    done
+    printf "\n"
+done
@@ -0,0 +1,460 @@
+/**************************************************************/
+// File name   : airfoil.h
+// Author      : Masatsugu Kitadai
+// Description : 翼型座標の読み込み・正規化・再配置と翼厚・キャンバーの計算
+//
+//   座標ファイル (.dat) は次の2形式に対応し、読み込み後はどちらも Selig 形式の点列 (後縁 → 上面 → 前縁 → 下面 → 後縁) とする
+//     Selig    : 1行目が翼型名、以降が後縁から上面・下面を一周する x y
+//     Lednicer : 1行目が翼型名、2行目が上面・下面の点数、以降が前縁から後縁への上面・下面 (空行区切り)
+//   前縁は後縁中点から最も遠い点 (3次スプライン上で探索) とし、正規化では前縁を原点・後縁中点を (1, 0) へ移す
+//   再配置はコサイン間隔 x = (1 - cos(π k / n)) / 2 の位置で上下面をスプラインから補間する
+/**************************************************************/
+
+#ifndef AIRFOIL_H
+#define AIRFOIL_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <filesystem>
+
+/** 翼型 **/
+struct Airfoil
+{
+    std::string name;      // 翼型名
+    std::vector<double> x; // x 座標 (Selig 形式の順)
+    std::vector<double> y; // y 座標
+};
+
+/** 3次スプライン (パラメータ s に対する値) **/
+struct Spline
+{
+    std::vector<double> s;  // 節点のパラメータ
+    std::vector<double> v;  // 節点の値
+    std::vector<double> d2; // 節点の2階微分
+};
+
+/** 翼型の形状 **/
+struct Airfoil_geometry
+{
+    double thickness = 0;   // 最大翼厚 (翼弦長比) [-]
+    double x_thickness = 0; // 最大翼厚の位置 (翼弦長比) [-]
+    double camber = 0;      // 最大キャンバー (翼弦長比, 負の場合は下向き) [-]
+    double x_camber = 0;    // 最大キャンバーの位置 (翼弦長比) [-]
+    double te_gap = 0;      // 後縁の厚さ (翼弦長比) [-]
+};
+
+/**************************************************************/
+// Function name : Spline_init
+// Description   : 自然3次スプラインの作成 (三重対角行列を Thomas 法で解く)
+/**************************************************************/
+inline void Spline_init(Spline &sp, const std::vector<double> &s, const std::vector<double> &v)
+{
+    const size_t n = s.size();
+    sp.s = s;
+    sp.v = v;
+    sp.d2.assign(n, 0.0);
+    if (n < 3)
+    {
+        return;
+    }
+
+    std::vector<double> c(n, 0.0), r(n, 0.0); // 前進消去後の上対角成分・右辺
+    for (size_t i = 1; i + 1 < n; i++)
+    {
+        const double h0 = s[i] - s[i - 1];
+        const double h1 = s[i + 1] - s[i];
+        const double a = h0 / 6.0;
+        const double b = (h0 + h1) / 3.0 - a * c[i - 1];
+        c[i] = h1 / 6.0 / b;
+        r[i] = ((v[i + 1] - v[i]) / h1 - (v[i] - v[i - 1]) / h0 - a * r[i - 1]) / b;
+    }
+    for (size_t i = n - 2; i >= 1; i--)
+    {
+        sp.d2[i] = r[i] - c[i] * sp.d2[i + 1];
+    }
+}
+
+/**************************************************************/
+// Function name : Spline_eval
+// Description   : パラメータ t での値 (d1 が NULL でなければ1階微分も返す)
+/**************************************************************/
+inline double Spline_eval(const Spline &sp, double t, double *d1 = NULL)
+{
+    const size_t n = sp.s.size();
+    size_t lo = 0, hi = n - 1;
+    while (hi - lo > 1)
+    {
+        const size_t mid = (lo + hi) / 2;
+        if (sp.s[mid] > t)
+        {
+            hi = mid;
+        }
+        else
+        {
+            lo = mid;
+        }
+    }
+    const double h = sp.s[hi] - sp.s[lo];
+    const double a = (sp.s[hi] - t) / h;
+    const double b = (t - sp.s[lo]) / h;
+    if (d1 != NULL)
+    {
+        *d1 = (sp.v[hi] - sp.v[lo]) / h - (3 * a * a - 1) * h / 6.0 * sp.d2[lo] + (3 * b * b - 1) * h / 6.0 * sp.d2[hi];
+    }
+    return a * sp.v[lo] + b * sp.v[hi] + ((a * a * a - a) * sp.d2[lo] + (b * b * b - b) * sp.d2[hi]) * h * h / 6.0;
+}
+
+/**************************************************************/
+// Function name : Airfoil_load
+// Description   : 座標ファイルの読み込み (Selig / Lednicer 形式)
+/**************************************************************/
+inline bool Airfoil_load(const char *filename, Airfoil &af)
+{
+    FILE *fp = fopen(filename, "r");
+    if (fp == NULL)
+    {
+        printf("Cannot open: %s\n", filename);
+        return false;
+    }
+
+    /** 行ごとの読み込み (1行目の数値以外は翼型名, 以降の空行などは読み飛ばし) **/
+    char line[1024];
+    std::vector<double> xs, ys;
+    bool first = true;
+    af.name.clear();
+    while (fgets(line, sizeof(line), fp) != NULL)
+    {
+        double a, b;
+        if (sscanf(line, "%lf %lf", &a, &b) != 2)
+        {
+            if (first)
+            {
+                af.name = line;
+                while (!af.name.empty() && (af.name.back() == '\n' || af.name.back() == '\r' || af.name.back() == ' '))
+                {
+                    af.name.pop_back();
+                }
+            }
+            first = false;
+            continue;
+        }
+        first = false;
+        xs.push_back(a);
+        ys.push_back(b);
+    }
+    fclose(fp);
+
+    af.x.clear();
+    af.y.clear();
+    if (xs.size() >= 3 && xs[0] > 1.5 && ys[0] > 1.5 && xs[0] == floor(xs[0]) && ys[0] == floor(ys[0]))
+    {
+        /** Lednicer 形式 (上面・下面とも前縁から後縁) → 上面を逆順にして下面を続ける **/
+        const size_t n_upper = xs[0], n_lower = ys[0];
+        if (xs.size() < 1 + n_upper + n_lower)
+        {
+            printf("%s: expected %ld + %ld points\n", filename, (long)n_upper, (long)n_lower);
+            return false;
+        }
+        for (size_t i = n_upper; i >= 1; i--)
+        {
+            af.x.push_back(xs[i]);
+            af.y.push_back(ys[i]);
+        }
+        for (size_t i = 1 + n_upper; i < 1 + n_upper + n_lower; i++)
+        {
+            if (i == 1 + n_upper && xs[i] == af.x.back() && ys[i] == af.y.back())
+            {
+                continue; // 前縁の重複
+            }
+            af.x.push_back(xs[i]);
+            af.y.push_back(ys[i]);
+        }
+    }
+    else
+    {
+        af.x = xs;
+        af.y = ys;
+    }
+
+    /** 連続する重複点の削除 **/
+    size_t k = 0;
+    for (size_t i = 0; i < af.x.size(); i++)
+    {
+        if (k == 0 || af.x[i] != af.x[k - 1] || af.y[i] != af.y[k - 1])
+        {
+            af.x[k] = af.x[i];
+            af.y[k] = af.y[i];
+            k++;
+        }
+    }
+    af.x.resize(k);
+    af.y.resize(k);
+    if (k < 5)
+    {
+        printf("%s: too few points (%ld)\n", filename, (long)k);
+        return false;
+    }
+    return true;
+}
+
+/**************************************************************/
+// Function name : Airfoil_files
+// Description   : 座標ファイルの一覧 (ディレクトリは中の全ての .dat, データ名のみは airfoil/<データ名>.dat)
+/**************************************************************/
+inline std::vector<std::string> Airfoil_files(const std::vector<std::string> &sources)
+{
+    namespace fs = std::filesystem;
+    std::vector<std::string> paths;
+    for (const std::string &source : sources)
+    {
+        std::error_code ec;
+        if (fs::is_directory(source, ec))
+        {
+            std::vector<std::string> files;
+            for (const auto &entry : fs::directory_iterator(source, ec))
+            {
+                if (entry.is_regular_file(ec) && entry.path().extension() == ".dat")
+                {
+                    files.push_back(entry.path().string());
+                }
+            }
+            std::sort(files.begin(), files.end());
+            paths.insert(paths.end(), files.begin(), files.end());
+        }
+        else
+        {
+            paths.push_back(fs::exists(source, ec) ? source : "airfoil/" + source + ".dat");
+        }
+    }
+    return paths;
+}
+
+/**************************************************************/
+// Function name : Airfoil_splines
+// Description   : 累積弦長をパラメータとする x(s), y(s) のスプライン
+/**************************************************************/
+inline void Airfoil_splines(const Airfoil &af, Spline &sx, Spline &sy)
+{
+    std::vector<double> s(af.x.size(), 0.0);
+    for (size_t i = 1; i < s.size(); i++)
+    {
+        s[i] = s[i - 1] + hypot(af.x[i] - af.x[i - 1], af.y[i] - af.y[i - 1]);
+    }
+    Spline_init(sx, s, af.x);
+    Spline_init(sy, s, af.y);
+}
+
+/**************************************************************/
+// Function name : Airfoil_leading_edge
+// Description   : 前縁のパラメータ s (後縁中点から最も遠い点を黄金分割法で探索)
+/**************************************************************/
+inline double Airfoil_leading_edge(const Airfoil &af, const Spline &sx, const Spline &sy)
+{
+    const size_t n = af.x.size();
+    const double x_te = 0.5 * (af.x[0] + af.x[n - 1]);
+    const double y_te = 0.5 * (af.y[0] + af.y[n - 1]);
+    auto distance = [&](double t)
+    {
+        return hypot(Spline_eval(sx, t) - x_te, Spline_eval(sy, t) - y_te);
+    };
+
+    /** 最も遠い節点の前後の区間で探索 **/
+    size_t i_max = 0;
+    for (size_t i = 1; i < n; i++)
+    {
+        if (hypot(af.x[i] - x_te, af.y[i] - y_te) > hypot(af.x[i_max] - x_te, af.y[i_max] - y_te))
+        {
+            i_max = i;
+        }
+    }
+    double a = sx.s[i_max > 0 ? i_max - 1 : 0];
+    double b = sx.s[i_max + 1 < n ? i_max + 1 : n - 1];
+    const double ratio = 0.5 * (sqrt(5.0) - 1.0);
+    double c = b - ratio * (b - a), d = a + ratio * (b - a);
+    double fc = distance(c), fd = distance(d);
+    for (int k = 0; k < 80; k++)
+    {
+        if (fc > fd)
+        {
+            b = d;
+            d = c;
+            fd = fc;
+            c = b - ratio * (b - a);
+            fc = distance(c);
+        }
+        else
+        {
+            a = c;
+            c = d;
+            fc = fd;
+            d = a + ratio * (b - a);
+            fd = distance(d);
+        }
+    }
+    return 0.5 * (a + b);
+}
+
+/**************************************************************/
+// Function name : Airfoil_transform
+// Description   : 前縁まわりの回転と拡大 (chord : 翼弦長, angle : 迎角 [deg] (正で前縁上げ))
+/**************************************************************/
+inline void Airfoil_transform(Airfoil &af, double chord, double angle)
+{
+    const double c = cos(angle * M_PI / 180.0);
+    const double s = sin(angle * M_PI / 180.0);
+    for (size_t i = 0; i < af.x.size(); i++)
+    {
+        const double x = af.x[i], y = af.y[i];
+        af.x[i] = chord * (x * c + y * s);
+        af.y[i] = chord * (-x * s + y * c);
+    }
+}
+
+/**************************************************************/
+// Function name : Airfoil_normalize
+// Description   : 前縁を原点、後縁中点を (1, 0) へ移し、上面から始まる順に揃える
+/**************************************************************/
+inline void Airfoil_normalize(Airfoil &af)
+{
+    Spline sx, sy;
+    Airfoil_splines(af, sx, sy);
+    const double s_le = Airfoil_leading_edge(af, sx, sy);
+    const double x_le = Spline_eval(sx, s_le);
+    const double y_le = Spline_eval(sy, s_le);
+
+    const size_t n = af.x.size();
+    const double dx = 0.5 * (af.x[0] + af.x[n - 1]) - x_le;
+    const double dy = 0.5 * (af.y[0] + af.y[n - 1]) - y_le;
+    const double chord = hypot(dx, dy);
+    for (size_t i = 0; i < n; i++)
+    {
+        af.x[i] -= x_le;
+        af.y[i] -= y_le;
+    }
+    Airfoil_transform(af, 1.0 / chord, atan2(dy, dx) * 180.0 / M_PI);
+
+    /** 下面から始まる (時計回りの) 点列は逆順にして上面から始める **/
+    double area = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        const size_t j = (i + 1) % n;
+        area += af.x[i] * af.y[j] - af.x[j] * af.y[i];
+    }
+    if (area < 0)
+    {
+        std::reverse(af.x.begin(), af.x.end());
+        std::reverse(af.y.begin(), af.y.end());
+    }
+}
+
+/**************************************************************/
+// Function name : Airfoil_find
+// Description   : 区間 [a, b] で x(s) = x_target となる s (二分法, 範囲外は端の値)
+/**************************************************************/
+inline double Airfoil_find(const Spline &sx, double a, double b, double x_target)
+{
+    const double xa = Spline_eval(sx, a);
+    const double xb = Spline_eval(sx, b);
+    if ((x_target - xa) * (x_target - xb) > 0)
+    {
+        return fabs(x_target - xa) < fabs(x_target - xb) ? a : b;
+    }
+    for (int k = 0; k < 60; k++)
+    {
+        const double m = 0.5 * (a + b);
+        const double xm = Spline_eval(sx, m);
+        if ((xm - x_target) * (xa - x_target) > 0)
+        {
+            a = m;
+        }
+        else
+        {
+            b = m;
+        }
+    }
+    return 0.5 * (a + b);
+}
+
+/**************************************************************/
+// Function name : Airfoil_resample
+// Description   : 正規化済みの翼型を上下面 n+1 点ずつ (計 2n+1 点) のコサイン間隔へ再配置
+/**************************************************************/
+inline Airfoil Airfoil_resample(const Airfoil &af, int n)
+{
+    Spline sx, sy;
+    Airfoil_splines(af, sx, sy);
+    const double s_le = Airfoil_leading_edge(af, sx, sy);
+    const double s_end = sx.s.back();
+
+    Airfoil out;
+    out.name = af.name;
+    out.x.resize(2 * n + 1);
+    out.y.resize(2 * n + 1);
+    for (int k = 0; k <= n; k++)
+    {
+        const double x = 0.5 * (1.0 - cos(M_PI * k / n));
+        const double s_upper = k == 0 ? s_le : k == n ? 0.0 : Airfoil_find(sx, 0.0, s_le, x);
+        const double s_lower = k == 0 ? s_le : k == n ? s_end : Airfoil_find(sx, s_le, s_end, x);
+        out.x[n - k] = Spline_eval(sx, s_upper);
+        out.y[n - k] = Spline_eval(sy, s_upper);
+        out.x[n + k] = Spline_eval(sx, s_lower);
+        out.y[n + k] = Spline_eval(sy, s_lower);
+    }
+    return out;
+}
+
+/**************************************************************/
+// Function name : Airfoil_measure
+// Description   : 再配置済み (上下面が同じ x 位置) の翼型の最大翼厚・最大キャンバー
+/**************************************************************/
+inline Airfoil_geometry Airfoil_measure(const Airfoil &af)
+{
+    Airfoil_geometry geo;
+    const int n = (af.x.size() - 1) / 2;
+    for (int k = 0; k <= n; k++)
+    {
+        const double x = 0.5 * (af.x[n - k] + af.x[n + k]);
+        const double thickness = af.y[n - k] - af.y[n + k];
+        const double camber = 0.5 * (af.y[n - k] + af.y[n + k]);
+        if (thickness > geo.thickness)
+        {
+            geo.thickness = thickness;
+            geo.x_thickness = x;
+        }
+        if (fabs(camber) > fabs(geo.camber))
+        {
+            geo.camber = camber;
+            geo.x_camber = x;
+        }
+    }
+    geo.te_gap = hypot(af.x[0] - af.x[2 * n], af.y[0] - af.y[2 * n]);
+    return geo;
+}
+
+/**************************************************************/
+// Function name : Airfoil_write
+// Description   : Selig 形式での書き出し
+/**************************************************************/
+inline bool Airfoil_write(const char *filename, const Airfoil &af)
+{
+    FILE *fp = fopen(filename, "w");
+    if (fp == NULL)
+    {
+        printf("Cannot open: %s\n", filename);
+        return false;
+    }
+    fprintf(fp, "%s\n", af.name.c_str());
+    for (size_t i = 0; i < af.x.size(); i++)
+    {
+        fprintf(fp, "%10.7f %10.7f\n", af.x[i], af.y[i]);
+    }
+    fclose(fp);
+    return true;
+}
+
+#endif
@@ -0,0 +1,266 @@
+/**************************************************************/
+// File name   : allan_variance.h
+// Author      : Masatsugu Kitadai
+// Description : オーバーラップ Allan 分散の逐次計算と雑音係数の推定
+//
+//   累積和 C[i] = Σ_{j<i} (y_j - y_0) を使うと、平均時間 τ = m τ0 のオーバーラップ Allan 分散は
+//     σ^2(τ) = Σ_i (C[i+2m] - 2 C[i+m] + C[i])^2 / (2 m^2 (N - 2m + 1))
+//   となり、1つの τ あたり O(N) で計算できる (τ0 は横軸の換算にだけ使う)
+//   累積和は直近 2 m_max + ブロック分だけをリングバッファに保持するため、入力全体をメモリに載せる必要はない
+//   ブロックごとに τ を並列に割り当てて更新する
+//   欠測のあるログは欠測の位置で区間を区切り (Allan_break)、区間をまたぐ項は使わずに
+//   区間ごとの2階差分の2乗和と項数をそのまま合算する (欠測を補間した値で曲線を作らない)
+//
+//   雑音係数 (IEEE Std 952 の傾きによる読み取り, 単位は入力の単位に合わせる)
+//     N : 角度 / 速度ランダムウォーク [単位/√s]   傾き -1/2 の点を通る直線の τ = 1 [s] での値
+//     B : バイアス不安定性 [単位]                 最小値 / 0.664
+//     K : レートランダムウォーク [単位/s/√s]      傾き +1/2 の点を通る直線の τ = 3 [s] での値
+//   (N は sensor_error.h の random_walk, B は bias_instability の目安としてそのまま使える)
+/**************************************************************/
+
+#ifndef ALLAN_VARIANCE_H
+#define ALLAN_VARIANCE_H
+
+#include <stdint.h>
+#include <math.h>
+#include <vector>
+#include <thread>
+#include <atomic>
+
+/** 逐次計算の状態 **/
+struct Allan_variance
+{
+    int channels = 0;            // チャンネル数 [-]
+    std::vector<long> m;         // 平均点数 (対数間隔) [-]
+    std::vector<double> ring;    // 累積和のリングバッファ (スロット × チャンネル)
+    uint64_t mask = 0;           // リングバッファのスロット数 - 1 (2 のべき乗)
+    uint64_t n = 0;              // 入力サンプル数 [-]
+    uint64_t segment_begin = 0;  // 現在の区間の先頭サンプルの番号 [-]
+    uint64_t longest = 0;        // 最長の区間のサンプル数 [-]
+    long segments = 0;           // 区間の数 [-]
+    std::vector<double> offset;  // 累積和から差し引く値 (先頭サンプル, 桁落ち対策)
+    std::vector<double> sum;     // 2階差分の2乗和 (m × チャンネル)
+    std::vector<uint64_t> terms; // 2階差分の項数 (m ごと)
+    size_t block = 65536;        // 1回に追加できる最大サンプル数 [-]
+};
+
+/** 1チャンネルの雑音係数 **/
+struct Allan_coefficients
+{
+    double arw = NAN;   // ランダムウォーク N [単位/√s]
+    double bias = NAN;  // バイアス不安定性 B [単位]
+    double tau_b = NAN; // B を読み取った平均時間 [s]
+    double rrw = NAN;   // レートランダムウォーク K [単位/s/√s]
+};
+
+/**************************************************************/
+// Function name : Allan_init
+// Description   : 初期化 (m_max : 最大の平均点数, per_decade : 1桁あたりの τ の数)
+/**************************************************************/
+inline void Allan_init(Allan_variance &av, int channels, long m_max, int per_decade = 10, size_t block = 65536)
+{
+    av.channels = channels;
+    av.block = block;
+    av.n = 0;
+    av.segment_begin = 0;
+    av.longest = 0;
+    av.segments = 0;
+
+    /** 対数間隔の平均点数 (重複を除く) **/
+    av.m.clear();
+    for (int k = 0;; k++)
+    {
+        const long m = lround(pow(10.0, (double)k / per_decade));
+        if (m > m_max)
+        {
+            break;
+        }
+        if (av.m.empty() || m > av.m.back())
+        {
+            av.m.push_back(m);
+        }
+    }
+
+    /** リングバッファ (直近 2 m_max + ブロック + 1 点) **/
+    uint64_t slots = 1;
+    while (slots < 2 * (uint64_t)m_max + block + 1)
+    {
+        slots <<= 1;
+    }
+    av.mask = slots - 1;
+    av.ring.assign(slots * channels, 0.0);
+    av.offset.assign(channels, 0.0);
+    av.sum.assign(av.m.size() * channels, 0.0);
+    av.terms.assign(av.m.size(), 0);
+}
+
+/**************************************************************/
+// Function name : Allan_break
+// Description   : 欠測による区間の区切り (次に追加するサンプルから新しい区間)
+/**************************************************************/
+inline void Allan_break(Allan_variance &av)
+{
+    av.segment_begin = av.n;
+}
+
+/**************************************************************/
+// Function name : Allan_push
+// Description   : count 点 (count <= block, 行優先で count × channels) の追加と全 τ の更新 (workers 並列)
+/**************************************************************/
+inline void Allan_push(Allan_variance &av, const double *rows, size_t count, int workers)
+{
+    const int nc = av.channels;
+    if (av.n == 0 && count > 0)
+    {
+        for (int c = 0; c < nc; c++)
+        {
+            av.offset[c] = rows[c];
+        }
+    }
+
+    /** 累積和の追加 (C[i+1] = C[i] + y_i - y_0) **/
+    const uint64_t first = av.n; // 追加前の最後の累積和の番号
+    for (size_t k = 0; k < count; k++)
+    {
+        const double *prev = &av.ring[((first + k) & av.mask) * nc];
+        double *next = &av.ring[((first + k + 1) & av.mask) * nc];
+        for (int c = 0; c < nc; c++)
+        {
+            next[c] = prev[c] + (rows[k * nc + c] - av.offset[c]);
+        }
+    }
+    av.n += count;
+    if (count > 0)
+    {
+        av.segments += first == av.segment_begin ? 1 : 0; // 区間の最初の追加
+        const uint64_t length = av.n - av.segment_begin;
+        av.longest = length > av.longest ? length : av.longest;
+    }
+
+    /** τ ごとの2階差分の2乗和 (新しく計算できるようになった i + 2m = first+1 ... n, 項の先頭 i は現在の区間内) **/
+    std::atomic<size_t> next_m(0);
+    auto worker = [&]()
+    {
+        size_t k;
+        std::vector<double> acc(nc);
+        while ((k = next_m++) < av.m.size())
+        {
+            const uint64_t m = av.m[k];
+            const uint64_t end = av.n;
+            const uint64_t begin = first + 1 > av.segment_begin + 2 * m ? first + 1 : av.segment_begin + 2 * m;
+            if (begin > end)
+            {
+                continue;
+            }
+            for (int c = 0; c < nc; c++)
+            {
+                acc[c] = 0;
+            }
+            for (uint64_t i = begin; i <= end; i++)
+            {
+                const double *c0 = &av.ring[((i - 2 * m) & av.mask) * nc];
+                const double *c1 = &av.ring[((i - m) & av.mask) * nc];
+                const double *c2 = &av.ring[(i & av.mask) * nc];
+                for (int c = 0; c < nc; c++)
+                {
+                    const double d = c2[c] - 2.0 * c1[c] + c0[c];
+                    acc[c] += d * d;
+                }
+            }
+            for (int c = 0; c < nc; c++)
+            {
+                av.sum[k * nc + c] += acc[c];
+            }
+            av.terms[k] += end - begin + 1;
+        }
+    };
+    std::vector<std::thread> threads;
+    const int n_threads = workers < 1 ? 1 : workers < (int)av.m.size() ? workers : (int)av.m.size();
+    for (int t = 1; t < n_threads; t++)
+    {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (std::thread &th : threads)
+    {
+        th.join();
+    }
+}
+
+/**************************************************************/
+// Function name : Allan_deviation
+// Description   : k 番目の τ のチャンネル c の Allan 偏差 (項がない場合は NaN)
+/**************************************************************/
+inline double Allan_deviation(const Allan_variance &av, size_t k, int c)
+{
+    if (av.terms[k] == 0)
+    {
+        return NAN;
+    }
+    const double m = (double)av.m[k];
+    return sqrt(av.sum[k * av.channels + c] / (2.0 * m * m * av.terms[k]));
+}
+
+/**************************************************************/
+// Function name : Allan_fit
+// Description   : Allan 偏差の曲線 (tau [s], adev) からの雑音係数の読み取り
+//                 傾きが ±1/2 から 0.25 以上離れている場合は該当する領域がないとして NaN
+/**************************************************************/
+inline Allan_coefficients Allan_fit(const std::vector<double> &tau, const std::vector<double> &adev)
+{
+    Allan_coefficients co;
+    const size_t n = tau.size();
+    if (n < 3)
+    {
+        return co;
+    }
+
+    /** 最小値 (バイアス不安定性) **/
+    size_t i_min = 0;
+    for (size_t i = 1; i < n; i++)
+    {
+        if (adev[i] < adev[i_min])
+        {
+            i_min = i;
+        }
+    }
+    co.bias = adev[i_min] / 0.664;
+    co.tau_b = tau[i_min];
+
+    /** 局所的な傾き (両隣の点の差分) が目標に最も近い点 **/
+    auto slope = [&](size_t i)
+    {
+        const size_t a = i > 0 ? i - 1 : i;
+        const size_t b = i + 1 < n ? i + 1 : i;
+        return log(adev[b] / adev[a]) / log(tau[b] / tau[a]);
+    };
+    auto closest = [&](size_t from, size_t to, double target)
+    {
+        long best = -1;
+        double best_err = 0.25;
+        for (size_t i = from; i < to; i++)
+        {
+            const double err = fabs(slope(i) - target);
+            if (err < best_err)
+            {
+                best = i;
+                best_err = err;
+            }
+        }
+        return best;
+    };
+
+    const long i_arw = closest(0, i_min + 1, -0.5);
+    if (i_arw >= 0)
+    {
+        co.arw = adev[i_arw] * sqrt(tau[i_arw]);
+    }
+    const long i_rrw = closest(i_min, n, 0.5);
+    if (i_rrw >= 0)
+    {
+        co.rrw = adev[i_rrw] * sqrt(3.0 / tau[i_rrw]);
+    }
+    return co;
+}
+
+#endif
@@ -0,0 +1,407 @@
+/**************************************************************/
+// File name   : data_reader.h
+// Author      : Masatsugu Kitadai
+// Description : 数値テキストファイル (.dat / .csv) の高速読み込み
+//               mmap したファイルを std::from_chars で解析し、列ごとの配列で返す
+//               区切り文字 : タブ・空白・カンマ・セミコロン
+//               ヘッダ行 (先頭が数値でない行) は自動的に読み飛ばす
+//               各列の先頭は 64 [byte] 境界に揃える (列の確保長をキャッシュラインの倍数に切り上げ)
+/**************************************************************/
+
+#ifndef DATA_READER_H
+#define DATA_READER_H
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <charconv>
+#include <limits>
+#include <new>
+#include <thread>
+#include <vector>
+#include "metrics.h"
+
+const size_t data_align = 64; // 列の先頭の境界 [byte] (キャッシュライン, AVX-512 のベクトル長)
+
+/** data_align 境界に確保するアロケータ **/
+template <typename T>
+struct Aligned_allocator
+{
+    typedef T value_type;
+
+    Aligned_allocator() = default;
+    template <typename U>
+    Aligned_allocator(const Aligned_allocator<U> &) {}
+
+    T *allocate(size_t n) { return (T *)::operator new(n * sizeof(T), std::align_val_t(data_align)); }
+    void deallocate(T *p, size_t) { ::operator delete(p, std::align_val_t(data_align)); }
+
+    template <typename U>
+    bool operator==(const Aligned_allocator<U> &) const { return true; }
+    template <typename U>
+    bool operator!=(const Aligned_allocator<U> &) const { return false; }
+};
+
+template <typename T>
+using Aligned_vector = std::vector<T, Aligned_allocator<T>>;
+
+/**************************************************************/
+// Function name : Aligned_stride
+// Description   : n 個の値を data_align の倍数の長さに切り上げた個数
+/**************************************************************/
+template <typename T>
+inline size_t Aligned_stride(size_t n)
+{
+    const size_t k = data_align / sizeof(T);
+    return (n + k - 1) / k * k;
+}
+
+/** 列指向のデータ表 **/
+template <typename T>
+struct Data_table
+{
+    size_t rows = 0;          // 行数 (データ行のみ) [-]
+    size_t cols = 0;          // 列数 [-]
+    size_t stride = 0;        // 列の確保長 (Aligned_stride) [-]
+    Aligned_vector<T> values; // 列ごとに連続した値 (values[j * stride + i])
+
+    T *Column(size_t j) { return values.data() + j * stride; }
+    const T *Column(size_t j) const { return values.data() + j * stride; }
+};
+
+/** 読み込み中のファイル (mmap) **/
+struct Mapped_file
+{
+    const char *data = NULL; // ファイル先頭
+    size_t size = 0;         // ファイルサイズ [byte]
+};
+
+/**************************************************************/
+// Function name : Map_file
+// Description   : ファイルを読み込み専用で mmap する
+/**************************************************************/
+inline bool Map_file(const char *filename, Mapped_file &file)
+{
+    const int fd = open(filename, O_RDONLY);
+    if (fd < 0)
+    {
+        printf("Cannot open: %s\n", filename);
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        printf("Cannot stat: %s\n", filename);
+        close(fd);
+        return false;
+    }
+    file.size = st.st_size;
+    file.data = NULL;
+
+    if (file.size > 0)
+    {
+        void *addr = mmap(NULL, file.size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr == MAP_FAILED)
+        {
+            printf("Cannot map: %s\n", filename);
+            close(fd);
+            return false;
+        }
+        madvise(addr, file.size, MADV_SEQUENTIAL);
+        file.data = (const char *)addr;
+    }
+    close(fd);
+    Metrics_add("bytes_read", file.size);
+
+    return true;
+}
+
+/**************************************************************/
+// Function name : Unmap_file
+// Description   : mmap の解除
+/**************************************************************/
+inline void Unmap_file(Mapped_file &file)
+{
+    if (file.data != NULL)
+    {
+        munmap((void *)file.data, file.size);
+    }
+    file.data = NULL;
+    file.size = 0;
+}
+
+/**************************************************************/
+// Function name : Count_lines
+// Description   : 行数の計数 (最終行の改行の有無によらない)
+/**************************************************************/
+inline int Count_lines(const char *filename)
+{
+    Mapped_file file;
+    if (!Map_file(filename, file))
+    {
+        return 0;
+    }
+
+    int n = 0;
+    const char *end = file.data + file.size;
+    for (const char *p = file.data; p < end; n++)
+    {
+        const char *nl = (const char *)memchr(p, '\n', end - p);
+        p = nl != NULL ? nl + 1 : end;
+    }
+    Unmap_file(file);
+
+    return n;
+}
+
+/**************************************************************/
+// Function name : Is_blank
+// Description   : 空白文字 (区切りとして扱う) の判定
+/**************************************************************/
+inline bool Is_blank(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+/**************************************************************/
+// Function name : Parse_field
+// Description   : 1フィールドの解析 (解析できない場合は NaN) | 戻り値は次の位置
+/**************************************************************/
+template <typename T>
+inline const char *Parse_field(const char *p, const char *end, T &value)
+{
+    while (p < end && Is_blank(*p))
+    {
+        p++;
+    }
+    if (p < end && *p == '+')
+    {
+        p++; // from_chars は '+' 記号を受け付けない
+    }
+
+    std::from_chars_result res = std::from_chars(p, end, value);
+    bool valid = res.ec == std::errc();
+    p = res.ptr;
+
+    // 数値の直後が区切りでなければ無効 (例: "2264:120732.000")
+    if (p < end && !Is_blank(*p) && *p != ',' && *p != ';' && *p != '\n')
+    {
+        valid = false;
+    }
+    if (!valid)
+    {
+        value = std::numeric_limits<T>::quiet_NaN();
+        while (p < end && *p != ',' && *p != ';' && *p != '\n' && !Is_blank(*p))
+        {
+            p++;
+        }
+    }
+
+    // 区切り (空白の連続 + カンマ1個) を読み飛ばす
+    while (p < end && Is_blank(*p))
+    {
+        p++;
+    }
+    if (p < end && (*p == ',' || *p == ';'))
+    {
+        p++;
+    }
+
+    return p;
+}
+
+/**************************************************************/
+// Function name : Parse_line
+// Description   : 1行の解析 | 戻り値は解析できた先頭からの列数 (先頭列が数値でなければ 0)
+/**************************************************************/
+template <typename T>
+inline size_t Parse_line(const char *p, const char *end, T *row, size_t cols, size_t row_stride)
+{
+    size_t n_valid = 0;
+    for (size_t j = 0; j < cols; j++)
+    {
+        T value = std::numeric_limits<T>::quiet_NaN();
+        if (p < end)
+        {
+            p = Parse_field(p, end, value);
+        }
+        row[j * row_stride] = value;
+        if (isnan((double)value))
+        {
+            if (j == 0)
+            {
+                return 0;
+            }
+        }
+        else if (n_valid == j)
+        {
+            n_valid += 1;
+        }
+    }
+    return n_valid;
+}
+
+/**************************************************************/
+// Function name : Count_fields
+// Description   : 1行に含まれるフィールド数
+/**************************************************************/
+inline size_t Count_fields(const char *p, const char *end)
+{
+    size_t n = 0;
+    while (p < end && Is_blank(*p))
+    {
+        p++;
+    }
+    while (p < end)
+    {
+        double value;
+        p = Parse_field(p, end, value);
+        n += 1;
+    }
+    return n;
+}
+
+/**************************************************************/
+// Function name : Read_table
+// Description   : ファイル全体を列ごとの配列へ読み込む
+//                 skip : 先頭の読み飛ばし行数 / cols : 列数 (0 の場合は最初のデータ行から決定)
+/**************************************************************/
+template <typename T>
+bool Read_table(const char *filename, Data_table<T> &table, int skip = 0, size_t cols = 0)
+{
+    Mapped_file file;
+    if (!Map_file(filename, file))
+    {
+        return false;
+    }
+
+    const char *begin = file.data;
+    const char *end = file.data + file.size;
+
+    /** 読み飛ばし行 **/
+    for (int i = 0; i < skip && begin < end; i++)
+    {
+        const char *nl = (const char *)memchr(begin, '\n', end - begin);
+        begin = nl != NULL ? nl + 1 : end;
+    }
+
+    /** 先頭のヘッダ行の読み飛ばしと列数の決定 **/
+    while (begin < end)
+    {
+        const char *nl = (const char *)memchr(begin, '\n', end - begin);
+        const char *line_end = nl != NULL ? nl : end;
+        double first;
+        Parse_field(begin, line_end, first);
+        if (!isnan(first))
+        {
+            if (cols == 0)
+            {
+                cols = Count_fields(begin, line_end);
+            }
+            break;
+        }
+        begin = nl != NULL ? nl + 1 : end;
+    }
+
+    /** 分割 (行境界で区切り、ブロックごとに並列で解析) **/
+    const size_t min_block = 4 << 20; // 1ブロックの最小サイズ [byte]
+    size_t n_blocks = std::thread::hardware_concurrency();
+    if (n_blocks == 0 || (size_t)(end - begin) < 2 * min_block)
+    {
+        n_blocks = 1;
+    }
+    std::vector<const char *> bounds(n_blocks + 1);
+    bounds[0] = begin;
+    bounds[n_blocks] = end;
+    for (size_t b = 1; b < n_blocks; b++)
+    {
+        const char *p = begin + (end - begin) * b / n_blocks;
+        const char *nl = (const char *)memchr(p, '\n', end - p);
+        bounds[b] = nl != NULL ? nl + 1 : end;
+    }
+
+    /** 行数の計数 (列の確保長を先に決める) **/
+    std::vector<size_t> lines(n_blocks + 1, 0);
+    {
+        std::vector<std::thread> threads;
+        for (size_t b = 0; b < n_blocks; b++)
+        {
+            threads.emplace_back([&, b]
+                                 {
+                size_t n = 0;
+                for (const char *p = bounds[b]; p < bounds[b + 1]; n++)
+                {
+                    const char *nl = (const char *)memchr(p, '\n', bounds[b + 1] - p);
+                    p = nl != NULL ? nl + 1 : bounds[b + 1];
+                }
+                lines[b + 1] = n; });
+        }
+        for (size_t b = 0; b < threads.size(); b++)
+        {
+            threads[b].join();
+        }
+    }
+    for (size_t b = 0; b < n_blocks; b++)
+    {
+        lines[b + 1] += lines[b];
+    }
+
+    const size_t n_lines = lines[n_blocks];
+    table.cols = cols;
+    table.stride = Aligned_stride<T>(n_lines);
+    table.values.assign(table.cols * table.stride, T(0));
+
+    /** 解析 (無効な行は後で詰める) **/
+    std::vector<char> valid(n_lines, 1);
+    {
+        std::vector<std::thread> threads;
+        for (size_t b = 0; b < n_blocks; b++)
+        {
+            threads.emplace_back([&, b]
+                                 {
+                size_t i = lines[b];
+                for (const char *p = bounds[b]; p < bounds[b + 1]; i++)
+                {
+                    const char *nl = (const char *)memchr(p, '\n', bounds[b + 1] - p);
+                    const char *line_end = nl != NULL ? nl : bounds[b + 1];
+                    if (Parse_line(p, line_end, table.values.data() + i, table.cols, table.stride) == 0)
+                    {
+                        valid[i] = 0;
+                    }
+                    p = nl != NULL ? nl + 1 : bounds[b + 1];
+                } });
+        }
+        for (size_t b = 0; b < threads.size(); b++)
+        {
+            threads[b].join();
+        }
+    }
+
+    size_t rows = 0;
+    for (size_t i = 0; i < n_lines; i++)
+    {
+        if (valid[i])
+        {
+            if (rows != i)
+            {
+                for (size_t j = 0; j < table.cols; j++)
+                {
+                    table.values[j * table.stride + rows] = table.values[j * table.stride + i];
+                }
+            }
+            rows += 1;
+        }
+    }
+    table.rows = rows;
+
+    Unmap_file(file);
+
+    return true;
+}
+
+#endif
@@ -0,0 +1,38 @@
+/**************************************************************/
+// File name   : dead_reckoning.h
+// Author      : Masatsugu Kitadai
+// Description : 6軸センサの積算による自己位置推定 (1サンプルごとの更新)
+/**************************************************************/
+
+#ifndef DEAD_RECKONING_H
+#define DEAD_RECKONING_H
+
+#include <math.h>
+
+/** 推定状態 **/
+struct Dead_reckoning
+{
+    float u = 0;     // x方向車両速度 [m/s]
+    float v = 0;     // y方向車両速度 [m/s]
+    float theta = 0; // 車両の角度 [rad]
+    float x = 0;     // x方向位置 [m]
+    float y = 0;     // y方向位置 [m]
+};
+
+/**************************************************************/
+// Function name : Dead_reckoning_step
+// Description   : 速度・角度・位置の積算
+/**************************************************************/
+inline void Dead_reckoning_step(Dead_reckoning &s, float acc_x, float acc_y, float omega_z, float dt)
+{
+    /** 速度・角度の積算 **/
+    s.theta += omega_z * dt;
+    s.u += -1.0 * (acc_x * sin(s.theta) + acc_y * cos(s.theta)) * dt; // 絶対座標系のx方向速度 [m/s]
+    s.v += -1.0 * (acc_x * cos(s.theta) + acc_y * sin(s.theta)) * dt; // 絶対座標系のy方向速度 [m/s]
+
+    /** 位置の積算 **/
+    s.x = s.x + s.u * dt;
+    s.y = s.y + s.v * dt;
+}
+
+#endif
@@ -0,0 +1,159 @@
+/**************************************************************/
+// File name   : geodesy.h
+// Author      : Masatsugu Kitadai
+// Description : WGS-84 測地座標 (緯度・経度・高さ) ／ ECEF ／ 局所座標 ENU の一括変換
+//               全て double で計算し、配列単位で処理する
+/**************************************************************/
+
+#ifndef GEODESY_H
+#define GEODESY_H
+
+#include <stddef.h>
+#include <math.h>
+
+/** WGS-84 楕円体 **/
+const double wgs84_a = 6378137.0;                     // 赤道半径 [m]
+const double wgs84_f = 1.0 / 298.257223563;           // 扁平率 [-]
+const double wgs84_e2 = wgs84_f * (2.0 - wgs84_f);    // 第一離心率の2乗 [-]
+const double wgs84_b = wgs84_a * (1.0 - wgs84_f);     // 極半径 [m]
+const double wgs84_ep2 = wgs84_e2 / (1.0 - wgs84_e2); // 第二離心率の2乗 [-]
+const double deg_to_rad = 3.14159265358979323846 / 180.0;
+
+/** 局所座標 (ENU) の基準点 **/
+struct Enu_reference
+{
+    double lat = 0, lon = 0, h = 0;  // 基準点の緯度・経度 [deg]、楕円体高 [m]
+    double x = 0, y = 0, z = 0;      // 基準点の ECEF 座標 [m]
+    double sin_lat = 0, cos_lat = 1; // 回転行列の成分
+    double sin_lon = 0, cos_lon = 1;
+};
+
+/**************************************************************/
+// Function name : Geodetic_to_ecef
+// Description   : 緯度・経度 [deg]・楕円体高 [m] → ECEF [m]
+/**************************************************************/
+inline void Geodetic_to_ecef(double lat, double lon, double h, double &x, double &y, double &z)
+{
+    const double sin_lat = sin(lat * deg_to_rad);
+    const double cos_lat = cos(lat * deg_to_rad);
+    const double sin_lon = sin(lon * deg_to_rad);
+    const double cos_lon = cos(lon * deg_to_rad);
+    const double n = wgs84_a / sqrt(1.0 - wgs84_e2 * sin_lat * sin_lat); // 卯酉線曲率半径 [m]
+
+    x = (n + h) * cos_lat * cos_lon;
+    y = (n + h) * cos_lat * sin_lon;
+    z = (n * (1.0 - wgs84_e2) + h) * sin_lat;
+}
+
+/**************************************************************/
+// Function name : Ecef_to_geodetic
+// Description   : ECEF [m] → 緯度・経度 [deg]・楕円体高 [m] (Bowring の初期値 + 反復)
+/**************************************************************/
+inline void Ecef_to_geodetic(double x, double y, double z, double &lat, double &lon, double &h)
+{
+    const double p = sqrt(x * x + y * y);
+    const double theta = atan2(z * wgs84_a, p * wgs84_b);
+    const double st = sin(theta);
+    const double ct = cos(theta);
+    double phi = atan2(z + wgs84_ep2 * wgs84_b * st * st * st, p - wgs84_e2 * wgs84_a * ct * ct * ct);
+
+    for (int i = 0; i < 3; i++)
+    {
+        const double s = sin(phi);
+        const double n = wgs84_a / sqrt(1.0 - wgs84_e2 * s * s);
+        h = p / cos(phi) - n;
+        phi = atan2(z, p * (1.0 - wgs84_e2 * n / (n + h)));
+    }
+
+    const double s = sin(phi);
+    const double n = wgs84_a / sqrt(1.0 - wgs84_e2 * s * s);
+    lat = phi / deg_to_rad;
+    lon = atan2(y, x) / deg_to_rad;
+    h = p / cos(phi) - n;
+}
+
+/**************************************************************/
+// Function name : Enu_reference_init
+// Description   : 基準点の設定 (緯度・経度 [deg]、楕円体高 [m])
+/**************************************************************/
+inline void Enu_reference_init(Enu_reference &ref, double lat, double lon, double h)
+{
+    ref.lat = lat;
+    ref.lon = lon;
+    ref.h = h;
+    ref.sin_lat = sin(lat * deg_to_rad);
+    ref.cos_lat = cos(lat * deg_to_rad);
+    ref.sin_lon = sin(lon * deg_to_rad);
+    ref.cos_lon = cos(lon * deg_to_rad);
+    Geodetic_to_ecef(lat, lon, h, ref.x, ref.y, ref.z);
+}
+
+/**************************************************************/
+// Function name : Enu_reference_init_ecef
+// Description   : 基準点の設定 (ECEF [m])
+/**************************************************************/
+inline void Enu_reference_init_ecef(Enu_reference &ref, double x, double y, double z)
+{
+    double lat, lon, h;
+    Ecef_to_geodetic(x, y, z, lat, lon, h);
+    Enu_reference_init(ref, lat, lon, h);
+    ref.x = x; // 往復変換の丸め誤差を避けるため入力値を基準とする
+    ref.y = y;
+    ref.z = z;
+}
+
+/**************************************************************/
+// Function name : Ecef_to_enu_batch
+// Description   : ECEF [m] → 局所座標 ENU [m] (n 点を一括変換)
+/**************************************************************/
+inline void Ecef_to_enu_batch(const Enu_reference &ref, const double *x, const double *y, const double *z, size_t n,
+                              double *east, double *north, double *up)
+{
+    const double sl = ref.sin_lat, cl = ref.cos_lat;
+    const double so = ref.sin_lon, co = ref.cos_lon;
+    for (size_t i = 0; i < n; i++)
+    {
+        const double dx = x[i] - ref.x;
+        const double dy = y[i] - ref.y;
+        const double dz = z[i] - ref.z;
+        east[i] = -so * dx + co * dy;
+        north[i] = -sl * co * dx - sl * so * dy + cl * dz;
+        if (up != NULL)
+        {
+            up[i] = cl * co * dx + cl * so * dy + sl * dz;
+        }
+    }
+}
+
+/**************************************************************/
+// Function name : Geodetic_to_enu_batch
+// Description   : 緯度・経度 [deg]・楕円体高 [m] → 局所座標 ENU [m] (n 点を一括変換)
+//                 h が NULL の場合は楕円体高 0 とする
+/**************************************************************/
+inline void Geodetic_to_enu_batch(const Enu_reference &ref, const double *lat, const double *lon, const double *h, size_t n,
+                                  double *east, double *north, double *up)
+{
+    const double sl = ref.sin_lat, cl = ref.cos_lat;
+    const double so = ref.sin_lon, co = ref.cos_lon;
+    for (size_t i = 0; i < n; i++)
+    {
+        const double hi = h != NULL ? h[i] : 0.0;
+        const double sin_lat = sin(lat[i] * deg_to_rad);
+        const double cos_lat = cos(lat[i] * deg_to_rad);
+        const double sin_lon = sin(lon[i] * deg_to_rad);
+        const double cos_lon = cos(lon[i] * deg_to_rad);
+        const double rn = wgs84_a / sqrt(1.0 - wgs84_e2 * sin_lat * sin_lat);
+
+        const double dx = (rn + hi) * cos_lat * cos_lon - ref.x;
+        const double dy = (rn + hi) * cos_lat * sin_lon - ref.y;
+        const double dz = (rn * (1.0 - wgs84_e2) + hi) * sin_lat - ref.z;
+        east[i] = -so * dx + co * dy;
+        north[i] = -sl * co * dx - sl * so * dy + cl * dz;
+        if (up != NULL)
+        {
+            up[i] = cl * co * dx + cl * so * dy + sl * dz;
+        }
+    }
+}
+
+#endif
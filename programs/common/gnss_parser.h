@@ -0,0 +1,513 @@
+/**************************************************************/
+// File name   : gnss_parser.h
+// Author      : Masatsugu Kitadai
+// Description : u-blox (ZED-F9P) の UBX / NMEA バイト列の逐次解析
+//
+//   受信したバイト列 (mmap したファイル・パイプの読み込みバッファ) を順に渡すと、
+//   チェックサムを検証して測位結果 Gnss_fix をコールバックで返す
+//     UBX  : NAV-PVT (0x01 0x07), NAV-HPPOSLLH (0x01 0x14)
+//     NMEA : GGA, RMC (トーカー ID は問わない)
+//   入力バッファ内で完結しているメッセージはその場で解析し、バッファの境界を
+//   またぐメッセージだけを固定長の内部バッファへ持ち越す (メッセージ単位の確保なし)
+//   UBX は GPS 週内時刻 (iTOW)、NMEA は UTC で時刻を持つため、同じエポックを1つにまとめるときは
+//   Gnss_time_base で NAV-PVT から GPS - UTC の差 (うるう秒) を求めて iTOW にそろえる
+/**************************************************************/
+
+#ifndef GNSS_PARSER_H
+#define GNSS_PARSER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+/** メッセージの種類 **/
+enum Gnss_source
+{
+    gnss_ubx_pvt,
+    gnss_ubx_hpposllh,
+    gnss_nmea_gga,
+    gnss_nmea_rmc,
+};
+
+/** 測位結果 **/
+struct Gnss_fix
+{
+    Gnss_source source = gnss_ubx_pvt; // 解析したメッセージ
+    double itow = NAN;                 // GPS 週内時刻 [s] (UBX のみ)
+    double utc = NAN;                  // UTC の日内時刻 [s]
+    int year = 0, month = 0, day = 0;  // UTC の日付 (NAV-PVT, RMC のみ)
+    double lat = NAN;                  // 緯度 [deg]
+    double lon = NAN;                  // 経度 [deg]
+    double height = NAN;               // 楕円体高 [m]
+    double h_acc = NAN;                // 水平精度 [m]
+    double v_acc = NAN;                // 垂直精度 [m]
+    double hdop = NAN;                 // 水平精度低下率 [-] (GGA のみ)
+    double speed = NAN;                // 対地速度 [m/s]
+    double heading = NAN;              // 進行方向 (北から時計回り) [deg]
+    int fix_type = 0;                  // 0: なし, 1: DR, 2: 2D, 3: 3D, 4: GNSS+DR, 5: 時刻のみ
+    int carrier = 0;                   // 搬送波位相解 0: なし, 1: RTK float, 2: RTK fixed
+    int satellites = 0;                // 使用衛星数 [-]
+    bool valid = false;                // 位置が有効か
+};
+
+/** 解析の集計 **/
+struct Gnss_parser_stats
+{
+    long bytes = 0;           // 入力バイト数 [-]
+    long ubx = 0;             // チェックサムが一致した UBX メッセージ数 [-]
+    long nmea = 0;            // チェックサムが一致した NMEA 文数 [-]
+    long fixes = 0;           // 出力した測位結果の数 [-]
+    long checksum_errors = 0; // チェックサム不一致 [-]
+    long skipped = 0;         // 同期できずに読み飛ばしたバイト数 [-]
+};
+
+/** 共通の時刻 (GPS 週内時刻) への換算 **/
+struct Gnss_time_base
+{
+    double leap = NAN;     // GPS 時刻 - UTC [s] (整数秒)
+    double itow_ref = NAN; // 換算に使った NAV-PVT の iTOW [s]
+};
+
+const double gnss_day = 86400.0;   // 1日 [s]
+const double gnss_week = 604800.0; // 1週 [s]
+
+const size_t gnss_ubx_payload_max = 1024;                 // 受け付ける UBX のペイロード長の上限 [byte]
+const size_t gnss_nmea_max = 128;                         // 受け付ける NMEA 文の長さの上限 (規格は82) [byte]
+const size_t gnss_buffer_size = gnss_ubx_payload_max + 8; // 持ち越し用バッファ [byte]
+
+/** 逐次処理の状態 **/
+struct Gnss_parser
+{
+    uint8_t carry[gnss_buffer_size]; // 入力の境界をまたぐメッセージの先頭部分
+    size_t carry_len = 0;            // 持ち越しているバイト数 [-]
+    Gnss_parser_stats stats;
+};
+
+/**************************************************************/
+// Function name : Gnss_time_learn
+// Description   : iTOW と UTC の両方を持つ測位結果 (NAV-PVT) から GPS - UTC の差を求める
+/**************************************************************/
+inline void Gnss_time_learn(Gnss_time_base &tb, const Gnss_fix &fix)
+{
+    if (!isnan(tb.leap) || isnan(fix.itow) || isnan(fix.utc))
+    {
+        return;
+    }
+    double d = fmod(fix.itow, gnss_day) - fix.utc;
+    d -= gnss_day * floor(d / gnss_day + 0.5); // (-12 [h], 12 [h]] へ
+    tb.leap = round(d);
+    tb.itow_ref = fix.itow;
+}
+
+/**************************************************************/
+// Function name : Gnss_fix_time
+// Description   : 測位結果の iTOW [s] (NMEA は UTC から換算, 換算できない場合は NAN)
+/**************************************************************/
+inline double Gnss_fix_time(const Gnss_time_base &tb, const Gnss_fix &fix)
+{
+    if (!isnan(fix.itow))
+    {
+        return fix.itow;
+    }
+    if (isnan(fix.utc) || isnan(tb.leap))
+    {
+        return NAN;
+    }
+    const double tow = fix.utc + tb.leap; // 日内の GPS 時刻
+    double itow = tow + gnss_day * floor((tb.itow_ref - tow) / gnss_day + 0.5);
+    itow -= gnss_week * floor(itow / gnss_week);
+    return itow;
+}
+
+/**************************************************************/
+// Function name : Gnss_u2 / Gnss_u4 / Gnss_i4
+// Description   : リトルエンディアンの整数の読み出し
+/**************************************************************/
+inline uint16_t Gnss_u2(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+inline uint32_t Gnss_u4(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+inline int32_t Gnss_i4(const uint8_t *p)
+{
+    return (int32_t)Gnss_u4(p);
+}
+
+/**************************************************************/
+// Function name : Gnss_message_length
+// Description   : p から始まるメッセージの長さ
+//                 (> 0 : 長さ [byte], 0 : メッセージの先頭ではない, -1 : データ不足)
+/**************************************************************/
+inline long Gnss_message_length(const uint8_t *p, size_t avail)
+{
+    if (p[0] == 0xB5)
+    {
+        /** UBX : 0xB5 0x62 class id length(2) payload checksum(2) **/
+        if (avail < 2)
+        {
+            return -1;
+        }
+        if (p[1] != 0x62)
+        {
+            return 0;
+        }
+        if (avail < 6)
+        {
+            return -1;
+        }
+        const size_t length = Gnss_u2(p + 4);
+        if (length > gnss_ubx_payload_max)
+        {
+            return 0;
+        }
+        return avail >= length + 8 ? (long)(length + 8) : -1;
+    }
+    if (p[0] == '$')
+    {
+        /** NMEA : $ ... *hh CR LF **/
+        const size_t n = avail < gnss_nmea_max ? avail : gnss_nmea_max;
+        const uint8_t *nl = (const uint8_t *)memchr(p, '\n', n);
+        if (nl != NULL)
+        {
+            return nl - p + 1;
+        }
+        return avail < gnss_nmea_max ? -1 : 0;
+    }
+    return 0;
+}
+
+/**************************************************************/
+// Function name : Gnss_decode_ubx
+// Description   : UBX メッセージの検証と解析 (チェックサム不一致は false)
+/**************************************************************/
+template <typename Output>
+inline bool Gnss_decode_ubx(Gnss_parser &ps, const uint8_t *p, size_t length, Output &output)
+{
+    /** Fletcher チェックサム (class から payload の末尾まで) **/
+    uint8_t ck_a = 0, ck_b = 0;
+    for (size_t i = 2; i < length - 2; i++)
+    {
+        ck_a += p[i];
+        ck_b += ck_a;
+    }
+    if (ck_a != p[length - 2] || ck_b != p[length - 1])
+    {
+        ps.stats.checksum_errors += 1;
+        return false;
+    }
+    ps.stats.ubx += 1;
+
+    const uint8_t cls = p[2];
+    const uint8_t id = p[3];
+    const size_t size = length - 8;
+    const uint8_t *m = p + 6; // ペイロード
+
+    if (cls == 0x01 && id == 0x07 && size >= 92)
+    {
+        /** NAV-PVT **/
+        Gnss_fix fix;
+        fix.source = gnss_ubx_pvt;
+        fix.itow = Gnss_u4(m + 0) * 1e-3;
+        fix.year = Gnss_u2(m + 4);
+        fix.month = m[6];
+        fix.day = m[7];
+        if (m[11] & 0x02) // validTime
+        {
+            fix.utc = m[8] * 3600.0 + m[9] * 60.0 + m[10] + Gnss_i4(m + 16) * 1e-9;
+        }
+        fix.fix_type = m[20];
+        fix.carrier = (m[21] >> 6) & 0x03;
+        fix.satellites = m[23];
+        fix.lon = Gnss_i4(m + 24) * 1e-7;
+        fix.lat = Gnss_i4(m + 28) * 1e-7;
+        fix.height = Gnss_i4(m + 32) * 1e-3;
+        fix.h_acc = Gnss_u4(m + 40) * 1e-3;
+        fix.v_acc = Gnss_u4(m + 44) * 1e-3;
+        fix.speed = Gnss_i4(m + 60) * 1e-3;
+        fix.heading = Gnss_i4(m + 64) * 1e-5;
+        fix.valid = (m[21] & 0x01) && fix.fix_type >= 2 && fix.fix_type <= 4; // gnssFixOK
+        ps.stats.fixes += 1;
+        output(fix);
+    }
+    else if (cls == 0x01 && id == 0x14 && size >= 36)
+    {
+        /** NAV-HPPOSLLH (高精度成分 lonHp, latHp [1e-9 deg], heightHp [0.1 mm] を加算) **/
+        Gnss_fix fix;
+        fix.source = gnss_ubx_hpposllh;
+        fix.itow = Gnss_u4(m + 4) * 1e-3;
+        fix.lon = Gnss_i4(m + 8) * 1e-7 + (int8_t)m[24] * 1e-9;
+        fix.lat = Gnss_i4(m + 12) * 1e-7 + (int8_t)m[25] * 1e-9;
+        fix.height = Gnss_i4(m + 16) * 1e-3 + (int8_t)m[26] * 1e-4;
+        fix.h_acc = Gnss_u4(m + 28) * 1e-4;
+        fix.v_acc = Gnss_u4(m + 32) * 1e-4;
+        fix.valid = !(m[3] & 0x01); // invalidLlh
+        ps.stats.fixes += 1;
+        output(fix);
+    }
+
+    return true;
+}
+
+/**************************************************************/
+// Function name : Gnss_nmea_number
+// Description   : NMEA のフィールドの数値 (空欄は NAN)
+/**************************************************************/
+inline double Gnss_nmea_number(const char *p, const char *end)
+{
+    if (p == end)
+    {
+        return NAN;
+    }
+    char text[32];
+    const size_t n = (size_t)(end - p) < sizeof(text) - 1 ? end - p : sizeof(text) - 1;
+    memcpy(text, p, n);
+    text[n] = '\0';
+    return atof(text);
+}
+
+/**************************************************************/
+// Function name : Gnss_nmea_angle
+// Description   : NMEA の緯度・経度 (dddmm.mmmm と N/S/E/W) を [deg] へ変換
+/**************************************************************/
+inline double Gnss_nmea_angle(const char *p, const char *end, const char *hemi, const char *hemi_end)
+{
+    const double v = Gnss_nmea_number(p, end);
+    if (isnan(v) || hemi == hemi_end)
+    {
+        return NAN;
+    }
+    const double deg = floor(v / 100.0);
+    const double angle = deg + (v - deg * 100.0) / 60.0;
+    return *hemi == 'S' || *hemi == 'W' ? -angle : angle;
+}
+
+/**************************************************************/
+// Function name : Gnss_nmea_time
+// Description   : NMEA の時刻 (hhmmss.ss) を日内時刻 [s] へ変換
+/**************************************************************/
+inline double Gnss_nmea_time(const char *p, const char *end)
+{
+    const double v = Gnss_nmea_number(p, end);
+    if (isnan(v))
+    {
+        return NAN;
+    }
+    const double hour = floor(v / 10000.0);
+    const double minute = floor((v - hour * 10000.0) / 100.0);
+    return hour * 3600.0 + minute * 60.0 + (v - hour * 10000.0 - minute * 100.0);
+}
+
+/**************************************************************/
+// Function name : Gnss_hex
+// Description   : 16進数1文字の値 (16進数でない場合は -1)
+/**************************************************************/
+inline int Gnss_hex(char c)
+{
+    if (c >= '0' && c <= '9')
+    {
+        return c - '0';
+    }
+    if (c >= 'A' && c <= 'F')
+    {
+        return c - 'A' + 10;
+    }
+    if (c >= 'a' && c <= 'f')
+    {
+        return c - 'a' + 10;
+    }
+    return -1;
+}
+
+/**************************************************************/
+// Function name : Gnss_decode_nmea
+// Description   : NMEA 文の検証と解析 (チェックサム不一致は false)
+/**************************************************************/
+template <typename Output>
+inline bool Gnss_decode_nmea(Gnss_parser &ps, const uint8_t *p, size_t length, Output &output)
+{
+    const char *s = (const char *)p + 1;
+    const char *star = (const char *)memchr(s, '*', length - 1);
+    if (star == NULL || star + 3 > (const char *)p + length)
+    {
+        ps.stats.checksum_errors += 1;
+        return false;
+    }
+
+    /** XOR チェックサム ($ と * の間) **/
+    uint8_t sum = 0;
+    for (const char *c = s; c < star; c++)
+    {
+        sum ^= (uint8_t)*c;
+    }
+    const int hi = Gnss_hex(star[1]);
+    const int lo = Gnss_hex(star[2]);
+    if (hi < 0 || lo < 0 || sum != (hi << 4 | lo))
+    {
+        ps.stats.checksum_errors += 1;
+        return false;
+    }
+    ps.stats.nmea += 1;
+
+    if (star - s < 5)
+    {
+        return true;
+    }
+    const char *end = star;
+    const char *f[14]; // 各フィールドの先頭
+    const char *e[14]; // 各フィールドの末尾
+    int nf = 0;
+    for (const char *q = s; nf < 14;)
+    {
+        const char *c = (const char *)memchr(q, ',', end - q);
+        f[nf] = q;
+        e[nf] = c != NULL ? c : end;
+        nf++;
+        if (c == NULL)
+        {
+            break;
+        }
+        q = c + 1;
+    }
+    for (; nf < 14; nf++)
+    {
+        f[nf] = e[nf] = end; // 省略されたフィールドは空欄
+    }
+
+    if (memcmp(s + 2, "GGA", 3) == 0)
+    {
+        /** GGA : 時刻, 緯度, N/S, 経度, E/W, 品質, 衛星数, HDOP, 標高, M, ジオイド高, M **/
+        const int quality = (int)Gnss_nmea_number(f[6], e[6]);
+        Gnss_fix fix;
+        fix.source = gnss_nmea_gga;
+        fix.utc = Gnss_nmea_time(f[1], e[1]);
+        fix.lat = Gnss_nmea_angle(f[2], e[2], f[3], e[3]);
+        fix.lon = Gnss_nmea_angle(f[4], e[4], f[5], e[5]);
+        fix.satellites = (int)Gnss_nmea_number(f[7], e[7]);
+        fix.hdop = Gnss_nmea_number(f[8], e[8]);
+        const double sep = Gnss_nmea_number(f[11], e[11]);
+        fix.height = Gnss_nmea_number(f[9], e[9]) + (isnan(sep) ? 0.0 : sep);
+        fix.fix_type = quality == 6 ? 1 : quality > 0 ? 3 : 0;
+        fix.carrier = quality == 4 ? 2 : quality == 5 ? 1 : 0;
+        fix.valid = quality > 0 && quality != 6 && !isnan(fix.lat) && !isnan(fix.lon);
+        ps.stats.fixes += 1;
+        output(fix);
+    }
+    else if (memcmp(s + 2, "RMC", 3) == 0)
+    {
+        /** RMC : 時刻, 状態, 緯度, N/S, 経度, E/W, 速度 [kn], 進行方向, 日付 (ddmmyy) **/
+        Gnss_fix fix;
+        fix.source = gnss_nmea_rmc;
+        fix.utc = Gnss_nmea_time(f[1], e[1]);
+        fix.lat = Gnss_nmea_angle(f[3], e[3], f[4], e[4]);
+        fix.lon = Gnss_nmea_angle(f[5], e[5], f[6], e[6]);
+        fix.speed = Gnss_nmea_number(f[7], e[7]) * 1852.0 / 3600.0;
+        fix.heading = Gnss_nmea_number(f[8], e[8]);
+        const double date = Gnss_nmea_number(f[9], e[9]);
+        if (!isnan(date))
+        {
+            fix.day = (int)(date / 10000);
+            fix.month = (int)(date / 100) % 100;
+            fix.year = 2000 + (int)date % 100;
+        }
+        fix.valid = f[2] != e[2] && *f[2] == 'A' && !isnan(fix.lat) && !isnan(fix.lon);
+        fix.fix_type = fix.valid ? 2 : 0;
+        ps.stats.fixes += 1;
+        output(fix);
+    }
+
+    return true;
+}
+
+/**************************************************************/
+// Function name : Gnss_decode
+// Description   : 長さの確定したメッセージの解析
+/**************************************************************/
+template <typename Output>
+inline bool Gnss_decode(Gnss_parser &ps, const uint8_t *p, size_t length, Output &output)
+{
+    return p[0] == 0xB5 ? Gnss_decode_ubx(ps, p, length, output) : Gnss_decode_nmea(ps, p, length, output);
+}
+
+/**************************************************************/
+// Function name : Gnss_parser_feed
+// Description   : バイト列の追加 (解析できた測位結果は output(const Gnss_fix &) で受け取る)
+/**************************************************************/
+template <typename Output>
+inline void Gnss_parser_feed(Gnss_parser &ps, const void *data, size_t n, Output output)
+{
+    const uint8_t *p = (const uint8_t *)data;
+    ps.stats.bytes += n;
+
+    while (n > 0)
+    {
+        /** 前回から持ち越したメッセージの続き **/
+        if (ps.carry_len > 0)
+        {
+            const size_t take = n < gnss_buffer_size - ps.carry_len ? n : gnss_buffer_size - ps.carry_len;
+            memcpy(ps.carry + ps.carry_len, p, take);
+            const long m = Gnss_message_length(ps.carry, ps.carry_len + take);
+
+            if (m < 0)
+            {
+                ps.carry_len += take; // まだ揃わない
+                p += take;
+                n -= take;
+                continue;
+            }
+            if (m > 0 && Gnss_decode(ps, ps.carry, m, output))
+            {
+                p += m - ps.carry_len;
+                n -= m - ps.carry_len;
+                ps.carry_len = 0;
+                continue;
+            }
+
+            /** 同期外れ : 持ち越した2バイト目以降から次の同期文字を探す **/
+            size_t k = 1;
+            while (k < ps.carry_len && ps.carry[k] != 0xB5 && ps.carry[k] != '$')
+            {
+                k++;
+            }
+            ps.stats.skipped += k;
+            memmove(ps.carry, ps.carry + k, ps.carry_len - k);
+            ps.carry_len -= k;
+            continue;
+        }
+
+        /** 同期文字 (0xB5 または $) の検索 **/
+        if (*p != 0xB5 && *p != '$')
+        {
+            ps.stats.skipped += 1;
+            p += 1;
+            n -= 1;
+            continue;
+        }
+
+        /** 入力バッファ内で完結するメッセージはその場で解析 **/
+        const long m = Gnss_message_length(p, n);
+        if (m < 0)
+        {
+            memcpy(ps.carry, p, n); // 境界をまたぐメッセージは持ち越し (n < メッセージ長 <= バッファ長)
+            ps.carry_len = n;
+            return;
+        }
+        if (m > 0 && Gnss_decode(ps, p, m, output))
+        {
+            p += m;
+            n -= m;
+            continue;
+        }
+        ps.stats.skipped += 1;
+        p += 1;
+        n -= 1;
+    }
+}
+
+#endif
@@ -0,0 +1,187 @@
+/**************************************************************/
+// File name   : gnuplot_pool.h
+// Author      : Masatsugu Kitadai
+// Description : 常駐 gnuplot プロセスによる並列描画
+//               (フレームごとの popen / pclose を廃止し、
+//                ジョブキューから複数のワーカーへ描画を分配する)
+/**************************************************************/
+
+#ifndef GNUPLOT_POOL_H
+#define GNUPLOT_POOL_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <signal.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "metrics.h"
+
+/** ワーカープールの状態 **/
+struct Gnuplot_pool_state
+{
+    std::vector<std::thread> workers; // 描画スレッド (1スレッド = 1 gnuplot プロセス)
+    std::deque<std::string> jobs;     // 描画ジョブのキュー
+    std::mutex mtx;                   // キュー保護用
+    std::condition_variable cv_job;   // ジョブ投入通知
+    std::condition_variable cv_space; // キュー空き通知
+    size_t queue_max = 64;            // キューの最大長 [-]
+    bool closing = false;             // 終了要求
+};
+
+inline Gnuplot_pool_state gnuplot_pool;
+
+/**************************************************************/
+// Function name : Gnuplot_open
+// Description   : gnuplot プロセスの起動
+/**************************************************************/
+inline FILE *Gnuplot_open()
+{
+    FILE *gp;
+    if ((gp = popen("gnuplot", "w")) == NULL)
+    {
+        printf("gnuplot is not here!\n");
+        exit(0); // gnuplotが無い場合、異常ある場合は終了
+    }
+    return gp;
+}
+
+/**************************************************************/
+// Function name : Gnuplot_worker
+// Description   : キューからジョブを取り出して常駐 gnuplot へ送る
+/**************************************************************/
+inline void Gnuplot_worker()
+{
+    FILE *gp = Gnuplot_open();
+
+    while (true)
+    {
+        std::string job;
+        {
+            std::unique_lock<std::mutex> lock(gnuplot_pool.mtx);
+            gnuplot_pool.cv_job.wait(lock, []
+                                     { return gnuplot_pool.closing || !gnuplot_pool.jobs.empty(); });
+            if (gnuplot_pool.jobs.empty())
+            {
+                break; // 終了要求かつキューが空
+            }
+            job = std::move(gnuplot_pool.jobs.front());
+            gnuplot_pool.jobs.pop_front();
+        }
+        gnuplot_pool.cv_space.notify_one();
+
+        /** 描画 (前のフレームの設定を引き継がないよう reset し、出力ファイルを閉じる) **/
+        fputs("reset\n", gp);
+        fputs(job.c_str(), gp);
+        fputs("unset output\n", gp);
+        Metrics_add("frames", 1);
+        if (fflush(gp) != 0 || ferror(gp))
+        {
+            // スクリプトエラー等で gnuplot が終了した場合は再起動
+            pclose(gp);
+            gp = Gnuplot_open();
+        }
+    }
+
+    /** Gnuplot 終了 **/
+    fprintf(gp, "exit\n"); // Quit gnuplot
+    pclose(gp);            // 描画完了まで待機
+}
+
+/**************************************************************/
+// Function name : Gnuplot_pool_start
+// Description   : ワーカーの起動 (n_workers <= 0 の場合は GNUPLOT_WORKERS または CPU コア数)
+/**************************************************************/
+inline void Gnuplot_pool_start(int n_workers = 0)
+{
+    if (n_workers <= 0)
+    {
+        const char *env = getenv("GNUPLOT_WORKERS");
+        n_workers = env != NULL ? atoi(env) : (int)std::thread::hardware_concurrency();
+    }
+    if (n_workers <= 0)
+    {
+        n_workers = 1;
+    }
+
+    signal(SIGPIPE, SIG_IGN); // gnuplot 異常終了時に書き込み側が落ちないようにする
+    gnuplot_pool.closing = false;
+    gnuplot_pool.queue_max = 16 * n_workers;
+    for (int i = 0; i < n_workers; i++)
+    {
+        gnuplot_pool.workers.emplace_back(Gnuplot_worker);
+    }
+}
+
+/**************************************************************/
+// Function name : Gnuplot_printf
+// Description   : 描画スクリプトへ1行追記 (fprintf(gp, ...) の代替)
+/**************************************************************/
+inline void Gnuplot_printf(std::string &script, const char *format, ...)
+{
+    char buf[1024];
+    va_list args;
+    va_start(args, format);
+    const int len = vsnprintf(buf, sizeof(buf), format, args);
+    va_end(args);
+
+    if (len < (int)sizeof(buf))
+    {
+        script.append(buf, len);
+        return;
+    }
+
+    // 長い行はヒープ上で再整形
+    std::string long_buf(len + 1, '\0');
+    va_start(args, format);
+    vsnprintf(&long_buf[0], len + 1, format, args);
+    va_end(args);
+    script.append(long_buf.c_str(), len);
+}
+
+/**************************************************************/
+// Function name : Gnuplot_submit
+// Description   : 描画ジョブの投入 (キューが満杯の場合は空くまで待機)
+/**************************************************************/
+inline void Gnuplot_submit(std::string script)
+{
+    if (gnuplot_pool.workers.empty())
+    {
+        Gnuplot_pool_start();
+    }
+
+    {
+        Metrics_timer timer("plot"); // キューの空き待ち (描画が計算に追いつかない時間)
+        std::unique_lock<std::mutex> lock(gnuplot_pool.mtx);
+        gnuplot_pool.cv_space.wait(lock, []
+                                   { return gnuplot_pool.jobs.size() < gnuplot_pool.queue_max; });
+        gnuplot_pool.jobs.push_back(std::move(script));
+    }
+    gnuplot_pool.cv_job.notify_one();
+}
+
+/**************************************************************/
+// Function name : Gnuplot_pool_finish
+// Description   : 全ジョブの描画完了を待ってワーカーを終了
+/**************************************************************/
+inline void Gnuplot_pool_finish()
+{
+    Metrics_timer timer("plot"); // 残りのフレームの描画待ち
+    {
+        std::lock_guard<std::mutex> lock(gnuplot_pool.mtx);
+        gnuplot_pool.closing = true;
+    }
+    gnuplot_pool.cv_job.notify_all();
+
+    for (size_t i = 0; i < gnuplot_pool.workers.size(); i++)
+    {
+        gnuplot_pool.workers[i].join();
+    }
+    gnuplot_pool.workers.clear();
+}
+
+#endif
@@ -0,0 +1,246 @@
+/**************************************************************/
+// File name   : imu_calibration.h
+// Author      : Masatsugu Kitadai
+// Description : 6軸センサのバイアス・スケールの逐次推定と補正
+//
+//   静止判定 : 直近 window サンプルの加速度・角速度の分散が閾値以下 (バイアスの影響を受けない)
+//              かつ窓内の平均が静止時の値 (推定済みのバイアス・スケールを含む) に近い
+//              (一定半径の旋回も分散は小さいため、横加速度・ヨーレートを分散だけでは静止と区別できない)
+//   推定     : 静止中のサンプルで軸ごとに逐次最小二乗法 (RLS, 忘却係数付き) を更新
+//                測定値 = スケール × 基準値 + バイアス
+//                基準値は静止時の真値 (加速度は重力 (0, 0, g), 角速度は 0)
+//   スケールは基準値の異なる静止姿勢がないと分離できないため、既定ではバイアスのみを推定する
+//   基準値が 0 の軸ではスケールの行を更新せず、励起されない方向の共分散は初期値の大きさで打ち切る
+//   1サンプルあたりの計算量は一定 (窓の和は差分で更新)
+/**************************************************************/
+
+#ifndef IMU_CALIBRATION_H
+#define IMU_CALIBRATION_H
+
+#include <stddef.h>
+#include <math.h>
+#include <vector>
+
+/** 静止判定 **/
+struct Stationary_detector
+{
+    int window = 32;              // 判定に使うサンプル数 [-]
+    double acc_threshold = 0.2;   // 加速度の標準偏差の閾値 [m/s2]
+    double gyro_threshold = 0.01; // 角速度の標準偏差の閾値 [rad/s]
+    double acc_rest = 2.0;        // 加速度の平均と静止時の値の差の閾値 [m/s2] (MPU6050 の個体差 0.1 [g] 程度を含む)
+    double gyro_rest = 0.15;      // 角速度の平均と静止時の値の差の閾値 [rad/s] (同 数 [deg/s] 程度を含む)
+    std::vector<double> ring;     // 直近の値 (window × 6)
+    double sum[6] = {0};          // 窓内の和
+    double sum2[6] = {0};         // 窓内の2乗和
+    long count = 0;               // 入力サンプル数 [-]
+};
+
+/** 1軸分の逐次最小二乗法 (theta = [スケール, バイアス]) **/
+struct Rls_axis
+{
+    double scale = 1.0;                // スケール [-]
+    double bias = 0.0;                 // バイアス [測定値の単位]
+    double p[2][2] = {{0, 0}, {0, 0}}; // 推定誤差の共分散
+    double p_limit = 0.0;              // 共分散のトレースの上限 (初期値)
+    bool estimate_scale = false;       // スケールも推定するか
+};
+
+/** 補正の状態 **/
+struct Imu_calibration
+{
+    Stationary_detector detector;
+    Rls_axis acc[3];               // 加速度 x, y, z
+    Rls_axis gyro[3];              // 角速度 x, y, z
+    double acc_reference[3] = {0}; // 静止時の加速度の真値 [m/s2]
+    double lambda = 0.999;         // 忘却係数 [-]
+    long stationary = 0;           // 静止と判定したサンプル数 [-]
+    long updates_min = 32;         // 補正を始めるまでの静止サンプル数 [-]
+};
+
+/**************************************************************/
+// Function name : Stationary_update
+// Description   : 1サンプルの追加と静止判定 (acc [m/s2], gyro [rad/s])
+/**************************************************************/
+inline bool Stationary_update(Stationary_detector &det, const float *acc, const float *gyro)
+{
+    const int w = det.window;
+    if ((int)det.ring.size() != w * 6)
+    {
+        det.ring.assign(w * 6, 0.0);
+    }
+
+    double *slot = &det.ring[(det.count % w) * 6];
+    for (int c = 0; c < 6; c++)
+    {
+        const double value = c < 3 ? acc[c] : gyro[c - 3];
+        if (det.count >= w)
+        {
+            det.sum[c] -= slot[c]; // 窓から外れる値
+            det.sum2[c] -= slot[c] * slot[c];
+        }
+        slot[c] = value;
+        det.sum[c] += value;
+        det.sum2[c] += value * value;
+    }
+    det.count += 1;
+    if (det.count < w)
+    {
+        return false;
+    }
+
+    /** 3軸の分散の合計 **/
+    double var_acc = 0, var_gyro = 0;
+    for (int c = 0; c < 6; c++)
+    {
+        const double mean = det.sum[c] / w;
+        const double var = det.sum2[c] / w - mean * mean;
+        (c < 3 ? var_acc : var_gyro) += var > 0 ? var : 0;
+    }
+    return var_acc < det.acc_threshold * det.acc_threshold && var_gyro < det.gyro_threshold * det.gyro_threshold;
+}
+
+/**************************************************************/
+// Function name : Rls_init
+// Description   : 初期化 (p_bias, p_scale : 初期値の分散)
+/**************************************************************/
+inline void Rls_init(Rls_axis &axis, bool estimate_scale, double p_bias, double p_scale = 1e-2)
+{
+    axis.scale = 1.0;
+    axis.bias = 0.0;
+    axis.estimate_scale = estimate_scale;
+    axis.p[0][0] = estimate_scale ? p_scale : 0.0;
+    axis.p[0][1] = axis.p[1][0] = 0.0;
+    axis.p[1][1] = p_bias;
+    axis.p_limit = axis.p[0][0] + axis.p[1][1];
+}
+
+/**************************************************************/
+// Function name : Rls_update
+// Description   : 基準値 reference のときの測定値 measured による更新 (回帰ベクトル [reference, 1])
+/**************************************************************/
+inline void Rls_update(Rls_axis &axis, double reference, double measured, double lambda)
+{
+    const double residual = measured - (axis.scale * reference + axis.bias);
+
+    /** 基準値が 0 のときはスケールが観測できないため、バイアスのみの更新 (スケールの行は λ で割らない) **/
+    if (!axis.estimate_scale || reference == 0.0)
+    {
+        const double k = axis.p[1][1] / (lambda + axis.p[1][1]);
+        axis.bias += k * residual;
+        axis.p[1][1] = (axis.p[1][1] - k * axis.p[1][1]) / lambda;
+        return;
+    }
+
+    const double phi[2] = {reference, 1.0};
+
+    /** ゲイン K = P φ / (λ + φᵀ P φ) **/
+    const double pphi[2] = {axis.p[0][0] * phi[0] + axis.p[0][1] * phi[1],
+                            axis.p[1][0] * phi[0] + axis.p[1][1] * phi[1]};
+    const double denom = lambda + phi[0] * pphi[0] + phi[1] * pphi[1];
+    const double k[2] = {pphi[0] / denom, pphi[1] / denom};
+
+    /** 推定値の更新 **/
+    axis.scale += k[0] * residual;
+    axis.bias += k[1] * residual;
+
+    /** 共分散の更新 P = (P - K φᵀ P) / λ **/
+    for (int r = 0; r < 2; r++)
+    {
+        for (int c = 0; c < 2; c++)
+        {
+            axis.p[r][c] = (axis.p[r][c] - k[r] * pphi[c]) / lambda;
+        }
+    }
+
+    /** 同じ姿勢が続くと φ に直交する方向の共分散が 1/λ ずつ増えるため、トレースを初期値で打ち切る **/
+    const double trace = axis.p[0][0] + axis.p[1][1];
+    if (trace > axis.p_limit)
+    {
+        const double ratio = axis.p_limit / trace;
+        for (int r = 0; r < 2; r++)
+        {
+            for (int c = 0; c < 2; c++)
+            {
+                axis.p[r][c] *= ratio;
+            }
+        }
+    }
+}
+
+/**************************************************************/
+// Function name : Rls_correct
+// Description   : 測定値の補正 ((測定値 - バイアス) / スケール)
+/**************************************************************/
+inline double Rls_correct(const Rls_axis &axis, double measured)
+{
+    return (measured - axis.bias) / axis.scale;
+}
+
+/**************************************************************/
+// Function name : Imu_calibration_init
+// Description   : 初期化 (acc_reference : 静止時の加速度の真値 [m/s2], estimate_scale : 加速度のスケールも推定)
+/**************************************************************/
+inline void Imu_calibration_init(Imu_calibration &cal, const double *acc_reference, bool estimate_scale = false,
+                                 int window = 32, double lambda = 0.999)
+{
+    cal.detector = Stationary_detector();
+    cal.detector.window = window;
+    cal.lambda = lambda;
+    cal.stationary = 0;
+    cal.updates_min = window;
+    for (int c = 0; c < 3; c++)
+    {
+        cal.acc_reference[c] = acc_reference[c];
+        Rls_init(cal.acc[c], estimate_scale, 100.0);
+        Rls_init(cal.gyro[c], false, 100.0);
+    }
+}
+
+/**************************************************************/
+// Function name : Imu_near_rest
+// Description   : 窓内の平均が静止時の値に近いか (加速度は スケール × 基準値 + バイアス, 角速度は バイアス)
+/**************************************************************/
+inline bool Imu_near_rest(const Imu_calibration &cal)
+{
+    const Stationary_detector &det = cal.detector;
+    double d_acc = 0, d_gyro = 0; // 静止時の値との差の2乗 [(m/s2)^2], [(rad/s)^2]
+    for (int c = 0; c < 3; c++)
+    {
+        const double acc = det.sum[c] / det.window - (cal.acc[c].scale * cal.acc_reference[c] + cal.acc[c].bias);
+        const double gyro = det.sum[3 + c] / det.window - cal.gyro[c].bias;
+        d_acc += acc * acc;
+        d_gyro += gyro * gyro;
+    }
+    return d_acc < det.acc_rest * det.acc_rest && d_gyro < det.gyro_rest * det.gyro_rest;
+}
+
+/**************************************************************/
+// Function name : Imu_calibrate
+// Description   : 静止判定・推定値の更新・補正 (acc, gyro を補正後の値で上書き, 戻り値は静止判定)
+/**************************************************************/
+inline bool Imu_calibrate(Imu_calibration &cal, float *acc, float *gyro)
+{
+    const bool stationary = Stationary_update(cal.detector, acc, gyro) && Imu_near_rest(cal);
+    if (stationary)
+    {
+        for (int c = 0; c < 3; c++)
+        {
+            Rls_update(cal.acc[c], cal.acc_reference[c], acc[c], cal.lambda);
+            Rls_update(cal.gyro[c], 0.0, gyro[c], cal.lambda);
+        }
+        cal.stationary += 1;
+    }
+
+    /** 十分な静止サンプルで推定した後から補正 **/
+    if (cal.stationary >= cal.updates_min)
+    {
+        for (int c = 0; c < 3; c++)
+        {
+            acc[c] = Rls_correct(cal.acc[c], acc[c]);
+            gyro[c] = Rls_correct(cal.gyro[c], gyro[c]);
+        }
+    }
+    return stationary;
+}
+
+#endif
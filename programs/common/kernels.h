@@ -0,0 +1,332 @@
+/**************************************************************/
+// File name   : kernels.h
+// Author      : Masatsugu Kitadai
+// Description : 配列に対する数値計算 (平滑化・FFT・積分・統計量)
+//               (C++ の各プログラムと Python 拡張モジュール (python/cpp/grandelfino.cpp) で共用)
+//
+//   入出力はすべて double の連続した配列で、出力先は呼び出し側が確保する
+//   出力を返すカーネル (Moving_average, Exponential_moving_average, Savgol_smooth, Bandpass_fft, Integrate_trapezoid) は
+//   出力先を入力と同じ配列 (out == x) にできる (in-place)。ずらして重なる配列は不可
+//   移動平均は pandas の rolling(window).mean()、指数移動平均は ewm(span, adjust=False).mean() と同じ値
+/**************************************************************/
+
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#include <stddef.h>
+#include <math.h>
+#include <complex>
+#include <vector>
+#include "savgol.h"
+
+/** 統計量 **/
+struct Kernel_stats
+{
+    size_t n = 0;      // 有効なサンプル数 (NaN を除く) [-]
+    double mean = NAN; // 平均値
+    double std = NAN;  // 標準偏差 (不偏)
+    double min = NAN;  // 最小値
+    double max = NAN;  // 最大値
+    double rms = NAN;  // 二乗平均平方根
+};
+
+/**************************************************************/
+// Function name : Moving_average
+// Description   : 後方移動平均 (先頭の window-1 点は NaN, 窓から外れる値はリングに保持するため in-place 可)
+/**************************************************************/
+inline void Moving_average(const double *x, size_t n, size_t window, double *out)
+{
+    std::vector<double> ring(window < n ? window : n); // 窓内の入力値
+    double sum = 0;                                    // 窓内の合計
+    long invalid = 0;                                  // 窓内の NaN の数 [-]
+    for (size_t i = 0; i < n; i++)
+    {
+        const double value = x[i];
+        if (isnan(value))
+        {
+            invalid++;
+        }
+        else
+        {
+            sum += value;
+        }
+        if (i >= window)
+        {
+            const double outgoing = ring[i % window];
+            if (isnan(outgoing))
+            {
+                invalid--;
+            }
+            else
+            {
+                sum -= outgoing;
+            }
+        }
+        ring[i % window] = value;
+        out[i] = i + 1 >= window && invalid == 0 ? sum / window : NAN;
+    }
+}
+
+/**************************************************************/
+// Function name : Exponential_moving_average
+// Description   : 指数移動平均 (α = 2 / (span + 1), 初期値は先頭の値)
+//                 NaN の区間も重みの減衰に数える (pandas の ignore_na=False と同じ, NaN の位置は直前の値)
+/**************************************************************/
+inline void Exponential_moving_average(const double *x, size_t n, double span, double *out)
+{
+    const double alpha = 2.0 / (span + 1.0);
+    double value = NAN;  // 現在の平均値
+    double weight = 1.0; // 現在の平均値の重み [-]
+    for (size_t i = 0; i < n; i++)
+    {
+        const double xi = x[i];
+        if (isnan(value))
+        {
+            value = xi;
+            weight = 1.0;
+        }
+        else
+        {
+            weight *= 1.0 - alpha;
+            if (!isnan(xi))
+            {
+                value = (weight * value + alpha * xi) / (weight + alpha);
+                weight = 1.0;
+            }
+        }
+        out[i] = value;
+    }
+}
+
+/**************************************************************/
+// Function name : Savgol_smooth
+// Description   : Savitzky-Golay フィルタによる平滑化・微分 (deriv = 0, 1, 2)
+/**************************************************************/
+inline void Savgol_smooth(const double *x, size_t n, int half, int order, double dt, int deriv, double *out)
+{
+    Savgol_filter sg;
+    Savgol_init(sg, half, order, 1, dt);
+    auto output = [&](long index, const double *position, const double *velocity, const double *acceleration)
+    {
+        out[index] = deriv == 0 ? position[0] : deriv == 1 ? velocity[0] : acceleration[0];
+    };
+    for (size_t i = 0; i < n; i++)
+    {
+        Savgol_push(sg, &x[i], output);
+    }
+    Savgol_flush(sg, output);
+}
+
+/**************************************************************/
+// Function name : Fft_radix2
+// Description   : 2 のべき乗点の FFT (in-place, inverse で逆変換 (1/n 倍))
+/**************************************************************/
+inline void Fft_radix2(std::complex<double> *a, size_t n, bool inverse)
+{
+    /** ビット反転の並べ替え **/
+    for (size_t i = 1, j = 0; i < n; i++)
+    {
+        size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1)
+        {
+            j ^= bit;
+        }
+        j ^= bit;
+        if (i < j)
+        {
+            std::swap(a[i], a[j]);
+        }
+    }
+
+    /** バタフライ演算 **/
+    const double sign = inverse ? 1.0 : -1.0;
+    for (size_t len = 2; len <= n; len <<= 1)
+    {
+        const double angle = sign * 2.0 * M_PI / len;
+        const std::complex<double> w_len(cos(angle), sin(angle));
+        for (size_t i = 0; i < n; i += len)
+        {
+            std::complex<double> w = 1.0;
+            for (size_t j = 0; j < len / 2; j++)
+            {
+                const std::complex<double> u = a[i + j];
+                const std::complex<double> v = a[i + j + len / 2] * w;
+                a[i + j] = u + v;
+                a[i + j + len / 2] = u - v;
+                w *= w_len;
+            }
+        }
+    }
+    if (inverse)
+    {
+        for (size_t i = 0; i < n; i++)
+        {
+            a[i] /= (double)n;
+        }
+    }
+}
+
+/**************************************************************/
+// Function name : Fft
+// Description   : 任意点数の FFT (実部 re・虚部 im を in-place で変換)
+//                 2 のべき乗以外は Bluestein 法 (畳み込みを 2 のべき乗の FFT で計算)
+/**************************************************************/
+inline void Fft(double *re, double *im, size_t n, bool inverse)
+{
+    if (n <= 1)
+    {
+        return;
+    }
+    if ((n & (n - 1)) == 0)
+    {
+        std::vector<std::complex<double>> a(n);
+        for (size_t i = 0; i < n; i++)
+        {
+            a[i] = std::complex<double>(re[i], im[i]);
+        }
+        Fft_radix2(a.data(), n, inverse);
+        for (size_t i = 0; i < n; i++)
+        {
+            re[i] = a[i].real();
+            im[i] = a[i].imag();
+        }
+        return;
+    }
+
+    /** Bluestein 法 (X_k = w_k Σ (x_j w_j) conj(w_{k-j}), w_j = exp(∓iπ j^2 / n)) **/
+    size_t m = 1;
+    while (m < 2 * n - 1)
+    {
+        m <<= 1;
+    }
+    const double sign = inverse ? 1.0 : -1.0;
+    std::vector<std::complex<double>> w(n), a(m), b(m);
+    for (size_t j = 0; j < n; j++)
+    {
+        const double angle = sign * M_PI * (double)((j * j) % (2 * n)) / n; // j^2 の桁あふれ・誤差を避けるため 2n で剰余
+        w[j] = std::complex<double>(cos(angle), sin(angle));
+        a[j] = std::complex<double>(re[j], im[j]) * w[j];
+        b[j] = std::conj(w[j]);
+        if (j > 0)
+        {
+            b[m - j] = b[j];
+        }
+    }
+    Fft_radix2(a.data(), m, false);
+    Fft_radix2(b.data(), m, false);
+    for (size_t i = 0; i < m; i++)
+    {
+        a[i] *= b[i];
+    }
+    Fft_radix2(a.data(), m, true);
+    for (size_t k = 0; k < n; k++)
+    {
+        std::complex<double> value = a[k] * w[k];
+        if (inverse)
+        {
+            value /= (double)n;
+        }
+        re[k] = value.real();
+        im[k] = value.imag();
+    }
+}
+
+/**************************************************************/
+// Function name : Bandpass_fft
+// Description   : FFT によるバンドパスフィルタ (f_low ~ f_high [Hz] 以外の成分を除去, dt : サンプリング間隔 [s])
+/**************************************************************/
+inline void Bandpass_fft(const double *x, size_t n, double dt, double f_low, double f_high, double *out)
+{
+    std::vector<double> im(n, 0.0);
+    for (size_t i = 0; i < n; i++)
+    {
+        out[i] = x[i];
+    }
+    Fft(out, im.data(), n, false);
+    for (size_t k = 0; k < n; k++)
+    {
+        const double f = (k <= n / 2 ? k : n - k) / (n * dt); // 負の周波数は対称な成分として扱う [Hz]
+        if (f < f_low || f > f_high)
+        {
+            out[k] = 0;
+            im[k] = 0;
+        }
+    }
+    Fft(out, im.data(), n, true);
+}
+
+/**************************************************************/
+// Function name : Integrate_trapezoid
+// Description   : 台形則による累積積分 (t : 時刻 [s], 先頭は 0, 1つ前の値を保持するため in-place 可)
+/**************************************************************/
+inline void Integrate_trapezoid(const double *t, const double *x, size_t n, double *out)
+{
+    double sum = 0;
+    double t_prev = 0, x_prev = 0; // 1つ前の時刻・値
+    for (size_t i = 0; i < n; i++)
+    {
+        const double t_now = t[i], x_now = x[i];
+        if (i > 0)
+        {
+            sum += 0.5 * (x_now + x_prev) * (t_now - t_prev);
+        }
+        t_prev = t_now;
+        x_prev = x_now;
+        out[i] = sum;
+    }
+}
+
+/**************************************************************/
+// Function name : Statistics
+// Description   : 統計量 (NaN は除外, 平均・分散は Welford 法)
+/**************************************************************/
+inline Kernel_stats Statistics(const double *x, size_t n)
+{
+    Kernel_stats s;
+    double mean = 0, m2 = 0, sum2 = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        if (isnan(x[i]))
+        {
+            continue;
+        }
+        s.n++;
+        const double delta = x[i] - mean;
+        mean += delta / s.n;
+        m2 += delta * (x[i] - mean);
+        sum2 += x[i] * x[i];
+        s.min = s.n == 1 ? x[i] : fmin(s.min, x[i]);
+        s.max = s.n == 1 ? x[i] : fmax(s.max, x[i]);
+    }
+    if (s.n > 0)
+    {
+        s.mean = mean;
+        s.rms = sqrt(sum2 / s.n);
+    }
+    if (s.n > 1)
+    {
+        s.std = sqrt(m2 / (s.n - 1));
+    }
+    return s;
+}
+
+/**************************************************************/
+// Function name : Range_mean
+// Description   : lower <= s <= upper の区間の v の平均値 (nonzero で v = 0 を除外, 該当なしは NaN)
+/**************************************************************/
+inline double Range_mean(const double *s, const double *v, size_t n, double lower, double upper, bool nonzero)
+{
+    double sum = 0;
+    size_t count = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        if (s[i] >= lower && s[i] <= upper && !isnan(v[i]) && (!nonzero || v[i] != 0))
+        {
+            sum += v[i];
+            count++;
+        }
+    }
+    return count > 0 ? sum / count : NAN;
+}
+
+#endif
@@ -0,0 +1,215 @@
+/**************************************************************/
+// File name   : lap_timing.h
+// Author      : Masatsugu Kitadai
+// Description : 走行軌跡の周回の分割とラップタイムの計算
+//
+//   コントロールライン (線分 (x0, y0) → (x1, y1)) を右側から左側へ横切った時刻を
+//   周回の区切りとする。交差判定は空間索引で線分の近くの軌跡だけを対象にし、
+//   交差時刻は線分上の位置で線形補間する
+/**************************************************************/
+
+#ifndef LAP_TIMING_H
+#define LAP_TIMING_H
+
+#include <stddef.h>
+#include <math.h>
+#include <vector>
+#include "spatial_grid.h"
+
+/** コントロールライン **/
+struct Lap_line
+{
+    double x0 = 0, y0 = 0; // 始点 [m]
+    double x1 = 0, y1 = 0; // 終点 [m] (始点 → 終点の左向きが進行方向)
+    double min_lap = 1.0;  // 最短の周回時間 [s] (測位誤差による往復を無視)
+};
+
+/** 通過 **/
+struct Lap_crossing
+{
+    double t = 0;    // 通過時刻 [s]
+    int segment = 0; // 通過した軌跡の線分番号 (点 segment → segment+1)
+    double s = 0;    // 線分上の位置 (0 ～ 1)
+};
+
+/** 周回ごとの集計 **/
+struct Lap
+{
+    int number = 0;        // 周回番号 [-]
+    double t_start = 0;    // 開始時刻 [s]
+    double t_end = 0;      // 終了時刻 [s]
+    double duration = 0;   // 周回時間 [s]
+    double distance = 0;   // 走行距離 [m]
+    double speed_mean = 0; // 平均速度 [m/s]
+    double speed_max = 0;  // 最高速度 [m/s]
+    double radius = 0;     // 円の当てはめによる旋回半径 [m]
+    double center_x = 0;   // 旋回中心 [m]
+    double center_y = 0;   // 旋回中心 [m]
+};
+
+/**************************************************************/
+// Function name : Lap_crossings
+// Description   : コントロールラインの通過の検出 (時刻順)
+/**************************************************************/
+template <typename T>
+inline std::vector<Lap_crossing> Lap_crossings(const Spatial_grid &grid, const T *t, const T *x, const T *y, size_t n,
+                                               const Lap_line &line)
+{
+    std::vector<Lap_crossing> crossings;
+    const double dx = line.x1 - line.x0;
+    const double dy = line.y1 - line.y0;
+
+    /** ラインの外接矩形と重なる線分だけを判定 **/
+    const std::vector<int> candidates = Grid_query_unique(grid, fmin(line.x0, line.x1), fmin(line.y0, line.y1),
+                                                          fmax(line.x0, line.x1), fmax(line.y0, line.y1));
+    for (size_t k = 0; k < candidates.size(); k++)
+    {
+        const int i = candidates[k];
+        if ((size_t)i + 1 >= n)
+        {
+            continue;
+        }
+
+        /** ラインに対する符号付き距離 (左側が正) : 負 → 0 以上 の変化を通過とする **/
+        const double side0 = dx * (y[i] - line.y0) - dy * (x[i] - line.x0);
+        const double side1 = dx * (y[i + 1] - line.y0) - dy * (x[i + 1] - line.x0);
+        if (!(side0 < 0 && side1 >= 0))
+        {
+            continue;
+        }
+
+        /** 交点がライン上にあるか **/
+        const double s = side0 / (side0 - side1);
+        const double px = x[i] + s * (x[i + 1] - x[i]);
+        const double py = y[i] + s * (y[i + 1] - y[i]);
+        const double u = ((px - line.x0) * dx + (py - line.y0) * dy) / (dx * dx + dy * dy);
+        if (u < 0 || u > 1)
+        {
+            continue;
+        }
+
+        Lap_crossing c;
+        c.t = t[i] + s * (t[i + 1] - t[i]);
+        c.segment = i;
+        c.s = s;
+        crossings.push_back(c);
+    }
+
+    /** 最短周回時間より短い間隔の通過を除外 **/
+    std::vector<Lap_crossing> laps;
+    for (size_t k = 0; k < crossings.size(); k++)
+    {
+        if (laps.empty() || crossings[k].t - laps.back().t >= line.min_lap)
+        {
+            laps.push_back(crossings[k]);
+        }
+    }
+
+    return laps;
+}
+
+/**************************************************************/
+// Function name : Circle_fit
+// Description   : 最小二乗法による円の当てはめ (Kasa 法 : x² + y² + D x + E y + F = 0)
+/**************************************************************/
+template <typename T>
+inline bool Circle_fit(const T *x, const T *y, size_t begin, size_t end, double &cx, double &cy, double &radius)
+{
+    if (end - begin < 3)
+    {
+        return false;
+    }
+
+    /** 桁落ちを避けるため重心からの相対座標で計算 **/
+    double mx = 0, my = 0;
+    for (size_t i = begin; i < end; i++)
+    {
+        mx += x[i];
+        my += y[i];
+    }
+    mx /= end - begin;
+    my /= end - begin;
+
+    double suu = 0, suv = 0, svv = 0, suuu = 0, svvv = 0, suvv = 0, svuu = 0;
+    for (size_t i = begin; i < end; i++)
+    {
+        const double u = x[i] - mx;
+        const double v = y[i] - my;
+        suu += u * u;
+        suv += u * v;
+        svv += v * v;
+        suuu += u * u * u;
+        svvv += v * v * v;
+        suvv += u * v * v;
+        svuu += v * u * u;
+    }
+
+    const double det = suu * svv - suv * suv;
+    if (fabs(det) < 1e-12)
+    {
+        return false; // 直線上の点
+    }
+    const double bu = 0.5 * (suuu + suvv);
+    const double bv = 0.5 * (svvv + svuu);
+    const double uc = (bu * svv - bv * suv) / det;
+    const double vc = (bv * suu - bu * suv) / det;
+
+    cx = uc + mx;
+    cy = vc + my;
+    radius = sqrt(uc * uc + vc * vc + (suu + svv) / (end - begin));
+    return true;
+}
+
+/**************************************************************/
+// Function name : Lap_statistics
+// Description   : 通過時刻で区切った周回ごとの集計
+/**************************************************************/
+template <typename T>
+inline std::vector<Lap> Lap_statistics(const std::vector<Lap_crossing> &crossings, const T *t, const T *x, const T *y)
+{
+    std::vector<Lap> laps;
+    for (size_t k = 0; k + 1 < crossings.size(); k++)
+    {
+        const Lap_crossing &a = crossings[k];
+        const Lap_crossing &b = crossings[k + 1];
+
+        Lap lap;
+        lap.number = k + 1;
+        lap.t_start = a.t;
+        lap.t_end = b.t;
+        lap.duration = b.t - a.t;
+
+        /** 通過点から通過点までの距離と速度 (端の線分は交点までの割合を使用) **/
+        for (int i = a.segment; i <= b.segment; i++)
+        {
+            const double length = hypot(x[i + 1] - x[i], y[i + 1] - y[i]);
+            const double dt = t[i + 1] - t[i];
+            double ratio = 1.0;
+            if (i == a.segment)
+            {
+                ratio -= a.s;
+            }
+            if (i == b.segment)
+            {
+                ratio -= 1.0 - b.s;
+            }
+            lap.distance += length * ratio;
+            if (dt > 0)
+            {
+                lap.speed_max = fmax(lap.speed_max, length / dt);
+            }
+        }
+        lap.speed_mean = lap.duration > 0 ? lap.distance / lap.duration : 0;
+
+        if (!Circle_fit(x, y, a.segment + 1, b.segment + 1, lap.center_x, lap.center_y, lap.radius))
+        {
+            lap.radius = INFINITY;
+            lap.center_x = lap.center_y = NAN;
+        }
+        laps.push_back(lap);
+    }
+
+    return laps;
+}
+
+#endif
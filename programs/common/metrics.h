@@ -0,0 +1,249 @@
+/**************************************************************/
+// File name   : metrics.h
+// Author      : Masatsugu Kitadai
+// Description : 処理時間・処理量の計測と JSON での出力
+//
+//   段階 (stage)  : Metrics_timer の生存期間の合計時間と呼び出し回数 (読み込み・計算・書き出し・描画)
+//   カウンタ      : Metrics_add で加算した処理量 (サンプル数・読み書きしたバイト数・描画フレーム数) と処理速度
+//   最大メモリ使用量 (peak RSS) は getrusage で取得する
+//
+//   環境変数
+//     METRICS_JSON     : 終了時の出力先 (省略時・"-" は標準エラー出力, "off" で出力しない)
+//     METRICS_INTERVAL : 実行中に集計値を標準エラー出力へ書き出す間隔 [s] (省略時は出力しない)
+//   カウンタ・段階の更新はロックを取るため、サンプル単位ではなくループ単位でまとめて加算する
+/**************************************************************/
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+#include <string>
+#include <map>
+#include <thread>
+#include <mutex>
+#include <chrono>
+#include <condition_variable>
+
+/** 段階ごとの集計 **/
+struct Metrics_stage
+{
+    double seconds = 0; // 合計時間 [s]
+    long calls = 0;     // 呼び出し回数 [-]
+};
+
+/** 計測の状態 **/
+struct Metrics_state
+{
+    std::string program;                         // プログラム名
+    std::string output;                          // 終了時の出力先 (空の場合は標準エラー出力)
+    double wall_start = 0;                       // 開始時刻 [s]
+    double interval = 0;                         // 実行中の出力間隔 [s]
+    std::map<std::string, Metrics_stage> stages; // 段階ごとの時間
+    std::map<std::string, double> counters;      // カウンタ
+    std::mutex mtx;                              // 集計値の保護用
+    std::thread reporter;                        // 実行中の出力スレッド
+    std::condition_variable cv_close;            // 終了通知
+    bool started = false;                        // 計測中
+    bool closing = false;                        // 終了要求
+};
+
+inline Metrics_state metrics;
+
+/**************************************************************/
+// Function name : Metrics_time
+// Description   : 経過時間計測用の時刻 [s]
+/**************************************************************/
+inline double Metrics_time()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**************************************************************/
+// Function name : Metrics_peak_rss
+// Description   : 最大メモリ使用量 [kB]
+/**************************************************************/
+inline long Metrics_peak_rss()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss; // Linux では [kB]
+}
+
+/**************************************************************/
+// Function name : Metrics_add
+// Description   : カウンタへの加算
+/**************************************************************/
+inline void Metrics_add(const char *name, double value)
+{
+    std::lock_guard<std::mutex> lock(metrics.mtx);
+    metrics.counters[name] += value;
+}
+
+/**************************************************************/
+// Function name : Metrics_stage_add
+// Description   : 段階の時間の加算
+/**************************************************************/
+inline void Metrics_stage_add(const char *name, double seconds)
+{
+    std::lock_guard<std::mutex> lock(metrics.mtx);
+    Metrics_stage &stage = metrics.stages[name];
+    stage.seconds += seconds;
+    stage.calls += 1;
+}
+
+/** 生存期間 (または Stop までの時間) を段階の時間として加算するタイマー **/
+struct Metrics_timer
+{
+    const char *name; // 段階名 (加算済みの場合は NULL)
+    double start;     // 開始時刻 [s]
+
+    explicit Metrics_timer(const char *stage_name) : name(stage_name), start(Metrics_time()) {}
+    ~Metrics_timer() { Stop(); }
+
+    void Stop()
+    {
+        if (name != NULL)
+        {
+            Metrics_stage_add(name, Metrics_time() - start);
+            name = NULL;
+        }
+    }
+};
+
+/**************************************************************/
+// Function name : Metrics_fclose
+// Description   : ファイルを閉じて書き出したバイト数を加算 (fclose の代替)
+/**************************************************************/
+inline int Metrics_fclose(FILE *fp)
+{
+    const long size = ftell(fp);
+    if (size > 0)
+    {
+        Metrics_add("bytes_written", size);
+    }
+    return fclose(fp);
+}
+
+/**************************************************************/
+// Function name : Metrics_json
+// Description   : 集計値の JSON 文字列 (1行)
+/**************************************************************/
+inline std::string Metrics_json(bool final)
+{
+    std::lock_guard<std::mutex> lock(metrics.mtx);
+    const double elapsed = Metrics_time() - metrics.wall_start;
+    char buf[256];
+    std::string json;
+
+    snprintf(buf, sizeof(buf), "{\"program\": \"%s\", \"final\": %s, \"elapsed\": %.6f, \"peak_rss_kb\": %ld, \"stages\": {",
+             metrics.program.c_str(), final ? "true" : "false", elapsed, Metrics_peak_rss());
+    json += buf;
+    for (auto it = metrics.stages.begin(); it != metrics.stages.end(); ++it)
+    {
+        snprintf(buf, sizeof(buf), "%s\"%s\": {\"seconds\": %.6f, \"calls\": %ld, \"share\": %.4f}",
+                 it == metrics.stages.begin() ? "" : ", ", it->first.c_str(), it->second.seconds, it->second.calls,
+                 elapsed > 0 ? it->second.seconds / elapsed : 0.0);
+        json += buf;
+    }
+    json += "}, \"counters\": {";
+    for (auto it = metrics.counters.begin(); it != metrics.counters.end(); ++it)
+    {
+        snprintf(buf, sizeof(buf), "%s\"%s\": {\"total\": %.0f, \"rate\": %.3f}",
+                 it == metrics.counters.begin() ? "" : ", ", it->first.c_str(), it->second,
+                 elapsed > 0 ? it->second / elapsed : 0.0);
+        json += buf;
+    }
+    json += "}}\n";
+    return json;
+}
+
+/**************************************************************/
+// Function name : Metrics_reporter
+// Description   : 一定間隔で集計値を標準エラー出力へ書き出す
+/**************************************************************/
+inline void Metrics_reporter()
+{
+    std::unique_lock<std::mutex> lock(metrics.mtx);
+    while (!metrics.cv_close.wait_for(lock, std::chrono::duration<double>(metrics.interval), []
+                                      { return metrics.closing; }))
+    {
+        lock.unlock();
+        fputs(Metrics_json(false).c_str(), stderr);
+        lock.lock();
+    }
+}
+
+/**************************************************************/
+// Function name : Metrics_finish
+// Description   : 計測の終了と集計値の書き出し (Metrics_start で終了時に自動で呼ばれる)
+/**************************************************************/
+inline void Metrics_finish()
+{
+    if (!metrics.started)
+    {
+        return;
+    }
+    metrics.started = false;
+
+    {
+        std::lock_guard<std::mutex> lock(metrics.mtx);
+        metrics.closing = true;
+    }
+    metrics.cv_close.notify_all();
+    if (metrics.reporter.joinable())
+    {
+        metrics.reporter.join();
+    }
+
+    if (metrics.output == "off")
+    {
+        return;
+    }
+    const std::string json = Metrics_json(true);
+    FILE *fp = metrics.output.empty() || metrics.output == "-" ? stderr : fopen(metrics.output.c_str(), "w");
+    if (fp == NULL)
+    {
+        fprintf(stderr, "Cannot open: %s\n", metrics.output.c_str());
+        return;
+    }
+    fputs(json.c_str(), fp);
+    if (fp != stderr)
+    {
+        fclose(fp);
+    }
+}
+
+/**************************************************************/
+// Function name : Metrics_start
+// Description   : 計測の開始 (program : 出力に記録するプログラム名)
+/**************************************************************/
+inline void Metrics_start(const char *program)
+{
+    if (metrics.started)
+    {
+        return;
+    }
+    metrics.program = program;
+    metrics.wall_start = Metrics_time();
+    metrics.started = true;
+    metrics.closing = false;
+
+    const char *output = getenv("METRICS_JSON");
+    const char *interval = getenv("METRICS_INTERVAL");
+    metrics.output = output != NULL ? output : "";
+    metrics.interval = interval != NULL ? atof(interval) : 0.0;
+    if (metrics.interval > 0)
+    {
+        metrics.reporter = std::thread(Metrics_reporter);
+    }
+
+    atexit(Metrics_finish); // main の return・exit のどちらでも書き出す
+}
+
+#endif
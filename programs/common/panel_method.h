@@ -0,0 +1,250 @@
+/**************************************************************/
+// File name   : panel_method.h
+// Author      : Masatsugu Kitadai
+// Description : 線形分布渦パネル法による2次元翼型の非粘性解析
+//
+//   翼面を N 枚のパネルに分け、節点 N+1 点の渦度 γ を未知数とする (Katz & Plotkin, Low-Speed Aerodynamics 11.4)
+//     各パネル中点で法線方向速度 0 (N 式) と後縁のクッタ条件 γ_1 + γ_{N+1} = 0 (1 式)
+//   影響係数行列は形状のみで決まるため、LU 分解は翼型ごとに1回だけ行い、迎角ごとには右辺の前進・後退代入のみを行う
+//   一様流速 1・翼弦長 1 (airfoil.h で正規化済み) として Cp・Cl・Cm (1/4 翼弦まわり, 頭上げ正) を計算する
+/**************************************************************/
+
+#ifndef PANEL_METHOD_H
+#define PANEL_METHOD_H
+
+#include <math.h>
+#include <vector>
+#include "airfoil.h"
+
+/** パネル形状と分解済みの影響係数 **/
+struct Panel_solver
+{
+    int n = 0;                  // パネル数 [-]
+    std::vector<double> xm, ym; // パネル中点 [-]
+    std::vector<double> length; // パネル長さ [-]
+    std::vector<double> sn, cs; // パネル角度の sin・cos [-]
+    std::vector<double> a;      // 法線方向の影響係数 ((n+1) × (n+1), LU 分解後)
+    std::vector<double> b;      // 接線方向の影響係数 (n × (n+1))
+    std::vector<int> pivot;     // LU 分解の行交換 [-]
+    bool ok = false;            // 分解の成否
+};
+
+/** 迎角ごとの解 **/
+struct Panel_result
+{
+    double alpha = 0;       // 迎角 [deg]
+    double cl = 0;          // 揚力係数 [-]
+    double cm = 0;          // 1/4 翼弦まわりのピッチングモーメント係数 [-]
+    std::vector<double> cp; // パネル中点の圧力係数 [-]
+};
+
+/**************************************************************/
+// Function name : Lu_factor
+// Description   : 部分ピボット選択付き LU 分解 (m × m, 行優先, in-place)
+/**************************************************************/
+inline bool Lu_factor(std::vector<double> &a, std::vector<int> &pivot, int m)
+{
+    pivot.resize(m);
+    for (int k = 0; k < m; k++)
+    {
+        int p = k;
+        for (int i = k + 1; i < m; i++)
+        {
+            if (fabs(a[i * m + k]) > fabs(a[p * m + k]))
+            {
+                p = i;
+            }
+        }
+        pivot[k] = p;
+        if (a[p * m + k] == 0)
+        {
+            return false; // 特異
+        }
+        if (p != k)
+        {
+            for (int j = 0; j < m; j++)
+            {
+                std::swap(a[k * m + j], a[p * m + j]);
+            }
+        }
+        const double inv = 1.0 / a[k * m + k];
+        for (int i = k + 1; i < m; i++)
+        {
+            const double f = a[i * m + k] *= inv;
+            if (f == 0)
+            {
+                continue;
+            }
+            double *row = &a[i * m];
+            const double *row_k = &a[k * m];
+            for (int j = k + 1; j < m; j++)
+            {
+                row[j] -= f * row_k[j];
+            }
+        }
+    }
+    return true;
+}
+
+/**************************************************************/
+// Function name : Lu_solve
+// Description   : LU 分解済みの行列での求解 (x : 右辺 → 解)
+/**************************************************************/
+inline void Lu_solve(const std::vector<double> &a, const std::vector<int> &pivot, int m, double *x)
+{
+    for (int k = 0; k < m; k++)
+    {
+        std::swap(x[k], x[pivot[k]]);
+    }
+    for (int i = 1; i < m; i++)
+    {
+        double sum = x[i];
+        for (int j = 0; j < i; j++)
+        {
+            sum -= a[i * m + j] * x[j];
+        }
+        x[i] = sum;
+    }
+    for (int i = m - 1; i >= 0; i--)
+    {
+        double sum = x[i];
+        for (int j = i + 1; j < m; j++)
+        {
+            sum -= a[i * m + j] * x[j];
+        }
+        x[i] = sum / a[i * m + i];
+    }
+}
+
+/**************************************************************/
+// Function name : Panel_init
+// Description   : 影響係数行列の作成と LU 分解 (af : 正規化済みの Selig 形式の翼型)
+/**************************************************************/
+inline bool Panel_init(Panel_solver &ps, const Airfoil &af)
+{
+    /** 節点は後縁 → 下面 → 前縁 → 上面 → 後縁 (時計回り) の順とし、法線 (-sin, cos) を外向きにする **/
+    const int n = af.x.size() - 1;
+    std::vector<double> px(n + 1), py(n + 1);
+    for (int i = 0; i <= n; i++)
+    {
+        px[i] = af.x[n - i];
+        py[i] = af.y[n - i];
+    }
+
+    ps.n = n;
+    ps.xm.resize(n);
+    ps.ym.resize(n);
+    ps.length.resize(n);
+    ps.sn.resize(n);
+    ps.cs.resize(n);
+    for (int j = 0; j < n; j++)
+    {
+        ps.xm[j] = 0.5 * (px[j] + px[j + 1]);
+        ps.ym[j] = 0.5 * (py[j] + py[j + 1]);
+        ps.length[j] = hypot(px[j + 1] - px[j], py[j + 1] - py[j]);
+        ps.sn[j] = (py[j + 1] - py[j]) / ps.length[j];
+        ps.cs[j] = (px[j + 1] - px[j]) / ps.length[j];
+    }
+
+    /** 影響係数 (パネル j の始点・終点の渦度がパネル i の中点に誘起する速度) **/
+    const int m = n + 1;
+    const double inv_2pi = 0.5 / M_PI;
+    ps.a.assign(m * m, 0.0);
+    ps.b.assign(n * m, 0.0);
+    for (int i = 0; i < n; i++)
+    {
+        for (int j = 0; j < n; j++)
+        {
+            /** パネル j の座標系での中点 i の位置 **/
+            const double dx = ps.xm[i] - px[j];
+            const double dy = ps.ym[i] - py[j];
+            const double x = dx * ps.cs[j] + dy * ps.sn[j];
+            const double z = -dx * ps.sn[j] + dy * ps.cs[j];
+            const double l = ps.length[j];
+
+            double u1, u2, w1, w2; // 始点・終点の単位渦度による誘起速度 (パネル座標系)
+            if (i == j)
+            {
+                u1 = -0.5 * (x - l) / l;
+                u2 = 0.5 * x / l;
+                w1 = -inv_2pi;
+                w2 = inv_2pi;
+            }
+            else
+            {
+                const double r1 = hypot(x, z);
+                const double r2 = hypot(x - l, z);
+                const double dth = atan2(z, x - l) - atan2(z, x);
+                const double log_r = log(r2 / r1);
+                u1 = -(z * log_r + x * dth - l * dth) * inv_2pi / l;
+                u2 = (z * log_r + x * dth) * inv_2pi / l;
+                w1 = -((l - z * dth) + x * log_r - l * log_r) * inv_2pi / l;
+                w2 = ((l - z * dth) + x * log_r) * inv_2pi / l;
+            }
+
+            /** 全体座標系へ戻し、パネル i の法線・接線方向成分を加算 **/
+            const double gu1 = u1 * ps.cs[j] - w1 * ps.sn[j];
+            const double gw1 = u1 * ps.sn[j] + w1 * ps.cs[j];
+            const double gu2 = u2 * ps.cs[j] - w2 * ps.sn[j];
+            const double gw2 = u2 * ps.sn[j] + w2 * ps.cs[j];
+            ps.a[i * m + j] += -gu1 * ps.sn[i] + gw1 * ps.cs[i];
+            ps.a[i * m + j + 1] += -gu2 * ps.sn[i] + gw2 * ps.cs[i];
+            ps.b[i * m + j] += gu1 * ps.cs[i] + gw1 * ps.sn[i];
+            ps.b[i * m + j + 1] += gu2 * ps.cs[i] + gw2 * ps.sn[i];
+        }
+    }
+
+    /** クッタ条件 **/
+    ps.a[n * m + 0] = 1.0;
+    ps.a[n * m + n] = 1.0;
+
+    ps.ok = Lu_factor(ps.a, ps.pivot, m);
+    return ps.ok;
+}
+
+/**************************************************************/
+// Function name : Panel_solve
+// Description   : 迎角 alpha [deg] での Cp・Cl・Cm の計算 (分解済みの行列を再利用)
+/**************************************************************/
+inline void Panel_solve(const Panel_solver &ps, double alpha, Panel_result &result)
+{
+    const int n = ps.n;
+    const int m = n + 1;
+    const double ca = cos(alpha * M_PI / 180.0);
+    const double sa = sin(alpha * M_PI / 180.0);
+
+    /** 右辺 (一様流の法線方向成分を打ち消す) と求解 **/
+    std::vector<double> gamma(m);
+    for (int i = 0; i < n; i++)
+    {
+        gamma[i] = ps.sn[i] * ca - ps.cs[i] * sa;
+    }
+    gamma[n] = 0.0;
+    Lu_solve(ps.a, ps.pivot, m, gamma.data());
+
+    /** 接線方向速度と Cp, 圧力の積分による力・モーメント **/
+    result.alpha = alpha;
+    result.cp.resize(n);
+    double fx = 0, fy = 0, moment = 0;
+    for (int i = 0; i < n; i++)
+    {
+        double vt = ps.cs[i] * ca + ps.sn[i] * sa;
+        const double *row = &ps.b[i * m];
+        for (int j = 0; j < m; j++)
+        {
+            vt += row[j] * gamma[j];
+        }
+        const double cp = 1.0 - vt * vt;
+        result.cp[i] = cp;
+
+        const double dfx = cp * ps.length[i] * ps.sn[i]; // -Cp l n (n = (-sin, cos))
+        const double dfy = -cp * ps.length[i] * ps.cs[i];
+        fx += dfx;
+        fy += dfy;
+        moment += -((ps.xm[i] - 0.25) * dfy - ps.ym[i] * dfx);
+    }
+    result.cl = fy * ca - fx * sa;
+    result.cm = moment;
+}
+
+#endif
@@ -0,0 +1,246 @@
+/**************************************************************/
+// File name   : path_query.h
+// Author      : Masatsugu Kitadai
+// Description : 基準経路 (真値・測量した走行ライン) に対する推定経路の誤差
+//
+//   横方向誤差 (cross-track) : 基準経路の最寄りの線分までの符号付き距離 (左側が正)
+//   前後方向誤差 (along-track) : 同時刻の基準点からの変位の進行方向成分
+//   最寄りの線分は空間索引の格子を近い順に探索し、同時刻の基準点は時刻の二分探索で求める。
+//   多数の点の問い合わせはスレッドに分割して処理する
+/**************************************************************/
+
+#ifndef PATH_QUERY_H
+#define PATH_QUERY_H
+
+#include <stddef.h>
+#include <math.h>
+#include <vector>
+#include <thread>
+#include <algorithm>
+#include "spatial_grid.h"
+
+/** 基準経路 **/
+struct Reference_path
+{
+    std::vector<double> t; // 時刻 [s]
+    std::vector<double> x; // x方向位置 [m]
+    std::vector<double> y; // y方向位置 [m]
+    std::vector<double> s; // 始点からの経路長 [m]
+    Spatial_grid grid;     // 線分の空間索引
+};
+
+/** 最寄りの線分 **/
+struct Path_match
+{
+    int segment = -1;      // 線分番号 (点 segment → segment+1)
+    double u = 0;          // 線分上の位置 (0 ～ 1)
+    double along = 0;      // 投影点の経路長 [m]
+    double cross = 0;      // 符号付き距離 (進行方向の左側が正) [m]
+    double distance = NAN; // 距離 [m]
+};
+
+/**************************************************************/
+// Function name : Reference_path_build
+// Description   : 基準経路の作成 (t が NULL の場合は点番号を時刻とする)
+/**************************************************************/
+template <typename T>
+inline void Reference_path_build(Reference_path &ref, const T *t, const T *x, const T *y, size_t n)
+{
+    ref.t.resize(n);
+    ref.x.assign(x, x + n);
+    ref.y.assign(y, y + n);
+    ref.s.assign(n, 0.0);
+    for (size_t i = 0; i < n; i++)
+    {
+        ref.t[i] = t != NULL ? t[i] : i;
+        if (i > 0)
+        {
+            ref.s[i] = ref.s[i - 1] + hypot(ref.x[i] - ref.x[i - 1], ref.y[i] - ref.y[i - 1]);
+        }
+    }
+    Grid_build(ref.grid, ref.x.data(), ref.y.data(), n);
+}
+
+/**************************************************************/
+// Function name : Path_segment_distance2
+// Description   : 点 (px, py) から線分 i までの距離の2乗 (u : 線分上の最近点の位置)
+/**************************************************************/
+inline double Path_segment_distance2(const Reference_path &ref, int i, double px, double py, double &u)
+{
+    const double ax = ref.x[i], ay = ref.y[i];
+    const double dx = ref.x[i + 1] - ax;
+    const double dy = ref.y[i + 1] - ay;
+    const double length2 = dx * dx + dy * dy;
+    u = length2 > 0 ? ((px - ax) * dx + (py - ay) * dy) / length2 : 0;
+    u = u < 0 ? 0 : u > 1 ? 1 : u;
+
+    const double ex = px - (ax + u * dx);
+    const double ey = py - (ay + u * dy);
+    return ex * ex + ey * ey;
+}
+
+/**************************************************************/
+// Function name : Path_nearest
+// Description   : 最寄りの線分の探索 (点を含む格子から外側の格子へ1周ずつ広げる)
+/**************************************************************/
+inline Path_match Path_nearest(const Reference_path &ref, double px, double py)
+{
+    Path_match best;
+    const Spatial_grid &grid = ref.grid;
+    if (grid.nx == 0)
+    {
+        return best;
+    }
+
+    const double gx = (px - grid.x_min) / grid.cell;
+    const double gy = (py - grid.y_min) / grid.cell;
+    const int ci = (int)floor(gx);
+    const int cj = (int)floor(gy);
+    const double margin = std::min(std::min(gx - ci, ci + 1 - gx), std::min(gy - cj, cj + 1 - gy)) * grid.cell; // 点から自分の格子の境界までの距離 [m]
+    const int r_max = std::max(std::max(abs(ci), abs(grid.nx - 1 - ci)), std::max(abs(cj), abs(grid.ny - 1 - cj)));
+
+    int best_i = -1;           // 最寄りの線分番号
+    double best_u = 0;         // 線分上の位置
+    double best_d2 = INFINITY; // 距離の2乗 [m2]
+    for (int r = 0; r <= r_max; r++)
+    {
+        /** 周回 r の格子 (|di| == r または |dj| == r) **/
+        for (int j = cj - r; j <= cj + r; j++)
+        {
+            if (j < 0 || j >= grid.ny)
+            {
+                continue;
+            }
+            const int step = (j == cj - r || j == cj + r) ? 1 : 2 * r;
+            for (int i = ci - r; i <= ci + r; i += step)
+            {
+                if (i < 0 || i >= grid.nx)
+                {
+                    continue;
+                }
+                const size_t c = (size_t)j * grid.nx + i;
+                for (int k = grid.start[c]; k < grid.start[c + 1]; k++)
+                {
+                    const int s = grid.segments[k];
+                    double u;
+                    const double d2 = Path_segment_distance2(ref, s, px, py, u);
+                    if (d2 < best_d2 || (d2 == best_d2 && s < best_i))
+                    {
+                        best_i = s;
+                        best_u = u;
+                        best_d2 = d2;
+                    }
+                }
+            }
+        }
+
+        /** 次の周回の格子は全て r × cell + margin 以上離れている **/
+        const double reach = r * grid.cell + margin;
+        if (best_i >= 0 && best_d2 <= reach * reach)
+        {
+            break;
+        }
+    }
+
+    /** 投影点の経路長と符号付き距離 **/
+    const double dx = ref.x[best_i + 1] - ref.x[best_i];
+    const double dy = ref.y[best_i + 1] - ref.y[best_i];
+    best.segment = best_i;
+    best.u = best_u;
+    best.distance = sqrt(best_d2);
+    best.along = ref.s[best_i] + best_u * (ref.s[best_i + 1] - ref.s[best_i]);
+    best.cross = dx * (py - ref.y[best_i]) - dy * (px - ref.x[best_i]) >= 0 ? best.distance : -best.distance; // 線分の端点の外側では端点までの距離
+
+    return best;
+}
+
+/**************************************************************/
+// Function name : Path_at_time
+// Description   : 時刻 t の基準点と進行方向の単位ベクトル (時刻の二分探索と線形補間)
+/**************************************************************/
+inline bool Path_at_time(const Reference_path &ref, double t, double &x, double &y, double &tx, double &ty)
+{
+    const size_t n = ref.t.size();
+    if (n < 2 || t < ref.t[0] || t > ref.t[n - 1])
+    {
+        return false;
+    }
+    size_t i = std::upper_bound(ref.t.begin(), ref.t.end(), t) - ref.t.begin();
+    i = i == 0 ? 0 : i - 1;
+    if (i > n - 2)
+    {
+        i = n - 2;
+    }
+    const double h = ref.t[i + 1] - ref.t[i];
+    const double w = h > 0 ? (t - ref.t[i]) / h : 0;
+    x = ref.x[i] + w * (ref.x[i + 1] - ref.x[i]);
+    y = ref.y[i] + w * (ref.y[i + 1] - ref.y[i]);
+
+    /** 停止中の区間は前後の移動している線分の向きを使う **/
+    size_t a = i, b = i + 1;
+    while (ref.x[a] == ref.x[b] && ref.y[a] == ref.y[b])
+    {
+        if (b + 1 < n)
+        {
+            b++;
+        }
+        else if (a > 0)
+        {
+            a--;
+        }
+        else
+        {
+            tx = ty = 0;
+            return true;
+        }
+    }
+    const double length = hypot(ref.x[b] - ref.x[a], ref.y[b] - ref.y[a]);
+    tx = (ref.x[b] - ref.x[a]) / length;
+    ty = (ref.y[b] - ref.y[a]) / length;
+    return true;
+}
+
+/**************************************************************/
+// Function name : Path_errors
+// Description   : 推定経路の各点の横方向誤差・前後方向誤差 (スレッドに分割して計算)
+//                 t が NULL の場合・基準経路の時刻範囲外の点は前後方向誤差を NAN とする
+/**************************************************************/
+template <typename T>
+inline void Path_errors(const Reference_path &ref, const T *t, const T *x, const T *y, size_t n,
+                        double *cross, double *along, int workers = 0)
+{
+    if (workers <= 0)
+    {
+        workers = std::max(1u, std::thread::hardware_concurrency());
+    }
+    const size_t min_block = 4096; // 1スレッドの最小点数 [-]
+    workers = std::max(1, std::min(workers, (int)(n / min_block)));
+
+    auto work = [&](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; i++)
+        {
+            const Path_match m = Path_nearest(ref, x[i], y[i]);
+            cross[i] = m.cross;
+
+            double rx, ry, tx, ty;
+            if (along != NULL)
+            {
+                along[i] = t != NULL && Path_at_time(ref, t[i], rx, ry, tx, ty) ? (x[i] - rx) * tx + (y[i] - ry) * ty : NAN;
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int w = 1; w < workers; w++)
+    {
+        threads.emplace_back(work, n * w / workers, n * (w + 1) / workers);
+    }
+    work(0, n / workers);
+    for (size_t w = 0; w < threads.size(); w++)
+    {
+        threads[w].join();
+    }
+}
+
+#endif
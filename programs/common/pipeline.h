@@ -0,0 +1,639 @@
+/**************************************************************/
+// File name   : pipeline.h
+// Author      : Masatsugu Kitadai
+// Description : 段階 (stage) の依存関係に基づく処理の実行
+//               (入力ファイルの内容・コマンド・パラメータのハッシュが前回と同じ段階は省略し、
+//                依存関係のない段階は並列に実行する)
+//
+//   定義ファイルの書式 (# 以降はコメント, 同じキーは複数行に分けて指定可能)
+//     [段階名]
+//     input  = 入力ファイル・ディレクトリ (空白区切り, ディレクトリは中の全ファイル)
+//     output = 出力ファイル・ディレクトリ (実行前に削除)
+//     param  = 名前=値 (環境変数としてコマンドへ渡す)
+//     after  = 先に実行する段階名 (入出力で依存関係が決まらない場合)
+//     run    = 実行するコマンド (sh -c)
+//   ある段階の入力が他の段階の出力 (またはその中のファイル) の場合は、その段階の後に実行する
+/**************************************************************/
+
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdint.h>
+#include <sys/wait.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <deque>
+#include <algorithm>
+#include <filesystem>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "metrics.h"
+
+/** 段階の状態 **/
+enum Pipeline_status
+{
+    pipeline_pending, // 未実行
+    pipeline_run,     // 実行済み
+    pipeline_skip,    // 前回から変更がないため省略
+    pipeline_fail,    // 失敗
+    pipeline_blocked, // 依存する段階の失敗により未実行
+};
+
+/** 段階 **/
+struct Pipeline_stage
+{
+    std::string name;                          // 段階名
+    std::vector<std::string> inputs;           // 入力ファイル・ディレクトリ
+    std::vector<std::string> outputs;          // 出力ファイル・ディレクトリ
+    std::vector<std::string> params;           // パラメータ (名前=値)
+    std::vector<std::string> after;            // 先に実行する段階名
+    std::string command;                       // コマンド
+    std::vector<int> deps;                     // 依存する段階の番号
+    std::vector<int> users;                    // この段階に依存する段階の番号
+    Pipeline_status status = pipeline_pending; // 実行結果
+    bool selected = true;                      // 実行対象
+    int waiting = 0;                           // 未完了の依存段階の数 [-]
+    uint64_t key = 0;                          // 入力・コマンド・パラメータのハッシュ
+    double seconds = 0;                        // 実行時間 [s]
+    std::string log;                           // コマンドの出力
+};
+
+/** 実行の状態 **/
+struct Pipeline
+{
+    std::vector<Pipeline_stage> stages;    // 段階 (定義ファイルの順)
+    std::map<std::string, uint64_t> state; // 前回成功時の段階ごとのハッシュ
+    std::string state_file;                // ハッシュの保存先
+    bool force = false;                    // 変更がなくても実行
+    bool dry_run = false;                  // 実行せずに判定のみ
+};
+
+const uint64_t fnv_offset = 14695981039346656037ULL; // FNV-1a の初期値
+const uint64_t fnv_prime = 1099511628211ULL;         // FNV-1a の乗数
+
+/**************************************************************/
+// Function name : Fnv_hash
+// Description   : FNV-1a ハッシュへのバイト列の追加
+/**************************************************************/
+inline uint64_t Fnv_hash(uint64_t hash, const void *data, size_t size)
+{
+    const unsigned char *p = (const unsigned char *)data;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= p[i];
+        hash *= fnv_prime;
+    }
+    return hash;
+}
+
+inline uint64_t Fnv_hash(uint64_t hash, const std::string &text)
+{
+    return Fnv_hash(hash, text.c_str(), text.size() + 1); // 終端文字も含めて区切りとする
+}
+
+/**************************************************************/
+// Function name : Hash_file
+// Description   : ファイルの内容のハッシュへの追加
+/**************************************************************/
+inline uint64_t Hash_file(uint64_t hash, const std::string &path)
+{
+    FILE *fp = fopen(path.c_str(), "rb");
+    if (fp == NULL)
+    {
+        return Fnv_hash(hash, "<unreadable>");
+    }
+    static thread_local std::vector<char> buffer(1 << 20);
+    size_t size, total = 0;
+    while ((size = fread(buffer.data(), 1, buffer.size(), fp)) > 0)
+    {
+        hash = Fnv_hash(hash, buffer.data(), size);
+        total += size;
+    }
+    fclose(fp);
+    Metrics_add("bytes_hashed", total);
+    return hash;
+}
+
+/**************************************************************/
+// Function name : Hash_path
+// Description   : 入力のハッシュへの追加 (ディレクトリは中のファイルをパスの順に追加)
+/**************************************************************/
+inline uint64_t Hash_path(uint64_t hash, const std::string &path)
+{
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    hash = Fnv_hash(hash, path);
+    if (fs::is_directory(path, ec))
+    {
+        std::vector<std::string> files;
+        for (fs::recursive_directory_iterator it(path, ec), end; !ec && it != end; it.increment(ec))
+        {
+            if (it->is_regular_file(ec))
+            {
+                files.push_back(it->path().string());
+            }
+        }
+        std::sort(files.begin(), files.end());
+        for (const std::string &file : files)
+        {
+            hash = Hash_file(Fnv_hash(hash, file), file);
+        }
+    }
+    else if (fs::exists(path, ec))
+    {
+        hash = Hash_file(hash, path);
+    }
+    else
+    {
+        hash = Fnv_hash(hash, "<missing>");
+    }
+    return hash;
+}
+
+/**************************************************************/
+// Function name : Split_words
+// Description   : 空白区切りの文字列の分割
+/**************************************************************/
+inline void Split_words(const std::string &text, std::vector<std::string> &words)
+{
+    size_t i = 0;
+    while (i < text.size())
+    {
+        while (i < text.size() && isspace((unsigned char)text[i]))
+        {
+            i++;
+        }
+        size_t j = i;
+        while (j < text.size() && !isspace((unsigned char)text[j]))
+        {
+            j++;
+        }
+        if (j > i)
+        {
+            words.push_back(text.substr(i, j - i));
+        }
+        i = j;
+    }
+}
+
+/**************************************************************/
+// Function name : Trim
+// Description   : 前後の空白の削除
+/**************************************************************/
+inline std::string Trim(const std::string &text)
+{
+    size_t begin = 0, end = text.size();
+    while (begin < end && isspace((unsigned char)text[begin]))
+    {
+        begin++;
+    }
+    while (end > begin && isspace((unsigned char)text[end - 1]))
+    {
+        end--;
+    }
+    return text.substr(begin, end - begin);
+}
+
+/**************************************************************/
+// Function name : Pipeline_inside
+// Description   : path が base と同じか base のディレクトリ内にあるか
+/**************************************************************/
+inline bool Pipeline_inside(const std::string &path, const std::string &base)
+{
+    if (base == ".")
+    {
+        return true;
+    }
+    return path == base || (path.size() > base.size() && path.compare(0, base.size(), base) == 0 &&
+                            (base.back() == '/' || path[base.size()] == '/'));
+}
+
+/**************************************************************/
+// Function name : Pipeline_load
+// Description   : 定義ファイルの読み込みと依存関係の作成
+/**************************************************************/
+inline bool Pipeline_load(const char *filename, Pipeline &pl)
+{
+    FILE *fp = fopen(filename, "r");
+    if (fp == NULL)
+    {
+        printf("Cannot open: %s\n", filename);
+        return false;
+    }
+
+    /** 定義の読み込み **/
+    char line[4096];
+    int line_number = 0;
+    bool ok = true;
+    while (fgets(line, sizeof(line), fp) != NULL)
+    {
+        line_number++;
+        std::string text = line;
+        const size_t comment = text.find('#');
+        if (comment != std::string::npos)
+        {
+            text.erase(comment);
+        }
+        text = Trim(text);
+        if (text.empty())
+        {
+            continue;
+        }
+
+        if (text.front() == '[' && text.back() == ']')
+        {
+            Pipeline_stage stage;
+            stage.name = Trim(text.substr(1, text.size() - 2));
+            pl.stages.push_back(stage);
+            continue;
+        }
+
+        const size_t equal = text.find('=');
+        if (pl.stages.empty() || equal == std::string::npos)
+        {
+            printf("%s:%d: syntax error\n", filename, line_number);
+            ok = false;
+            continue;
+        }
+        Pipeline_stage &stage = pl.stages.back();
+        const std::string key = Trim(text.substr(0, equal));
+        const std::string value = Trim(text.substr(equal + 1));
+        if (key == "input")
+        {
+            Split_words(value, stage.inputs);
+        }
+        else if (key == "output")
+        {
+            Split_words(value, stage.outputs);
+        }
+        else if (key == "after")
+        {
+            Split_words(value, stage.after);
+        }
+        else if (key == "param")
+        {
+            stage.params.push_back(value);
+        }
+        else if (key == "run")
+        {
+            stage.command += stage.command.empty() ? value : " && " + value;
+        }
+        else
+        {
+            printf("%s:%d: unknown key '%s'\n", filename, line_number, key.c_str());
+            ok = false;
+        }
+    }
+    fclose(fp);
+
+    /** 依存関係 (入力が他の段階の出力に含まれる・明示した段階) **/
+    std::map<std::string, int> index;
+    for (size_t i = 0; i < pl.stages.size(); i++)
+    {
+        if (!index.emplace(pl.stages[i].name, i).second)
+        {
+            printf("%s: duplicate stage '%s'\n", filename, pl.stages[i].name.c_str());
+            ok = false;
+        }
+    }
+    for (size_t i = 0; i < pl.stages.size(); i++)
+    {
+        Pipeline_stage &stage = pl.stages[i];
+        for (size_t j = 0; j < pl.stages.size(); j++)
+        {
+            bool depends = false;
+            for (const std::string &input : stage.inputs)
+            {
+                for (const std::string &output : pl.stages[j].outputs)
+                {
+                    depends |= Pipeline_inside(input, output) || Pipeline_inside(output, input);
+                }
+            }
+            for (const std::string &name : stage.after)
+            {
+                depends |= name == pl.stages[j].name;
+            }
+            if (depends && j != i)
+            {
+                stage.deps.push_back(j);
+            }
+        }
+        for (const std::string &name : stage.after)
+        {
+            if (index.count(name) == 0)
+            {
+                printf("%s: unknown stage '%s' in '%s'\n", filename, name.c_str(), stage.name.c_str());
+                ok = false;
+            }
+        }
+    }
+
+    /** 循環の検出 (依存のない段階から順に取り除く) **/
+    std::vector<int> count(pl.stages.size());
+    std::deque<int> ready;
+    for (size_t i = 0; i < pl.stages.size(); i++)
+    {
+        count[i] = pl.stages[i].deps.size();
+        for (int j : pl.stages[i].deps)
+        {
+            pl.stages[j].users.push_back(i);
+        }
+        if (count[i] == 0)
+        {
+            ready.push_back(i);
+        }
+    }
+    size_t sorted = 0;
+    while (!ready.empty())
+    {
+        const int i = ready.front();
+        ready.pop_front();
+        sorted++;
+        for (int j : pl.stages[i].users)
+        {
+            if (--count[j] == 0)
+            {
+                ready.push_back(j);
+            }
+        }
+    }
+    if (sorted != pl.stages.size())
+    {
+        printf("%s: dependency cycle\n", filename);
+        ok = false;
+    }
+
+    return ok;
+}
+
+/**************************************************************/
+// Function name : Pipeline_select
+// Description   : 指定した段階とその依存段階のみを実行対象とする (未指定の場合は全段階)
+/**************************************************************/
+inline bool Pipeline_select(Pipeline &pl, const std::vector<std::string> &targets)
+{
+    if (targets.empty())
+    {
+        return true;
+    }
+    for (Pipeline_stage &stage : pl.stages)
+    {
+        stage.selected = false;
+    }
+    std::vector<int> stack;
+    for (const std::string &target : targets)
+    {
+        size_t i = 0;
+        while (i < pl.stages.size() && pl.stages[i].name != target)
+        {
+            i++;
+        }
+        if (i == pl.stages.size())
+        {
+            printf("Unknown stage: %s\n", target.c_str());
+            return false;
+        }
+        stack.push_back(i);
+    }
+    while (!stack.empty())
+    {
+        const int i = stack.back();
+        stack.pop_back();
+        if (!pl.stages[i].selected)
+        {
+            pl.stages[i].selected = true;
+            stack.insert(stack.end(), pl.stages[i].deps.begin(), pl.stages[i].deps.end());
+        }
+    }
+    return true;
+}
+
+/**************************************************************/
+// Function name : Pipeline_read_state / Pipeline_write_state
+// Description   : 前回成功時のハッシュの読み書き (1行に "ハッシュ 段階名")
+/**************************************************************/
+inline void Pipeline_read_state(Pipeline &pl)
+{
+    FILE *fp = fopen(pl.state_file.c_str(), "r");
+    if (fp == NULL)
+    {
+        return; // 初回
+    }
+    char line[1024];
+    while (fgets(line, sizeof(line), fp) != NULL)
+    {
+        char *name = NULL;
+        const uint64_t key = strtoull(line, &name, 16);
+        pl.state[Trim(name)] = key;
+    }
+    fclose(fp);
+}
+
+inline void Pipeline_write_state(const Pipeline &pl)
+{
+    const std::string tmp = pl.state_file + ".tmp";
+    FILE *fp = fopen(tmp.c_str(), "w");
+    if (fp == NULL)
+    {
+        printf("Cannot open: %s\n", tmp.c_str());
+        return;
+    }
+    for (const auto &entry : pl.state)
+    {
+        fprintf(fp, "%016llx %s\n", (unsigned long long)entry.second, entry.first.c_str());
+    }
+    fclose(fp);
+    rename(tmp.c_str(), pl.state_file.c_str()); // 途中で中断しても前回の内容を壊さない
+}
+
+/**************************************************************/
+// Function name : Pipeline_key
+// Description   : 段階のハッシュ (コマンド・パラメータ・入力の内容)
+/**************************************************************/
+inline uint64_t Pipeline_key(const Pipeline_stage &stage)
+{
+    uint64_t hash = Fnv_hash(fnv_offset, stage.command);
+    for (const std::string &param : stage.params)
+    {
+        hash = Fnv_hash(hash, param);
+    }
+    for (const std::string &input : stage.inputs)
+    {
+        hash = Hash_path(hash, input);
+    }
+    for (const std::string &output : stage.outputs)
+    {
+        hash = Fnv_hash(hash, output); // 出力先の変更でも再実行
+    }
+    return hash;
+}
+
+/**************************************************************/
+// Function name : Pipeline_execute
+// Description   : 段階のコマンドの実行 (標準出力・標準エラー出力を log に保存)
+/**************************************************************/
+inline bool Pipeline_execute(Pipeline_stage &stage)
+{
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    for (const std::string &output : stage.outputs)
+    {
+        fs::remove_all(output, ec); // 前回の出力の削除
+    }
+
+    std::string command;
+    for (const std::string &param : stage.params)
+    {
+        command += param + " ";
+    }
+    command = "(" + (stage.params.empty() ? "" : "export " + command + "; ") + stage.command + ") 2>&1 < /dev/null";
+
+    FILE *pp = popen(command.c_str(), "r");
+    if (pp == NULL)
+    {
+        stage.log = "Cannot run: " + stage.command + "\n";
+        return false;
+    }
+    char buffer[4096];
+    size_t size;
+    while ((size = fread(buffer, 1, sizeof(buffer), pp)) > 0)
+    {
+        stage.log.append(buffer, size);
+    }
+    const int result = pclose(pp);
+    return result != -1 && WIFEXITED(result) && WEXITSTATUS(result) == 0;
+}
+
+/**************************************************************/
+// Function name : Pipeline_run
+// Description   : 依存関係の順に段階を実行 (workers : 同時に実行する段階の数)
+//                 on_finish は段階の終了ごとに (排他制御下で) 呼ばれる
+/**************************************************************/
+template <typename Callback>
+inline bool Pipeline_run(Pipeline &pl, int workers, Callback on_finish)
+{
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::deque<int> ready;
+    int remaining = 0;
+
+    for (size_t i = 0; i < pl.stages.size(); i++)
+    {
+        Pipeline_stage &stage = pl.stages[i];
+        stage.waiting = 0;
+        for (int j : stage.deps)
+        {
+            stage.waiting += pl.stages[j].selected;
+        }
+        if (stage.selected)
+        {
+            remaining++;
+            if (stage.waiting == 0)
+            {
+                ready.push_back(i);
+            }
+        }
+    }
+
+    auto worker = [&]()
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        while (true)
+        {
+            cv.wait(lock, [&]
+                    { return remaining == 0 || !ready.empty(); });
+            if (ready.empty())
+            {
+                break;
+            }
+            const int i = ready.front();
+            ready.pop_front();
+            Pipeline_stage &stage = pl.stages[i];
+
+            /** 依存する段階が失敗した場合は実行しない **/
+            bool blocked = false;
+            for (int j : stage.deps)
+            {
+                blocked |= pl.stages[j].status == pipeline_fail || pl.stages[j].status == pipeline_blocked;
+            }
+            const bool force = pl.force;
+            const bool dry_run = pl.dry_run;
+            const auto previous = pl.state.find(stage.name);
+            const bool known = previous != pl.state.end();
+            const uint64_t previous_key = known ? previous->second : 0;
+            lock.unlock();
+
+            /** ハッシュの比較と実行 **/
+            const double start = Metrics_time();
+            Pipeline_status status = pipeline_blocked;
+            if (!blocked)
+            {
+                stage.key = Pipeline_key(stage);
+                bool outputs_exist = true;
+                for (const std::string &output : stage.outputs)
+                {
+                    std::error_code ec;
+                    outputs_exist &= std::filesystem::exists(output, ec);
+                }
+                if (!force && known && previous_key == stage.key && outputs_exist)
+                {
+                    status = pipeline_skip;
+                }
+                else if (dry_run)
+                {
+                    status = pipeline_run;
+                }
+                else
+                {
+                    status = Pipeline_execute(stage) ? pipeline_run : pipeline_fail;
+                }
+            }
+            stage.seconds = Metrics_time() - start;
+            Metrics_stage_add(stage.name.c_str(), stage.seconds);
+
+            /** 結果の記録と後続の段階の解放 **/
+            lock.lock();
+            stage.status = status;
+            if (status == pipeline_run && !dry_run)
+            {
+                pl.state[stage.name] = stage.key;
+                Pipeline_write_state(pl);
+            }
+            on_finish(stage);
+            for (int j : stage.users)
+            {
+                if (pl.stages[j].selected && --pl.stages[j].waiting == 0)
+                {
+                    ready.push_back(j);
+                }
+            }
+            remaining--;
+            cv.notify_all();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int k = 0; k < std::max(workers, 1); k++)
+    {
+        threads.emplace_back(worker);
+    }
+    for (std::thread &thread : threads)
+    {
+        thread.join();
+    }
+
+    bool ok = true;
+    for (const Pipeline_stage &stage : pl.stages)
+    {
+        ok &= !stage.selected || stage.status == pipeline_run || stage.status == pipeline_skip;
+    }
+    return ok;
+}
+
+#endif
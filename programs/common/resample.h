@@ -0,0 +1,341 @@
+/**************************************************************/
+// File name   : resample.h
+// Author      : Masatsugu Kitadai
+// Description : 不等間隔のタイムスタンプを持つデータの等間隔化 (逐次処理)
+//
+//   millis() で記録したデータは 20 [ms] 周期でも実際の間隔がばらつくため、
+//   一定の dt を仮定する積算の前に等間隔の時刻列へ補間する
+//     linear    : 線形補間
+//     cubic     : 3次エルミート補間 (不等間隔の差分で傾きを計算)
+//     polyphase : 窓付き sinc 補間 (位相ごとに係数を前計算したテーブルを使用)
+//   補間係数は出力1サンプルごとに1回だけ計算し、チャンネル方向のループは分岐なしで処理する
+//   欠測の判定に使う公称の入力間隔は、実測の間隔の中央値から求められる (Resample_nominal_interval)
+//   公称間隔の gap_factor 倍を超える欠測区間には出力しない (欠測の前後を別の区間として補間し、出力時刻の格子は共通)
+//   fill_gaps を指定した場合のみ欠測区間も補間で埋める
+/**************************************************************/
+
+#ifndef RESAMPLE_H
+#define RESAMPLE_H
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+/** 補間方法 **/
+enum Resample_method
+{
+    resample_linear,
+    resample_cubic,
+    resample_polyphase,
+};
+
+/** 入力の異常の集計 **/
+struct Resample_stats
+{
+    long input = 0;      // 入力サンプル数 [-]
+    long output = 0;     // 出力サンプル数 [-]
+    long duplicated = 0; // 同じ時刻の重複サンプル (破棄) [-]
+    long reversed = 0;   // 時刻が逆行したサンプル (破棄) [-]
+    long dropped = 0;    // 欠測と推定されるサンプル数 [-]
+    long gaps = 0;       // 欠測区間の数 [-]
+    long filled = 0;     // 欠測区間に補間で出力したサンプル数 (fill_gaps の場合) [-]
+};
+
+const int resample_taps = 8;     // 補間に使う入力サンプル数 (k-3 ～ k+4) [-]
+const int resample_phases = 256; // polyphase の位相の分割数 [-]
+
+/** 逐次処理の状態 **/
+struct Resampler
+{
+    int channels = 0;                         // チャンネル数 [-]
+    double dt_out = 0;                        // 出力のサンプリング間隔 [s]
+    double dt_in = 0;                         // 入力の公称サンプリング間隔 [s]
+    Resample_method method = resample_linear; // 補間方法
+    int lookahead = 1;                        // 補間に必要な先読みサンプル数 [-]
+    double gap_factor = 1.5;                  // 欠測と判定する間隔 (公称間隔に対する倍率) [-]
+    bool fill_gaps = false;                   // 欠測区間も補間して出力するか
+
+    double t[resample_taps]; // 入力時刻の履歴 (リングバッファ)
+    std::vector<float> v;    // 入力値の履歴 (resample_taps × channels)
+    long count = 0;          // 受け取った有効な入力サンプル数 [-]
+    long next_interval = 0;  // 次に出力する入力区間 [k, k+1] の k
+    double t_origin = 0;     // 出力時刻の原点 (最初の入力時刻) [s]
+    double t_out = 0;        // 次の出力時刻 [s]
+    long n_out = 0;          // 出力した時刻の番号 (累積誤差を避けるため t_origin + n * dt で計算)
+
+    std::vector<float> row;    // 出力1サンプル分の値
+    std::vector<float> kernel; // polyphase の係数表 ((resample_phases + 1) × resample_taps)
+    Resample_stats stats;
+};
+
+/**************************************************************/
+// Function name : Lanczos
+// Description   : 窓付き sinc (Lanczos 窓, a = 4)
+/**************************************************************/
+inline double Lanczos(double x)
+{
+    const double pi = 4 * atan(1.0);
+    const double a = resample_taps / 2;
+    if (fabs(x) < 1e-9)
+    {
+        return 1.0;
+    }
+    if (fabs(x) >= a)
+    {
+        return 0.0;
+    }
+    return a * sin(pi * x) * sin(pi * x / a) / (pi * pi * x * x);
+}
+
+/**************************************************************/
+// Function name : Resample_nominal_interval
+// Description   : 時刻列 t (n 個) の公称サンプリング間隔 (正の間隔の中央値, 求められない場合は 0)
+//                 平均間隔と異なり、欠測区間や数個の外れ値の影響を受けない
+/**************************************************************/
+template <typename T>
+inline double Resample_nominal_interval(const T *t, size_t n)
+{
+    std::vector<double> dt;
+    dt.reserve(n);
+    for (size_t i = 1; i < n; i++)
+    {
+        const double d = (double)t[i] - (double)t[i - 1];
+        if (d > 0)
+        {
+            dt.push_back(d);
+        }
+    }
+    if (dt.empty())
+    {
+        return 0;
+    }
+    std::nth_element(dt.begin(), dt.begin() + dt.size() / 2, dt.end());
+    return dt[dt.size() / 2];
+}
+
+/**************************************************************/
+// Function name : Resampler_init
+// Description   : 初期化 (hz_out : 出力周波数 [Hz] / hz_in : 入力の公称周波数 [Hz], 0 の場合は hz_out)
+/**************************************************************/
+inline void Resampler_init(Resampler &rs, int channels, double hz_out, Resample_method method, double hz_in = 0)
+{
+    rs.channels = channels;
+    rs.dt_out = 1.0 / hz_out;
+    rs.dt_in = 1.0 / (hz_in > 0 ? hz_in : hz_out);
+    rs.method = method;
+    rs.lookahead = method == resample_linear ? 1 : method == resample_cubic ? 2 : resample_taps / 2;
+    rs.v.assign(resample_taps * channels, 0.0f);
+    rs.row.assign(channels, 0.0f);
+    rs.count = 0;
+    rs.next_interval = 0;
+    rs.n_out = 0;
+    rs.stats = Resample_stats();
+
+    /** polyphase の係数表 (各位相で正規化) **/
+    if (method == resample_polyphase)
+    {
+        rs.kernel.assign((resample_phases + 1) * resample_taps, 0.0f);
+        for (int p = 0; p <= resample_phases; p++)
+        {
+            const double mu = (double)p / resample_phases;
+            double sum = 0;
+            for (int j = 0; j < resample_taps; j++)
+            {
+                sum += Lanczos(mu - (j - 3));
+            }
+            for (int j = 0; j < resample_taps; j++)
+            {
+                rs.kernel[p * resample_taps + j] = Lanczos(mu - (j - 3)) / sum;
+            }
+        }
+    }
+}
+
+/**************************************************************/
+// Function name : Resample_index
+// Description   : 入力番号 k のリングバッファ上の位置 (範囲外は端の値で代用)
+/**************************************************************/
+inline int Resample_index(const Resampler &rs, long k)
+{
+    const long oldest = rs.count > resample_taps ? rs.count - resample_taps : 0;
+    if (k < oldest)
+    {
+        k = oldest;
+    }
+    if (k > rs.count - 1)
+    {
+        k = rs.count - 1;
+    }
+    return k % resample_taps;
+}
+
+/**************************************************************/
+// Function name : Resample_interval
+// Description   : 入力区間 [k, k+1) に含まれる出力時刻を全て補間して出力
+/**************************************************************/
+template <typename Output>
+inline void Resample_interval(Resampler &rs, long k, Output &output)
+{
+    /** 補間に使う入力の位置と時刻 (k-3 ～ k+4) **/
+    int idx[resample_taps];
+    double tk[resample_taps];
+    for (int j = 0; j < resample_taps; j++)
+    {
+        idx[j] = Resample_index(rs, k + j - 3);
+        tk[j] = rs.t[idx[j]];
+    }
+    const double t0 = tk[3];  // 区間の始点
+    const double t1 = tk[4];  // 区間の終点
+    const double h = t1 - t0; // 区間の長さ (重複・逆行は除外済みのため h > 0) [s]
+
+    while (rs.t_out < t1)
+    {
+        /** 補間係数の計算 **/
+        float w[resample_taps] = {0};
+        const double s = (rs.t_out - t0) / h; // 区間内の位置 (0 <= s < 1)
+
+        if (rs.method == resample_linear)
+        {
+            w[3] = 1 - s;
+            w[4] = s;
+        }
+        else if (rs.method == resample_cubic)
+        {
+            const double d0 = tk[4] - tk[2]; // 始点の傾きの差分間隔
+            const double d1 = tk[5] - tk[3]; // 終点の傾きの差分間隔
+            const double h00 = 2 * s * s * s - 3 * s * s + 1;
+            const double h10 = s * s * s - 2 * s * s + s;
+            const double h01 = -2 * s * s * s + 3 * s * s;
+            const double h11 = s * s * s - s * s;
+            const double c0 = d0 > 0 ? h10 * h / d0 : 0;
+            const double c1 = d1 > 0 ? h11 * h / d1 : 0;
+            w[2] = -c0;
+            w[3] = h00 - c1;
+            w[4] = h01 + c0;
+            w[5] = c1;
+        }
+        else
+        {
+            const int p = (int)(s * resample_phases + 0.5);
+            memcpy(w, &rs.kernel[p * resample_taps], sizeof(w));
+        }
+
+        /** チャンネル方向の積和 (分岐なし) **/
+        const int nc = rs.channels;
+        for (int c = 0; c < nc; c++)
+        {
+            rs.row[c] = 0;
+        }
+        for (int j = 0; j < resample_taps; j++)
+        {
+            const float wj = w[j];
+            const float *vj = &rs.v[idx[j] * nc];
+            for (int c = 0; c < nc; c++)
+            {
+                rs.row[c] += wj * vj[c];
+            }
+        }
+
+        output(rs.t_out, rs.row.data());
+        rs.stats.output += 1;
+        rs.n_out += 1;
+        rs.t_out = rs.t_origin + rs.n_out * rs.dt_out;
+    }
+}
+
+/**************************************************************/
+// Function name : Resampler_flush
+// Description   : 入力終了時に残りの区間を出力 (端は最終サンプルの値で延長して補間)
+/**************************************************************/
+template <typename Output>
+inline void Resampler_flush(Resampler &rs, Output output)
+{
+    if (rs.count == 0)
+    {
+        return;
+    }
+    while (rs.next_interval < rs.count - 1)
+    {
+        Resample_interval(rs, rs.next_interval, output);
+        rs.next_interval += 1;
+    }
+
+    /** 最終サンプルと同時刻の出力 **/
+    const double t_last = rs.t[(rs.count - 1) % resample_taps];
+    if (rs.t_out <= t_last + 1e-9 * rs.dt_out)
+    {
+        const int last = (rs.count - 1) % resample_taps;
+        output(rs.t_out, &rs.v[last * rs.channels]);
+        rs.stats.output += 1;
+        rs.n_out += 1;
+        rs.t_out = rs.t_origin + rs.n_out * rs.dt_out;
+    }
+}
+
+/**************************************************************/
+// Function name : Resampler_push
+// Description   : 入力1サンプルの追加 (補間できた出力は output(t, values) で受け取る)
+/**************************************************************/
+template <typename Output>
+inline void Resampler_push(Resampler &rs, double t, const float *values, Output output)
+{
+    rs.stats.input += 1;
+
+    /** 重複・逆行・欠測の検出 **/
+    if (rs.count > 0)
+    {
+        const double t_last = rs.t[(rs.count - 1) % resample_taps];
+        if (t == t_last)
+        {
+            rs.stats.duplicated += 1;
+            return;
+        }
+        if (t < t_last)
+        {
+            rs.stats.reversed += 1;
+            return;
+        }
+        const long missing = lround((t - t_last) / rs.dt_in) - 1;
+        if (missing > 0 && t - t_last > rs.gap_factor * rs.dt_in)
+        {
+            rs.stats.dropped += missing;
+            rs.stats.gaps += 1;
+            if (rs.fill_gaps)
+            {
+                const long n_first = (long)floor((t_last - rs.t_origin) / rs.dt_out) + 1; // 欠測区間内の最初の出力の番号
+                const long n_last = (long)ceil((t - rs.t_origin) / rs.dt_out) - 1;        // 欠測区間内の最後の出力の番号
+                rs.stats.filled += n_last >= n_first ? n_last - n_first + 1 : 0;
+            }
+            else
+            {
+                /** 欠測の前の区間を出力して履歴を空にし、欠測の後の最初の格子点から再開 **/
+                Resampler_flush(rs, output);
+                rs.count = 0;
+                rs.next_interval = 0;
+                rs.n_out = (long)ceil((t - rs.t_origin) / rs.dt_out - 1e-9);
+                rs.t_out = rs.t_origin + rs.n_out * rs.dt_out;
+            }
+        }
+    }
+    else
+    {
+        rs.t_origin = t; // 出力時刻の原点は最初の入力
+        rs.t_out = t;
+    }
+
+    /** 履歴への追加 **/
+    const int slot = rs.count % resample_taps;
+    rs.t[slot] = t;
+    memcpy(&rs.v[slot * rs.channels], values, sizeof(float) * rs.channels);
+    rs.count += 1;
+
+    /** 先読みが揃った区間を出力 **/
+    while (rs.next_interval + rs.lookahead <= rs.count - 1)
+    {
+        Resample_interval(rs, rs.next_interval, output);
+        rs.next_interval += 1;
+    }
+}
+
+#endif
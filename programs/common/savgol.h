@@ -0,0 +1,241 @@
+/**************************************************************/
+// File name   : savgol.h
+// Author      : Masatsugu Kitadai
+// Description : Savitzky-Golay フィルタによる位置の平滑化と速度・加速度の計算 (逐次処理)
+//
+//   窓幅 2h+1 点に多項式を最小二乗で当てはめ、その値・1階微分・2階微分を返す。
+//   係数は窓内の評価位置ごとに前計算しておき、通常は窓の中央 (h サンプルの遅れ) で、
+//   データの先頭と末尾は窓の端の位置で評価する。全チャンネル (x, y, z) を同じ係数でまとめて処理する
+/**************************************************************/
+
+#ifndef SAVGOL_H
+#define SAVGOL_H
+
+#include <stddef.h>
+#include <math.h>
+#include <vector>
+
+const int savgol_derivs = 3; // 計算する微分の階数 (値, 1階, 2階) [-]
+
+/** 逐次処理の状態 **/
+struct Savgol_filter
+{
+    int half = 3;             // 窓の半幅 h [-]
+    int order = 2;            // 多項式の次数 [-]
+    int channels = 3;         // チャンネル数 [-]
+    double dt = 1.0;          // サンプリング間隔 [s]
+    std::vector<double> coef; // 係数表 ((2h+1) 評価位置 × savgol_derivs × (2h+1) 点)
+    std::vector<double> ring; // 入力の履歴 ((2h+1) × channels)
+    long count = 0;           // 入力サンプル数 [-]
+    long next = 0;            // 次に出力するサンプル番号 [-]
+    std::vector<double> out;  // 出力1サンプル分 (savgol_derivs × channels)
+};
+
+/**************************************************************/
+// Function name : Savgol_coefficients
+// Description   : 位置 0, 1, ..., m-1 の m 点に order 次多項式を当てはめたときの、
+//                 位置 e における d 階微分 (d = 0, 1, 2) の係数 (サンプル間隔 1 の単位)
+/**************************************************************/
+inline void Savgol_coefficients(int m, int order, double e, double *coef)
+{
+    const int k = order + 1;
+
+    /** 正規方程式 (p = 位置 - e の冪) **/
+    std::vector<double> a(k * 2 * k, 0.0); // [M | I] の拡大行列
+    for (int r = 0; r < k; r++)
+    {
+        for (int c = 0; c < k; c++)
+        {
+            double sum = 0;
+            for (int j = 0; j < m; j++)
+            {
+                sum += pow(j - e, r + c);
+            }
+            a[r * 2 * k + c] = sum;
+        }
+        a[r * 2 * k + k + r] = 1.0;
+    }
+
+    /** ガウス・ジョルダン法による逆行列 (部分ピボット選択) **/
+    for (int c = 0; c < k; c++)
+    {
+        int pivot = c;
+        for (int r = c + 1; r < k; r++)
+        {
+            if (fabs(a[r * 2 * k + c]) > fabs(a[pivot * 2 * k + c]))
+            {
+                pivot = r;
+            }
+        }
+        for (int j = 0; j < 2 * k; j++)
+        {
+            const double tmp = a[c * 2 * k + j];
+            a[c * 2 * k + j] = a[pivot * 2 * k + j];
+            a[pivot * 2 * k + j] = tmp;
+        }
+        const double diag = a[c * 2 * k + c];
+        for (int j = 0; j < 2 * k; j++)
+        {
+            a[c * 2 * k + j] /= diag;
+        }
+        for (int r = 0; r < k; r++)
+        {
+            if (r != c)
+            {
+                const double f = a[r * 2 * k + c];
+                for (int j = 0; j < 2 * k; j++)
+                {
+                    a[r * 2 * k + j] -= f * a[c * 2 * k + j];
+                }
+            }
+        }
+    }
+
+    /** d 階微分の係数 = d! × (M^-1 A^T) の d 行目 **/
+    for (int d = 0; d < savgol_derivs; d++)
+    {
+        const double factorial = d == 2 ? 2.0 : 1.0;
+        for (int j = 0; j < m; j++)
+        {
+            double sum = 0;
+            if (d < k)
+            {
+                for (int c = 0; c < k; c++)
+                {
+                    sum += a[d * 2 * k + k + c] * pow(j - e, c);
+                }
+            }
+            coef[d * m + j] = factorial * sum;
+        }
+    }
+}
+
+/**************************************************************/
+// Function name : Savgol_init
+// Description   : 初期化 (half : 窓の半幅, order : 多項式の次数, dt : サンプリング間隔 [s])
+/**************************************************************/
+inline void Savgol_init(Savgol_filter &sg, int half, int order, int channels, double dt)
+{
+    const int w = 2 * half + 1;
+    sg.half = half;
+    sg.order = order < w - 1 ? order : w - 1;
+    sg.channels = channels;
+    sg.dt = dt;
+    sg.ring.assign(w * channels, 0.0);
+    sg.out.assign(savgol_derivs * channels, 0.0);
+    sg.count = 0;
+    sg.next = 0;
+
+    /** 評価位置ごとの係数表 (微分の時間の単位を [s] に変換) **/
+    sg.coef.assign(w * savgol_derivs * w, 0.0);
+    for (int e = 0; e < w; e++)
+    {
+        double *c = &sg.coef[e * savgol_derivs * w];
+        Savgol_coefficients(w, sg.order, e, c);
+        for (int j = 0; j < w; j++)
+        {
+            c[1 * w + j] /= dt;
+            c[2 * w + j] /= dt * dt;
+        }
+    }
+}
+
+/**************************************************************/
+// Function name : Savgol_evaluate
+// Description   : 窓 (サンプル first ～ first+m-1) の位置 e での値・速度・加速度を出力
+/**************************************************************/
+template <typename Output>
+inline void Savgol_evaluate(Savgol_filter &sg, const double *coef, int m, long first, long index, Output &output)
+{
+    const int w = 2 * sg.half + 1;
+    const int nc = sg.channels;
+    for (int i = 0; i < savgol_derivs * nc; i++)
+    {
+        sg.out[i] = 0;
+    }
+
+    /** 全チャンネルをまとめて積和 **/
+    for (int j = 0; j < m; j++)
+    {
+        const double *v = &sg.ring[((first + j) % w) * nc];
+        const double c0 = coef[0 * m + j];
+        const double c1 = coef[1 * m + j];
+        const double c2 = coef[2 * m + j];
+        for (int c = 0; c < nc; c++)
+        {
+            sg.out[0 * nc + c] += c0 * v[c];
+            sg.out[1 * nc + c] += c1 * v[c];
+            sg.out[2 * nc + c] += c2 * v[c];
+        }
+    }
+
+    output(index, &sg.out[0], &sg.out[nc], &sg.out[2 * nc]);
+}
+
+/**************************************************************/
+// Function name : Savgol_push
+// Description   : 1サンプルの追加 (確定したサンプルを output(index, 位置, 速度, 加速度) で返す)
+/**************************************************************/
+template <typename Output>
+inline void Savgol_push(Savgol_filter &sg, const double *values, Output output)
+{
+    const int w = 2 * sg.half + 1;
+    const int nc = sg.channels;
+    for (int c = 0; c < nc; c++)
+    {
+        sg.ring[(sg.count % w) * nc + c] = values[c];
+    }
+    sg.count += 1;
+    if (sg.count < w)
+    {
+        return;
+    }
+
+    /** 窓が揃ったら中央まで (先頭の窓では窓の端から中央まで) を出力 **/
+    const long first = sg.count - w;
+    while (sg.next <= first + sg.half)
+    {
+        const int e = sg.next - first;
+        Savgol_evaluate(sg, &sg.coef[e * savgol_derivs * w], w, first, sg.next, output);
+        sg.next += 1;
+    }
+}
+
+/**************************************************************/
+// Function name : Savgol_flush
+// Description   : 入力終了時に残りのサンプルを出力 (最後の窓の端の位置で評価)
+/**************************************************************/
+template <typename Output>
+inline void Savgol_flush(Savgol_filter &sg, Output output)
+{
+    const int w = 2 * sg.half + 1;
+    if (sg.count >= w)
+    {
+        const long first = sg.count - w;
+        while (sg.next < sg.count)
+        {
+            const int e = sg.next - first;
+            Savgol_evaluate(sg, &sg.coef[e * savgol_derivs * w], w, first, sg.next, output);
+            sg.next += 1;
+        }
+        return;
+    }
+
+    /** 窓幅に満たない短いデータは全点で当てはめ **/
+    const int m = sg.count;
+    const int order = sg.order < m - 1 ? sg.order : m - 1;
+    std::vector<double> coef(savgol_derivs * m);
+    while (sg.next < sg.count)
+    {
+        Savgol_coefficients(m, order, sg.next, coef.data());
+        for (int j = 0; j < m; j++)
+        {
+            coef[1 * m + j] /= sg.dt;
+            coef[2 * m + j] /= sg.dt * sg.dt;
+        }
+        Savgol_evaluate(sg, coef.data(), m, 0, sg.next, output);
+        sg.next += 1;
+    }
+}
+
+#endif
@@ -0,0 +1,224 @@
+/**************************************************************/
+// File name   : sensor_error.h
+// Author      : Masatsugu Kitadai
+// Description : 6軸センサ・GNSS の誤差モデル (シミュレーションの真値に実機相当の誤差を加える)
+//
+//   6軸センサ (1軸ごと) : 測定値 = 量子化((1 + スケール誤差) × 真値 + 一定バイアス + 変動バイアス + 白色雑音)
+//     一定バイアス   : 起動ごとに正規分布から1回だけ決まるオフセット
+//     変動バイアス   : 1次 Gauss-Markov 過程 b[k+1] = φ b[k] + σ √(1 - φ^2) w, φ = exp(-dt / τ)
+//     白色雑音       : 角度 / 速度ランダムウォーク (密度 N [単位/√s] → 1サンプルの標準偏差 N / √dt)
+//     量子化         : 分解能 (MPU6050 の既定レンジでは 1 / 16384 [g], 1 / 131 [deg/s]) で丸め、フルスケールで飽和
+//   GNSS : 白色雑音・遅延 (latency 前の位置を出力)・受信断 (発生率と平均継続時間の指数分布)
+//
+//   乱数は軸ごとに独立した状態を持ち、ブロック (1024 点) ごとに正規乱数をまとめて作ってから加算する
+/**************************************************************/
+
+#ifndef SENSOR_ERROR_H
+#define SENSOR_ERROR_H
+
+#include <stdint.h>
+#include <math.h>
+#include <vector>
+#include "signal_generator.h"
+
+/** 6軸センサ1軸分の誤差の大きさ **/
+struct Imu_error_params
+{
+    double bias = 0;             // 一定バイアスの標準偏差 [単位]
+    double bias_instability = 0; // 変動バイアスの標準偏差 [単位]
+    double bias_tau = 100;       // 変動バイアスの相関時間 [s]
+    double random_walk = 0;      // 白色雑音の密度 [単位/√s]
+    double scale_factor = 0;     // スケール誤差の標準偏差 [-]
+    double lsb = 0;              // 量子化の分解能 [単位] (0 の場合は量子化しない)
+    double range = 0;            // フルスケール [単位] (0 の場合は飽和させない)
+};
+
+/** 6軸センサ1軸分の誤差の状態 **/
+struct Imu_error_channel
+{
+    Imu_error_params params;  // 誤差の大きさ
+    uint64_t rng[4];          // 乱数の状態
+    double bias = 0;          // 一定バイアス [単位]
+    double scale = 0;         // スケール誤差 [-]
+    double drift = 0;         // 変動バイアスの現在値 [単位]
+    std::vector<double> work; // 正規乱数の作業領域 (2 ブロック分)
+};
+
+/** GNSS の誤差の大きさ **/
+struct Gnss_error_params
+{
+    double sigma = 0;           // 位置の白色雑音の標準偏差 [m]
+    double latency = 0;         // 出力の遅延 [s]
+    double outage_rate = 0;     // 受信断の発生率 [1/s]
+    double outage_duration = 0; // 受信断の平均継続時間 [s]
+};
+
+/** GNSS の誤差の状態 **/
+struct Gnss_error_state
+{
+    Gnss_error_params params; // 誤差の大きさ
+    uint64_t rng[4];          // 乱数の状態
+    double outage_left = 0;   // 受信断の残り時間 [s]
+};
+
+const size_t sensor_error_block = 1024; // ブロックの点数 [-]
+const double sensor_error_g = 9.80665;  // 重力加速度 [m/s2]
+
+/** 既定の誤差 (MPU6050 : 加速度 ±2 [g]・角速度 ±250 [deg/s] レンジ, Arduino の /16384.0・/131.0 と同じ分解能) **/
+/** ランダムウォークは密度で与える (100 [Hz] で1サンプルの標準偏差が 2 % g・2π × 1 % [rad/s] になる値) **/
+const Imu_error_params mpu6050_acc_error = {
+    0.10,                                       // 一定バイアス [m/s2]
+    0.005,                                      // 変動バイアス [m/s2]
+    100.0,                                      // 変動バイアスの相関時間 [s]
+    2.0 * sensor_error_g * 0.010 / sqrt(100.0), // 速度ランダムウォーク [m/s/√s]
+    0.01,                                       // スケール誤差 [-]
+    sensor_error_g / 16384.0,                   // 分解能 [m/s2]
+    2.0 * sensor_error_g,                       // フルスケール [m/s2]
+};
+const Imu_error_params mpu6050_gyro_error = {
+    0.01,                             // 一定バイアス [rad/s]
+    0.001,                            // 変動バイアス [rad/s]
+    100.0,                            // 変動バイアスの相関時間 [s]
+    2.0 * M_PI * 0.010 / sqrt(100.0), // 角度ランダムウォーク [rad/√s]
+    0.01,                             // スケール誤差 [-]
+    M_PI / 180.0 / 131.0,             // 分解能 [rad/s]
+    250.0 * M_PI / 180.0,             // フルスケール [rad/s]
+};
+
+/** 既定の誤差 (ZED-F9P : RTK 測位時) **/
+const Gnss_error_params zed_f9p_error = {
+    0.01, // 位置の誤差 [m]
+    0.10, // 遅延 [s]
+    0.02, // 受信断の発生率 [1/s]
+    2.0,  // 受信断の平均継続時間 [s]
+};
+
+/**************************************************************/
+// Function name : Imu_error_init
+// Description   : 1軸分の誤差の初期化 (一定バイアス・スケール誤差・変動バイアスの初期値を決める)
+/**************************************************************/
+inline void Imu_error_init(Imu_error_channel &ch, const Imu_error_params &params, uint64_t seed)
+{
+    ch.params = params;
+    Signal_seed(ch.rng, seed);
+    double g[4];
+    Signal_gaussian(ch.rng, g, 4);
+    ch.bias = params.bias * g[0];
+    ch.scale = params.scale_factor * g[1];
+    ch.drift = params.bias_instability * g[2]; // 定常分布から開始
+    ch.work.resize(2 * sensor_error_block);
+}
+
+/**************************************************************/
+// Function name : Imu_error_apply
+// Description   : 真値 x (n 点, サンプリング間隔 dt [s]) を測定値に置き換える
+/**************************************************************/
+template <typename T>
+void Imu_error_apply(Imu_error_channel &ch, T *x, size_t n, double dt)
+{
+    const Imu_error_params &p = ch.params;
+    const double phi = p.bias_tau > 0 ? exp(-dt / p.bias_tau) : 0.0;
+    const double drift_step = p.bias_instability * sqrt(1.0 - phi * phi);
+    const double white = p.random_walk / sqrt(dt);
+    const double gain = 1.0 + ch.scale;
+    double *w_drift = ch.work.data();
+    double *w_white = ch.work.data() + sensor_error_block;
+
+    for (size_t k0 = 0; k0 < n; k0 += sensor_error_block)
+    {
+        const size_t len = n - k0 < sensor_error_block ? n - k0 : sensor_error_block;
+        T *y = x + k0;
+
+        /** 正規乱数 (ブロック分まとめて) **/
+        Signal_gaussian(ch.rng, w_drift, len);
+        Signal_gaussian(ch.rng, w_white, len);
+
+        /** 変動バイアス (漸化式のため逐次, 結果は w_drift に上書き) **/
+        double drift = ch.drift;
+        for (size_t k = 0; k < len; k++)
+        {
+            const double current = drift;
+            drift = phi * drift + drift_step * w_drift[k];
+            w_drift[k] = current;
+        }
+        ch.drift = drift;
+
+        /** スケール・バイアス・白色雑音 **/
+        for (size_t k = 0; k < len; k++)
+        {
+            y[k] = gain * y[k] + ch.bias + w_drift[k] + white * w_white[k];
+        }
+
+        /** 量子化・飽和 **/
+        if (p.lsb > 0)
+        {
+            const double inv = 1.0 / p.lsb;
+            for (size_t k = 0; k < len; k++)
+            {
+                y[k] = nearbyint(y[k] * inv) * p.lsb;
+            }
+        }
+        if (p.range > 0)
+        {
+            for (size_t k = 0; k < len; k++)
+            {
+                y[k] = y[k] > p.range ? p.range : y[k] < -p.range ? -p.range : y[k];
+            }
+        }
+    }
+}
+
+/**************************************************************/
+// Function name : Gnss_error_init
+// Description   : GNSS の誤差の初期化
+/**************************************************************/
+inline void Gnss_error_init(Gnss_error_state &st, const Gnss_error_params &params, uint64_t seed)
+{
+    st.params = params;
+    st.outage_left = 0;
+    Signal_seed(st.rng, seed);
+}
+
+/**************************************************************/
+// Function name : Gnss_error_apply
+// Description   : 真値の位置 (x_true, y_true : n 点, 間隔 dt [s]) から interval 点ごとの測定値を作る
+//                 測定のない点・受信断の点は no_fix とする
+/**************************************************************/
+template <typename T>
+void Gnss_error_apply(Gnss_error_state &st, const T *x_true, const T *y_true, size_t n, double dt, int interval, T no_fix, T *x_out, T *y_out)
+{
+    const Gnss_error_params &p = st.params;
+    const long delay = lround(p.latency / dt);                  // 遅延 [サンプル]
+    const double dt_fix = interval * dt;                        // 測定間隔 [s]
+    const double p_outage = 1.0 - exp(-p.outage_rate * dt_fix); // 1回の測定間隔で受信断が始まる確率 [-]
+    for (size_t i = 0; i < n; i++)
+    {
+        x_out[i] = no_fix;
+        y_out[i] = no_fix;
+        if (i % interval != 0)
+        {
+            continue;
+        }
+
+        /** 受信断 **/
+        if (st.outage_left > 0)
+        {
+            st.outage_left -= dt_fix;
+            continue;
+        }
+        if (p.outage_rate > 0 && Signal_uniform(st.rng) < p_outage)
+        {
+            st.outage_left = -p.outage_duration * log(Signal_uniform(st.rng)) - dt_fix;
+            continue;
+        }
+
+        /** 遅延・白色雑音 **/
+        const size_t j = (long)i >= delay ? i - delay : 0;
+        double g[2];
+        Signal_gaussian(st.rng, g, 2);
+        x_out[i] = x_true[j] + p.sigma * g[0];
+        y_out[i] = y_true[j] + p.sigma * g[1];
+    }
+}
+
+#endif
@@ -0,0 +1,163 @@
+/**************************************************************/
+// File name   : sensor_frame.h
+// Author      : Masatsugu Kitadai
+// Description : 6軸センサ + GPS の計測データ (Simulation/data/data.dat の 9 列) の列指向コンテナ
+//
+//   Data_table と同じ配置 (チャンネルごとに連続, 各列の先頭は 64 [byte] 境界) で、
+//   列番号の代わりに名前付きのチャンネル (Sensor_channel) で参照する
+//   シミュレータは計測時間とサンプリング周波数から行数を1回だけ決めて確保し (Sensor_frame_init)、
+//   推定プログラムは Read_table でそのまま読み込む (Read_sensor_frame, 列のコピーなし)
+//   Sensor_view は一部の行 (区間) をコピーせずに参照する
+/**************************************************************/
+
+#ifndef SENSOR_FRAME_H
+#define SENSOR_FRAME_H
+
+#include <stdio.h>
+#include <math.h>
+#include "data_reader.h"
+#include "metrics.h"
+
+/** チャンネル (data.dat の列の順番) **/
+enum Sensor_channel
+{
+    sensor_t,        // 時刻 [s]
+    sensor_acc_x,    // x方向加速度 [m/s2]
+    sensor_acc_y,    // y方向加速度 [m/s2]
+    sensor_acc_z,    // z方向加速度 [m/s2]
+    sensor_omega_x,  // roll方向角速度 [rad/s]
+    sensor_omega_y,  // pitch方向角速度 [rad/s]
+    sensor_omega_z,  // yaw方向角速度 [rad/s]
+    sensor_gps_x,    // GPS x方向位置 (経度) [m]
+    sensor_gps_y,    // GPS y方向位置 (緯度) [m]
+    sensor_channels, // チャンネル数
+};
+
+const char *const sensor_channel_name[sensor_channels] = {"t", "acc_x", "acc_y", "acc_z", "omega_x", "omega_y", "omega_z", "gps_x", "gps_y"};
+const char *const sensor_channel_unit[sensor_channels] = {"s", "m/s2", "m/s2", "m/s2", "rad/s", "rad/s", "rad/s", "m", "m"};
+const float sensor_no_fix = -100.0; // GPS 未受信の値 [m]
+
+/** 計測データ **/
+template <typename T>
+struct Sensor_frame : Data_table<T>
+{
+    double sample_rate = 0; // サンプリング周波数 [Hz]
+};
+
+/** 一部の行の参照 (コピーなし) **/
+template <typename T>
+struct Sensor_view
+{
+    T *column[sensor_channels] = {}; // チャンネルごとの先頭
+    size_t rows = 0;                 // 行数 [-]
+
+    T *Column(Sensor_channel c) const { return column[c]; }
+};
+
+/**************************************************************/
+// Function name : Sensor_frame_samples
+// Description   : 計測時間 duration [s] をサンプリング周波数 hz [Hz] で記録したときの行数
+/**************************************************************/
+inline size_t Sensor_frame_samples(double duration, double hz)
+{
+    return (size_t)floor(duration * hz + 1e-9);
+}
+
+/**************************************************************/
+// Function name : Sensor_frame_init
+// Description   : rows 行の確保 (全チャンネル 0) と時刻列 i / hz の設定
+/**************************************************************/
+template <typename T>
+inline void Sensor_frame_init(Sensor_frame<T> &frame, size_t rows, double hz)
+{
+    frame.rows = rows;
+    frame.cols = sensor_channels;
+    frame.stride = Aligned_stride<T>(rows);
+    frame.values.assign(frame.cols * frame.stride, T(0));
+    frame.sample_rate = hz;
+
+    T *t = frame.Column(sensor_t);
+    for (size_t i = 0; i < rows; i++)
+    {
+        t[i] = (T)(i / hz);
+    }
+}
+
+/**************************************************************/
+// Function name : Read_sensor_frame
+// Description   : data.dat の読み込み (サンプリング周波数は時刻列の平均間隔から求める)
+/**************************************************************/
+template <typename T>
+inline bool Read_sensor_frame(const char *filename, Sensor_frame<T> &frame)
+{
+    if (!Read_table(filename, frame, 0, sensor_channels))
+    {
+        return false;
+    }
+
+    const T *t = frame.Column(sensor_t);
+    frame.sample_rate = 0;
+    if (frame.rows > 1 && t[frame.rows - 1] > t[0])
+    {
+        frame.sample_rate = (frame.rows - 1) / (double)(t[frame.rows - 1] - t[0]);
+    }
+    return true;
+}
+
+/**************************************************************/
+// Function name : Sensor_frame_slice
+// Description   : begin 行目から end 行目の手前までの参照
+/**************************************************************/
+template <typename T>
+inline Sensor_view<T> Sensor_frame_slice(Sensor_frame<T> &frame, size_t begin, size_t end)
+{
+    Sensor_view<T> view;
+    end = end < frame.rows ? end : frame.rows;
+    begin = begin < end ? begin : end;
+    for (int c = 0; c < sensor_channels; c++)
+    {
+        view.column[c] = frame.Column(c) + begin;
+    }
+    view.rows = end - begin;
+    return view;
+}
+
+template <typename T>
+inline Sensor_view<const T> Sensor_frame_slice(const Sensor_frame<T> &frame, size_t begin, size_t end)
+{
+    Sensor_view<const T> view;
+    end = end < frame.rows ? end : frame.rows;
+    begin = begin < end ? begin : end;
+    for (int c = 0; c < sensor_channels; c++)
+    {
+        view.column[c] = frame.Column(c) + begin;
+    }
+    view.rows = end - begin;
+    return view;
+}
+
+/**************************************************************/
+// Function name : Write_sensor_frame
+// Description   : data.dat 形式 (9 列, タブ区切り) での書き出し
+/**************************************************************/
+template <typename T>
+inline bool Write_sensor_frame(const char *filename, const Sensor_view<T> &view)
+{
+    FILE *fp = fopen(filename, "w");
+    if (fp == NULL)
+    {
+        printf("Cannot open: %s\n", filename);
+        return false;
+    }
+    for (size_t i = 0; i < view.rows; i++)
+    {
+        for (int c = 0; c < sensor_channels; c++)
+        {
+            fprintf(fp, c + 1 < sensor_channels ? "%f\t" : "%f\n", (double)view.column[c][i]);
+        }
+    }
+    Metrics_fclose(fp);
+    return true;
+}
+
+#endif
@@ -0,0 +1,383 @@
+/**************************************************************/
+// File name   : sensor_log.h
+// Author      : Masatsugu Kitadai
+// Description : 列指向バイナリ形式のセンサログ (.slog)
+//
+//   [ヘッダ 64 byte][チャンネル表 64 byte × n_channels][時刻配列][各チャンネルの配列][有効ビット列] ...
+//   ・時刻配列は double (n_samples 個) で全チャンネル共通
+//   ・各チャンネルは float または double の配列と、欠測を表す有効ビット列を持つ
+//     (GPS の未受信を -100 で表すような番兵値は使わない)
+//   ・全ての配列は 64 byte 境界に配置するため、mmap したまま参照できる
+//   ・開くときにヘッダ・チャンネル表の全ての位置と長さをファイルサイズと照合する (壊れたファイルは開かない)
+/**************************************************************/
+
+#ifndef SENSOR_LOG_H
+#define SENSOR_LOG_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "data_reader.h"
+
+const char sensor_log_magic[8] = {'S', 'E', 'N', 'S', 'L', 'O', 'G', '\0'}; // 識別子
+const uint32_t sensor_log_version = 2;                                      // 形式のバージョン (2 : n_valid を 64 bit 化)
+const uint64_t sensor_log_align = 64;                                       // 配列の境界 [byte]
+
+/** ファイルヘッダ (64 byte) **/
+struct Sensor_log_header
+{
+    char magic[8];        // 識別子 "SENSLOG"
+    uint32_t version;     // 形式のバージョン
+    uint32_t n_channels;  // チャンネル数 [-]
+    uint64_t n_samples;   // サンプル数 [-]
+    double sample_rate;   // 基準のサンプリング周波数 [Hz]
+    uint64_t time_offset; // 時刻配列の位置 [byte]
+    uint8_t reserved[24];
+};
+
+/** チャンネル表 (64 byte) **/
+struct Sensor_log_channel
+{
+    char name[20];         // チャンネル名
+    char unit[12];         // 単位
+    float sample_rate;     // 公称サンプリング周波数 [Hz]
+    uint32_t value_size;   // 値のサイズ (4 : float / 8 : double) [byte]
+    uint64_t n_valid;      // 有効なサンプル数 [-]
+    uint64_t data_offset;  // 値の配列の位置 [byte]
+    uint64_t valid_offset; // 有効ビット列の位置 [byte] (0 の場合は全て有効)
+};
+
+static_assert(sizeof(Sensor_log_header) == 64, "Sensor_log_header must be 64 byte");
+static_assert(sizeof(Sensor_log_channel) == 64, "Sensor_log_channel must be 64 byte");
+
+/** 書き出し用のチャンネル **/
+struct Sensor_log_column
+{
+    std::string name;           // チャンネル名
+    std::string unit;           // 単位
+    float sample_rate = 0;      // 公称サンプリング周波数 [Hz]
+    bool is_double = false;     // double で保存するか
+    std::vector<double> values; // 値 (n_samples 個)
+    std::vector<uint8_t> valid; // 有効フラグ (空の場合は全て有効)
+};
+
+/** 書き出し用のログ **/
+struct Sensor_log_data
+{
+    double sample_rate = 0;                 // 基準のサンプリング周波数 [Hz]
+    std::vector<double> time;               // 時刻 [s]
+    std::vector<Sensor_log_column> columns; // チャンネル
+};
+
+/** mmap した読み込み済みログ **/
+struct Sensor_log
+{
+    Mapped_file file;                          // mmap 領域
+    const Sensor_log_header *header = NULL;    // ヘッダ
+    const Sensor_log_channel *channels = NULL; // チャンネル表
+    const double *time = NULL;                 // 時刻 [s]
+};
+
+/**************************************************************/
+// Function name : Align_offset
+// Description   : 64 byte 境界への切り上げ
+/**************************************************************/
+inline uint64_t Align_offset(uint64_t offset)
+{
+    return (offset + sensor_log_align - 1) / sensor_log_align * sensor_log_align;
+}
+
+/**************************************************************/
+// Function name : Write_padding
+// Description   : 64 byte 境界までゼロで埋める
+/**************************************************************/
+inline bool Write_padding(FILE *fp, uint64_t &offset)
+{
+    static const char zeros[64] = {0};
+    const uint64_t aligned = Align_offset(offset);
+    const size_t size = aligned - offset;
+    offset = aligned;
+    return fwrite(zeros, 1, size, fp) == size;
+}
+
+/**************************************************************/
+// Function name : Write_sensor_log
+// Description   : バイナリログの書き出し
+/**************************************************************/
+inline bool Write_sensor_log(const char *filename, const Sensor_log_data &data)
+{
+    const uint64_t n = data.time.size();
+    const uint32_t n_channels = data.columns.size();
+
+    /** 配置の計算 **/
+    std::vector<Sensor_log_channel> table(n_channels);
+    uint64_t offset = sizeof(Sensor_log_header) + n_channels * sizeof(Sensor_log_channel);
+    offset = Align_offset(offset);
+    const uint64_t time_offset = offset;
+    offset = Align_offset(offset + n * sizeof(double));
+
+    for (uint32_t j = 0; j < n_channels; j++)
+    {
+        const Sensor_log_column &col = data.columns[j];
+        Sensor_log_channel &ch = table[j];
+        memset(&ch, 0, sizeof(ch));
+        strncpy(ch.name, col.name.c_str(), sizeof(ch.name) - 1);
+        strncpy(ch.unit, col.unit.c_str(), sizeof(ch.unit) - 1);
+        ch.sample_rate = col.sample_rate;
+        ch.value_size = col.is_double ? 8 : 4;
+        ch.n_valid = n;
+        ch.data_offset = offset;
+        offset = Align_offset(offset + n * ch.value_size);
+        if (!col.valid.empty())
+        {
+            ch.n_valid = 0;
+            for (uint64_t i = 0; i < n; i++)
+            {
+                ch.n_valid += col.valid[i] ? 1 : 0;
+            }
+            ch.valid_offset = offset;
+            offset = Align_offset(offset + (n + 7) / 8);
+        }
+    }
+
+    /** ヘッダ **/
+    Sensor_log_header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, sensor_log_magic, sizeof(header.magic));
+    header.version = sensor_log_version;
+    header.n_channels = n_channels;
+    header.n_samples = n;
+    header.sample_rate = data.sample_rate;
+    header.time_offset = time_offset;
+
+    FILE *fp = fopen(filename, "wb");
+    if (fp == NULL)
+    {
+        printf("Cannot open: %s\n", filename);
+        return false;
+    }
+
+    /** 書き込み (失敗した場合は ok = false) **/
+    bool ok = true;
+    uint64_t pos = 0;
+    ok = ok && fwrite(&header, sizeof(header), 1, fp) == 1;
+    ok = ok && fwrite(table.data(), sizeof(Sensor_log_channel), n_channels, fp) == n_channels;
+    pos = sizeof(header) + n_channels * sizeof(Sensor_log_channel);
+    ok = ok && Write_padding(fp, pos);
+
+    ok = ok && fwrite(data.time.data(), sizeof(double), n, fp) == n;
+    pos += n * sizeof(double);
+    ok = ok && Write_padding(fp, pos);
+
+    for (uint32_t j = 0; j < n_channels && ok; j++)
+    {
+        const Sensor_log_column &col = data.columns[j];
+        if (col.is_double)
+        {
+            ok = fwrite(col.values.data(), sizeof(double), n, fp) == n;
+        }
+        else
+        {
+            std::vector<float> tmp(col.values.begin(), col.values.end());
+            ok = fwrite(tmp.data(), sizeof(float), n, fp) == n;
+        }
+        pos += n * table[j].value_size;
+        ok = ok && Write_padding(fp, pos);
+
+        if (!col.valid.empty())
+        {
+            std::vector<uint8_t> bits((n + 7) / 8, 0);
+            for (uint64_t i = 0; i < n; i++)
+            {
+                bits[i >> 3] |= (col.valid[i] ? 1 : 0) << (i & 7);
+            }
+            ok = ok && fwrite(bits.data(), 1, bits.size(), fp) == bits.size();
+            pos += bits.size();
+            ok = ok && Write_padding(fp, pos);
+        }
+    }
+    ok = Metrics_fclose(fp) == 0 && ok;
+    if (!ok)
+    {
+        printf("Cannot write: %s\n", filename);
+    }
+
+    return ok;
+}
+
+/**************************************************************/
+// Function name : Sensor_log_range
+// Description   : offset から count 個 (1個 size byte) の配列がファイル内に収まり、64 byte 境界にあるか
+/**************************************************************/
+inline bool Sensor_log_range(uint64_t file_size, uint64_t offset, uint64_t count, uint64_t size)
+{
+    return offset % sensor_log_align == 0 && offset <= file_size && count <= (file_size - offset) / size;
+}
+
+/**************************************************************/
+// Function name : Check_sensor_log
+// Description   : ヘッダ・チャンネル表の位置と長さの検証 (問題がある場合は理由, 正常な場合は NULL)
+/**************************************************************/
+inline const char *Check_sensor_log(const Sensor_log &log)
+{
+    const uint64_t size = log.file.size;
+    const Sensor_log_header &h = *log.header;
+    const uint64_t n = h.n_samples;
+
+    /** チャンネル表 **/
+    if (h.n_channels > (size - sizeof(Sensor_log_header)) / sizeof(Sensor_log_channel))
+    {
+        return "channel table exceeds file";
+    }
+    const uint64_t table_end = sizeof(Sensor_log_header) + (uint64_t)h.n_channels * sizeof(Sensor_log_channel);
+
+    /** 時刻配列 **/
+    if (h.time_offset < table_end || !Sensor_log_range(size, h.time_offset, n, sizeof(double)))
+    {
+        return "time array exceeds file";
+    }
+
+    /** 各チャンネル **/
+    for (uint32_t j = 0; j < h.n_channels; j++)
+    {
+        const Sensor_log_channel &ch = log.channels[j];
+        if (memchr(ch.name, '\0', sizeof(ch.name)) == NULL || memchr(ch.unit, '\0', sizeof(ch.unit)) == NULL)
+        {
+            return "unterminated channel name";
+        }
+        if (ch.value_size != 4 && ch.value_size != 8)
+        {
+            return "invalid value size";
+        }
+        if (ch.data_offset < table_end || !Sensor_log_range(size, ch.data_offset, n, ch.value_size))
+        {
+            return "channel data exceeds file";
+        }
+        if (ch.valid_offset != 0 && (ch.valid_offset < table_end || !Sensor_log_range(size, ch.valid_offset, (n + 7) / 8, 1)))
+        {
+            return "valid bits exceed file";
+        }
+        if (ch.n_valid > n)
+        {
+            return "invalid valid count";
+        }
+    }
+    return NULL;
+}
+
+/**************************************************************/
+// Function name : Close_sensor_log
+// Description   : mmap の解除
+/**************************************************************/
+inline void Close_sensor_log(Sensor_log &log)
+{
+    Unmap_file(log.file);
+    log.header = NULL;
+    log.channels = NULL;
+    log.time = NULL;
+}
+
+/**************************************************************/
+// Function name : Open_sensor_log
+// Description   : バイナリログを mmap して開く (値はコピーしない)
+/**************************************************************/
+inline bool Open_sensor_log(const char *filename, Sensor_log &log)
+{
+    if (!Map_file(filename, log.file))
+    {
+        return false;
+    }
+
+    if (log.file.size < sizeof(Sensor_log_header) || memcmp(log.file.data, sensor_log_magic, sizeof(sensor_log_magic)) != 0)
+    {
+        printf("Not a sensor log: %s\n", filename);
+        Unmap_file(log.file);
+        return false;
+    }
+
+    log.header = (const Sensor_log_header *)log.file.data;
+    if (log.header->version != sensor_log_version)
+    {
+        printf("Unsupported sensor log version %u: %s\n", log.header->version, filename);
+        Unmap_file(log.file);
+        return false;
+    }
+    log.channels = (const Sensor_log_channel *)(log.file.data + sizeof(Sensor_log_header));
+
+    /** 位置と長さの検証 (切り詰められた・壊れたファイル) **/
+    const char *error = Check_sensor_log(log);
+    if (error != NULL)
+    {
+        printf("Corrupt sensor log (%s): %s\n", error, filename);
+        Close_sensor_log(log);
+        return false;
+    }
+    log.time = (const double *)(log.file.data + log.header->time_offset);
+
+    return true;
+}
+
+/**************************************************************/
+// Function name : Find_channel
+// Description   : チャンネル番号の検索 (見つからない場合は -1)
+/**************************************************************/
+inline int Find_channel(const Sensor_log &log, const char *name)
+{
+    for (uint32_t j = 0; j < log.header->n_channels; j++)
+    {
+        if (strncmp(log.channels[j].name, name, sizeof(log.channels[j].name)) == 0)
+        {
+            return j;
+        }
+    }
+    return -1;
+}
+
+/**************************************************************/
+// Function name : Channel_float / Channel_double
+// Description   : チャンネルの値の配列 (型が一致しない場合は NULL)
+/**************************************************************/
+inline const float *Channel_float(const Sensor_log &log, int j)
+{
+    const Sensor_log_channel &ch = log.channels[j];
+    return ch.value_size == 4 ? (const float *)(log.file.data + ch.data_offset) : NULL;
+}
+
+inline const double *Channel_double(const Sensor_log &log, int j)
+{
+    const Sensor_log_channel &ch = log.channels[j];
+    return ch.value_size == 8 ? (const double *)(log.file.data + ch.data_offset) : NULL;
+}
+
+/**************************************************************/
+// Function name : Channel_value
+// Description   : 型によらない値の取得
+/**************************************************************/
+inline double Channel_value(const Sensor_log &log, int j, uint64_t i)
+{
+    const Sensor_log_channel &ch = log.channels[j];
+    if (ch.value_size == 8)
+    {
+        return ((const double *)(log.file.data + ch.data_offset))[i];
+    }
+    return ((const float *)(log.file.data + ch.data_offset))[i];
+}
+
+/**************************************************************/
+// Function name : Is_valid
+// Description   : サンプルの有効判定
+/**************************************************************/
+inline bool Is_valid(const Sensor_log &log, int j, uint64_t i)
+{
+    const Sensor_log_channel &ch = log.channels[j];
+    if (ch.valid_offset == 0)
+    {
+        return true;
+    }
+    const uint8_t *bits = (const uint8_t *)(log.file.data + ch.valid_offset);
+    return (bits[i >> 3] >> (i & 7)) & 1;
+}
+
+#endif
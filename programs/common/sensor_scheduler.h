@@ -0,0 +1,142 @@
+/**************************************************************/
+// File name   : sensor_scheduler.h
+// Author      : Masatsugu Kitadai
+// Description : サンプリング周期の異なるセンサ列を時刻順に統合して処理する
+//
+//   各センサは自分の周期の時刻配列だけを持つ (GPS を IMU の周期に合わせて
+//   番兵値で埋める必要はない)。全センサの次の時刻を小さなヒープで比較し、
+//   最も早いサンプルから登録したコールバック (予測・更新) を呼び出す。
+//   同時刻の場合は先に登録したセンサを先に処理する。
+/**************************************************************/
+
+#ifndef SENSOR_SCHEDULER_H
+#define SENSOR_SCHEDULER_H
+
+#include <stddef.h>
+#include <functional>
+#include <vector>
+
+/** センサ列 **/
+struct Sensor_stream
+{
+    const float *time_f = NULL;             // 時刻配列 (float の場合) [s]
+    const double *time_d = NULL;            // 時刻配列 (double の場合) [s]
+    size_t size = 0;                        // サンプル数 [-]
+    size_t pos = 0;                         // 次に処理するサンプル番号 [-]
+    std::function<void(size_t i)> callback; // サンプル i の処理
+
+    double Time() const { return time_d != NULL ? time_d[pos] : time_f[pos]; }
+};
+
+/** スケジューラ **/
+struct Sensor_scheduler
+{
+    std::vector<Sensor_stream> streams; // 登録したセンサ列
+    std::vector<int> heap;              // 次の時刻が早い順の二分ヒープ (streams の番号)
+};
+
+/**************************************************************/
+// Function name : Scheduler_before
+// Description   : センサ列 a の次のサンプルが b より先か (同時刻は登録順)
+/**************************************************************/
+inline bool Scheduler_before(const Sensor_scheduler &sc, int a, int b)
+{
+    const double ta = sc.streams[a].Time();
+    const double tb = sc.streams[b].Time();
+    return ta < tb || (ta == tb && a < b);
+}
+
+/**************************************************************/
+// Function name : Scheduler_sift_down
+// Description   : ヒープの先頭要素を正しい位置へ移動
+/**************************************************************/
+inline void Scheduler_sift_down(Sensor_scheduler &sc, size_t i)
+{
+    const size_t n = sc.heap.size();
+    while (true)
+    {
+        size_t first = i;
+        const size_t l = 2 * i + 1;
+        const size_t r = 2 * i + 2;
+        if (l < n && Scheduler_before(sc, sc.heap[l], sc.heap[first]))
+        {
+            first = l;
+        }
+        if (r < n && Scheduler_before(sc, sc.heap[r], sc.heap[first]))
+        {
+            first = r;
+        }
+        if (first == i)
+        {
+            return;
+        }
+        std::swap(sc.heap[i], sc.heap[first]);
+        i = first;
+    }
+}
+
+/**************************************************************/
+// Function name : Scheduler_add
+// Description   : センサ列の登録 (戻り値はセンサ番号)
+/**************************************************************/
+inline int Scheduler_add(Sensor_scheduler &sc, const double *time, size_t size, std::function<void(size_t)> callback)
+{
+    Sensor_stream st;
+    st.time_d = time;
+    st.size = size;
+    st.callback = callback;
+    sc.streams.push_back(st);
+    return sc.streams.size() - 1;
+}
+
+inline int Scheduler_add(Sensor_scheduler &sc, const float *time, size_t size, std::function<void(size_t)> callback)
+{
+    Sensor_stream st;
+    st.time_f = time;
+    st.size = size;
+    st.callback = callback;
+    sc.streams.push_back(st);
+    return sc.streams.size() - 1;
+}
+
+/**************************************************************/
+// Function name : Scheduler_run
+// Description   : 全センサ列のサンプルを時刻順に処理
+/**************************************************************/
+inline void Scheduler_run(Sensor_scheduler &sc)
+{
+    /** ヒープの構築 **/
+    sc.heap.clear();
+    for (size_t s = 0; s < sc.streams.size(); s++)
+    {
+        sc.streams[s].pos = 0;
+        if (sc.streams[s].size > 0)
+        {
+            sc.heap.push_back(s);
+        }
+    }
+    for (size_t i = sc.heap.size() / 2; i-- > 0;)
+    {
+        Scheduler_sift_down(sc, i);
+    }
+
+    /** 時刻順の処理 **/
+    while (!sc.heap.empty())
+    {
+        Sensor_stream &st = sc.streams[sc.heap[0]];
+        st.callback(st.pos);
+        st.pos += 1;
+
+        if (st.pos == st.size)
+        {
+            sc.heap[0] = sc.heap.back(); // 処理し終えたセンサ列を除外
+            sc.heap.pop_back();
+        }
+        if (!sc.heap.empty())
+        {
+            Scheduler_sift_down(sc, 0);
+        }
+    }
+}
+
+#endif
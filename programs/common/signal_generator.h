@@ -0,0 +1,394 @@
+/**************************************************************/
+// File name   : signal_generator.h
+// Author      : Masatsugu Kitadai
+// Description : 試験用信号の合成 (正弦波・チャープ・ステップ・有色雑音・外れ値の組み合わせ)
+//
+//   成分は "種類:パラメータ,..." の文字列で指定し、実行時に何個でも足し合わせられる
+//     dc:値                              直流成分
+//     tone:振幅,周波数[,位相 [deg]]      正弦波
+//     multitone:振幅,最初の周波数,間隔,本数  等間隔の正弦波の組 (tone に展開)
+//     chirp:振幅,開始周波数,終了周波数,周期 [s]  線形チャープ (周期ごとに繰り返す)
+//     step:振幅,時刻 [s]                 ステップ
+//     white:標準偏差                     白色雑音 (正規分布)
+//     pink:標準偏差                      ピンク雑音 (1/f, Paul Kellett のフィルタ)
+//     brown:標準偏差 [/√s]               ブラウン雑音 (白色雑音の積分, ランダムウォーク)
+//     impulse:振幅,発生率 [1/s]          インパルス状の外れ値 (符号はランダム)
+//
+//   信号はブロック (既定 1024 点) 単位で生成するため、長さに制限なく逐次書き出せる
+//   正弦波はブロック先頭の位相を通し番号から毎回計算し直し、ブロック内は事前に作った回転表との積和で求める
+//   (sin の呼び出しがなくベクトル化でき、位相の誤差も蓄積しない)
+/**************************************************************/
+
+#ifndef SIGNAL_GENERATOR_H
+#define SIGNAL_GENERATOR_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+#include <vector>
+
+/** 成分の種類 **/
+enum Signal_kind
+{
+    signal_dc,
+    signal_tone,
+    signal_chirp,
+    signal_step,
+    signal_white,
+    signal_pink,
+    signal_brown,
+    signal_impulse
+};
+
+/** 1成分 **/
+struct Signal_component
+{
+    Signal_kind kind = signal_dc; // 種類
+    double p[4] = {0, 0, 0, 0};   // パラメータ (種類ごとの意味は先頭の説明の順)
+    std::vector<double> rot_cos;  // 正弦波のブロック内の回転表 cos(ωk) [-]
+    std::vector<double> rot_sin;  // 正弦波のブロック内の回転表 sin(ωk) [-]
+    double state[7] = {0};        // ピンク雑音のフィルタ・ブラウン雑音の積分値
+};
+
+/** 信号の生成器 **/
+struct Signal_generator
+{
+    double fs = 1000;                         // サンプリング周波数 [Hz]
+    size_t block = 1024;                      // ブロックの点数 [-]
+    uint64_t index = 0;                       // 次に生成する点の通し番号 [-]
+    uint64_t rng[4] = {0, 0, 0, 0};           // 乱数の状態 (xoshiro256**)
+    std::vector<Signal_component> components; // 成分
+    std::vector<double> gauss;                // 正規乱数の作業領域
+};
+
+/**************************************************************/
+// Function name : Signal_rng_next
+// Description   : 64 bit の一様乱数 (xoshiro256**)
+/**************************************************************/
+inline uint64_t Signal_rng_next(uint64_t s[4])
+{
+    auto rotl = [](uint64_t x, int k)
+    {
+        return (x << k) | (x >> (64 - k));
+    };
+    const uint64_t result = rotl(s[1] * 5, 7) * 9;
+    const uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 45);
+    return result;
+}
+
+/**************************************************************/
+// Function name : Signal_uniform
+// Description   : (0, 1) の一様乱数
+/**************************************************************/
+inline double Signal_uniform(uint64_t s[4])
+{
+    return ((Signal_rng_next(s) >> 11) + 0.5) * (1.0 / 9007199254740992.0);
+}
+
+/**************************************************************/
+// Function name : Signal_seed
+// Description   : 乱数の状態の初期化 (splitmix64 で種を4語に広げる)
+/**************************************************************/
+inline void Signal_seed(uint64_t s[4], uint64_t seed)
+{
+    uint64_t x = seed;
+    for (int k = 0; k < 4; k++)
+    {
+        uint64_t z = (x += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        s[k] = z ^ (z >> 31);
+    }
+}
+
+/**************************************************************/
+// Function name : Signal_init
+// Description   : 生成器の初期化 (fs : サンプリング周波数 [Hz], seed : 乱数の種, block : ブロックの点数)
+/**************************************************************/
+inline void Signal_init(Signal_generator &gen, double fs, uint64_t seed, size_t block = 1024)
+{
+    gen.fs = fs;
+    gen.block = block > 0 ? block : 1;
+    gen.index = 0;
+    gen.components.clear();
+    Signal_seed(gen.rng, seed);
+}
+
+/**************************************************************/
+// Function name : Signal_add_tone
+// Description   : 正弦波の追加 (回転表の作成)
+/**************************************************************/
+inline void Signal_add_tone(Signal_generator &gen, double amp, double freq, double phase_deg)
+{
+    Signal_component c;
+    c.kind = signal_tone;
+    c.p[0] = amp;
+    c.p[1] = freq;
+    c.p[2] = phase_deg * M_PI / 180.0;
+    c.rot_cos.resize(gen.block);
+    c.rot_sin.resize(gen.block);
+    const double omega = 2.0 * M_PI * freq / gen.fs; // 1点あたりの位相増分 [rad]
+    for (size_t k = 0; k < gen.block; k++)
+    {
+        c.rot_cos[k] = cos(omega * k);
+        c.rot_sin[k] = sin(omega * k);
+    }
+    gen.components.push_back(c);
+}
+
+/**************************************************************/
+// Function name : Signal_add
+// Description   : "種類:パラメータ,..." の成分の追加 | 解釈できない場合は false
+/**************************************************************/
+inline bool Signal_add(Signal_generator &gen, const char *spec)
+{
+    const char *names[] = {"dc", "tone", "multitone", "chirp", "step", "white", "pink", "brown", "impulse"};
+    const int n_min[] = {1, 2, 4, 4, 2, 1, 1, 1, 2}; // 必要なパラメータ数
+    const int n_max[] = {1, 3, 4, 4, 2, 1, 1, 1, 2}; // パラメータ数の上限
+
+    /** 種類 **/
+    const char *colon = strchr(spec, ':');
+    const std::string name = colon != NULL ? std::string(spec, colon - spec) : std::string(spec);
+    int kind = -1;
+    for (int k = 0; k < 9; k++)
+    {
+        if (name == names[k])
+        {
+            kind = k;
+        }
+    }
+    if (kind < 0)
+    {
+        printf("Unknown signal: %s\n", spec);
+        return false;
+    }
+
+    /** パラメータ **/
+    double p[4] = {0, 0, 0, 0};
+    int n = 0;
+    const char *s = colon != NULL ? colon + 1 : "";
+    while (*s != '\0')
+    {
+        char *end;
+        const double value = strtod(s, &end);
+        if (end == s || n >= 4 || (*end != ',' && *end != '\0'))
+        {
+            n = -1;
+            break;
+        }
+        p[n++] = value;
+        s = *end == ',' ? end + 1 : end;
+    }
+    if (n < n_min[kind] || n > n_max[kind])
+    {
+        printf("Invalid parameters: %s\n", spec);
+        return false;
+    }
+
+    /** 登録 (multitone は tone に展開) **/
+    if (name == "tone")
+    {
+        Signal_add_tone(gen, p[0], p[1], p[2]);
+        return true;
+    }
+    if (name == "multitone")
+    {
+        for (int k = 0; k < (int)p[3]; k++)
+        {
+            Signal_add_tone(gen, p[0], p[1] + k * p[2], 0.0);
+        }
+        return true;
+    }
+    const Signal_kind kinds[] = {signal_dc, signal_tone, signal_tone, signal_chirp, signal_step, signal_white, signal_pink, signal_brown, signal_impulse};
+    Signal_component c;
+    c.kind = kinds[kind];
+    memcpy(c.p, p, sizeof(p));
+    if (c.kind == signal_chirp && c.p[3] <= 0)
+    {
+        printf("Invalid parameters: %s\n", spec);
+        return false;
+    }
+    gen.components.push_back(c);
+    return true;
+}
+
+/**************************************************************/
+// Function name : Signal_gaussian
+// Description   : 標準正規乱数 n 点 (Box-Muller 法)
+/**************************************************************/
+inline void Signal_gaussian(uint64_t s[4], double *g, size_t n)
+{
+    for (size_t k = 0; k < n; k += 2)
+    {
+        const double r = sqrt(-2.0 * log(Signal_uniform(s)));
+        const double theta = 2.0 * M_PI * Signal_uniform(s);
+        g[k] = r * cos(theta);
+        if (k + 1 < n)
+        {
+            g[k + 1] = r * sin(theta);
+        }
+    }
+}
+
+/**************************************************************/
+// Function name : Signal_block
+// Description   : 1ブロック (n <= block 点) の生成 (clean : 確定的な成分の和, noise : 乱数成分の和)
+/**************************************************************/
+inline void Signal_block(Signal_generator &gen, double *clean, double *noise, size_t n)
+{
+    const double dt = 1.0 / gen.fs;
+    const uint64_t i0 = gen.index;
+    for (size_t k = 0; k < n; k++)
+    {
+        clean[k] = 0;
+        noise[k] = 0;
+    }
+    gen.gauss.resize(gen.block);
+    double *g = gen.gauss.data();
+
+    for (Signal_component &c : gen.components)
+    {
+        switch (c.kind)
+        {
+        case signal_dc:
+            for (size_t k = 0; k < n; k++)
+            {
+                clean[k] += c.p[0];
+            }
+            break;
+
+        case signal_tone:
+        {
+            /** ブロック先頭の位相 (f i0 / fs の小数部から計算し、誤差を蓄積させない) **/
+            const double cycles = fmod(c.p[1] * (double)i0, gen.fs) / gen.fs;
+            const double phase = 2.0 * M_PI * cycles + c.p[2];
+            const double a_sin = c.p[0] * sin(phase);
+            const double a_cos = c.p[0] * cos(phase);
+            const double *rc = c.rot_cos.data();
+            const double *rs = c.rot_sin.data();
+            for (size_t k = 0; k < n; k++)
+            {
+                clean[k] += a_sin * rc[k] + a_cos * rs[k]; // A sin(φ + ωk)
+            }
+            break;
+        }
+
+        case signal_chirp:
+        {
+            /** φ(τ) = 2π (f0 τ + (f1 - f0) τ^2 / 2T), τ は周期 T ごとに 0 に戻る **/
+            const double rate = (c.p[2] - c.p[1]) / c.p[3];
+            for (size_t k = 0; k < n; k++)
+            {
+                const double tau = fmod((i0 + k) * dt, c.p[3]);
+                clean[k] += c.p[0] * sin(2.0 * M_PI * (c.p[1] * tau + 0.5 * rate * tau * tau));
+            }
+            break;
+        }
+
+        case signal_step:
+            for (size_t k = 0; k < n; k++)
+            {
+                clean[k] += (i0 + k) * dt >= c.p[1] ? c.p[0] : 0.0;
+            }
+            break;
+
+        case signal_white:
+            Signal_gaussian(gen.rng, g, n);
+            for (size_t k = 0; k < n; k++)
+            {
+                noise[k] += c.p[0] * g[k];
+            }
+            break;
+
+        case signal_pink:
+        {
+            /** Paul Kellett のフィルタ (白色雑音の標準偏差 1 に対する出力の標準偏差 3.0525 で正規化) **/
+            Signal_gaussian(gen.rng, g, n);
+            double *b = c.state;
+            const double gain = c.p[0] / 3.0525;
+            for (size_t k = 0; k < n; k++)
+            {
+                const double w = g[k];
+                b[0] = 0.99886 * b[0] + w * 0.0555179;
+                b[1] = 0.99332 * b[1] + w * 0.0750759;
+                b[2] = 0.96900 * b[2] + w * 0.1538520;
+                b[3] = 0.86650 * b[3] + w * 0.3104856;
+                b[4] = 0.55000 * b[4] + w * 0.5329522;
+                b[5] = -0.7616 * b[5] - w * 0.0168980;
+                noise[k] += gain * (b[0] + b[1] + b[2] + b[3] + b[4] + b[5] + b[6] + w * 0.5362);
+                b[6] = w * 0.115926;
+            }
+            break;
+        }
+
+        case signal_brown:
+        {
+            Signal_gaussian(gen.rng, g, n);
+            const double step = c.p[0] * sqrt(dt); // 1点あたりの増分の標準偏差
+            for (size_t k = 0; k < n; k++)
+            {
+                c.state[0] += step * g[k];
+                noise[k] += c.state[0];
+            }
+            break;
+        }
+
+        case signal_impulse:
+        {
+            const double probability = c.p[1] * dt; // 1点あたりの発生確率 [-]
+            for (size_t k = 0; k < n; k++)
+            {
+                const uint64_t r = Signal_rng_next(gen.rng);
+                if ((r >> 11) * (1.0 / 9007199254740992.0) < probability)
+                {
+                    noise[k] += (r & 1) ? c.p[0] : -c.p[0];
+                }
+            }
+            break;
+        }
+        }
+    }
+    gen.index += n;
+}
+
+/**************************************************************/
+// Function name : Signal_next
+// Description   : 次の n 点の生成 (ブロック単位に分けて生成, clean・noise は n 点分)
+/**************************************************************/
+inline void Signal_next(Signal_generator &gen, double *clean, double *noise, size_t n)
+{
+    for (size_t k = 0; k < n; k += gen.block)
+    {
+        const size_t len = n - k < gen.block ? n - k : gen.block;
+        Signal_block(gen, clean + k, noise + k, len);
+    }
+}
+
+/**************************************************************/
+// Function name : Signal_generate
+// Description   : 次の n 点の生成 (全成分の和)
+/**************************************************************/
+inline void Signal_generate(Signal_generator &gen, double *out, size_t n)
+{
+    std::vector<double> noise(n < gen.block ? n : gen.block);
+    for (size_t k = 0; k < n; k += gen.block)
+    {
+        const size_t len = n - k < gen.block ? n - k : gen.block;
+        Signal_block(gen, out + k, noise.data(), len);
+        for (size_t j = 0; j < len; j++)
+        {
+            out[k + j] += noise[j];
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,254 @@
+/**************************************************************/
+// File name   : simplify.h
+// Author      : Masatsugu Kitadai
+// Description : 走行軌跡の間引き (許容誤差 [m] 以内で頂点を削減)
+//
+//   Simplify_douglas_peucker : Douglas-Peucker 法 (元の全点が許容誤差以内に収まる)
+//   Simplify_visvalingam     : Visvalingam 法 (ヒープで重要度の低い点から削除, O(N log N))
+//   Simplify_stream          : 逐次処理 (opening window 法, 点が届くたびに確定した頂点を返す)
+//   重要度・誤差はいずれも線分からの距離 [m] で評価する
+/**************************************************************/
+
+#ifndef SIMPLIFY_H
+#define SIMPLIFY_H
+
+#include <stddef.h>
+#include <math.h>
+#include <vector>
+#include <queue>
+
+/**************************************************************/
+// Function name : Segment_distance
+// Description   : 点 (px, py) から線分 (ax, ay) → (bx, by) までの距離 [m]
+/**************************************************************/
+inline double Segment_distance(double px, double py, double ax, double ay, double bx, double by)
+{
+    const double dx = bx - ax;
+    const double dy = by - ay;
+    const double length2 = dx * dx + dy * dy;
+    double u = length2 > 0 ? ((px - ax) * dx + (py - ay) * dy) / length2 : 0;
+    u = u < 0 ? 0 : u > 1 ? 1 : u;
+    return hypot(px - (ax + u * dx), py - (ay + u * dy));
+}
+
+/**************************************************************/
+// Function name : Simplify_douglas_peucker
+// Description   : Douglas-Peucker 法 (戻り値は残す点の番号, 昇順)
+/**************************************************************/
+template <typename T>
+inline std::vector<int> Simplify_douglas_peucker(const T *x, const T *y, size_t n, double tolerance)
+{
+    std::vector<int> kept;
+    if (n <= 2)
+    {
+        for (size_t i = 0; i < n; i++)
+        {
+            kept.push_back(i);
+        }
+        return kept;
+    }
+
+    std::vector<char> keep(n, 0);
+    keep[0] = keep[n - 1] = 1;
+
+    /** 再帰の代わりに区間のスタックで処理 **/
+    std::vector<std::pair<int, int>> stack;
+    stack.push_back(std::make_pair(0, (int)n - 1));
+    while (!stack.empty())
+    {
+        const int a = stack.back().first;
+        const int b = stack.back().second;
+        stack.pop_back();
+
+        int farthest = -1;
+        double d_max = tolerance;
+        for (int i = a + 1; i < b; i++)
+        {
+            const double d = Segment_distance(x[i], y[i], x[a], y[a], x[b], y[b]);
+            if (d > d_max)
+            {
+                d_max = d;
+                farthest = i;
+            }
+        }
+        if (farthest >= 0)
+        {
+            keep[farthest] = 1;
+            stack.push_back(std::make_pair(a, farthest));
+            stack.push_back(std::make_pair(farthest, b));
+        }
+    }
+
+    for (size_t i = 0; i < n; i++)
+    {
+        if (keep[i])
+        {
+            kept.push_back(i);
+        }
+    }
+    return kept;
+}
+
+/**************************************************************/
+// Function name : Simplify_visvalingam
+// Description   : Visvalingam 法 (戻り値は残す点の番号, 昇順)
+//                 重要度は前後の点を結ぶ線分からの距離 (削除済みの点の重要度を下回らない)
+/**************************************************************/
+template <typename T>
+inline std::vector<int> Simplify_visvalingam(const T *x, const T *y, size_t n, double tolerance)
+{
+    std::vector<int> prev(n), next(n);
+    std::vector<double> importance(n, INFINITY);
+    for (size_t i = 0; i < n; i++)
+    {
+        prev[i] = (int)i - 1;
+        next[i] = i + 1 < n ? (int)i + 1 : -1;
+    }
+
+    /** 重要度の小さい順のヒープ (更新前の古い要素は取り出し時に読み飛ばす) **/
+    typedef std::pair<double, int> Entry;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> heap;
+    auto update = [&](int i, double floor_value)
+    {
+        if (prev[i] < 0 || next[i] < 0)
+        {
+            return;
+        }
+        const double d = Segment_distance(x[i], y[i], x[prev[i]], y[prev[i]], x[next[i]], y[next[i]]);
+        importance[i] = d > floor_value ? d : floor_value;
+        heap.push(Entry(importance[i], i));
+    };
+    for (size_t i = 1; i + 1 < n; i++)
+    {
+        update(i, 0.0);
+    }
+
+    std::vector<char> removed(n, 0);
+    while (!heap.empty())
+    {
+        const Entry e = heap.top();
+        heap.pop();
+        if (removed[e.second] || e.first != importance[e.second])
+        {
+            continue;
+        }
+        if (e.first > tolerance)
+        {
+            break;
+        }
+
+        /** 削除して前後の点の重要度を更新 **/
+        const int i = e.second;
+        removed[i] = 1;
+        next[prev[i]] = next[i];
+        prev[next[i]] = prev[i];
+        update(prev[i], e.first);
+        update(next[i], e.first);
+    }
+
+    std::vector<int> kept;
+    for (size_t i = 0; i < n; i++)
+    {
+        if (!removed[i])
+        {
+            kept.push_back(i);
+        }
+    }
+    return kept;
+}
+
+/** 逐次処理の状態 **/
+struct Simplify_stream
+{
+    double tolerance = 0.01;  // 許容誤差 [m]
+    size_t max_window = 1024; // 確定前に保持する点数の上限 [-]
+    std::vector<double> wx;   // 最後の頂点以降の点の x 座標 (先頭が最後の頂点) [m]
+    std::vector<double> wy;   // 最後の頂点以降の点の y 座標 [m]
+    std::vector<long> wi;     // 最後の頂点以降の点の番号 [-]
+    long input = 0;           // 入力点数 [-]
+    long output = 0;          // 出力した頂点数 [-]
+};
+
+/**************************************************************/
+// Function name : Simplify_stream_init
+// Description   : 初期化 (tolerance : 許容誤差 [m])
+/**************************************************************/
+inline void Simplify_stream_init(Simplify_stream &st, double tolerance, size_t max_window = 1024)
+{
+    st.tolerance = tolerance;
+    st.max_window = max_window;
+    st.wx.clear();
+    st.wy.clear();
+    st.wi.clear();
+    st.input = 0;
+    st.output = 0;
+}
+
+/**************************************************************/
+// Function name : Simplify_emit
+// Description   : 頂点の確定 (保持している点をその頂点から始め直す)
+/**************************************************************/
+template <typename Output>
+inline void Simplify_emit(Simplify_stream &st, size_t k, Output &output)
+{
+    output(st.wi[k]);
+    st.output += 1;
+    st.wx.erase(st.wx.begin(), st.wx.begin() + k);
+    st.wy.erase(st.wy.begin(), st.wy.begin() + k);
+    st.wi.erase(st.wi.begin(), st.wi.begin() + k);
+}
+
+/**************************************************************/
+// Function name : Simplify_push
+// Description   : 点 index の追加 (確定した頂点の番号を output(index) で昇順に返す)
+//                 keep が true の点は必ず頂点として残す
+/**************************************************************/
+template <typename Output>
+inline void Simplify_push(Simplify_stream &st, long index, double x, double y, Output output, bool keep = false)
+{
+    st.input += 1;
+    if (st.wi.empty())
+    {
+        /** 最初の点は必ず頂点 **/
+        st.wx.push_back(x);
+        st.wy.push_back(y);
+        st.wi.push_back(index);
+        output(index);
+        st.output += 1;
+        return;
+    }
+
+    /** 最後の頂点 → 新しい点 の線分から保持中の点が外れる場合は直前の点を頂点にする **/
+    bool fit = st.wi.size() < st.max_window;
+    for (size_t k = 1; k < st.wi.size() && fit; k++)
+    {
+        fit = Segment_distance(st.wx[k], st.wy[k], st.wx[0], st.wy[0], x, y) <= st.tolerance;
+    }
+    if (!fit)
+    {
+        Simplify_emit(st, st.wi.size() - 1, output);
+    }
+
+    st.wx.push_back(x);
+    st.wy.push_back(y);
+    st.wi.push_back(index);
+    if (keep)
+    {
+        Simplify_emit(st, st.wi.size() - 1, output);
+    }
+}
+
+/**************************************************************/
+// Function name : Simplify_finish
+// Description   : 入力終了時に最後の点を頂点として確定
+/**************************************************************/
+template <typename Output>
+inline void Simplify_finish(Simplify_stream &st, Output output)
+{
+    if (st.wi.size() > 1)
+    {
+        Simplify_emit(st, st.wi.size() - 1, output);
+    }
+}
+
+#endif
@@ -0,0 +1,167 @@
+/**************************************************************/
+// File name   : spatial_grid.h
+// Author      : Masatsugu Kitadai
+// Description : 走行軌跡の線分に対する一様格子の空間索引
+//
+//   軌跡の各線分 (点 i → 点 i+1) を外接矩形が重なる格子に登録する。
+//   格子ごとの線分番号は1本の配列に詰めて保持し (開始位置の累積和で参照)、
+//   矩形の検索では重なる格子の線分だけを返す
+/**************************************************************/
+
+#ifndef SPATIAL_GRID_H
+#define SPATIAL_GRID_H
+
+#include <stddef.h>
+#include <math.h>
+#include <vector>
+#include <algorithm>
+
+/** 空間索引 **/
+struct Spatial_grid
+{
+    double x_min = 0, y_min = 0; // 格子の原点 [m]
+    double cell = 1;             // 格子の大きさ [m]
+    int nx = 0, ny = 0;          // 格子数 [-]
+    std::vector<int> start;      // 格子ごとの線分番号の開始位置 (nx × ny + 1)
+    std::vector<int> segments;   // 格子ごとに並べた線分番号
+};
+
+/**************************************************************/
+// Function name : Grid_cell_range
+// Description   : 矩形と重なる格子の範囲 (範囲外は端の格子に制限)
+/**************************************************************/
+inline void Grid_cell_range(const Spatial_grid &grid, double x0, double y0, double x1, double y1,
+                            int &i0, int &j0, int &i1, int &j1)
+{
+    i0 = std::clamp((int)floor((x0 - grid.x_min) / grid.cell), 0, grid.nx - 1);
+    j0 = std::clamp((int)floor((y0 - grid.y_min) / grid.cell), 0, grid.ny - 1);
+    i1 = std::clamp((int)floor((x1 - grid.x_min) / grid.cell), 0, grid.nx - 1);
+    j1 = std::clamp((int)floor((y1 - grid.y_min) / grid.cell), 0, grid.ny - 1);
+}
+
+/**************************************************************/
+// Function name : Grid_build
+// Description   : 軌跡 (n 点, n-1 本の線分) の索引の作成
+//                 cell <= 0 の場合は線分の平均長さの4倍を格子の大きさとする
+/**************************************************************/
+template <typename T>
+inline void Grid_build(Spatial_grid &grid, const T *x, const T *y, size_t n, double cell = 0)
+{
+    grid.start.clear();
+    grid.segments.clear();
+    grid.nx = grid.ny = 0;
+    if (n < 2)
+    {
+        return;
+    }
+
+    /** 範囲と格子の大きさ **/
+    double x_min = x[0], x_max = x[0], y_min = y[0], y_max = y[0], length = 0;
+    for (size_t i = 1; i < n; i++)
+    {
+        x_min = std::min(x_min, (double)x[i]);
+        x_max = std::max(x_max, (double)x[i]);
+        y_min = std::min(y_min, (double)y[i]);
+        y_max = std::max(y_max, (double)y[i]);
+        length += hypot(x[i] - x[i - 1], y[i] - y[i - 1]);
+    }
+    if (cell <= 0)
+    {
+        cell = 4.0 * length / (n - 1);
+    }
+
+    /** 格子数が点数の数倍を超えないように調整 **/
+    const double area = std::max(x_max - x_min, 1e-9) * std::max(y_max - y_min, 1e-9);
+    cell = std::max(cell, sqrt(area / (4.0 * n)));
+    grid.x_min = x_min;
+    grid.y_min = y_min;
+    grid.cell = cell;
+    grid.nx = (int)((x_max - x_min) / cell) + 1;
+    grid.ny = (int)((y_max - y_min) / cell) + 1;
+
+    /** 格子ごとの線分数の計数 → 開始位置 → 登録 **/
+    grid.start.assign((size_t)grid.nx * grid.ny + 1, 0);
+    for (int pass = 0; pass < 2; pass++)
+    {
+        std::vector<int> fill;
+        if (pass == 1)
+        {
+            for (size_t c = 1; c < grid.start.size(); c++)
+            {
+                grid.start[c] += grid.start[c - 1];
+            }
+            grid.segments.resize(grid.start.back());
+            fill.assign(grid.start.begin(), grid.start.end() - 1);
+        }
+
+        for (size_t s = 0; s + 1 < n; s++)
+        {
+            int i0, j0, i1, j1;
+            Grid_cell_range(grid, std::min(x[s], x[s + 1]), std::min(y[s], y[s + 1]),
+                            std::max(x[s], x[s + 1]), std::max(y[s], y[s + 1]), i0, j0, i1, j1);
+            for (int j = j0; j <= j1; j++)
+            {
+                for (int i = i0; i <= i1; i++)
+                {
+                    const size_t c = (size_t)j * grid.nx + i;
+                    if (pass == 0)
+                    {
+                        grid.start[c + 1] += 1;
+                    }
+                    else
+                    {
+                        grid.segments[fill[c]++] = s;
+                    }
+                }
+            }
+        }
+    }
+}
+
+/**************************************************************/
+// Function name : Grid_query
+// Description   : 矩形 [x0, x1] × [y0, y1] と重なる格子の線分を f(線分番号) で返す
+//                 複数の格子にまたがる線分は重複して返す
+/**************************************************************/
+template <typename F>
+inline void Grid_query(const Spatial_grid &grid, double x0, double y0, double x1, double y1, F f)
+{
+    if (grid.nx == 0)
+    {
+        return;
+    }
+    if (x1 < grid.x_min || y1 < grid.y_min || x0 > grid.x_min + grid.nx * grid.cell || y0 > grid.y_min + grid.ny * grid.cell)
+    {
+        return;
+    }
+
+    int i0, j0, i1, j1;
+    Grid_cell_range(grid, x0, y0, x1, y1, i0, j0, i1, j1);
+    for (int j = j0; j <= j1; j++)
+    {
+        const size_t row = (size_t)j * grid.nx;
+        for (int k = grid.start[row + i0]; k < grid.start[row + i1 + 1]; k++)
+        {
+            f(grid.segments[k]);
+        }
+    }
+}
+
+/**************************************************************/
+// Function name : Grid_query_unique
+// Description   : 矩形と重なる線分番号の一覧 (昇順, 重複なし)
+/**************************************************************/
+inline std::vector<int> Grid_query_unique(const Spatial_grid &grid, double x0, double y0, double x1, double y1)
+{
+    std::vector<int> found;
+    auto add = [&](int s)
+    {
+        found.push_back(s);
+    };
+    Grid_query(grid, x0, y0, x1, y1, add);
+    std::sort(found.begin(), found.end());
+    found.erase(std::unique(found.begin(), found.end()), found.end());
+    return found;
+}
+
+#endif
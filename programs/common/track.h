@@ -0,0 +1,864 @@
+/**************************************************************/
+// File name   : track.h
+// Author      : Masatsugu Kitadai
+// Description : コースの中心線と速度の分布からの走行の真値 (位置・方位・車両座標系の加速度・ヨーレート)
+//
+//   中心線 : 直線・円弧・クロソイド (曲率が長さに比例して変わる区間) の連結、
+//            または通過点 (測量した走行ラインなど) を通る3次スプライン (弦長をパラメータとする)
+//            始点を原点・進行方向を +y に合わせる (Simulation.cpp の走行と同じ向き)
+//   速度   : 走行距離と速度の点の間を等加速度 (v^2 が距離に比例) とし、走行距離 s(t) を解析的に求める
+//   真値   : 位置・方位は区間ごとの式から求める (クロソイドは 8 点の Gauss-Legendre 積分)
+//            同じ区間の続きの点は前の点からの小さい回転 (Taylor 展開) で更新し、三角関数の呼び出しを省く
+//            前後加速度 = dv/dt, 横加速度 = v^2 κ (左が正), ヨーレート = v κ (反時計回りが正)
+//   時刻の列はブロックに分けてスレッドで並列に計算する
+//
+//   コースファイルの書式 (1行に1つ, # 以降はコメント)
+//     line     長さ [m]                         直線
+//     arc      半径 [m] 角度 [deg]              円弧 (半径は左旋回が正)
+//     clothoid 長さ [m] 終点の半径 [m]          クロソイド (曲率は直前の区間の終点から変化, 半径 0 は直線)
+//     point    x [m] y [m]                      スプラインの通過点
+//     trace    ファイル x列 y列 [間隔 [m]]      測量した走行ラインの通過点 (列は 0 始まり, 間隔ごとに平均して間引く, 既定 2 [m])
+//     closed                                    周回コース (スプラインを周期的にする)
+//     laps     周回数                           周回数 (closed の場合のみ)
+//     speed    走行距離 [m] 速度 [km/h]        速度の点 (周回コースでは最後の点までの1周分の点を1周ごとに繰り返す,
+//                                               s = 0 の点は繰り返さないため発進は1周目だけになる)
+//   直線・円弧・クロソイドと通過点は混在できない
+/**************************************************************/
+
+#ifndef TRACK_H
+#define TRACK_H
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <filesystem>
+#include "data_reader.h"
+
+/** 中心線の区間 **/
+struct Track_segment
+{
+    int type = 0;                  // 0 : 直線・円弧・クロソイド, 1 : 3次スプライン
+    double s0 = 0;                 // 始点の1周内の走行距離 [m]
+    double length = 0;             // 長さ [m]
+    double x0 = 0, y0 = 0;         // 始点 [m]
+    double phi0 = 0;               // 始点の方位 [rad] (x軸から反時計回り, 区間をまたいで連続)
+    double cos0 = 0, sin0 = 1;     // cos φ0, sin φ0
+    double k0 = 0, k1 = 0;         // 始点・終点の曲率 [1/m] (左旋回が正)
+    double h = 0;                  // スプラインのパラメータの区間長 [m]
+    double cx[4] = {}, cy[4] = {}; // スプラインの係数 (x(u) = cx[0] + cx[1] u + cx[2] u^2 + cx[3] u^3)
+};
+
+/** コース **/
+struct Track
+{
+    std::vector<Track_segment> segments; // 中心線の区間
+    double length = 0;                   // 1周の長さ [m]
+    double turn = 0;                     // 1周の方位の変化 [rad]
+    bool closed = false;                 // 周回コースか
+    int laps = 1;                        // 周回数 [-]
+    std::vector<double> speed_s;         // 速度の点の走行距離 [m]
+    std::vector<double> speed_v;         // 速度の点の速度 [m/s]
+    std::vector<double> knot_s;          // 周回分に展開した点の走行距離 [m]
+    std::vector<double> knot_v;          // 同 速度 [m/s]
+    std::vector<double> knot_a;          // 同 次の点までの加速度 [m/s2]
+    std::vector<double> knot_t;          // 同 時刻 [s]
+    double distance = 0;                 // 総走行距離 [m]
+    double duration = 0;                 // 総走行時間 [s]
+};
+
+/** 走行の真値 (時刻ごと) **/
+struct Track_samples
+{
+    std::vector<double> t;        // 時刻 [s]
+    std::vector<double> s;        // 走行距離 [m]
+    std::vector<double> x;        // x方向位置 [m]
+    std::vector<double> y;        // y方向位置 [m]
+    std::vector<double> heading;  // 方位 [rad] (x軸から反時計回り, 連続)
+    std::vector<double> speed;    // 速度 [m/s]
+    std::vector<double> acc_long; // 前後加速度 [m/s2] (加速が正)
+    std::vector<double> acc_lat;  // 横加速度 [m/s2] (左が正)
+    std::vector<double> yaw_rate; // ヨーレート [rad/s] (反時計回りが正)
+};
+
+const double track_pi = 3.14159265358979323846;
+const double track_piece_turn = 0.5; // クロソイドを分割する方位の変化 [rad] (積分の精度のため)
+const double track_step_turn = 0.05; // 前の点からの差分で計算する方位の変化の上限 [rad]
+const size_t track_batch = 4096;     // 並列計算のブロックの点数 [-]
+
+/** 8 点の Gauss-Legendre 積分 ([-1, 1] の分点と重み) **/
+const double track_gauss_x[8] = {-0.9602898564975363, -0.7966664774136267, -0.5255324099163290, -0.1834346424956498,
+                                 0.1834346424956498, 0.5255324099163290, 0.7966664774136267, 0.9602898564975363};
+const double track_gauss_w[8] = {0.1012285362903763, 0.2223810344533745, 0.3137066458778873, 0.3626837833783620,
+                                 0.3626837833783620, 0.3137066458778873, 0.2223810344533745, 0.1012285362903763};
+
+/** 4 点の Gauss-Legendre 積分 (前の点からの差分用) **/
+const double track_gauss4_x[4] = {-0.8611363115940526, -0.3399810435848563, 0.3399810435848563, 0.8611363115940526};
+const double track_gauss4_w[4] = {0.3478548451374538, 0.6521451548625461, 0.6521451548625461, 0.3478548451374538};
+
+/**************************************************************/
+// Function name : Track_spline_length
+// Description   : スプラインの区間のパラメータ 0 ～ u の弧長 [m]
+/**************************************************************/
+inline double Track_spline_length(const Track_segment &seg, double u)
+{
+    double sum = 0;
+    for (int j = 0; j < 8; j++)
+    {
+        const double v = 0.5 * u * (1.0 + track_gauss_x[j]);
+        const double dx = seg.cx[1] + (2.0 * seg.cx[2] + 3.0 * seg.cx[3] * v) * v;
+        const double dy = seg.cy[1] + (2.0 * seg.cy[2] + 3.0 * seg.cy[3] * v) * v;
+        sum += track_gauss_w[j] * sqrt(dx * dx + dy * dy);
+    }
+    return 0.5 * u * sum;
+}
+
+/**************************************************************/
+// Function name : Track_spline_point
+// Description   : スプラインの区間のパラメータ u の点の位置・方位・曲率
+/**************************************************************/
+inline void Track_spline_point(const Track_segment &seg, double u, double &x, double &y, double &phi, double &kappa)
+{
+    const double dx = seg.cx[1] + (2.0 * seg.cx[2] + 3.0 * seg.cx[3] * u) * u;
+    const double dy = seg.cy[1] + (2.0 * seg.cy[2] + 3.0 * seg.cy[3] * u) * u;
+    const double ddx = 2.0 * seg.cx[2] + 6.0 * seg.cx[3] * u;
+    const double ddy = 2.0 * seg.cy[2] + 6.0 * seg.cy[3] * u;
+    const double speed2 = dx * dx + dy * dy;
+    x = seg.cx[0] + (seg.cx[1] + (seg.cx[2] + seg.cx[3] * u) * u) * u;
+    y = seg.cy[0] + (seg.cy[1] + (seg.cy[2] + seg.cy[3] * u) * u) * u;
+    phi = seg.phi0 + remainder(atan2(dy, dx) - seg.phi0, 2.0 * track_pi);
+    kappa = (dx * ddy - dy * ddx) / (speed2 * sqrt(speed2));
+}
+
+/**************************************************************/
+// Function name : Track_segment_point
+// Description   : 区間の始点から長さ sigma [m] の点の位置・方位・曲率 (u_out : スプラインのパラメータ)
+/**************************************************************/
+inline void Track_segment_point(const Track_segment &seg, double sigma, double &x, double &y, double &phi, double &kappa, double *u_out = NULL)
+{
+    if (seg.type == 0)
+    {
+        /** 直線・円弧・クロソイド (φ = φ0 + k0 σ + dk σ^2 / 2) **/
+        const double dk = seg.length > 0 ? (seg.k1 - seg.k0) / seg.length : 0.0;
+        phi = seg.phi0 + (seg.k0 + 0.5 * dk * sigma) * sigma;
+        kappa = seg.k0 + dk * sigma;
+        if (dk == 0 && fabs(seg.k0) < 1e-12)
+        {
+            x = seg.x0 + sigma * seg.cos0;
+            y = seg.y0 + sigma * seg.sin0;
+        }
+        else if (dk == 0)
+        {
+            x = seg.x0 + (sin(phi) - seg.sin0) / seg.k0;
+            y = seg.y0 - (cos(phi) - seg.cos0) / seg.k0;
+        }
+        else
+        {
+            double sx = 0, sy = 0;
+            for (int j = 0; j < 8; j++)
+            {
+                const double v = 0.5 * sigma * (1.0 + track_gauss_x[j]);
+                const double p = seg.phi0 + (seg.k0 + 0.5 * dk * v) * v;
+                sx += track_gauss_w[j] * cos(p);
+                sy += track_gauss_w[j] * sin(p);
+            }
+            x = seg.x0 + 0.5 * sigma * sx;
+            y = seg.y0 + 0.5 * sigma * sy;
+        }
+        return;
+    }
+
+    /** 3次スプライン (弧長 sigma となるパラメータ u を Newton 法で求める) **/
+    double u = seg.length > 0 ? sigma * seg.h / seg.length : 0.0;
+    for (int it = 0; it < 8; it++)
+    {
+        const double dx = seg.cx[1] + (2.0 * seg.cx[2] + 3.0 * seg.cx[3] * u) * u;
+        const double dy = seg.cy[1] + (2.0 * seg.cy[2] + 3.0 * seg.cy[3] * u) * u;
+        const double du = (Track_spline_length(seg, u) - sigma) / sqrt(dx * dx + dy * dy);
+        u -= du;
+        if (fabs(du) < 1e-12 * seg.h)
+        {
+            break;
+        }
+    }
+    Track_spline_point(seg, u, x, y, phi, kappa);
+    if (u_out != NULL)
+    {
+        *u_out = u;
+    }
+}
+
+/**************************************************************/
+// Function name : Track_small_rotation
+// Description   : 小さい角度 d (|d| <= track_step_turn) の cos・sin (Taylor 展開, 打ち切り誤差 |d|^9 / 9! 以下)
+/**************************************************************/
+inline void Track_small_rotation(double d, double &cd, double &sd)
+{
+    const double d2 = d * d;
+    sd = d * (1.0 - d2 / 6.0 * (1.0 - d2 / 20.0 * (1.0 - d2 / 42.0)));
+    cd = 1.0 - d2 / 2.0 * (1.0 - d2 / 12.0 * (1.0 - d2 / 30.0 * (1.0 - d2 / 56.0)));
+}
+
+/**************************************************************/
+// Function name : Track_step
+// Description   : 区間内で前の点 (sigma_a, 方位 phi_a, c = cos, s = sin, 位置 x, y, スプラインのパラメータ u) から
+//                 sigma_b の点へ進める (三角関数を使わない) | 方位の変化が大きい場合は false
+/**************************************************************/
+inline bool Track_step(const Track_segment &seg, double sigma_a, double sigma_b, double phi_a, double &c, double &s, double &x, double &y, double &u, double &phi, double &kappa)
+{
+    if (seg.type == 1)
+    {
+        /** スプライン (前の点からの弧長の増分で Newton 法) **/
+        const double u_a = u;
+        for (int it = 0; it < 8; it++)
+        {
+            double length = 0, dx = 0, dy = 0;
+            for (int j = 0; j < 4; j++)
+            {
+                const double v = u_a + 0.5 * (u - u_a) * (1.0 + track_gauss4_x[j]);
+                dx = seg.cx[1] + (2.0 * seg.cx[2] + 3.0 * seg.cx[3] * v) * v;
+                dy = seg.cy[1] + (2.0 * seg.cy[2] + 3.0 * seg.cy[3] * v) * v;
+                length += track_gauss4_w[j] * sqrt(dx * dx + dy * dy);
+            }
+            length *= 0.5 * (u - u_a);
+            dx = seg.cx[1] + (2.0 * seg.cx[2] + 3.0 * seg.cx[3] * u) * u;
+            dy = seg.cy[1] + (2.0 * seg.cy[2] + 3.0 * seg.cy[3] * u) * u;
+            const double du = (length - (sigma_b - sigma_a)) / sqrt(dx * dx + dy * dy);
+            u -= du;
+            if (fabs(du) < 1e-12 * seg.h)
+            {
+                break;
+            }
+        }
+        Track_spline_point(seg, u, x, y, phi, kappa);
+        return true;
+    }
+
+    const double dk = seg.length > 0 ? (seg.k1 - seg.k0) / seg.length : 0.0;
+    const double h = sigma_b - sigma_a;
+    kappa = seg.k0 + dk * sigma_b;
+    if (fabs(h) * fmax(fabs(seg.k0 + dk * sigma_a), fabs(kappa)) > track_step_turn)
+    {
+        return false;
+    }
+    phi = seg.phi0 + (seg.k0 + 0.5 * dk * sigma_b) * sigma_b;
+
+    if (dk == 0 && fabs(seg.k0) < 1e-12)
+    {
+        /** 直線 **/
+        x = seg.x0 + sigma_b * seg.cos0;
+        y = seg.y0 + sigma_b * seg.sin0;
+        return true;
+    }
+    if (dk != 0)
+    {
+        /** クロソイド (sigma_a ～ sigma_b の積分を加える) **/
+        double sx = 0, sy = 0;
+        for (int j = 0; j < 4; j++)
+        {
+            const double v = 0.5 * h * (1.0 + track_gauss4_x[j]);
+            double cd, sd;
+            Track_small_rotation(v * (seg.k0 + dk * (sigma_a + 0.5 * v)), cd, sd);
+            sx += track_gauss4_w[j] * (c * cd - s * sd);
+            sy += track_gauss4_w[j] * (s * cd + c * sd);
+        }
+        x += 0.5 * h * sx;
+        y += 0.5 * h * sy;
+    }
+
+    /** 方位の回転 **/
+    double cd, sd;
+    Track_small_rotation(phi - phi_a, cd, sd);
+    const double c_next = c * cd - s * sd;
+    s = s * cd + c * sd;
+    c = c_next;
+    if (dk == 0)
+    {
+        /** 円弧 **/
+        x = seg.x0 + (s - seg.sin0) / seg.k0;
+        y = seg.y0 - (c - seg.cos0) / seg.k0;
+    }
+    return true;
+}
+
+/**************************************************************/
+// Function name : Track_add_segment
+// Description   : 直線・円弧・クロソイドの追加 (直前の区間の終点から始める, 方位の変化が大きいクロソイドは分割)
+/**************************************************************/
+inline void Track_add_segment(Track &tr, double length, double k0, double k1)
+{
+    if (length <= 0)
+    {
+        return;
+    }
+    const int pieces = k0 == k1 ? 1 : std::max(1, (int)ceil(std::max(fabs(k0), fabs(k1)) * length / track_piece_turn));
+    for (int p = 0; p < pieces; p++)
+    {
+        Track_segment seg;
+        seg.length = length / pieces;
+        seg.k0 = k0 + (k1 - k0) * p / pieces;
+        seg.k1 = k0 + (k1 - k0) * (p + 1) / pieces;
+        if (tr.segments.empty())
+        {
+            seg.phi0 = 0.5 * track_pi; // 始点は原点, 進行方向は +y
+        }
+        else
+        {
+            const Track_segment &prev = tr.segments.back();
+            double kappa;
+            Track_segment_point(prev, prev.length, seg.x0, seg.y0, seg.phi0, kappa);
+            seg.s0 = prev.s0 + prev.length;
+        }
+        seg.cos0 = cos(seg.phi0);
+        seg.sin0 = sin(seg.phi0);
+        tr.segments.push_back(seg);
+    }
+}
+
+/**************************************************************/
+// Function name : Track_tridiagonal
+// Description   : 3重対角の連立方程式 (a : 下, b : 対角, c : 上, d : 右辺 → 解)
+/**************************************************************/
+inline void Track_tridiagonal(const std::vector<double> &a, std::vector<double> b, const std::vector<double> &c, std::vector<double> &d)
+{
+    const size_t n = b.size();
+    for (size_t i = 1; i < n; i++)
+    {
+        const double w = a[i] / b[i - 1];
+        b[i] -= w * c[i - 1];
+        d[i] -= w * d[i - 1];
+    }
+    d[n - 1] /= b[n - 1];
+    for (size_t i = n - 1; i-- > 0;)
+    {
+        d[i] = (d[i] - c[i] * d[i + 1]) / b[i];
+    }
+}
+
+/**************************************************************/
+// Function name : Track_spline_second
+// Description   : スプラインの通過点の2階微分 (h : 区間長, 開いた曲線は自然スプライン, 閉じた曲線は周期スプライン)
+/**************************************************************/
+inline std::vector<double> Track_spline_second(const std::vector<double> &p, const std::vector<double> &h, bool closed)
+{
+    const size_t n = p.size();
+    const size_t m = h.size(); // 区間数
+    auto slope = [&](size_t i)
+    {
+        return (p[(i + 1) % n] - p[i]) / h[i];
+    };
+
+    if (!closed)
+    {
+        std::vector<double> second(n, 0.0);
+        if (n < 3)
+        {
+            return second;
+        }
+        std::vector<double> a(n - 2), b(n - 2), c(n - 2), d(n - 2);
+        for (size_t i = 1; i + 1 < n; i++)
+        {
+            a[i - 1] = h[i - 1];
+            b[i - 1] = 2.0 * (h[i - 1] + h[i]);
+            c[i - 1] = h[i];
+            d[i - 1] = 6.0 * (slope(i) - slope(i - 1));
+        }
+        Track_tridiagonal(a, b, c, d);
+        std::copy(d.begin(), d.end(), second.begin() + 1);
+        return second;
+    }
+
+    /** 周期スプライン (巡回3重対角, Sherman-Morrison の公式) **/
+    std::vector<double> a(m), b(m), c(m), d(m);
+    for (size_t i = 0; i < m; i++)
+    {
+        const size_t prev = (i + m - 1) % m;
+        a[i] = h[prev];
+        b[i] = 2.0 * (h[prev] + h[i]);
+        c[i] = h[i];
+        d[i] = 6.0 * (slope(i) - slope(prev));
+    }
+    const double alpha = c[m - 1]; // 左下の角
+    const double beta = a[0];      // 右上の角
+    const double gamma = -b[0];
+    std::vector<double> bb = b;
+    bb[0] -= gamma;
+    bb[m - 1] -= alpha * beta / gamma;
+    std::vector<double> z(m, 0.0);
+    z[0] = gamma;
+    z[m - 1] = alpha;
+    Track_tridiagonal(a, bb, c, d);
+    Track_tridiagonal(a, bb, c, z);
+    const double fact = (d[0] + beta * d[m - 1] / gamma) / (1.0 + z[0] + beta * z[m - 1] / gamma);
+    for (size_t i = 0; i < m; i++)
+    {
+        d[i] -= fact * z[i];
+    }
+    return d;
+}
+
+/**************************************************************/
+// Function name : Track_spline_fit
+// Description   : 通過点を通る3次スプラインの区間の作成
+/**************************************************************/
+inline void Track_spline_fit(Track &tr, const std::vector<double> &px, const std::vector<double> &py)
+{
+    const size_t n = px.size();
+    const size_t m = tr.closed ? n : n - 1;
+    std::vector<double> h(m);
+    for (size_t i = 0; i < m; i++)
+    {
+        h[i] = hypot(px[(i + 1) % n] - px[i], py[(i + 1) % n] - py[i]);
+    }
+    const std::vector<double> mx = Track_spline_second(px, h, tr.closed);
+    const std::vector<double> my = Track_spline_second(py, h, tr.closed);
+
+    tr.segments.assign(m, Track_segment());
+    for (size_t i = 0; i < m; i++)
+    {
+        const size_t j = (i + 1) % n;
+        Track_segment &seg = tr.segments[i];
+        seg.type = 1;
+        seg.h = h[i];
+        seg.cx[0] = px[i];
+        seg.cx[1] = (px[j] - px[i]) / h[i] - h[i] * (2.0 * mx[i] + mx[j]) / 6.0;
+        seg.cx[2] = 0.5 * mx[i];
+        seg.cx[3] = (mx[j] - mx[i]) / (6.0 * h[i]);
+        seg.cy[0] = py[i];
+        seg.cy[1] = (py[j] - py[i]) / h[i] - h[i] * (2.0 * my[i] + my[j]) / 6.0;
+        seg.cy[2] = 0.5 * my[i];
+        seg.cy[3] = (my[j] - my[i]) / (6.0 * h[i]);
+        seg.x0 = px[i];
+        seg.y0 = py[i];
+        seg.length = Track_spline_length(seg, h[i]);
+        seg.s0 = i > 0 ? tr.segments[i - 1].s0 + tr.segments[i - 1].length : 0.0;
+
+        /** 始点の方位 (前の区間から連続させる) **/
+        const double phi = atan2(seg.cy[1], seg.cx[1]);
+        seg.phi0 = i > 0 ? tr.segments[i - 1].phi0 + remainder(phi - tr.segments[i - 1].phi0, 2.0 * track_pi) : phi;
+        seg.cos0 = cos(seg.phi0);
+        seg.sin0 = sin(seg.phi0);
+    }
+}
+
+/**************************************************************/
+// Function name : Track_spline_points
+// Description   : 通過点からスプラインの中心線を作る (始点を原点・進行方向を +y に合わせる)
+/**************************************************************/
+inline bool Track_spline_points(Track &tr, std::vector<double> px, std::vector<double> py)
+{
+    /** 重複した点・閉じた曲線の終点 (始点と同じ点) を除く **/
+    size_t k = 0;
+    for (size_t i = 0; i < px.size(); i++)
+    {
+        if (k == 0 || hypot(px[i] - px[k - 1], py[i] - py[k - 1]) > 1e-9)
+        {
+            px[k] = px[i];
+            py[k] = py[i];
+            k++;
+        }
+    }
+    px.resize(k);
+    py.resize(k);
+    if (tr.closed && k > 1 && hypot(px[k - 1] - px[0], py[k - 1] - py[0]) < 1e-9)
+    {
+        px.pop_back();
+        py.pop_back();
+    }
+    if (px.size() < (tr.closed ? 3u : 2u))
+    {
+        printf("track: too few points (%zu)\n", px.size());
+        return false;
+    }
+
+    /** 始点の接線の向きを求めて回転・平行移動してから作り直す **/
+    Track_spline_fit(tr, px, py);
+    const double rotate = 0.5 * track_pi - tr.segments[0].phi0;
+    const double c = cos(rotate), s = sin(rotate);
+    const double x0 = px[0], y0 = py[0];
+    for (size_t i = 0; i < px.size(); i++)
+    {
+        const double dx = px[i] - x0, dy = py[i] - y0;
+        px[i] = c * dx - s * dy;
+        py[i] = s * dx + c * dy;
+    }
+    Track_spline_fit(tr, px, py);
+    return true;
+}
+
+/**************************************************************/
+// Function name : Track_trace
+// Description   : 測量した走行ラインの読み込み (走行距離 spacing [m] ごとの平均, no_fix (-100) の行は除く)
+/**************************************************************/
+inline bool Track_trace(const char *filename, size_t col_x, size_t col_y, double spacing, std::vector<double> &px, std::vector<double> &py)
+{
+    Data_table<double> table;
+    if (!Read_table(filename, table))
+    {
+        return false;
+    }
+    if (col_x >= table.cols || col_y >= table.cols)
+    {
+        printf("%s: column out of range\n", filename);
+        return false;
+    }
+    const double *x = table.Column(col_x);
+    const double *y = table.Column(col_y);
+
+    double distance = 0, sum_x = 0, sum_y = 0;
+    double last_x = NAN, last_y = NAN;
+    long bin = 0, count = 0;
+    for (size_t i = 0; i < table.rows; i++)
+    {
+        if (!isfinite(x[i]) || !isfinite(y[i]) || (x[i] == -100 && y[i] == -100))
+        {
+            continue;
+        }
+        if (!isnan(last_x))
+        {
+            distance += hypot(x[i] - last_x, y[i] - last_y);
+        }
+        last_x = x[i];
+        last_y = y[i];
+        const long b = (long)(distance / spacing);
+        if (b != bin && count > 0)
+        {
+            px.push_back(sum_x / count);
+            py.push_back(sum_y / count);
+            sum_x = sum_y = 0;
+            count = 0;
+        }
+        bin = b;
+        sum_x += x[i];
+        sum_y += y[i];
+        count++;
+    }
+    if (count > 0)
+    {
+        px.push_back(sum_x / count);
+        py.push_back(sum_y / count);
+    }
+    return true;
+}
+
+/**************************************************************/
+// Function name : Track_speed_build
+// Description   : 速度の点を周回分に展開し、各点の時刻と加速度を求める
+/**************************************************************/
+inline bool Track_speed_build(Track &tr)
+{
+    tr.distance = tr.length * tr.laps;
+    if (tr.speed_s.empty())
+    {
+        printf("track: no speed points\n");
+        return false;
+    }
+
+    /** 走行距離の順に並べ、周回コースでは最後の点までの1周分 (s = 0 を除く) を繰り返す **/
+    std::vector<size_t> order(tr.speed_s.size());
+    for (size_t i = 0; i < order.size(); i++)
+    {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b)
+                     { return tr.speed_s[a] < tr.speed_s[b]; });
+    tr.knot_s.clear();
+    tr.knot_v.clear();
+    for (size_t i : order)
+    {
+        tr.knot_s.push_back(tr.speed_s[i]);
+        tr.knot_v.push_back(tr.speed_v[i]);
+    }
+    if (tr.knot_s[0] > 0)
+    {
+        tr.knot_s.insert(tr.knot_s.begin(), 0.0);
+        tr.knot_v.insert(tr.knot_v.begin(), tr.knot_v[0]);
+    }
+    const double s_last = tr.knot_s.back();
+    std::vector<double> repeat_s, repeat_v;
+    for (size_t i = 0; i < tr.knot_s.size(); i++)
+    {
+        if (tr.knot_s[i] > std::max(0.0, s_last - tr.length))
+        {
+            repeat_s.push_back(tr.knot_s[i]);
+            repeat_v.push_back(tr.knot_v[i]);
+        }
+    }
+    for (int lap = 1; tr.closed && tr.length > 0 && s_last + (lap - 1) * tr.length < tr.distance; lap++)
+    {
+        for (size_t i = 0; i < repeat_s.size(); i++)
+        {
+            const double s = repeat_s[i] + lap * tr.length;
+            if (s <= tr.distance)
+            {
+                tr.knot_s.push_back(s);
+                tr.knot_v.push_back(repeat_v[i]);
+            }
+        }
+    }
+
+    /** 区間ごとの加速度と時刻 (等加速度 : a = (v1^2 - v0^2) / 2Δs, 所要時間 = 2Δs / (v0 + v1)) **/
+    const size_t n = tr.knot_s.size();
+    tr.knot_a.assign(n, 0.0);
+    tr.knot_t.assign(n, 0.0);
+    for (size_t i = 0; i + 1 < n; i++)
+    {
+        const double ds = tr.knot_s[i + 1] - tr.knot_s[i];
+        const double v0 = tr.knot_v[i], v1 = tr.knot_v[i + 1];
+        if (ds <= 0)
+        {
+            tr.knot_t[i + 1] = tr.knot_t[i];
+            continue;
+        }
+        if (v0 + v1 <= 0)
+        {
+            printf("track: vehicle stops between s = %.3f and %.3f [m]\n", tr.knot_s[i], tr.knot_s[i + 1]);
+            return false;
+        }
+        tr.knot_a[i] = (v1 * v1 - v0 * v0) / (2.0 * ds);
+        tr.knot_t[i + 1] = tr.knot_t[i] + 2.0 * ds / (v0 + v1);
+    }
+
+    /** 最後の点より先は速度一定 (停止している場合はそこで終了) **/
+    const double v_end = tr.knot_v[n - 1];
+    if (tr.knot_s[n - 1] < tr.distance && v_end <= 0)
+    {
+        tr.distance = tr.knot_s[n - 1];
+    }
+    tr.duration = tr.knot_t[n - 1] + (tr.distance > tr.knot_s[n - 1] ? (tr.distance - tr.knot_s[n - 1]) / v_end : 0.0);
+    return true;
+}
+
+/**************************************************************/
+// Function name : Track_load
+// Description   : コースファイルの読み込み
+/**************************************************************/
+inline bool Track_load(const char *filename, Track &tr)
+{
+    FILE *fp = fopen(filename, "r");
+    if (fp == NULL)
+    {
+        printf("Cannot open: %s\n", filename);
+        return false;
+    }
+    const std::filesystem::path dir = std::filesystem::path(filename).parent_path();
+
+    tr = Track();
+    std::vector<double> px, py; // スプラインの通過点
+    double kappa = 0;           // 直前の区間の終点の曲率 [1/m]
+    char line[1024];
+    int number = 0;
+    bool ok = true;
+    while (ok && fgets(line, sizeof(line), fp) != NULL)
+    {
+        number++;
+        char *comment = strchr(line, '#');
+        if (comment != NULL)
+        {
+            *comment = '\0';
+        }
+        char key[64], file[512];
+        double a = 0, b = 0, c = 0;
+        if (sscanf(line, "%63s", key) != 1)
+        {
+            continue;
+        }
+        const char *rest = line + (strstr(line, key) - line) + strlen(key);
+
+        if (strcmp(key, "line") == 0 && sscanf(rest, "%lf", &a) == 1)
+        {
+            Track_add_segment(tr, a, 0.0, 0.0);
+            kappa = 0;
+        }
+        else if (strcmp(key, "arc") == 0 && sscanf(rest, "%lf %lf", &a, &b) == 2 && a != 0)
+        {
+            Track_add_segment(tr, fabs(a) * fabs(b) * track_pi / 180.0, 1.0 / a, 1.0 / a);
+            kappa = 1.0 / a;
+        }
+        else if (strcmp(key, "clothoid") == 0 && sscanf(rest, "%lf %lf", &a, &b) == 2)
+        {
+            const double k1 = b != 0 ? 1.0 / b : 0.0;
+            Track_add_segment(tr, a, kappa, k1);
+            kappa = k1;
+        }
+        else if (strcmp(key, "point") == 0 && sscanf(rest, "%lf %lf", &a, &b) == 2)
+        {
+            px.push_back(a);
+            py.push_back(b);
+        }
+        else if (strcmp(key, "trace") == 0 && sscanf(rest, "%511s %lf %lf %lf", file, &a, &b, &c) >= 3)
+        {
+            const std::filesystem::path path = std::filesystem::path(file).is_absolute() ? std::filesystem::path(file) : dir / file;
+            ok = Track_trace(path.string().c_str(), (size_t)a, (size_t)b, c > 0 ? c : 2.0, px, py);
+        }
+        else if (strcmp(key, "closed") == 0)
+        {
+            tr.closed = true;
+        }
+        else if (strcmp(key, "laps") == 0 && sscanf(rest, "%lf", &a) == 1 && a >= 1)
+        {
+            tr.laps = (int)a;
+        }
+        else if (strcmp(key, "speed") == 0 && sscanf(rest, "%lf %lf", &a, &b) == 2 && a >= 0 && b >= 0)
+        {
+            tr.speed_s.push_back(a);
+            tr.speed_v.push_back(b / 3.6);
+        }
+        else
+        {
+            printf("%s:%d: cannot parse: %s", filename, number, line);
+            ok = false;
+        }
+    }
+    fclose(fp);
+    if (!ok)
+    {
+        return false;
+    }
+
+    /** 中心線 **/
+    if (!px.empty() && !tr.segments.empty())
+    {
+        printf("%s: line/arc/clothoid and points cannot be mixed\n", filename);
+        return false;
+    }
+    if (!px.empty() && !Track_spline_points(tr, px, py))
+    {
+        return false;
+    }
+    if (tr.segments.empty())
+    {
+        printf("%s: no segments\n", filename);
+        return false;
+    }
+    if (tr.laps > 1 && !tr.closed)
+    {
+        printf("%s: laps requires closed\n", filename);
+        return false;
+    }
+    const Track_segment &last = tr.segments.back();
+    double x_end, y_end, phi_end, k_end;
+    Track_segment_point(last, last.length, x_end, y_end, phi_end, k_end);
+    tr.length = last.s0 + last.length;
+    tr.turn = phi_end - tr.segments[0].phi0;
+    if (tr.closed && hypot(x_end - tr.segments[0].x0, y_end - tr.segments[0].y0) > 0.01)
+    {
+        printf("%s: warning: closed track ends %.3f [m] from the start\n", filename, hypot(x_end - tr.segments[0].x0, y_end - tr.segments[0].y0));
+    }
+
+    return Track_speed_build(tr);
+}
+
+/**************************************************************/
+// Function name : Track_evaluate
+// Description   : 時刻 t0 + i dt (i = 0 ... n-1) の真値を out の first 番目から書き込む
+//                 前半で走行距離・速度・加速度を、後半で区間ごとの位置・方位・曲率を求める
+/**************************************************************/
+inline void Track_evaluate(const Track &tr, double t0, double dt, size_t n, Track_samples &out, size_t first)
+{
+    double *s = &out.s[first];
+    double *speed = &out.speed[first];
+    double *acc = &out.acc_long[first];
+
+    /** 走行距離・速度 (等加速度の区間, 点は時刻順なので前の点から探索を続ける) **/
+    const size_t nk = tr.knot_t.size();
+    size_t k = std::upper_bound(tr.knot_t.begin(), tr.knot_t.end(), t0) - tr.knot_t.begin();
+    k = k > 0 ? k - 1 : 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        const double t = t0 + i * dt;
+        while (k + 1 < nk && tr.knot_t[k + 1] <= t)
+        {
+            k++;
+        }
+        const double tau = t - tr.knot_t[k];
+        const double a = k + 1 < nk ? tr.knot_a[k] : 0.0;
+        out.t[first + i] = t;
+        s[i] = std::min(tr.knot_s[k] + (tr.knot_v[k] + 0.5 * a * tau) * tau, tr.distance);
+        speed[i] = std::max(tr.knot_v[k] + a * tau, 0.0);
+        acc[i] = a;
+    }
+
+    /** 位置・方位・曲率 (1周内の走行距離で区間を探索)
+        区間の最初の点は区間の始点から求め、同じ区間の続きの点は前の点からの差分で求める **/
+    size_t seg = 0;
+    int lap_prev = -1;
+    bool chain = false;                                                      // 前の点から続けて計算できるか
+    double sigma_prev = 0, phi_prev = 0, c = 1, sn = 0, x = 0, y = 0, u = 0; // 前の点の状態
+    for (size_t i = 0; i < n; i++)
+    {
+        const int lap = tr.closed && tr.length > 0 ? std::min((int)(s[i] / tr.length), tr.laps - 1) : 0;
+        const double sigma = s[i] - lap * tr.length;
+        if (lap != lap_prev || sigma < tr.segments[seg].s0)
+        {
+            seg = 0;
+            lap_prev = lap;
+            chain = false;
+        }
+        while (seg + 1 < tr.segments.size() && tr.segments[seg + 1].s0 <= sigma)
+        {
+            seg++;
+            chain = false;
+        }
+        const Track_segment &sg = tr.segments[seg];
+        const double local = std::min(sigma - sg.s0, sg.length);
+        double phi, kappa;
+        if (!chain || !Track_step(sg, sigma_prev, local, phi_prev, c, sn, x, y, u, phi, kappa))
+        {
+            Track_segment_point(sg, local, x, y, phi, kappa, &u);
+            c = cos(phi);
+            sn = sin(phi);
+            chain = true;
+        }
+        sigma_prev = local;
+        phi_prev = phi;
+        out.x[first + i] = x;
+        out.y[first + i] = y;
+        out.heading[first + i] = phi + lap * tr.turn;
+        out.acc_lat[first + i] = speed[i] * speed[i] * kappa;
+        out.yaw_rate[first + i] = speed[i] * kappa;
+    }
+}
+
+/**************************************************************/
+// Function name : Track_generate
+// Description   : サンプリング周波数 hz [Hz] で走行終了までの真値を作る (ブロックごとに workers 並列)
+/**************************************************************/
+inline void Track_generate(const Track &tr, double hz, int workers, Track_samples &out)
+{
+    const double dt = 1.0 / hz;
+    const size_t n = (size_t)floor(tr.duration * hz + 1e-9) + 1;
+    for (std::vector<double> *v : {&out.t, &out.s, &out.x, &out.y, &out.heading, &out.speed, &out.acc_long, &out.acc_lat, &out.yaw_rate})
+    {
+        v->resize(n);
+    }
+
+    std::atomic<size_t> next(0);
+    auto worker = [&]()
+    {
+        size_t b;
+        while ((b = next++) * track_batch < n)
+        {
+            const size_t first = b * track_batch;
+            Track_evaluate(tr, first * dt, dt, std::min(track_batch, n - first), out, first);
+        }
+    };
+    std::vector<std::thread> threads;
+    const size_t batches = (n + track_batch - 1) / track_batch;
+    const int n_threads = workers < 1 ? 1 : std::min((size_t)workers, batches);
+    for (int t = 1; t < n_threads; t++)
+    {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (std::thread &th : threads)
+    {
+        th.join();
+    }
+}
+
+#endif
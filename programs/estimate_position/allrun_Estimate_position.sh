@@ -1,16 +1,10 @@
-# 画像ファイルの削除
-rm -r Estimate_position_IMU/
-# rm -r Estimate_position_GPS/
-rm -r Estimate_position_IMU+GPS/
+# パイプライン実行プログラムのコンパイル
+mkdir -p ../pipeline/out
+[ ../pipeline/out/Pipeline.out -nt ../pipeline/cpp/Pipeline.cpp ] && [ ../pipeline/out/Pipeline.out -nt ../common/pipeline.h ] ||
+    g++ -O2 -std=c++17 -pthread ../pipeline/cpp/Pipeline.cpp -o "../pipeline/out/Pipeline.out"
 
-# Estimate_positionの実行
-g++ cpp/Estimate_position_IMU.cpp -o "out/Estimate_position_IMU.out"
-./out/Estimate_position_IMU.out
+# Estimate_positionの実行・gifアニメーションの作成 (IMU と IMU+GPS は並列に実行)
+../pipeline/out/Pipeline.out pipeline.txt Estimate_position_IMU Estimate_position_IMU+GPS gif_Estimate_position_IMU gif_Estimate_position_IMU+GPS
 
-g++ cpp/Estimate_position_IMU+GPS.cpp -o "out/Estimate_position_IMU+GPS.out"
-./out/Estimate_position_IMU+GPS.out
-
-# gifアニメーションの作成
-python3 py/gif_Estimate_position_IMU.py
-# python3 py/gif_Estimate_position_GPS.py
-python3 py/gif_Estimate_position_IMU+GPS.py
+# GPS のみの推定
+# ../pipeline/out/Pipeline.out pipeline.txt Estimate_position_GPS
@@ -1,3 +1,7 @@
-# RMSEの実行
-g++ cpp/RMSE.cpp -o "out/RMSE.out"
-./out/RMSE.out
+# パイプライン実行プログラムのコンパイル
+mkdir -p ../pipeline/out
+[ ../pipeline/out/Pipeline.out -nt ../pipeline/cpp/Pipeline.cpp ] && [ ../pipeline/out/Pipeline.out -nt ../common/pipeline.h ] ||
+    g++ -O2 -std=c++17 -pthread ../pipeline/cpp/Pipeline.cpp -o "../pipeline/out/Pipeline.out"
+
+# RMSEの実行 (シミュレーション・推定結果が変わっていなければ計算済みの結果を表示)
+../pipeline/out/Pipeline.out pipeline.txt RMSE && cat RMSE/rmse.txt
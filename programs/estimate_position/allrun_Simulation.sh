@@ -1,9 +1,7 @@
-# 画像ファイルの削除
-rm -r Simulation/
+# パイプライン実行プログラムのコンパイル
+mkdir -p ../pipeline/out
+[ ../pipeline/out/Pipeline.out -nt ../pipeline/cpp/Pipeline.cpp ] && [ ../pipeline/out/Pipeline.out -nt ../common/pipeline.h ] ||
+    g++ -O2 -std=c++17 -pthread ../pipeline/cpp/Pipeline.cpp -o "../pipeline/out/Pipeline.out"
 
-# シミュレーションの実行
-g++ cpp/Simulation.cpp -o "out/Simulation.out"
-./out/Simulation.out
-
-# gifアニメーションの作成
-python3 py/gif_Simulation.py
\ No newline at end of file
+# シミュレーションの実行・gifアニメーションの作成 (入力が変わった段階のみ実行, 全段階の再実行は -f)
+../pipeline/out/Pipeline.out pipeline.txt Simulation gif_Simulation
@@ -0,0 +1,9 @@
+# 任意コースの走行シミュレーションのコンパイル
+mkdir -p out
+g++ -O2 -std=c++17 -pthread cpp/Simulation_track.cpp -o "out/Simulation_track.out"
+
+# クロソイドでつないだ周回コースを 10 周 (出力は Simulation.cpp と同じ Simulation/ 以下, 自己位置推定・RMSE はそのまま実行できる)
+./out/Simulation_track.out track/oval.txt
+
+# Simulation.cpp と同じスキッドパッドの場合
+# ./out/Simulation_track.out track/skidpad.txt
@@ -0,0 +1,11 @@
+# ラップタイム計算プログラムのコンパイル
+g++ -O2 -std=c++17 -pthread cpp/Lap_timing.cpp -o "out/Lap_timing.out"
+
+# シミュレーションの走行軌跡 (最後の route ファイルが全区間) の周回分割
+# コントロールラインはスキッドパッドの入口 (y = 助走距離 11.111 [m]) に置き、+y 方向の通過を1周とする
+mkdir -p Lap_timing
+route=$(ls Simulation/route | sort -n | tail -1)
+./out/Lap_timing.out Simulation/route/$route -1.0 11.111 1.0 11.111 1.0 Lap_timing/laps.dat
+
+# GNSS の走行軌跡の場合 (コントロールラインの座標はコースに合わせて設定)
+# ./out/Lap_timing.out ../gnss_data/GNSS_position/route/1036.dat x0 y0 x1 y1 30.0 Lap_timing/laps_gnss.dat
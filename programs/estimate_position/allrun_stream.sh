@@ -0,0 +1,33 @@
+# 逐次推定プログラムのコンパイル
+g++ -O2 -std=c++17 -pthread cpp/Estimate_position_stream.cpp -o "out/Estimate_position_stream.out"
+
+# 記録済みデータを再生して逐次推定 (ハードウェア不要)
+mkdir -p Estimate_position_stream
+cat Simulation/data/data.dat | ./out/Estimate_position_stream.out > Estimate_position_stream/pose.dat
+
+# FIFO 経由の再生
+# mkfifo /tmp/imu_fifo
+# ./out/Estimate_position_stream.out /tmp/imu_fifo > Estimate_position_stream/pose.dat &
+# cat ../acceleration/data/data.csv > /tmp/imu_fifo
+
+# シリアルデバイスから直接受信 (Arduino)
+# ./out/Estimate_position_stream.out /dev/ttyACM0 -b 115200
+
+# 静止区間でバイアスを推定・補正して逐次推定 (ロガーの記録データ)
+# ./out/Estimate_position_stream.out ../acceleration/data/data.csv -c > Estimate_position_stream/pose_calibrated.dat
+
+# 回帰確認 : 誤差なしの一定半径の旋回 (スキッドパッド) を静止と誤判定せず、走行距離が真値と 1 [%] 以内で一致すること
+g++ -O2 -std=c++17 -pthread cpp/Simulation_track.cpp -o "out/Simulation_track.out"
+mkdir -p Estimate_position_stream/regression
+(
+    cd Estimate_position_stream/regression
+    ../../out/Simulation_track.out ../../track/skidpad.txt -clean -no-graph > /dev/null
+    distance=$(tail -n 1 Simulation/data/truth.dat | awk '{print $2}')
+    ../../out/Estimate_position_stream.out Simulation/data/data.dat -c -s 0 2>&1 > /dev/null |
+        awk -v truth="$distance" '/^\[final\]/ {
+            for (i = 1; i <= NF; i++) if ($i == "distance") d = $(i + 2)
+            ok = d > 0.99 * truth && d < 1.01 * truth
+            printf "[regression] skidpad -clean -c : distance = %.3f [m] (truth %.3f [m]) %s\n", d, truth, ok ? "OK" : "NG"
+            exit !ok
+        }'
+)
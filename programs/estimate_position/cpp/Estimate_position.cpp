@@ -10,6 +10,9 @@
 #include <math.h>
 #include <sys/stat.h>
 #include <vector>
+#include "../../common/gnuplot_pool.h"
+#include "../../common/sensor_frame.h"
+#include "../../common/metrics.h"
 using namespace std;
 FILE *fp;
 mode_t dir_mode = S_IRUSR | S_IWUSR | S_IXUSR | S_IRGRP | S_IWGRP | S_IXGRP | S_IROTH | S_IXOTH | S_IXOTH;
@@ -23,7 +26,7 @@ vector<float> y; // y方向位置 [m]
 
 /** プロトタイプ宣言 **/
 int Estimate_position();
-void Moving_Average(vector<float> &data);
+void Moving_Average(float *data, int length);
 void Write_data(int num);
 void Gnuplot(int n);
 
@@ -33,6 +36,8 @@ void Gnuplot(int n);
 /**************************************************************/
 int main()
 {
+    Metrics_start("Estimate_position");
+
     /** ディレクトリの作成 **/
     const char dir_0[] = "Estimate_position+MA";
     const char dir_1[] = "Estimate_position+MA/position";
@@ -45,7 +50,10 @@ int main()
     mkdir(dir_3, dir_mode);
 
     int data_length = Estimate_position();
+    Metrics_add("samples", data_length);
 
+    Metrics_timer timer_write("write");
+    Gnuplot_pool_start(); // 描画ワーカーの起動
     for (int i = 0; i < data_length; i++)
     {
         Write_data(i);
@@ -54,6 +62,8 @@ int main()
             Gnuplot(i);
         }
     }
+    timer_write.Stop();
+    Gnuplot_pool_finish(); // 全フレームの描画完了を待機
 
     return 0;
 }
@@ -64,46 +74,31 @@ int main()
 /**************************************************************/
 int Estimate_position()
 {
-    /** 変数設定 **/
-    vector<float> t;         // 時刻 [s]
-    vector<float> acc_x;     // x方向加速度 [m/s2]
-    vector<float> acc_y;     // y方向加速度 [m/s2]
-    vector<float> acc_z;     // z方向加速度 [m/s2]
-    vector<float> omega_x;   // roll方向角加速度 [rad/s2]
-    vector<float> omega_y;   // pitch方向角加速度 [rad/s2]
-    vector<float> omega_z;   // yaw方向角加速度 [rad/s2]
-    vector<float> longitude; // 経度情報 [m]
-    vector<float> latitude;  // 緯度情報 [m]
-
-    float tmp[8];    // 一時保存用バッファ [-]
-    int data_length; // データの長さ [-]
-
     /** ファイルの読み込み **/
+    Metrics_timer timer_read("read");
+    Sensor_frame<float> frame; // 読み込みデータ (9列)
     char filename[] = "Simulation/data/data.dat";
-    fp = fopen(filename, "r");
-    while ((fscanf(fp, "%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f", &tmp[0], &tmp[1], &tmp[2], &tmp[3], &tmp[4], &tmp[5], &tmp[6], &tmp[7], &tmp[8])) != EOF)
+    if (!Read_sensor_frame(filename, frame))
     {
-        t.push_back(tmp[0]);
-        acc_x.push_back(tmp[1]);
-        acc_y.push_back(tmp[2]);
-        acc_z.push_back(tmp[3]);
-        omega_x.push_back(tmp[4]);
-        omega_y.push_back(tmp[5]);
-        omega_z.push_back(tmp[6]);
-        longitude.push_back(tmp[7]);
-        latitude.push_back(tmp[8]);
-        data_length += 1;
+        exit(1);
     }
-    fclose(fp);
+    timer_read.Stop();
+    const int data_length = frame.rows; // データの長さ [-]
+
+    /** 変数設定 (移動平均は読み込んだ列をそのまま上書き) **/
+    float *acc_x = frame.Column(sensor_acc_x);           // x方向加速度 [m/s2] (移動平均で上書き)
+    float *acc_y = frame.Column(sensor_acc_y);           // y方向加速度 [m/s2] (移動平均で上書き)
+    const float *omega_z = frame.Column(sensor_omega_z); // yaw方向角加速度 [rad/s2]
 
     /** 配列のサイズ変更 **/
     x.resize(data_length);
     y.resize(data_length);
 
     /** 移動平均の適用 **/
-    Moving_Average(acc_x);
-    Moving_Average(acc_y);
-    // Moving_Average(omega_z);
+    Metrics_timer timer_compute("compute");
+    Moving_Average(acc_x, data_length);
+    Moving_Average(acc_y, data_length);
+    // Moving_Average(omega_z, data_length);
 
     /** 位置の積算 **/
     const float dt = 1.0 / hz_6axis; // サンプリング間隔 [s]
@@ -136,20 +131,20 @@ int Estimate_position()
 // Function name : Moving_Average
 // Description   : 移動平均値を計算
 /**************************************************************/
-void Moving_Average(vector<float> &data)
+void Moving_Average(float *data, int length)
 {
-    const int n = 5.0;              // 移動平均で使用するデータ数
-    vector<float> ave(data.size()); // 移動平均値用の配列
+    const int n = 5.0;         // 移動平均で使用するデータ数
+    vector<float> ave(length); // 移動平均値用の配列
 
     /** 移動平均の計算 **/
-    for (int i = n / 2.0; i < data.size() - n / 2.0; i++)
+    for (int i = n / 2.0; i < length - n / 2.0; i++)
         for (int j = i - n / 2.0; j <= i + n / 2.0; j++)
         {
             ave[i] += data[j]; // 合計値の計算
         }
 
     /** 算出値の代入 **/
-    for (int i = n / 2.0; i < data.size() - n / 2.0; i++)
+    for (int i = n / 2.0; i < length - n / 2.0; i++)
     {
         data[i] = float(ave[i] / n + 1);
     }
@@ -168,7 +163,7 @@ void Write_data(int n)
     sprintf(filename, "Estimate_position+MA/position/%d.dat", n);
     fp = fopen(filename, "w");
     fprintf(fp, "%f\t%f\t%f\n", t, x[n], y[n]);
-    fclose(fp);
+    Metrics_fclose(fp);
 
     /** 走行経路の書き出し **/
     sprintf(filename, "Estimate_position+MA/route/%d.dat", n);
@@ -178,7 +173,7 @@ void Write_data(int n)
         float t_tmp = i / hz_6axis;
         fprintf(fp, "%f\t%f\t%f\n", t_tmp, x[i], y[i]);
     }
-    fclose(fp);
+    Metrics_fclose(fp);
 }
 
 /**************************************************************/
@@ -187,7 +182,7 @@ void Write_data(int n)
 /**************************************************************/
 void Gnuplot(int n)
 {
-    FILE *gp;
+    string script; // 描画スクリプト
 
     /** Gnuplot 初期設定 **/
     const float t = n / hz_6axis;
@@ -202,31 +197,22 @@ void Gnuplot(int n)
     sprintf(filename_2, "Estimate_position+MA/route/%d.dat", n);
     sprintf(graphname, "Estimate_position+MA/graph/%04d.png", n);
 
-    /** Gnuplot 呼び出し **/
-    if ((gp = popen("gnuplot", "w")) == NULL)
-    {
-        printf("gnuplot is not here!\n");
-        exit(0); // gnuplotが無い場合、異常ある場合は終了
-    }
-
     /** Gnuplot 描画設定 **/
-    fprintf(gp, "set terminal png size 800, 600 font 'Times New Roman, 16'\n");
-    fprintf(gp, "set size ratio -1\n");
-    fprintf(gp, "set output '%s'\n", graphname);                                             // 出力ファイル
-    fprintf(gp, "unset key\n");                                                              // 凡例非表示
-    fprintf(gp, "set xrange [%.3f:%.3f]\n", x_min, x_max);                                   // x軸の描画範囲
-    fprintf(gp, "set yrange [%.3f:%.3f]\n", y_min, y_max);                                   // y軸の描画範囲
-    fprintf(gp, "set title 'Estimated Position + MA : {/Times-Italic t} = %1.3f [s]'\n", t); // グラフタイトル
-    fprintf(gp, "set xlabel '{/Times-Italic x} [m]' offset 0.0, 0.0\n");                     // x軸のラベル
-    fprintf(gp, "set ylabel '{/Times-Italic y} [m]' offset 1.0, 0.0\n");                     // y軸のラベル
-    fprintf(gp, "set xtics 5.0 offset 0.0, 0.0\n");                                          // x軸の間隔
-    fprintf(gp, "set ytics 5.0 offset 0.0, 0.0\n");                                          // y軸の間隔
+    Gnuplot_printf(script, "set terminal png size 800, 600 font 'Times New Roman, 16'\n");
+    Gnuplot_printf(script, "set size ratio -1\n");
+    Gnuplot_printf(script, "set output '%s'\n", graphname);                                             // 出力ファイル
+    Gnuplot_printf(script, "unset key\n");                                                              // 凡例非表示
+    Gnuplot_printf(script, "set xrange [%.3f:%.3f]\n", x_min, x_max);                                   // x軸の描画範囲
+    Gnuplot_printf(script, "set yrange [%.3f:%.3f]\n", y_min, y_max);                                   // y軸の描画範囲
+    Gnuplot_printf(script, "set title 'Estimated Position + MA : {/Times-Italic t} = %1.3f [s]'\n", t); // グラフタイトル
+    Gnuplot_printf(script, "set xlabel '{/Times-Italic x} [m]' offset 0.0, 0.0\n");                     // x軸のラベル
+    Gnuplot_printf(script, "set ylabel '{/Times-Italic y} [m]' offset 1.0, 0.0\n");                     // y軸のラベル
+    Gnuplot_printf(script, "set xtics 5.0 offset 0.0, 0.0\n");                                          // x軸の間隔
+    Gnuplot_printf(script, "set ytics 5.0 offset 0.0, 0.0\n");                                          // y軸の間隔
 
     /** Gnuplot 書き出し **/
-    fprintf(gp, "plot '%s' using 2:3 with lines lc 'grey50' notitle, '%s' using 2:3 with points lc 'red' ps 3 pt 7 notitle\n", filename_2, filename_1);
+    Gnuplot_printf(script, "plot '%s' using 2:3 with lines lc 'grey50' notitle, '%s' using 2:3 with points lc 'red' ps 3 pt 7 notitle\n", filename_2, filename_1);
 
-    /** Gnuplot 終了 **/
-    fflush(gp);            // Clean up Data
-    fprintf(gp, "exit\n"); // Quit gnuplot
-    pclose(gp);
+    /** 描画ワーカーへ投入 **/
+    Gnuplot_submit(script);
 }
\ No newline at end of file
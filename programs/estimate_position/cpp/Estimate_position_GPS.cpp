@@ -10,20 +10,23 @@
 #include <math.h>
 #include <sys/stat.h>
 #include <vector>
+#include "../../common/gnuplot_pool.h"
+#include "../../common/sensor_frame.h"
+#include "../../common/metrics.h"
 using namespace std;
 FILE *fp;
 mode_t dir_mode = S_IRUSR | S_IWUSR | S_IXUSR | S_IRGRP | S_IWGRP | S_IXGRP | S_IROTH | S_IXOTH | S_IXOTH;
 
 /** パラメータ **/
-const float hz_gps = 2.0; // サンプリング周期 [Hz]
+const float error = -90.0; // GPSの情報がないときの値の閾値 [-]
 
 /** 変数宣言 **/
-vector<float> x; // x方向位置 [m]
-vector<float> y; // y方向位置 [m]
+vector<float> t_gps; // GPS受信時刻 [s]
+vector<float> x;     // x方向位置 [m]
+vector<float> y;     // y方向位置 [m]
 
 /** プロトタイプ宣言 **/
 int Estimate_position();
-void Moving_Average(vector<float> &data);
 void Write_data(int num);
 void Gnuplot(int n);
 
@@ -33,6 +36,8 @@ void Gnuplot(int n);
 /**************************************************************/
 int main()
 {
+    Metrics_start("Estimate_position_GPS");
+
     /** ディレクトリの作成 **/
     const char dir_0[] = "Estimate_position_GPS";
     const char dir_1[] = "Estimate_position_GPS/position";
@@ -45,15 +50,17 @@ int main()
     mkdir(dir_3, dir_mode);
 
     int data_length = Estimate_position();
+    Metrics_add("samples", data_length);
 
+    Metrics_timer timer_write("write");
+    Gnuplot_pool_start(); // 描画ワーカーの起動
     for (int i = 0; i < data_length; i++)
     {
         Write_data(i);
-        if (i % 10 == 0)
-        {
-            Gnuplot(i);
-        }
+        Gnuplot(i);
     }
+    timer_write.Stop();
+    Gnuplot_pool_finish(); // 全フレームの描画完了を待機
 
     return 0;
 }
@@ -64,82 +71,38 @@ int main()
 /**************************************************************/
 int Estimate_position()
 {
-    /** 変数設定 **/
-    vector<float> t;         // 時刻 [s]
-    vector<float> longitude; // 経度情報 [m]
-    vector<float> latitude;  // 緯度情報 [m]
-
-    float tmp[8];    // 一時保存用バッファ [-]
-    int data_length; // データの長さ [-]
-
     /** ファイルの読み込み **/
+    Metrics_timer timer_read("read");
+    Sensor_frame<float> frame; // 読み込みデータ (9列)
     char filename[] = "Simulation/data/data.dat";
-    fp = fopen(filename, "r");
-    while ((fscanf(fp, "%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f", &tmp[0], &tmp[1], &tmp[2], &tmp[3], &tmp[4], &tmp[5], &tmp[6], &tmp[7], &tmp[8])) != EOF)
+    if (!Read_sensor_frame(filename, frame))
     {
-        if (tmp[0] % == 0)
-        {
-            t.push_back(tmp[0]);
-            longitude.push_back(tmp[7]);
-            latitude.push_back(tmp[8]);
-        }
-
-        data_length += 1;
+        exit(1);
     }
-    fclose(fp);
+    timer_read.Stop();
 
-    /** 配列のサイズ変更 **/
-    x.resize(data_length);
-    y.resize(data_length);
-
-    /** 位置の積算 **/
-    const float dt = 1.0 / hz_gps; // サンプリング間隔 [s]
-    float u = 0;                   // x方向車両速度 [m/s]
-    float v = 0;                   // y方向車両速度 [m/s]
-    float theta = 0;               // 車両の角度 [rad]
-    float x_tmp = 0;
-    float y_tmp = 0;
-
-    for (int i = 0; i < data_length; i++)
+    /** 変数設定 **/
+    const float *t = frame.Column(sensor_t);             // 時刻 [s]
+    const float *longitude = frame.Column(sensor_gps_x); // 経度情報 [m]
+    const float *latitude = frame.Column(sensor_gps_y);  // 緯度情報 [m]
+
+    /** GPS情報の抽出 (受信したサンプルだけを受信時刻とともに保持) **/
+    Metrics_timer timer_compute("compute");
+    t_gps.clear();
+    x.clear();
+    y.clear();
+    for (size_t i = 0; i < frame.rows; i++)
     {
-        /** 速度・角度の積算 **/
-        theta += omega_z[i] * dt;
-
-        u += -1.0 * (acc_x[i] * sin(theta) + acc_y[i] * cos(theta)) * dt; // 絶対座標系のx方向速度 [m/s]
-        v += -1.0 * (acc_x[i] * cos(theta) + acc_y[i] * sin(theta)) * dt; // 絶対座標系のy方向速度 [m/s]
-
-        /** 速度・角度の積算 **/
-        x[i] = x_tmp + u * dt;
-        y[i] = y_tmp + v * dt;
-
-        x_tmp = x[i]; // 積算したx方向位置 [m]
-        y_tmp = y[i]; // 積算したy方向位置 [m]
-    }
-
-    return data_length;
-}
-
-/**************************************************************/
-// Function name : Moving_Average
-// Description   : 移動平均値を計算
-/**************************************************************/
-void Moving_Average(vector<float> &data)
-{
-    const int n = 5.0;              // 移動平均で使用するデータ数
-    vector<float> ave(data.size()); // 移動平均値用の配列
-
-    /** 移動平均の計算 **/
-    for (int i = n / 2.0; i < data.size() - n / 2.0; i++)
-        for (int j = i - n / 2.0; j <= i + n / 2.0; j++)
+        if (longitude[i] >= error && latitude[i] >= error)
         {
-            ave[i] += data[j]; // 合計値の計算
+            t_gps.push_back(t[i]);
+            x.push_back(longitude[i]);
+            y.push_back(latitude[i]);
         }
-
-    /** 算出値の代入 **/
-    for (int i = n / 2.0; i < data.size() - n / 2.0; i++)
-    {
-        data[i] = float(ave[i] / n + 1);
     }
+    const int data_length = x.size(); // データの長さ [-]
+
+    return data_length;
 }
 
 /**************************************************************/
@@ -148,24 +111,23 @@ void Moving_Average(vector<float> &data)
 /**************************************************************/
 void Write_data(int n)
 {
-    const float t = n / hz_gps;
+    const float t = t_gps[n];
 
     /** 走行位置の書き出し **/
     char filename[100];
     sprintf(filename, "Estimate_position_GPS/position/%d.dat", n);
     fp = fopen(filename, "w");
     fprintf(fp, "%f\t%f\t%f\n", t, x[n], y[n]);
-    fclose(fp);
+    Metrics_fclose(fp);
 
     /** 走行経路の書き出し **/
     sprintf(filename, "Estimate_position_GPS/route/%d.dat", n);
     fp = fopen(filename, "w");
     for (int i = 0; i <= n; i++)
     {
-        float t_tmp = i / hz_gps;
-        fprintf(fp, "%f\t%f\t%f\n", t_tmp, x[i], y[i]);
+        fprintf(fp, "%f\t%f\t%f\n", t_gps[i], x[i], y[i]);
     }
-    fclose(fp);
+    Metrics_fclose(fp);
 }
 
 /**************************************************************/
@@ -174,10 +136,10 @@ void Write_data(int n)
 /**************************************************************/
 void Gnuplot(int n)
 {
-    FILE *gp;
+    string script; // 描画スクリプト
 
     /** Gnuplot 初期設定 **/
-    const float t = n / hz_gps;
+    const float t = t_gps[n];
     const float x_max = 20.0;
     const float x_min = -20.0;
     const float y_max = 25.0;
@@ -189,31 +151,22 @@ void Gnuplot(int n)
     sprintf(filename_2, "Estimate_position_GPS/route/%d.dat", n);
     sprintf(graphname, "Estimate_position_GPS/graph/%04d.png", n);
 
-    /** Gnuplot 呼び出し **/
-    if ((gp = popen("gnuplot", "w")) == NULL)
-    {
-        printf("gnuplot is not here!\n");
-        exit(0); // gnuplotが無い場合、異常ある場合は終了
-    }
-
     /** Gnuplot 描画設定 **/
-    fprintf(gp, "set terminal png size 800, 600 font 'Times New Roman, 16'\n");
-    fprintf(gp, "set size ratio -1\n");
-    fprintf(gp, "set output '%s'\n", graphname);                                             // 出力ファイル
-    fprintf(gp, "unset key\n");                                                              // 凡例非表示
-    fprintf(gp, "set xrange [%.3f:%.3f]\n", x_min, x_max);                                   // x軸の描画範囲
-    fprintf(gp, "set yrange [%.3f:%.3f]\n", y_min, y_max);                                   // y軸の描画範囲
-    fprintf(gp, "set title 'Estimated Position + MA : {/Times-Italic t} = %1.3f [s]'\n", t); // グラフタイトル
-    fprintf(gp, "set xlabel '{/Times-Italic x} [m]' offset 0.0, 0.0\n");                     // x軸のラベル
-    fprintf(gp, "set ylabel '{/Times-Italic y} [m]' offset 1.0, 0.0\n");                     // y軸のラベル
-    fprintf(gp, "set xtics 5.0 offset 0.0, 0.0\n");                                          // x軸の間隔
-    fprintf(gp, "set ytics 5.0 offset 0.0, 0.0\n");                                          // y軸の間隔
+    Gnuplot_printf(script, "set terminal png size 800, 600 font 'Times New Roman, 16'\n");
+    Gnuplot_printf(script, "set size ratio -1\n");
+    Gnuplot_printf(script, "set output '%s'\n", graphname);                                              // 出力ファイル
+    Gnuplot_printf(script, "unset key\n");                                                               // 凡例非表示
+    Gnuplot_printf(script, "set xrange [%.3f:%.3f]\n", x_min, x_max);                                    // x軸の描画範囲
+    Gnuplot_printf(script, "set yrange [%.3f:%.3f]\n", y_min, y_max);                                    // y軸の描画範囲
+    Gnuplot_printf(script, "set title 'Estimated Position | GPS : {/Times-Italic t} = %1.3f [s]'\n", t); // グラフタイトル
+    Gnuplot_printf(script, "set xlabel '{/Times-Italic x} [m]' offset 0.0, 0.0\n");                      // x軸のラベル
+    Gnuplot_printf(script, "set ylabel '{/Times-Italic y} [m]' offset 1.0, 0.0\n");                      // y軸のラベル
+    Gnuplot_printf(script, "set xtics 5.0 offset 0.0, 0.0\n");                                           // x軸の間隔
+    Gnuplot_printf(script, "set ytics 5.0 offset 0.0, 0.0\n");                                           // y軸の間隔
 
     /** Gnuplot 書き出し **/
-    fprintf(gp, "plot '%s' using 2:3 with lines lc 'grey50' notitle, '%s' using 2:3 with points lc 'red' ps 3 pt 7 notitle\n", filename_2, filename_1);
+    Gnuplot_printf(script, "plot '%s' using 2:3 with lines lc 'grey50' notitle, '%s' using 2:3 with points lc 'red' ps 3 pt 7 notitle\n", filename_2, filename_1);
 
-    /** Gnuplot 終了 **/
-    fflush(gp);            // Clean up Data
-    fprintf(gp, "exit\n"); // Quit gnuplot
-    pclose(gp);
-}
\ No newline at end of file
+    /** 描画ワーカーへ投入 **/
+    Gnuplot_submit(script);
+}
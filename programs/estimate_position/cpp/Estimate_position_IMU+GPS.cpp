@@ -10,19 +10,30 @@
 #include <math.h>
 #include <sys/stat.h>
 #include <vector>
+#include "../../common/gnuplot_pool.h"
+#include "../../common/sensor_frame.h"
+#include "../../common/dead_reckoning.h"
+#include "../../common/sensor_scheduler.h"
+#include "../../common/simplify.h"
+#include "../../common/metrics.h"
 using namespace std;
 FILE *fp;
 mode_t dir_mode = S_IRUSR | S_IWUSR | S_IXUSR | S_IRGRP | S_IWGRP | S_IXGRP | S_IROTH | S_IXOTH | S_IXOTH;
 
 /** パラメータ **/
-const float hz_imu = 100;   // サンプリング周期 [Hz]
-const float error = -100.0; // GPSの情報がないときの値 [-]
+const float hz_imu = 100;           // サンプリング周期 [Hz]
+const float error = -100.0;         // GPSの情報がないときの値 [-]
+const float route_tolerance = 0.02; // 描画用の走行経路の許容誤差 [m]
 
 /** 変数宣言 **/
-vector<float> x;         // x方向位置 [m]
-vector<float> y;         // y方向位置 [m]
-vector<float> longitude; // 経度情報 [m]
-vector<float> latitude;  // 緯度情報 [m]
+vector<float> x;               // x方向位置 [m]
+vector<float> y;               // y方向位置 [m]
+Sensor_frame<float> frame;     // 読み込みデータ (9列)
+const float *longitude = NULL; // 経度情報 [m]
+const float *latitude = NULL;  // 緯度情報 [m]
+
+Simplify_stream route_stream; // 走行経路の間引き
+vector<int> route_rows;       // 描画用の走行経路に残す点 (GPS情報のある点は全て残す)
 
 /** プロトタイプ宣言 **/
 int Estimate_position();
@@ -35,6 +46,8 @@ void Gnuplot(int n);
 /**************************************************************/
 int main()
 {
+    Metrics_start("Estimate_position_IMU+GPS");
+
     /** ディレクトリの作成 **/
     const char dir_0[] = "Estimate_position_IMU+GPS";
     const char dir_1[] = "Estimate_position_IMU+GPS/position";
@@ -47,7 +60,11 @@ int main()
     mkdir(dir_3, dir_mode);
 
     int data_length = Estimate_position();
+    Metrics_add("samples", data_length);
 
+    Metrics_timer timer_write("write");
+    Simplify_stream_init(route_stream, route_tolerance);
+    Gnuplot_pool_start(); // 描画ワーカーの起動
     for (int i = 0; i < data_length; i++)
     {
         Write_data(i);
@@ -56,6 +73,8 @@ int main()
             Gnuplot(i);
         }
     }
+    timer_write.Stop();
+    Gnuplot_pool_finish(); // 全フレームの描画完了を待機
 
     return 0;
 }
@@ -66,73 +85,62 @@ int main()
 /**************************************************************/
 int Estimate_position()
 {
-    /** 変数設定 **/
-    vector<float> t;       // 時刻 [s]
-    vector<float> acc_x;   // x方向加速度 [m/s2]
-    vector<float> acc_y;   // y方向加速度 [m/s2]
-    vector<float> acc_z;   // z方向加速度 [m/s2]
-    vector<float> omega_x; // roll方向角加速度 [rad/s2]
-    vector<float> omega_y; // pitch方向角加速度 [rad/s2]
-    vector<float> omega_z; // yaw方向角加速度 [rad/s2]
-
-    float tmp[8];    // 一時保存用バッファ [-]
-    int data_length; // データの長さ [-]
-
     /** ファイルの読み込み **/
+    Metrics_timer timer_read("read");
     char filename[] = "Simulation/data/data.dat";
-    fp = fopen(filename, "r");
-    while ((fscanf(fp, "%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f", &tmp[0], &tmp[1], &tmp[2], &tmp[3], &tmp[4], &tmp[5], &tmp[6], &tmp[7], &tmp[8])) != EOF)
+    if (!Read_sensor_frame(filename, frame))
     {
-        t.push_back(tmp[0]);
-        acc_x.push_back(tmp[1]);
-        acc_y.push_back(tmp[2]);
-        acc_z.push_back(tmp[3]);
-        omega_x.push_back(tmp[4]);
-        omega_y.push_back(tmp[5]);
-        omega_z.push_back(tmp[6]);
-        longitude.push_back(tmp[7]);
-        latitude.push_back(tmp[8]);
-        data_length += 1;
+        exit(1);
     }
-    fclose(fp);
+    timer_read.Stop();
+    const int data_length = frame.rows; // データの長さ [-]
+
+    /** 変数設定 **/
+    const float *t = frame.Column(sensor_t);             // 時刻 [s]
+    const float *acc_x = frame.Column(sensor_acc_x);     // x方向加速度 [m/s2]
+    const float *acc_y = frame.Column(sensor_acc_y);     // y方向加速度 [m/s2]
+    const float *omega_z = frame.Column(sensor_omega_z); // yaw方向角加速度 [rad/s2]
+    longitude = frame.Column(sensor_gps_x);
+    latitude = frame.Column(sensor_gps_y);
 
     /** 配列のサイズ変更 **/
     x.resize(data_length);
     y.resize(data_length);
 
-    /** 位置の積算 **/
-    const float dt = 1.0 / hz_imu; // サンプリング間隔 [s]
-    float u = 0;                   // x方向車両速度 [m/s]
-    float v = 0;                   // y方向車両速度 [m/s]
-    float theta = 0;               // 車両の角度 [rad]
-    float x_tmp = 0;
-    float y_tmp = 0;
-
+    /** GPS情報の抽出 (受信したサンプルだけを GPS の周期で保持) **/
+    vector<float> t_gps; // 受信時刻 [s]
+    vector<float> x_gps; // x方向位置 [m]
+    vector<float> y_gps; // y方向位置 [m]
     for (int i = 0; i < data_length; i++)
     {
-        /** GPS情報による校正 **/
-        if (longitude[i] >= -90)
+        if (longitude[i] >= -90 && latitude[i] >= -90)
         {
-            x_tmp = longitude[i];
+            t_gps.push_back(t[i]);
+            x_gps.push_back(longitude[i]);
+            y_gps.push_back(latitude[i]);
         }
+    }
 
-        if (latitude[i] >= -90)
-        {
-            y_tmp = latitude[i];
-        }
+    /** 位置の積算 **/
+    Metrics_timer timer_compute("compute");
+    const float dt = 1.0 / hz_imu; // サンプリング間隔 [s]
+    Dead_reckoning state;          // 推定状態
+    Sensor_scheduler scheduler;    // 時刻順の処理
 
-        /** 速度・角度の積算 **/
-        theta += omega_z[i] * dt;
-        u += -1.0 * (acc_x[i] * sin(theta) + acc_y[i] * cos(theta)) * dt; // 絶対座標系のx方向速度 [m/s]
-        v += -1.0 * (acc_x[i] * cos(theta) + acc_y[i] * sin(theta)) * dt; // 絶対座標系のy方向速度 [m/s]
+    // GPS情報による校正 (同時刻の IMU より先に処理するため先に登録)
+    Scheduler_add(scheduler, t_gps.data(), t_gps.size(), [&](size_t k)
+                  {
+        state.x = x_gps[k];
+        state.y = y_gps[k]; });
 
-        /** 速度・角度の積算 **/
-        x[i] = x_tmp + u * dt;
-        y[i] = y_tmp + v * dt;
+    // 速度・角度・位置の積算
+    Scheduler_add(scheduler, t, data_length, [&](size_t i)
+                  {
+        Dead_reckoning_step(state, acc_x[i], acc_y[i], omega_z[i], dt);
+        x[i] = state.x;
+        y[i] = state.y; });
 
-        x_tmp = x[i]; // 積算したx方向位置 [m]
-        y_tmp = y[i]; // 積算したy方向位置 [m]
-    }
+    Scheduler_run(scheduler);
 
     return data_length;
 }
@@ -150,17 +158,42 @@ void Write_data(int n)
     sprintf(filename, "Estimate_position_IMU+GPS/position/%d.dat", n);
     fp = fopen(filename, "w");
     fprintf(fp, "%f\t%f\t%f\n", t, x[n], y[n]);
-    fclose(fp);
+    Metrics_fclose(fp);
 
-    /** 走行経路の書き出し **/
-    sprintf(filename, "Estimate_position_IMU+GPS/route/%d.dat", n);
-    fp = fopen(filename, "w");
-    for (int i = 0; i <= n; i++)
+    /** 走行経路の書き出し (描画用は許容誤差以内で間引き、最後のファイルは全点) **/
+    auto add = [&](long i)
+    {
+        route_rows.push_back(i);
+    };
+    Simplify_push(route_stream, n, x[n], y[n], add, longitude[n] >= -90 && latitude[n] >= -90);
+
+    auto write_row = [&](int i)
     {
         float t_tmp = i / hz_imu;
         fprintf(fp, "%f\t%f\t%f\t%lf\t%lf\n", t_tmp, x[i], y[i], longitude[i], latitude[i]);
+    };
+
+    sprintf(filename, "Estimate_position_IMU+GPS/route/%d.dat", n);
+    fp = fopen(filename, "w");
+    if (n == (int)x.size() - 1)
+    {
+        for (int i = 0; i <= n; i++)
+        {
+            write_row(i);
+        }
     }
-    fclose(fp);
+    else
+    {
+        for (size_t k = 0; k < route_rows.size(); k++)
+        {
+            write_row(route_rows[k]);
+        }
+        if (route_rows.back() != n)
+        {
+            write_row(n); // 未確定の現在位置
+        }
+    }
+    Metrics_fclose(fp);
 }
 
 /**************************************************************/
@@ -169,7 +202,7 @@ void Write_data(int n)
 /**************************************************************/
 void Gnuplot(int n)
 {
-    FILE *gp;
+    string script; // 描画スクリプト
 
     /** Gnuplot 初期設定 **/
     const float t = n / hz_imu;
@@ -184,31 +217,22 @@ void Gnuplot(int n)
     sprintf(filename_2, "Estimate_position_IMU+GPS/route/%d.dat", n);
     sprintf(graphname, "Estimate_position_IMU+GPS/graph/%04d.png", n);
 
-    /** Gnuplot 呼び出し **/
-    if ((gp = popen("gnuplot", "w")) == NULL)
-    {
-        printf("gnuplot is not here!\n");
-        exit(0); // gnuplotが無い場合、異常ある場合は終了
-    }
-
     /** Gnuplot 描画設定 **/
-    fprintf(gp, "set terminal png size 800, 600 font 'Times New Roman, 20'\n");
-    fprintf(gp, "set size ratio -1\n");
-    fprintf(gp, "set output '%s'\n", graphname);                                                    // 出力ファイル
-    fprintf(gp, "unset key\n");                                                                     // 凡例非表示
-    fprintf(gp, "set xrange [%.3f:%.3f]\n", x_min, x_max);                                          // x軸の描画範囲
-    fprintf(gp, "set yrange [%.3f:%.3f]\n", y_min, y_max);                                          // y軸の描画範囲
-    fprintf(gp, "set title 'Estimated Position | IMU + GPS : {/Times-Italic t} = %1.3f [s]'\n", t); // グラフタイトル
-    fprintf(gp, "set xlabel '{/Times-Italic x} [m]' offset 0.0, 0.0\n");                            // x軸のラベル
-    fprintf(gp, "set ylabel '{/Times-Italic y} [m]' offset 1.0, 0.0\n");                            // y軸のラベル
-    fprintf(gp, "set xtics 5.0 offset 0.0, 0.0\n");                                                 // x軸の間隔
-    fprintf(gp, "set ytics 5.0 offset 0.0, 0.0\n");                                                 // y軸の間隔
+    Gnuplot_printf(script, "set terminal png size 800, 600 font 'Times New Roman, 20'\n");
+    Gnuplot_printf(script, "set size ratio -1\n");
+    Gnuplot_printf(script, "set output '%s'\n", graphname);                                                    // 出力ファイル
+    Gnuplot_printf(script, "unset key\n");                                                                     // 凡例非表示
+    Gnuplot_printf(script, "set xrange [%.3f:%.3f]\n", x_min, x_max);                                          // x軸の描画範囲
+    Gnuplot_printf(script, "set yrange [%.3f:%.3f]\n", y_min, y_max);                                          // y軸の描画範囲
+    Gnuplot_printf(script, "set title 'Estimated Position | IMU + GPS : {/Times-Italic t} = %1.3f [s]'\n", t); // グラフタイトル
+    Gnuplot_printf(script, "set xlabel '{/Times-Italic x} [m]' offset 0.0, 0.0\n");                            // x軸のラベル
+    Gnuplot_printf(script, "set ylabel '{/Times-Italic y} [m]' offset 1.0, 0.0\n");                            // y軸のラベル
+    Gnuplot_printf(script, "set xtics 5.0 offset 0.0, 0.0\n");                                                 // x軸の間隔
+    Gnuplot_printf(script, "set ytics 5.0 offset 0.0, 0.0\n");                                                 // y軸の間隔
 
     /** Gnuplot 書き出し **/
-    fprintf(gp, "plot '%s' using 2:3 with lines lc 'grey50' notitle, '%s' using 4:5 with points lc 'grey' ps 1 pt 7 notitle, '%s' using 2:3 with points lc 'red' ps 3 pt 7 notitle\n", filename_2, filename_2, filename_1);
+    Gnuplot_printf(script, "plot '%s' using 2:3 with lines lc 'grey50' notitle, '%s' using 4:5 with points lc 'grey' ps 1 pt 7 notitle, '%s' using 2:3 with points lc 'red' ps 3 pt 7 notitle\n", filename_2, filename_2, filename_1);
 
-    /** Gnuplot 終了 **/
-    fflush(gp);            // Clean up Data
-    fprintf(gp, "exit\n"); // Quit gnuplot
-    pclose(gp);
+    /** 描画ワーカーへ投入 **/
+    Gnuplot_submit(script);
 }
\ No newline at end of file
@@ -10,22 +10,30 @@
 #include <math.h>
 #include <sys/stat.h>
 #include <vector>
+#include "../../common/gnuplot_pool.h"
+#include "../../common/sensor_frame.h"
+#include "../../common/dead_reckoning.h"
+#include "../../common/simplify.h"
+#include "../../common/metrics.h"
 using namespace std;
 FILE *fp;
 mode_t dir_mode = S_IRUSR | S_IWUSR | S_IXUSR | S_IRGRP | S_IWGRP | S_IXGRP | S_IROTH | S_IXOTH | S_IXOTH;
 
 /** パラメータ **/
-const float hz_imu = 100; // サンプリング周期 [Hz]
+const float hz_imu = 100;           // サンプリング周期 [Hz]
+const float route_tolerance = 0.02; // 描画用の走行経路の許容誤差 [m]
 
 /** 変数宣言 **/
 vector<float> x; // x方向位置 [m]
 vector<float> y; // y方向位置 [m]
 
+Simplify_stream route_stream; // 走行経路の間引き
+vector<int> route_rows;       // 描画用の走行経路に残す点
+
 /** プロトタイプ宣言 **/
 int Estimate_position();
 void Write_data(int num);
 void Gnuplot(int n);
-void RMSE();
 
 /**************************************************************/
 // Function name : main
@@ -33,40 +41,167 @@ void RMSE();
 /**************************************************************/
 int main()
 {
+    Metrics_start("Estimate_position_IMU");
+
+    /** ディレクトリの作成 **/
+    const char dir_0[] = "Estimate_position_IMU";
+    const char dir_1[] = "Estimate_position_IMU/position";
+    const char dir_2[] = "Estimate_position_IMU/route";
+    const char dir_3[] = "Estimate_position_IMU/graph";
+
+    mkdir(dir_0, dir_mode);
+    mkdir(dir_1, dir_mode);
+    mkdir(dir_2, dir_mode);
+    mkdir(dir_3, dir_mode);
+
     int data_length = Estimate_position();
-    printf("data = %d\n", data_length);
+    Metrics_add("samples", data_length);
 
+    Metrics_timer timer_write("write");
+    Simplify_stream_init(route_stream, route_tolerance);
+    Gnuplot_pool_start(); // 描画ワーカーの起動
     for (int i = 0; i < data_length; i++)
     {
         Write_data(i);
-
         if (i % 10 == 0)
         {
             Gnuplot(i);
         }
     }
+    timer_write.Stop();
+    Gnuplot_pool_finish(); // 全フレームの描画完了を待機
 
     return 0;
 }
 
 /**************************************************************/
-// Function name : Airfoil_size
+// Function name : Estimate_position
 // Description   : 自己位置推定
 /**************************************************************/
-int Airfoil_size()
+int Estimate_position()
 {
-    /** データ名の読み取り **/
-    string name_str;
-    cout << "Data Name:";
-    cin >> name_str;
-    const char *name = name_str.c_str();
-
     /** ファイルの読み込み **/
+    Metrics_timer timer_read("read");
+    Sensor_frame<float> frame; // 読み込みデータ (9列)
+    char filename[] = "Simulation/data/data.dat";
+    if (!Read_sensor_frame(filename, frame))
+    {
+        exit(1);
+    }
+    timer_read.Stop();
+    const int data_length = frame.rows; // データの長さ [-]
+
+    /** 変数設定 **/
+    const float *acc_x = frame.Column(sensor_acc_x);     // x方向加速度 [m/s2]
+    const float *acc_y = frame.Column(sensor_acc_y);     // y方向加速度 [m/s2]
+    const float *omega_z = frame.Column(sensor_omega_z); // yaw方向角加速度 [rad/s2]
+
+    /** 配列のサイズ変更 **/
+    x.resize(data_length);
+    y.resize(data_length);
+
+    /** 位置の積算 (GPS情報による校正なし) **/
+    Metrics_timer timer_compute("compute");
+    const float dt = 1.0 / hz_imu; // サンプリング間隔 [s]
+    Dead_reckoning state;          // 推定状態
+    for (int i = 0; i < data_length; i++)
+    {
+        Dead_reckoning_step(state, acc_x[i], acc_y[i], omega_z[i], dt);
+        x[i] = state.x;
+        y[i] = state.y;
+    }
+
+    return data_length;
+}
+
+/**************************************************************/
+// Function name : Write_data
+// Description   : 車両の位置を計算
+/**************************************************************/
+void Write_data(int n)
+{
+    const float t = n / hz_imu;
+
+    /** 走行位置の書き出し **/
     char filename[100];
-    sprintf(filename, "airfoil/");
-    fp = fopen(filename, "r");
-    while ((fscanf(fp, "%f\t%f", &tmp[0], &tmp[1])) != EOF)
+    sprintf(filename, "Estimate_position_IMU/position/%d.dat", n);
+    fp = fopen(filename, "w");
+    fprintf(fp, "%f\t%f\t%f\n", t, x[n], y[n]);
+    Metrics_fclose(fp);
+
+    /** 走行経路の書き出し (描画用は許容誤差以内で間引き、最後のファイルは全点) **/
+    auto add = [&](long i)
     {
+        route_rows.push_back(i);
+    };
+    Simplify_push(route_stream, n, x[n], y[n], add);
+
+    auto write_row = [&](int i)
+    {
+        float t_tmp = i / hz_imu;
+        fprintf(fp, "%f\t%f\t%f\n", t_tmp, x[i], y[i]);
+    };
+
+    sprintf(filename, "Estimate_position_IMU/route/%d.dat", n);
+    fp = fopen(filename, "w");
+    if (n == (int)x.size() - 1)
+    {
+        for (int i = 0; i <= n; i++)
+        {
+            write_row(i);
+        }
+    }
+    else
+    {
+        for (size_t k = 0; k < route_rows.size(); k++)
+        {
+            write_row(route_rows[k]);
+        }
+        if (route_rows.back() != n)
+        {
+            write_row(n); // 未確定の現在位置
+        }
     }
-    fclose(fp);
+    Metrics_fclose(fp);
+}
+
+/**************************************************************/
+// Function name : Gnuplot
+// Description  :
+/**************************************************************/
+void Gnuplot(int n)
+{
+    string script; // 描画スクリプト
+
+    /** Gnuplot 初期設定 **/
+    const float t = n / hz_imu;
+    const float x_max = 20.0;
+    const float x_min = -20.0;
+    const float y_max = 25.0;
+    const float y_min = -5.0;
+
+    /** Gnuplot ファイル名の設定 **/
+    char graphname[100], filename_1[100], filename_2[100];
+    sprintf(filename_1, "Estimate_position_IMU/position/%d.dat", n);
+    sprintf(filename_2, "Estimate_position_IMU/route/%d.dat", n);
+    sprintf(graphname, "Estimate_position_IMU/graph/%04d.png", n);
+
+    /** Gnuplot 描画設定 **/
+    Gnuplot_printf(script, "set terminal png size 800, 600 font 'Times New Roman, 20'\n");
+    Gnuplot_printf(script, "set size ratio -1\n");
+    Gnuplot_printf(script, "set output '%s'\n", graphname);                                              // 出力ファイル
+    Gnuplot_printf(script, "unset key\n");                                                               // 凡例非表示
+    Gnuplot_printf(script, "set xrange [%.3f:%.3f]\n", x_min, x_max);                                    // x軸の描画範囲
+    Gnuplot_printf(script, "set yrange [%.3f:%.3f]\n", y_min, y_max);                                    // y軸の描画範囲
+    Gnuplot_printf(script, "set title 'Estimated Position | IMU : {/Times-Italic t} = %1.3f [s]'\n", t); // グラフタイトル
+    Gnuplot_printf(script, "set xlabel '{/Times-Italic x} [m]' offset 0.0, 0.0\n");                      // x軸のラベル
+    Gnuplot_printf(script, "set ylabel '{/Times-Italic y} [m]' offset 1.0, 0.0\n");                      // y軸のラベル
+    Gnuplot_printf(script, "set xtics 5.0 offset 0.0, 0.0\n");                                           // x軸の間隔
+    Gnuplot_printf(script, "set ytics 5.0 offset 0.0, 0.0\n");                                           // y軸の間隔
+
+    /** Gnuplot 書き出し **/
+    Gnuplot_printf(script, "plot '%s' using 2:3 with lines lc 'grey50' notitle, '%s' using 2:3 with points lc 'red' ps 3 pt 7 notitle\n", filename_2, filename_1);
+
+    /** 描画ワーカーへ投入 **/
+    Gnuplot_submit(script);
 }
\ No newline at end of file
@@ -0,0 +1,396 @@
+/**************************************************************/
+// Program name : Estimate_position_stream
+// Author       : Masatsugu Kitadai
+// Date         : 2023/10/22
+// Description  : 逐次入力による自己位置推定 (標準入力・FIFO・シリアルデバイス)
+//
+//   ./out/Estimate_position_stream.out [入力 (省略時は標準入力)] [-b ボーレート] [-s 集計間隔 [s]] [-c]
+//     -b はシリアルデバイスの場合のみ有効 (9600, 19200, 38400, 57600, 115200, 230400, 既定 115200, それ以外はエラー)
+//
+//   入力形式は最初のデータ行の列数で判定する
+//     7列 : Arduino ロガー (Time [ms], rax, ray, raz [g], rgx, rgy, rgz [deg/s])
+//     9列 : Simulation/data/data.dat (t [s], acc_x, acc_y, acc_z, omega_x, omega_y, omega_z, x_gps, y_gps)
+//   推定位置は1サンプルごとに標準出力へ、集計値は一定間隔で標準エラー出力へ書き出す
+//   -c : 静止区間を検出してセンサのバイアスを逐次推定・補正し、静止中は速度を 0 に戻す (9列では GPS の位置が動いていないことも確認)
+/**************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include <vector>
+#include "../../common/data_reader.h"
+#include "../../common/dead_reckoning.h"
+#include "../../common/imu_calibration.h"
+#include "../../common/metrics.h"
+using namespace std;
+
+/** 物理法則 **/
+const float pi = 4 * atan(1.0); // 円周率 [rad]
+const float g = 9.80665;        // 重力加速度 [m/s2]
+
+/** パラメータ **/
+const float hz_imu = 100;        // 公称サンプリング周期 [Hz] (最初のサンプルの積算間隔)
+const float error = -90.0;       // GPSの情報がないときの値の閾値 [-]
+const float dt_max = 1.0;        // 積算間隔の上限 [s] (欠測区間での発散を防ぐ)
+const float v_rest = 0.5;        // GPS の位置の変化から求めた速度がこれ以上なら ZUPT しない [m/s]
+const float fix_timeout = 2.0;   // GPS の速度を使う期限 [s] (受信断の間は IMU の静止判定のみ)
+const int buffer_size = 1 << 16; // 読み込みバッファ [byte]
+
+/** 集計値 **/
+struct Stream_stats
+{
+    long samples = 0;       // 処理したサンプル数 [-]
+    long fixes = 0;         // 使用したGPS情報の数 [-]
+    long skipped = 0;       // 解析できなかった行数 [-]
+    long stationary = 0;    // 静止と判定したサンプル数 [-]
+    double distance = 0;    // 走行距離 [m]
+    double latency_max = 0; // 受信から出力までの最大遅延 [s]
+    double latency_sum = 0; // 受信から出力までの遅延の合計 [s]
+    long latency_count = 0; // 遅延の計測回数 [-]
+    double wall_start = 0;  // 開始時刻 [s]
+};
+
+/** プロトタイプ宣言 **/
+int Open_input(const char *path, int baud);
+double Wall_time();
+void Print_summary(const Stream_stats &stats, const Dead_reckoning &state, bool final);
+void Print_calibration(const Imu_calibration &cal);
+
+/**************************************************************/
+// Function name : main
+// Description   : メイン
+/**************************************************************/
+int main(int argc, char *argv[])
+{
+    /** 引数の解析 **/
+    const char *path = NULL; // 入力 (NULL の場合は標準入力)
+    int baud = 115200;       // シリアル通信速度 [bps]
+    double interval = 1.0;   // 集計値の出力間隔 [s]
+    bool calibrate = false;  // バイアスの逐次推定と補正
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-b") == 0 && i + 1 < argc)
+        {
+            baud = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+        {
+            interval = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-c") == 0)
+        {
+            calibrate = true;
+        }
+        else
+        {
+            path = argv[i];
+        }
+    }
+
+    Metrics_start("Estimate_position_stream");
+    const int fd = path == NULL || strcmp(path, "-") == 0 ? STDIN_FILENO : Open_input(path, baud);
+    if (fd < 0)
+    {
+        return 1;
+    }
+
+    /** 推定状態 **/
+    Dead_reckoning state;
+    Stream_stats stats;
+    Imu_calibration cal;
+    stats.wall_start = Wall_time();
+    double wall_report = stats.wall_start;
+
+    size_t cols = 0;     // 入力の列数 (7 または 9)
+    double t_prev = NAN; // 前サンプルの時刻 [s]
+    double t_fix = NAN;  // 前回の GPS 受信時刻 [s]
+    float x_fix = 0;     // 前回の GPS の x方向位置 [m]
+    float y_fix = 0;     // 前回の GPS の y方向位置 [m]
+    bool moving = false; // GPS の位置が動いているか
+    float values[9];     // 1行分の値
+
+    /** 逐次処理 (改行単位で解析し、バッファを使い切ったら出力をフラッシュ) **/
+    vector<char> buf(buffer_size);
+    size_t filled = 0;
+    bool read_error = false; // 読み込みエラー (EINTR 以外)
+    while (true)
+    {
+        Metrics_timer timer_read("read"); // 受信待ちを含む
+        ssize_t n = read(fd, buf.data() + filled, buf.size() - filled);
+        timer_read.Stop();
+        if (n < 0 && errno == EINTR)
+        {
+            continue; // シグナルによる中断は読み直す
+        }
+        if (n < 0)
+        {
+            fprintf(stderr, "Cannot read: %s\n", strerror(errno));
+            read_error = true; // 受信済みの行を処理して終了
+        }
+        const bool eof = n <= 0; // EOF (FIFO の書き込み側が閉じた場合を含む)
+        if (eof)
+        {
+            if (filled == 0)
+            {
+                break;
+            }
+            buf[filled] = '\n'; // 改行のない最終行
+            n = 1;
+        }
+        const double wall_recv = Wall_time();
+        Metrics_add("bytes_read", eof ? 0 : n);
+        filled += n;
+
+        Metrics_timer timer_compute("compute"); // 解析と積算
+        const long samples_prev = stats.samples;
+
+        const char *p = buf.data();
+        const char *end = buf.data() + filled;
+        while (p < end)
+        {
+            const char *nl = (const char *)memchr(p, '\n', end - p);
+            if (nl == NULL)
+            {
+                break; // 行の途中 (次の read で続きを受け取る)
+            }
+
+            /** 列数の判定 **/
+            if (cols == 0)
+            {
+                double first;
+                Parse_field(p, nl, first);
+                if (!isnan(first))
+                {
+                    cols = Count_fields(p, nl) >= 9 ? 9 : 7;
+                }
+            }
+
+            if (cols == 0 || Parse_line(p, nl, values, cols, 1) < cols)
+            {
+                stats.skipped += cols == 0 ? 0 : 1; // ヘッダ行・壊れた行
+                p = nl + 1;
+                continue;
+            }
+
+            /** 単位の変換 **/
+            double t;
+            float acc[3], gyro[3];
+            if (cols == 7)
+            {
+                t = values[0] / 1000.0; // [ms] → [s]
+                for (int c = 0; c < 3; c++)
+                {
+                    acc[c] = values[1 + c] * g;           // [g] → [m/s2]
+                    gyro[c] = values[4 + c] * pi / 180.0; // [deg/s] → [rad/s]
+                }
+            }
+            else
+            {
+                t = values[0];
+                for (int c = 0; c < 3; c++)
+                {
+                    acc[c] = values[1 + c];
+                    gyro[c] = values[4 + c];
+                }
+
+                /** GPS情報による校正 **/
+                if (values[7] >= error && values[8] >= error)
+                {
+                    if (!isnan(t_fix) && t > t_fix)
+                    {
+                        moving = hypot(values[7] - x_fix, values[8] - y_fix) > v_rest * (t - t_fix);
+                    }
+                    t_fix = t;
+                    x_fix = values[7];
+                    y_fix = values[8];
+                    state.x = values[7];
+                    state.y = values[8];
+                    stats.fixes += 1;
+                }
+            }
+
+            /** バイアスの推定と補正 (静止時の加速度の真値は Arduino では重力, Simulation では 0) **/
+            bool stationary = false;
+            if (calibrate)
+            {
+                if (cal.detector.count == 0)
+                {
+                    const double acc_reference[3] = {0.0, 0.0, cols == 7 ? g : 0.0};
+                    Imu_calibration_init(cal, acc_reference);
+                }
+                stationary = Imu_calibrate(cal, acc, gyro);
+                stats.stationary += stationary ? 1 : 0;
+            }
+
+            /** 積算間隔 (タイムスタンプから計算) **/
+            float dt = isnan(t_prev) ? 1.0 / hz_imu : t - t_prev;
+            if (dt < 0 || dt > dt_max)
+            {
+                dt = 0; // 時刻の逆行・長時間の欠測は積算しない
+            }
+            t_prev = t;
+
+            /** 速度・角度・位置の積算 **/
+            const float x_prev = state.x;
+            const float y_prev = state.y;
+            Dead_reckoning_step(state, acc[0], acc[1], gyro[2], dt);
+            if (stationary && !(moving && t - t_fix < fix_timeout))
+            {
+                state.u = 0; // 静止中の速度の補正 (ZUPT, 直進の等速走行は IMU では静止と区別できないため GPS でも確認)
+                state.v = 0;
+            }
+            stats.distance += sqrt((state.x - x_prev) * (state.x - x_prev) + (state.y - y_prev) * (state.y - y_prev));
+            stats.samples += 1;
+
+            printf("%f\t%f\t%f\t%f\n", t, state.x, state.y, state.theta);
+            p = nl + 1;
+        }
+
+        /** 未処理の行の途中をバッファ先頭へ移動 **/
+        filled = end - p;
+        memmove(buf.data(), p, filled);
+        if (filled == buf.size())
+        {
+            filled = 0; // 改行のない長すぎる行は破棄
+            stats.skipped += 1;
+        }
+
+        timer_compute.Stop();
+        Metrics_add("samples", stats.samples - samples_prev);
+
+        Metrics_timer timer_write("write");
+        fflush(stdout);
+        timer_write.Stop();
+
+        /** 遅延の計測と集計値の出力 **/
+        const double wall_now = Wall_time();
+        const double latency = wall_now - wall_recv;
+        stats.latency_sum += latency;
+        stats.latency_count += 1;
+        if (latency > stats.latency_max)
+        {
+            stats.latency_max = latency;
+        }
+        if (interval > 0 && wall_now - wall_report >= interval)
+        {
+            Print_summary(stats, state, false);
+            wall_report = wall_now;
+        }
+
+        if (eof)
+        {
+            break;
+        }
+    }
+
+    Print_summary(stats, state, true);
+    if (calibrate)
+    {
+        Print_calibration(cal);
+    }
+    if (fd != STDIN_FILENO)
+    {
+        close(fd);
+    }
+
+    return read_error ? 1 : 0;
+}
+
+/**************************************************************/
+// Function name : Open_input
+// Description   : 入力ファイル・FIFO・シリアルデバイスを開く
+/**************************************************************/
+int Open_input(const char *path, int baud)
+{
+    const int fd = open(path, O_RDONLY | O_NOCTTY);
+    if (fd < 0)
+    {
+        fprintf(stderr, "Cannot open: %s\n", path);
+        return -1;
+    }
+
+    /** シリアルデバイスの設定 (8N1, 行単位受信) **/
+    if (isatty(fd))
+    {
+        speed_t speed;
+        switch (baud)
+        {
+        case 9600:
+            speed = B9600;
+            break;
+        case 19200:
+            speed = B19200;
+            break;
+        case 38400:
+            speed = B38400;
+            break;
+        case 57600:
+            speed = B57600;
+            break;
+        case 115200:
+            speed = B115200;
+            break;
+        case 230400:
+            speed = B230400;
+            break;
+        default:
+            fprintf(stderr, "Unsupported baud rate: %d (9600, 19200, 38400, 57600, 115200, 230400)\n", baud);
+            close(fd);
+            return -1;
+        }
+
+        struct termios tio;
+        tcgetattr(fd, &tio);
+        cfsetispeed(&tio, speed);
+        cfsetospeed(&tio, speed);
+        tio.c_cflag = (tio.c_cflag & ~(CSIZE | PARENB | CSTOPB)) | CS8 | CLOCAL | CREAD;
+        tio.c_iflag = IGNCR; // Serial.println の CR を除去
+        tio.c_lflag = ICANON;
+        tio.c_oflag = 0;
+        tcsetattr(fd, TCSANOW, &tio);
+        tcflush(fd, TCIFLUSH);
+    }
+
+    return fd;
+}
+
+/**************************************************************/
+// Function name : Wall_time
+// Description   : 経過時間計測用の時刻 [s]
+/**************************************************************/
+double Wall_time()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**************************************************************/
+// Function name : Print_summary
+// Description   : 集計値の出力 (標準エラー出力)
+/**************************************************************/
+void Print_summary(const Stream_stats &stats, const Dead_reckoning &state, bool final)
+{
+    const double elapsed = Wall_time() - stats.wall_start;
+    const double latency_mean = stats.latency_count > 0 ? stats.latency_sum / stats.latency_count : 0;
+    fprintf(stderr, "%s samples = %ld\trate = %.1f [Hz]\tfixes = %ld\tskipped = %ld\tstationary = %ld\tdistance = %.3f [m]\tx = %.3f [m]\ty = %.3f [m]\tlatency = %.3f / %.3f [ms]\n",
+            final ? "[final]" : "[stream]", stats.samples, elapsed > 0 ? stats.samples / elapsed : 0, stats.fixes, stats.skipped, stats.stationary,
+            stats.distance, state.x, state.y, latency_mean * 1e3, stats.latency_max * 1e3);
+}
+
+/**************************************************************/
+// Function name : Print_calibration
+// Description   : 推定したバイアス・スケールの出力 (標準エラー出力)
+/**************************************************************/
+void Print_calibration(const Imu_calibration &cal)
+{
+    fprintf(stderr, "[calibration] acc bias = %.4f %.4f %.4f [m/s2]\tacc scale = %.4f %.4f %.4f [-]\tgyro bias = %.4f %.4f %.4f [deg/s]\n",
+            cal.acc[0].bias, cal.acc[1].bias, cal.acc[2].bias, cal.acc[0].scale, cal.acc[1].scale, cal.acc[2].scale,
+            cal.gyro[0].bias * 180.0 / pi, cal.gyro[1].bias * 180.0 / pi, cal.gyro[2].bias * 180.0 / pi);
+}
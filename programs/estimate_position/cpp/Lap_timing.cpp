@@ -0,0 +1,95 @@
+/**************************************************************/
+// Program name : Lap_timing
+// Author       : Masatsugu Kitadai
+// Date         : 2023/10/26
+// Description  : 走行軌跡の周回分割とラップタイムの計算
+//
+//   ./out/Lap_timing.out <走行軌跡 (t, x, y)> <x0> <y0> <x1> <y1> [最短周回時間 [s]] [出力ファイル]
+//   コントロールラインは (x0, y0) → (x1, y1) の線分で、進行方向はその左向き
+//   (スキッドパッドでは y = 助走距離 の線分を +y 方向へ通過するたびに1周)
+/**************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include <vector>
+#include "../../common/data_reader.h"
+#include "../../common/spatial_grid.h"
+#include "../../common/lap_timing.h"
+#include "../../common/metrics.h"
+using namespace std;
+
+/**************************************************************/
+// Function name : main
+// Description   : メイン
+/**************************************************************/
+int main(int argc, char *argv[])
+{
+    if (argc < 6)
+    {
+        printf("usage: %s <route.dat> <x0> <y0> <x1> <y1> [min_lap] [output.dat]\n", argv[0]);
+        return 1;
+    }
+
+    Metrics_start("Lap_timing");
+
+    Lap_line line;
+    line.x0 = atof(argv[2]);
+    line.y0 = atof(argv[3]);
+    line.x1 = atof(argv[4]);
+    line.y1 = atof(argv[5]);
+    if (argc >= 7)
+    {
+        line.min_lap = atof(argv[6]);
+    }
+
+    /** 走行軌跡の読み込み **/
+    Metrics_timer timer_read("read");
+    Data_table<double> table;
+    if (!Read_table(argv[1], table, 0, 3))
+    {
+        return 1;
+    }
+    timer_read.Stop();
+    const double *t = table.Column(0);
+    const double *x = table.Column(1);
+    const double *y = table.Column(2);
+    const size_t n = table.rows;
+
+    /** 空間索引の作成と通過の検出 **/
+    const clock_t clock_start = clock();
+    Metrics_timer timer_compute("compute");
+    Spatial_grid grid;
+    Grid_build(grid, x, y, n);
+    const vector<Lap_crossing> crossings = Lap_crossings(grid, t, x, y, n, line);
+    const vector<Lap> laps = Lap_statistics(crossings, t, x, y);
+    const double elapsed = (double)(clock() - clock_start) / CLOCKS_PER_SEC;
+    timer_compute.Stop();
+    Metrics_add("samples", n);
+
+    /** 結果の書き出し **/
+    Metrics_timer timer_write("write");
+    FILE *fp = argc >= 8 ? fopen(argv[7], "w") : stdout;
+    if (fp == NULL)
+    {
+        printf("Cannot open: %s\n", argv[7]);
+        return 1;
+    }
+    fprintf(fp, "# lap\tt_start[s]\tt_end[s]\tlap_time[s]\tdistance[m]\tv_mean[m/s]\tv_max[m/s]\tradius[m]\tcenter_x[m]\tcenter_y[m]\n");
+    for (size_t k = 0; k < laps.size(); k++)
+    {
+        const Lap &lap = laps[k];
+        fprintf(fp, "%d\t%.3f\t%.3f\t%.3f\t%.3f\t%.3f\t%.3f\t%.3f\t%.3f\t%.3f\n", lap.number, lap.t_start, lap.t_end,
+                lap.duration, lap.distance, lap.speed_mean, lap.speed_max, lap.radius, lap.center_x, lap.center_y);
+    }
+    if (fp != stdout)
+    {
+        Metrics_fclose(fp);
+    }
+
+    fprintf(stderr, "points = %ld\tgrid = %d x %d (%.3f [m])\tcrossings = %ld\tlaps = %ld\telapsed = %.3f [ms]\n",
+            (long)n, grid.nx, grid.ny, grid.cell, (long)crossings.size(), (long)laps.size(), elapsed * 1e3);
+
+    return 0;
+}
@@ -10,6 +10,9 @@
 #include <math.h>
 #include <sys/stat.h>
 #include <vector>
+#include "../../common/data_reader.h"
+#include "../../common/path_query.h"
+#include "../../common/metrics.h"
 using namespace std;
 FILE *fp;
 mode_t dir_mode = S_IRUSR | S_IWUSR | S_IXUSR | S_IRGRP | S_IWGRP | S_IXGRP | S_IROTH | S_IXOTH | S_IXOTH;
@@ -19,18 +22,22 @@ const float hz_imu = 100.0; // サンプリング周期 [Hz]
 const float hz_gps = 2.0;   // サンプリング周期 [Hz]
 
 /** 変数設定 **/
+vector<float> t;     // シミュレーション結果(真値)の時刻
 vector<float> x;     // x方向のシミュレーション結果(真値)
 vector<float> y;     // y方向のシミュレーション結果(真値)
+vector<float> t_imu; // IMU単独推定値の時刻
 vector<float> x_imu; // x方向のIMU単独推定値
 vector<float> y_imu; // y方向のIMU単独推定値
+vector<float> t_gps; // IMU＋GPS推定値の時刻
 vector<float> x_gps; // x方向のIMU＋GPS推定値
 vector<float> y_gps; // y方向のIMU＋GPS推定値
 
 /** プロトタイプ宣言 **/
 int Get_number();
-void Read_data(const char *filename, vector<float> &x, vector<float> &y);
+void Read_data(const char *filename, vector<float> &t, vector<float> &x, vector<float> &y);
 float RMSE(vector<float> &data1, vector<float> &data2);
 float RMSE_2(vector<float> &data11, vector<float> &data12, vector<float> &data21, vector<float> &data22);
+void Track_error(const char *name, const Reference_path &ref, vector<float> &t, vector<float> &x, vector<float> &y);
 
 /**************************************************************/
 // Function name : main
@@ -38,25 +45,28 @@ float RMSE_2(vector<float> &data11, vector<float> &data12, vector<float> &data21
 /**************************************************************/
 int main()
 {
+    Metrics_start("RMSE");
     int data_length = Get_number();
 
     char filename[100];
 
     /** シミュレーション(真値) **/
     sprintf(filename, "Simulation/route/%d.dat", data_length - 1); // 読み込みファイル
-    Read_data(filename, x, y);
+    Read_data(filename, t, x, y);
     printf("Read: %s\n", filename);
 
     /** IMU単独 **/
     sprintf(filename, "Estimate_position_IMU/route/%d.dat", data_length - 1); // 読み込みファイル
-    Read_data(filename, x_imu, y_imu);
+    Read_data(filename, t_imu, x_imu, y_imu);
     printf("Read: %s\n", filename);
 
     /** IMU+GPS **/
     sprintf(filename, "Estimate_position_IMU+GPS/route/%d.dat", data_length - 1); // 読み込みファイル
-    Read_data(filename, x_gps, y_gps);
+    Read_data(filename, t_gps, x_gps, y_gps);
     printf("Read: %s\n", filename);
 
+    Metrics_timer timer_compute("compute");
+    Metrics_add("samples", x_imu.size() + x_gps.size());
     float rmse_x_imu = RMSE(x, x_imu);
     float rmse_y_imu = RMSE(y, y_imu);
     float rmse_v_imu = RMSE_2(x, x_imu, y, y_imu);
@@ -68,6 +78,12 @@ int main()
     printf("IMU    \tx = %.3f [m]\ty = %.3f [m]\td = %.3f [m]\n", rmse_x_imu, rmse_y_imu, rmse_v_imu);
     printf("IMU+GPS\tx = %.3f [m]\ty = %.3f [m]\td = %.3f [m]\n", rmse_x_gps, rmse_y_gps, rmse_v_gps);
 
+    /** 真値の経路に対する横方向・前後方向誤差 (点番号ではなく位置と時刻で対応付け) **/
+    Reference_path ref;
+    Reference_path_build(ref, t.data(), x.data(), y.data(), t.size());
+    Track_error("IMU    ", ref, t_imu, x_imu, y_imu);
+    Track_error("IMU+GPS", ref, t_gps, x_gps, y_gps);
+
     return 0;
 }
 
@@ -77,17 +93,9 @@ int main()
 /**************************************************************/
 int Get_number()
 {
-    int data_length; // データの長さ [-]
-
-    /** ファイル名の取得 **/
-    char buf[200];                                // 文字列用バッファ
-    char datafile[] = "Simulation/data/data.dat"; // 読み込みファイル
-    fp = fopen(datafile, "r");
-    while (fgets(buf, 200, fp) != NULL)
-    {
-        data_length += 1;
-    }
-    fclose(fp);
+    /** 行数の計数 **/
+    char datafile[] = "Simulation/data/data.dat";  // 読み込みファイル
+    const int data_length = Count_lines(datafile); // データの長さ [-]
 
     printf("data_length = %d\n", data_length);
 
@@ -98,17 +106,18 @@ int Get_number()
 // Function name : Read_data
 // Description   : データの読み込み
 /**************************************************************/
-void Read_data(const char *filename, vector<float> &x, vector<float> &y)
+void Read_data(const char *filename, vector<float> &t, vector<float> &x, vector<float> &y)
 {
-    float tmp[5]; // 読み込み時のバッファ
-
-    fp = fopen(filename, "r");
-    while (fscanf(fp, "%f\t%f\t%f\t%f\t%f", &tmp[0], &tmp[1], &tmp[2], &tmp[3], &tmp[4]) != EOF)
+    Metrics_timer timer("read");
+    Data_table<float> table; // 読み込みデータ
+    if (!Read_table(filename, table))
     {
-        x.push_back(tmp[1]);
-        y.push_back(tmp[2]);
+        exit(1);
     }
-    fclose(fp);
+
+    t.assign(table.Column(0), table.Column(0) + table.rows);
+    x.assign(table.Column(1), table.Column(1) + table.rows);
+    y.assign(table.Column(2), table.Column(2) + table.rows);
 }
 
 /**************************************************************/
@@ -153,4 +162,34 @@ float RMSE_2(vector<float> &data11, vector<float> &data12, vector<float> &data21
     float rmse = sqrt(1.0 / n * sum);
 
     return rmse;
-}
\ No newline at end of file
+}
+
+/**************************************************************/
+// Function name : Track_error
+// Description   : 基準経路に対する横方向誤差・前後方向誤差の RMSE と最大値
+/**************************************************************/
+void Track_error(const char *name, const Reference_path &ref, vector<float> &t, vector<float> &x, vector<float> &y)
+{
+    const size_t n = t.size();
+    vector<double> cross(n); // 横方向誤差 [m]
+    vector<double> along(n); // 前後方向誤差 [m]
+    Path_errors(ref, t.data(), x.data(), y.data(), n, cross.data(), along.data());
+
+    double sum_cross = 0, sum_along = 0, max_cross = 0, max_along = 0;
+    int n_along = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        sum_cross += cross[i] * cross[i];
+        max_cross = fmax(max_cross, fabs(cross[i]));
+        if (!isnan(along[i]))
+        {
+            sum_along += along[i] * along[i];
+            max_along = fmax(max_along, fabs(along[i]));
+            n_along += 1;
+        }
+    }
+
+    const double rmse_cross = n > 0 ? sqrt(sum_cross / n) : 0;
+    const double rmse_along = n_along > 0 ? sqrt(sum_along / n_along) : 0;
+    printf("%s\tcross-track = %.3f [m] (max %.3f [m])\talong-track = %.3f [m] (max %.3f [m])\n", name, rmse_cross, max_cross, rmse_along, max_along);
+}
@@ -7,10 +7,16 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 #include <sys/stat.h>
 #include <time.h>
 #include <vector>
+#include "../../common/gnuplot_pool.h"
+#include "../../common/simplify.h"
+#include "../../common/sensor_error.h"
+#include "../../common/sensor_frame.h"
+#include "../../common/metrics.h"
 using namespace std;
 FILE *fp;
 mode_t dir_mode = S_IRUSR | S_IWUSR | S_IXUSR | S_IRGRP | S_IWGRP | S_IXGRP | S_IROTH | S_IXOTH | S_IXOTH;
@@ -20,14 +26,12 @@ const float pi = 4 * atan(1.0); // 円周率 [rad]
 const float g = 9.80665;        // 重力加速度 [m/s2]
 
 /** パラメータ **/
-const float v = 40.0;                     // 走行速度 [km/h]
-const float r = 7.625;                    // 旋回半径 [m]
-const float n = 4.0;                      // スキッドパッドの周回数 [-] (右周り2周 → 左回り2周)
-const float hz_imu = 100.0;               // 6軸センサのサンプリング周期 [Hz]
-const float hz_gps = 2.0;                 // GPSのサンプリング周期 [Hz] (ZED-F9P は RTK 時に最大 20 [Hz])
-const float err_g = 2.0 * g * 0.010;      // 加速度センサの誤差 [m/s2]
-const float err_omega = 2.0 * pi * 0.010; // 加速度センサの誤差 [m/s2]
-const float err_gps = 0.01;               // GPSの誤差 [m]
+const float v = 40.0;               // 走行速度 [km/h]
+const float r = 7.625;              // 旋回半径 [m]
+const float n = 4.0;                // スキッドパッドの周回数 [-] (右周り2周 → 左回り2周)
+const float hz_imu = 100.0;         // 6軸センサのサンプリング周期 [Hz]
+const float hz_gps = 2.0;           // GPSのサンプリング周期 [Hz] (ZED-F9P は RTK 時に最大 20 [Hz])
+const float route_tolerance = 0.02; // 描画用の走行経路の許容誤差 [m]
 
 /** パラメータ（自動的に決まる） **/
 const float v2 = v * 1000.0 / 3600.0;                                  // 走行速度 [m/s]
@@ -45,24 +49,19 @@ const float t1 = t_start;       // スキッドパッド開始時刻 [s]
 const float t2 = t1 + t_sp;     // スキッドパッド終了時刻 [s]
 const float t3 = t2 + t_finish; // 走行終了時刻 [s]
 
-/** グローバル変数 **/
-vector<float> xw(t3 *hz_imu); // 絶対座標系 x軸方向 : World coordinate system
-vector<float> yw(t3 *hz_imu); // 絶対座標系 y軸方向 : World coordinate system
-vector<float> xl(t3 *hz_imu); // 車両座標系 x軸方向 : Local coordinate system
-vector<float> yl(t3 *hz_imu); // 車両座標系 y軸方向 : Local coordinate system
-
-vector<float> acc_xl(t3 *hz_imu);    // 測定データ：車両に加わる加速度 x軸方向
-vector<float> acc_yl(t3 *hz_imu);    // 測定データ：車両に加わる加速度 y軸方向
-vector<float> omegal(t3 *hz_imu);    // 測定データ：車両に加わる角加速度 z軸方向
-vector<float> latitude(t3 *hz_imu);  // 測定データ：車両位置 緯度
-vector<float> longitude(t3 *hz_imu); // 測定データ：車両位置 経度
-
-vector<float> err_xl(t3 *hz_imu);     // 乱数配列
-vector<float> err_yl(t3 *hz_imu);     // 乱数配列
-vector<float> err_omegal(t3 *hz_imu); // 乱数配列
-vector<float> err_lon(t3 *hz_imu);    // 乱数配列
-vector<float> err_lat(t3 *hz_imu);    // 乱数配列
-vector<float> err_buf(t3 *hz_imu);    // 乱数配列
+/** グローバル変数 (行数は main で1回だけ決めて確保) **/
+Aligned_vector<float> xw;  // 絶対座標系 x軸方向 : World coordinate system
+Aligned_vector<float> yw;  // 絶対座標系 y軸方向 : World coordinate system
+Sensor_frame<float> frame; // 測定データ (加速度・角速度・GPS)
+
+float *acc_xl = NULL;    // 測定データ：車両に加わる加速度 x軸方向
+float *acc_yl = NULL;    // 測定データ：車両に加わる加速度 y軸方向
+float *omegal = NULL;    // 測定データ：車両に加わる角加速度 z軸方向
+float *latitude = NULL;  // 測定データ：車両位置 緯度
+float *longitude = NULL; // 測定データ：車両位置 経度
+
+Simplify_stream route_stream; // 走行経路の間引き
+vector<int> route_rows;       // 描画用の走行経路に残す点
 
 /** プロトタイプ宣言 **/
 float Start(float t);
@@ -73,8 +72,6 @@ float Skidpad_y_acc(float t);
 float Skidpad_omega_acc(float t);
 float GPS_latitude(int n);
 float GPS_longitude(int n);
-void Random_number(vector<float> &err);
-void Box_Mullers_method(vector<float> &x1, vector<float> &x2);
 void Write_data(int n);
 void Gnuplot(int n);
 void Gnuplot_2();
@@ -83,8 +80,17 @@ void Gnuplot_2();
 // Function name : main
 // Description   : メインプログラム
 /**************************************************************/
-int main()
+int main(int argc, char *argv[])
 {
+    /** 乱数の種 (-seed で固定, モンテカルロ法では試行ごとに変える) **/
+    unsigned long seed = (unsigned long)time(NULL);
+    if (argc > 2 && strcmp(argv[1], "-seed") == 0)
+    {
+        seed = strtoul(argv[2], NULL, 10);
+    }
+
+    Metrics_start("Simulation");
+
     /** ディレクトリの作成 **/
     const char dir_0[] = "Simulation";
     const char dir_1[] = "Simulation/position";
@@ -98,21 +104,18 @@ int main()
     mkdir(dir_3, dir_mode);
     mkdir(dir_4, dir_mode);
 
-    /** 誤差データの生成 **/
-    srand((unsigned int)time(NULL)); // シード値の変更
+    /** 配列の確保 **/
+    const size_t samples = Sensor_frame_samples(t3, hz_imu); // データの長さ [-]
+    Sensor_frame_init(frame, samples, hz_imu);
+    xw.assign(samples, 0);
+    yw.assign(samples, 0);
+    acc_xl = frame.Column(sensor_acc_x);
+    acc_yl = frame.Column(sensor_acc_y);
+    omegal = frame.Column(sensor_omega_z);
+    longitude = frame.Column(sensor_gps_x);
+    latitude = frame.Column(sensor_gps_y);
 
-    // 一様乱数の生成
-    Random_number(err_xl);
-    Random_number(err_yl);
-    Random_number(err_omegal);
-    Random_number(err_lon);
-    Random_number(err_lat);
-    Random_number(err_buf);
-
-    // 正規分布乱数への変換
-    Box_Mullers_method(err_xl, err_yl);
-    Box_Mullers_method(err_omegal, err_lon);
-    Box_Mullers_method(err_lat, err_buf);
+    Metrics_timer timer_compute("compute");
 
     /** 助走区間 (t0 <= t < t1) **/
     for (int i = int(t0 * hz_imu); i < int(t1 * hz_imu); i++)
@@ -174,7 +177,13 @@ int main()
         latitude[i] = GPS_latitude(i);
     }
 
+    timer_compute.Stop();
+    Metrics_add("samples", frame.rows);
+
     /** 真値の書き出し **/
+    Metrics_timer timer_write("write");
+    Simplify_stream_init(route_stream, route_tolerance);
+    Gnuplot_pool_start(); // 描画ワーカーの起動
     for (int i = int(t0 * hz_imu); i < int(t3 * hz_imu); i++)
     {
         const float t = i / hz_imu;
@@ -184,27 +193,32 @@ int main()
             Gnuplot(i);
         }
     }
-
-    /** 誤差の足し算 **/
-    for (int i = 0; i < acc_xl.size(); i++)
-    {
-        acc_xl[i] += err_g * err_xl[i];
-        acc_yl[i] += err_g * err_yl[i];
-        omegal[i] += err_omega * err_omegal[i];
-        longitude[i] += err_gps * err_lon[i];
-        latitude[i] += err_gps * err_lat[i];
-    }
+    timer_write.Stop();
+    Gnuplot_pool_finish(); // 全フレームの描画完了を待機
+
+    /** 誤差の付加 (軸ごとに独立した乱数) **/
+    Metrics_timer timer_error("error");
+    Imu_error_channel err_xl, err_yl, err_omegal;
+    Gnss_error_state err_gps;
+    Imu_error_init(err_xl, mpu6050_acc_error, seed * 4 + 0);
+    Imu_error_init(err_yl, mpu6050_acc_error, seed * 4 + 1);
+    Imu_error_init(err_omegal, mpu6050_gyro_error, seed * 4 + 2);
+    Gnss_error_init(err_gps, zed_f9p_error, seed * 4 + 3);
+    Imu_error_apply(err_xl, acc_xl, frame.rows, 1.0 / hz_imu);
+    Imu_error_apply(err_yl, acc_yl, frame.rows, 1.0 / hz_imu);
+    Imu_error_apply(err_omegal, omegal, frame.rows, 1.0 / hz_imu);
+    Gnss_error_apply(err_gps, xw.data(), yw.data(), frame.rows, 1.0 / hz_imu, int(hz_imu / hz_gps), sensor_no_fix, longitude, latitude);
+    timer_error.Stop();
 
     /** 加速度の書き出し **/
+    Metrics_timer timer_output("write");
     char filename[] = "Simulation/data/data.dat";
-    fp = fopen(filename, "w");
-    for (int i = 0; i < acc_xl.size(); i++)
+    Write_sensor_frame(filename, Sensor_frame_slice(frame, 0, frame.rows));
+    for (size_t i = 0; i < frame.rows; i++)
     {
         float t_tmp = i / hz_imu;
-        fprintf(fp, "%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f\n", t_tmp, acc_xl[i], acc_yl[i], 0.0, 0.0, 0.0, omegal[i], longitude[i], latitude[i]);
         printf("%f\t%f\t%f\t%f\t%f\t%f\n", t_tmp, acc_xl[i], acc_yl[i], omegal[i], longitude[i], latitude[i]);
     }
-    fclose(fp);
 
     return 0;
 }
@@ -337,7 +351,7 @@ float GPS_longitude(int n)
     }
     else
     {
-        longitude = -100;
+        longitude = sensor_no_fix;
     }
 
     return longitude;
@@ -359,44 +373,12 @@ float GPS_latitude(int n)
     }
     else
     {
-        latitude = -100;
+        latitude = sensor_no_fix;
     }
 
     return latitude;
 }
 
-/**************************************************************/
-// Function name : Random_number
-// Description   : 一様乱数の生成
-/**************************************************************/
-void Random_number(vector<float> &err)
-{
-    for (int i = 0; i < err.size(); i++)
-    {
-        err[i] = (float)rand() / RAND_MAX;
-    }
-}
-
-/**************************************************************/
-// Function name : Box_Mullers_method
-// Description   : 正規分布の乱数を与える (x1,x2は互いに独立な一様乱数)
-/**************************************************************/
-void Box_Mullers_method(vector<float> &x1, vector<float> &x2)
-{
-    const float pi = 4 * atan(1.0); // 円周率 [rad]
-    for (int i = 0; i < x1.size(); i++)
-    {
-        // ボックス=ミュラー法による正規分布乱数の計算
-        float tmp = sqrt(-2.0 * log(x1[i]));
-        float value1 = tmp * cos(2.0 * pi * x2[i]);
-        float value2 = tmp * sin(2.0 * pi * x2[i]);
-
-        // 配列への代入
-        x1[i] = value1; // -1.0 <= x1 <= 1.0
-        x2[i] = value2; // -1.0 <= x2 <= 1.0
-    }
-}
-
 /**************************************************************/
 // Function name : Write_data
 // Description   : 車両の位置を計算
@@ -410,17 +392,42 @@ void Write_data(int n)
     sprintf(filename, "Simulation/position/%d.dat", n);
     fp = fopen(filename, "w");
     fprintf(fp, "%f\t%f\t%f\n", t, xw[n], yw[n]);
-    fclose(fp);
+    Metrics_fclose(fp);
 
-    /** 走行経路の書き出し **/
-    sprintf(filename, "Simulation/route/%d.dat", n);
-    fp = fopen(filename, "w");
-    for (int i = 0; i <= n; i++)
+    /** 走行経路の書き出し (描画用は許容誤差以内で間引き、最後のファイルは全点) **/
+    auto add = [&](long i)
+    {
+        route_rows.push_back(i);
+    };
+    Simplify_push(route_stream, n, xw[n], yw[n], add);
+
+    auto write_row = [&](int i)
     {
         float t_tmp = i / hz_imu;
         fprintf(fp, "%f\t%f\t%f\t%f\t%f\n", t_tmp, xw[i], yw[i], longitude[i], latitude[i]);
+    };
+
+    sprintf(filename, "Simulation/route/%d.dat", n);
+    fp = fopen(filename, "w");
+    if (n == (int)frame.rows - 1)
+    {
+        for (int i = 0; i <= n; i++)
+        {
+            write_row(i);
+        }
     }
-    fclose(fp);
+    else
+    {
+        for (size_t k = 0; k < route_rows.size(); k++)
+        {
+            write_row(route_rows[k]);
+        }
+        if (route_rows.back() != n)
+        {
+            write_row(n); // 未確定の現在位置
+        }
+    }
+    Metrics_fclose(fp);
 }
 
 /**************************************************************/
@@ -429,7 +436,7 @@ void Write_data(int n)
 /**************************************************************/
 void Gnuplot(int n)
 {
-    FILE *gp;
+    string script; // 描画スクリプト
 
     /** Gnuplot 初期設定 **/
     const float t = n / hz_imu;
@@ -444,31 +451,22 @@ void Gnuplot(int n)
     sprintf(filename_2, "Simulation/route/%d.dat", n);
     sprintf(graphname, "Simulation/graph/%04d.png", n);
 
-    /** Gnuplot 呼び出し **/
-    if ((gp = popen("gnuplot", "w")) == NULL)
-    {
-        printf("gnuplot is not here!\n");
-        exit(0); // gnuplotが無い場合、異常ある場合は終了
-    }
-
     /** Gnuplot 描画設定 **/
-    fprintf(gp, "set terminal png size 800, 600 font 'Times New Roman, 20'\n");
-    fprintf(gp, "set size ratio -1\n");
-    fprintf(gp, "set output '%s'\n", graphname);                                        // 出力ファイル
-    fprintf(gp, "unset key\n");                                                         // 凡例非表示
-    fprintf(gp, "set xrange [%.3f:%.3f]\n", x_min, x_max);                              // x軸の描画範囲
-    fprintf(gp, "set yrange [%.3f:%.3f]\n", y_min, y_max);                              // y軸の描画範囲
-    fprintf(gp, "set title 'Skidpad Simulation : {/Times-Italic t} = %1.3f [s]'\n", t); // グラフタイトル
-    fprintf(gp, "set xlabel '{/Times-Italic x} [m]' offset 0.0, 0.0\n");                // x軸のラベル
-    fprintf(gp, "set ylabel '{/Times-Italic y} [m]' offset 1.0, 0.0\n");                // y軸のラベル
-    fprintf(gp, "set xtics 5.0 offset 0.0, 0.0\n");                                     // x軸の間隔
-    fprintf(gp, "set ytics 5.0 offset 0.0, 0.0\n");                                     // y軸の間隔
+    Gnuplot_printf(script, "set terminal png size 800, 600 font 'Times New Roman, 20'\n");
+    Gnuplot_printf(script, "set size ratio -1\n");
+    Gnuplot_printf(script, "set output '%s'\n", graphname);                                        // 出力ファイル
+    Gnuplot_printf(script, "unset key\n");                                                         // 凡例非表示
+    Gnuplot_printf(script, "set xrange [%.3f:%.3f]\n", x_min, x_max);                              // x軸の描画範囲
+    Gnuplot_printf(script, "set yrange [%.3f:%.3f]\n", y_min, y_max);                              // y軸の描画範囲
+    Gnuplot_printf(script, "set title 'Skidpad Simulation : {/Times-Italic t} = %1.3f [s]'\n", t); // グラフタイトル
+    Gnuplot_printf(script, "set xlabel '{/Times-Italic x} [m]' offset 0.0, 0.0\n");                // x軸のラベル
+    Gnuplot_printf(script, "set ylabel '{/Times-Italic y} [m]' offset 1.0, 0.0\n");                // y軸のラベル
+    Gnuplot_printf(script, "set xtics 5.0 offset 0.0, 0.0\n");                                     // x軸の間隔
+    Gnuplot_printf(script, "set ytics 5.0 offset 0.0, 0.0\n");                                     // y軸の間隔
 
     /** Gnuplot 書き出し **/
-    fprintf(gp, "plot '%s' using 2:3 with lines lc 'grey50' notitle, '%s' using 2:3 with points lc 'royalblue' ps 3 pt 7 notitle\n", filename_2, filename_1);
+    Gnuplot_printf(script, "plot '%s' using 2:3 with lines lc 'grey50' notitle, '%s' using 2:3 with points lc 'royalblue' ps 3 pt 7 notitle\n", filename_2, filename_1);
 
-    /** Gnuplot 終了 **/
-    fflush(gp);            // Clean up Data
-    fprintf(gp, "exit\n"); // Quit gnuplot
-    pclose(gp);
+    /** 描画ワーカーへ投入 **/
+    Gnuplot_submit(script);
 }
\ No newline at end of file
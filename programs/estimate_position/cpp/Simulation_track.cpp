@@ -0,0 +1,269 @@
+/**************************************************************/
+// Program name : Simulation_track
+// Author       : Masatsugu Kitadai
+// Date         : 2023/10/29
+// Description  : 任意のコース (中心線と速度の分布) の走行シミュレーション
+//
+//   ./out/Simulation_track.out <コースファイル> [-hz 6軸センサの周波数 [Hz]] [-hz_gps GPS の周波数 [Hz]] [-seed 乱数の種] [-clean] [-j 並列数] [-no-graph]
+//     コースファイルの書式は common/track.h を参照 (例 : track/skidpad.txt, track/oval.txt)
+//     出力は Simulation.cpp と同じ形式のため、自己位置推定・RMSE の入力にそのまま使える
+//       Simulation/data/data.dat      : 測定データ (9列, センサの誤差は Simulation.cpp と同じ, -clean で誤差なし)
+//       Simulation/data/truth.dat     : 真値 (t, 走行距離, x, y, 方位, 速度, 前後加速度, 横加速度, ヨーレート)
+//       Simulation/route/<最終>.dat   : 真値の走行経路 (RMSE の基準)
+//       Simulation/graph/track.svg    : 走行経路
+//     車両座標系の符号は Simulation.cpp と同じ (acc_x は前後加速度の符号を反転, acc_y・omega_z は左旋回が正)
+/**************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <vector>
+#include <thread>
+#include "../../common/track.h"
+#include "../../common/sensor_error.h"
+#include "../../common/sensor_frame.h"
+#include "../../common/metrics.h"
+using namespace std;
+FILE *fp;
+mode_t dir_mode = S_IRUSR | S_IWUSR | S_IXUSR | S_IRGRP | S_IWGRP | S_IXGRP | S_IROTH | S_IXOTH | S_IXOTH;
+
+/** 物理法則 **/
+const float g = 9.80665; // 重力加速度 [m/s2]
+
+/** 各種パラメータ (引数で変更) **/
+float hz_imu = 100.0; // 6軸センサのサンプリング周期 [Hz]
+float hz_gps = 2.0;   // GPSのサンプリング周期 [Hz]
+
+/** プロトタイプ宣言 **/
+void Write_data(const Track_samples &truth, const Sensor_frame<float> &frame);
+void Gnuplot(const char filename[], const Track_samples &truth);
+
+/**************************************************************/
+// Function name : main
+// Description   : メインプログラム
+/**************************************************************/
+int main(int argc, char *argv[])
+{
+    /** 引数の読み取り **/
+    const char *trackfile = NULL;
+    unsigned long seed = (unsigned long)time(NULL); // 乱数の種 (既定は時刻)
+    bool clean = false;
+    bool graph = true;
+    int workers = thread::hardware_concurrency();
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-hz") == 0 && i + 1 < argc)
+        {
+            hz_imu = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-hz_gps") == 0 && i + 1 < argc)
+        {
+            hz_gps = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-seed") == 0 && i + 1 < argc)
+        {
+            seed = strtoul(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "-clean") == 0)
+        {
+            clean = true;
+        }
+        else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+        {
+            workers = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-no-graph") == 0)
+        {
+            graph = false;
+        }
+        else
+        {
+            trackfile = argv[i];
+        }
+    }
+    if (trackfile == NULL || hz_imu <= 0 || hz_gps <= 0)
+    {
+        printf("usage: %s <track file> [-hz hz] [-hz_gps hz] [-seed n] [-clean] [-j workers] [-no-graph]\n", argv[0]);
+        return 1;
+    }
+
+    /** コースの読み込み **/
+    Track track;
+    if (!Track_load(trackfile, track))
+    {
+        return 1;
+    }
+
+    Metrics_start("Simulation_track");
+
+    /** ディレクトリの作成 **/
+    const char dir_0[] = "Simulation";
+    const char dir_1[] = "Simulation/route";
+    const char dir_2[] = "Simulation/data";
+    const char dir_3[] = "Simulation/graph";
+    mkdir(dir_0, dir_mode);
+    mkdir(dir_1, dir_mode);
+    mkdir(dir_2, dir_mode);
+    mkdir(dir_3, dir_mode);
+
+    /** 真値の計算 **/
+    Metrics_timer timer_compute("compute");
+    Track_samples truth;
+    Track_generate(track, hz_imu, workers, truth);
+    const size_t n = truth.t.size();
+    timer_compute.Stop();
+    Metrics_add("samples", n);
+
+    /** 測定データ (車両座標系の符号は Simulation.cpp に合わせる) **/
+    Metrics_timer timer_error("error");
+    Sensor_frame<float> frame; // 測定データ
+    Sensor_frame_init(frame, n, hz_imu);
+    float *acc_xl = frame.Column(sensor_acc_x);
+    float *acc_yl = frame.Column(sensor_acc_y);
+    float *omegal = frame.Column(sensor_omega_z);
+    float *longitude = frame.Column(sensor_gps_x);
+    float *latitude = frame.Column(sensor_gps_y);
+    Aligned_vector<float> xw(n), yw(n);
+    for (size_t i = 0; i < n; i++)
+    {
+        acc_xl[i] = -truth.acc_long[i];
+        acc_yl[i] = truth.acc_lat[i];
+        omegal[i] = truth.yaw_rate[i];
+        xw[i] = truth.x[i];
+        yw[i] = truth.y[i];
+    }
+    const int interval = max(1, (int)lround(hz_imu / hz_gps)); // GPS の測定間隔 [サンプル]
+    if (clean)
+    {
+        for (size_t i = 0; i < n; i++)
+        {
+            longitude[i] = i % interval == 0 ? xw[i] : sensor_no_fix;
+            latitude[i] = i % interval == 0 ? yw[i] : sensor_no_fix;
+        }
+    }
+    else
+    {
+        Imu_error_channel err_xl, err_yl, err_omegal;
+        Gnss_error_state err_gps;
+        Imu_error_init(err_xl, mpu6050_acc_error, seed * 4 + 0);
+        Imu_error_init(err_yl, mpu6050_acc_error, seed * 4 + 1);
+        Imu_error_init(err_omegal, mpu6050_gyro_error, seed * 4 + 2);
+        Gnss_error_init(err_gps, zed_f9p_error, seed * 4 + 3);
+        Imu_error_apply(err_xl, acc_xl, n, 1.0 / hz_imu);
+        Imu_error_apply(err_yl, acc_yl, n, 1.0 / hz_imu);
+        Imu_error_apply(err_omegal, omegal, n, 1.0 / hz_imu);
+        Gnss_error_apply(err_gps, xw.data(), yw.data(), n, 1.0 / hz_imu, interval, sensor_no_fix, longitude, latitude);
+    }
+    timer_error.Stop();
+
+    /** 書き出し **/
+    Write_data(truth, frame);
+
+    /** グラフの作成 **/
+    if (graph)
+    {
+        char routefile[100];
+        sprintf(routefile, "Simulation/route/%d.dat", (int)n - 1);
+        Gnuplot(routefile, truth);
+    }
+
+    /** 概要 **/
+    double acc_lat_max = 0, yaw_rate_max = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        acc_lat_max = fmax(acc_lat_max, fabs(truth.acc_lat[i]));
+        yaw_rate_max = fmax(yaw_rate_max, fabs(truth.yaw_rate[i]));
+    }
+    printf("%s\tsegments = %zu\tlap = %.3f [m]\tlaps = %d\tdistance = %.3f [m]\tduration = %.3f [s]\tsamples = %zu\n", trackfile, track.segments.size(), track.length, track.laps, track.distance, track.duration, n);
+    printf("max |acc_lat| = %.3f [m/s2] (%.2f [g])\tmax |yaw rate| = %.3f [rad/s]\n", acc_lat_max, acc_lat_max / g, yaw_rate_max);
+
+    return 0;
+}
+
+/**************************************************************/
+// Function name : Write_data
+// Description   : 測定データ・真値・走行経路の書き出し
+/**************************************************************/
+void Write_data(const Track_samples &truth, const Sensor_frame<float> &frame)
+{
+    Metrics_timer timer_write("write");
+    const size_t n = truth.t.size();
+    const float *longitude = frame.Column(sensor_gps_x);
+    const float *latitude = frame.Column(sensor_gps_y);
+
+    /** 測定データ (Simulation.cpp と同じ 9列) **/
+    Write_sensor_frame("Simulation/data/data.dat", Sensor_frame_slice(frame, 0, n));
+
+    /** 真値 **/
+    fp = fopen("Simulation/data/truth.dat", "w");
+    fprintf(fp, "# t[s]\ts[m]\tx[m]\ty[m]\theading[rad]\tv[m/s]\tacc_long[m/s2]\tacc_lat[m/s2]\tyaw_rate[rad/s]\n");
+    for (size_t i = 0; i < n; i++)
+    {
+        fprintf(fp, "%.4f\t%.6f\t%.6f\t%.6f\t%.6f\t%.6f\t%.6f\t%.6f\t%.6f\n", truth.t[i], truth.s[i], truth.x[i], truth.y[i], truth.heading[i], truth.speed[i], truth.acc_long[i], truth.acc_lat[i], truth.yaw_rate[i]);
+    }
+    Metrics_fclose(fp);
+
+    /** 走行経路 (RMSE の基準に使う最後のファイルのみ) **/
+    char filename[100];
+    sprintf(filename, "Simulation/route/%d.dat", (int)n - 1);
+    fp = fopen(filename, "w");
+    for (size_t i = 0; i < n; i++)
+    {
+        const float t_tmp = i / hz_imu;
+        fprintf(fp, "%f\t%f\t%f\t%f\t%f\n", t_tmp, truth.x[i], truth.y[i], longitude[i], latitude[i]);
+    }
+    Metrics_fclose(fp);
+}
+
+/**************************************************************/
+// Function name : Gnuplot
+// Description   : 走行経路のグラフの作成
+/**************************************************************/
+void Gnuplot(const char filename[], const Track_samples &truth)
+{
+    FILE *gp;
+
+    /** Gnuplot 初期設定 (経路を囲む範囲) **/
+    double x_min = 0, x_max = 0, y_min = 0, y_max = 0;
+    for (size_t i = 0; i < truth.x.size(); i++)
+    {
+        x_min = fmin(x_min, truth.x[i]);
+        x_max = fmax(x_max, truth.x[i]);
+        y_min = fmin(y_min, truth.y[i]);
+        y_max = fmax(y_max, truth.y[i]);
+    }
+    const double margin = 5.0;
+
+    /** Gnuplot 呼び出し **/
+    Metrics_timer timer_plot("plot");
+    if ((gp = popen("gnuplot", "w")) == NULL)
+    {
+        printf("gnuplot is not here!\n");
+        exit(0); // gnuplotが無い場合、異常ある場合は終了
+    }
+
+    /** Gnuplot 描画設定 **/
+    fprintf(gp, "set terminal svg size 800, 800 font 'Times New Roman, 20'\n");
+    fprintf(gp, "set size ratio -1\n");
+    fprintf(gp, "set output 'Simulation/graph/track.svg'\n");                // 出力ファイル
+    fprintf(gp, "unset key\n");                                              // 凡例非表示
+    fprintf(gp, "set xrange [%.3f:%.3f]\n", x_min - margin, x_max + margin); // x軸の描画範囲
+    fprintf(gp, "set yrange [%.3f:%.3f]\n", y_min - margin, y_max + margin); // y軸の描画範囲
+    fprintf(gp, "set title 'Track Simulation'\n");                           // グラフタイトル
+    fprintf(gp, "set xlabel '{/Times-Italic x} [m]' offset 0.0, 0.0\n");     // x軸のラベル
+    fprintf(gp, "set ylabel '{/Times-Italic y} [m]' offset 1.0, 0.0\n");     // y軸のラベル
+    fprintf(gp, "set xtics autofreq offset 0.0, 0.0\n");                     // x軸の間隔
+    fprintf(gp, "set ytics autofreq offset 0.0, 0.0\n");                     // y軸の間隔
+
+    /** Gnuplot 書き出し (GPS の測定点は no_fix (-100) を除く) **/
+    fprintf(gp, "plot '%s' using 2:3 with lines lc 'grey50' notitle, '' using ($4 == -100 ? NaN : $4):5 with points lc 'royalblue' pt 7 ps 0.3 notitle\n", filename);
+
+    /** Gnuplot 終了 **/
+    fflush(gp);            // Clean up Data
+    fprintf(gp, "exit\n"); // Quit gnuplot
+    pclose(gp);
+    Metrics_add("frames", 1);
+}
@@ -2,8 +2,13 @@
 rm -r GNSS_position/
 
 # Estimate_positionの実行
-g++ cpp/GNSS_position.cpp -o "out/GNSS_position.out"
+g++ -O2 -std=c++17 -pthread cpp/GNSS_position.cpp -o "out/GNSS_position.out"
 ./out/GNSS_position.out
 
 # gifアニメーションの作成
 python3 py/gif_GNSS_position.py
+
+# 受信ログ (UBX / NMEA) を使う場合
+# g++ -O2 -std=c++17 -pthread cpp/GNSS_parse.cpp -o "out/GNSS_parse.out"
+# ./out/GNSS_parse.out GNSS_data/log.ubx GNSS_data/fix.dat   # 測位結果の一覧
+# ./out/GNSS_position.out GNSS_data/log.ubx                  # 受信ログから直接位置を計算
@@ -0,0 +1,92 @@
+/**************************************************************/
+// Program name : GNSS_parse
+// Author       : Masatsugu Kitadai
+// Date         : 2023/10/25
+// Description  : ZED-F9P の受信ログ (UBX / NMEA) から測位結果を抽出
+//
+//   ./out/GNSS_parse.out <受信ログ (- の場合は標準入力)> [出力ファイル]
+//   ファイルは mmap してそのまま解析し、標準入力 (パイプ・シリアル) は逐次解析する
+/**************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+#include "../../common/data_reader.h"
+#include "../../common/gnss_parser.h"
+#include "../../common/metrics.h"
+using namespace std;
+
+const int buffer_size = 1 << 16; // 標準入力の読み込みバッファ [byte]
+
+const char *source_name[] = {"UBX-NAV-PVT", "UBX-NAV-HPPOSLLH", "NMEA-GGA", "NMEA-RMC"};
+
+/**************************************************************/
+// Function name : main
+// Description   : メイン
+/**************************************************************/
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        printf("usage: %s <log.ubx|-> [output.dat]\n", argv[0]);
+        return 1;
+    }
+
+    Metrics_start("GNSS_parse");
+
+    FILE *fp = argc >= 3 ? fopen(argv[2], "w") : stdout;
+    if (fp == NULL)
+    {
+        printf("Cannot open: %s\n", argv[2]);
+        return 1;
+    }
+    fprintf(fp, "# itow[s]\tutc[s]\tlat[deg]\tlon[deg]\theight[m]\th_acc[m]\tv_acc[m]\tspeed[m/s]\theading[deg]\tfix\tcarrier\tsv\tvalid\tsource\n");
+
+    /** 測位結果の書き出し **/
+    Gnss_parser parser;
+    auto output = [&](const Gnss_fix &fix)
+    {
+        fprintf(fp, "%.3f\t%.3f\t%.9f\t%.9f\t%.4f\t%.4f\t%.4f\t%.3f\t%.2f\t%d\t%d\t%d\t%d\t%s\n",
+                fix.itow, fix.utc, fix.lat, fix.lon, fix.height, fix.h_acc, fix.v_acc, fix.speed, fix.heading,
+                fix.fix_type, fix.carrier, fix.satellites, fix.valid ? 1 : 0, source_name[fix.source]);
+    };
+
+    if (strcmp(argv[1], "-") == 0)
+    {
+        /** 標準入力の逐次解析 **/
+        vector<char> buf(buffer_size);
+        ssize_t n;
+        while ((n = read(STDIN_FILENO, buf.data(), buf.size())) > 0)
+        {
+            Metrics_add("bytes_read", n);
+            Metrics_timer timer("parse");
+            Gnss_parser_feed(parser, buf.data(), n, output);
+            fflush(fp);
+        }
+    }
+    else
+    {
+        /** ファイル全体を mmap して解析 **/
+        Mapped_file file;
+        if (!Map_file(argv[1], file))
+        {
+            return 1;
+        }
+        Metrics_timer timer("parse");
+        Gnss_parser_feed(parser, file.data, file.size, output);
+        Unmap_file(file);
+    }
+
+    if (fp != stdout)
+    {
+        Metrics_fclose(fp);
+    }
+
+    const Gnss_parser_stats &st = parser.stats;
+    Metrics_add("samples", st.fixes);
+    fprintf(stderr, "bytes = %ld\tUBX = %ld\tNMEA = %ld\tfixes = %ld\tchecksum errors = %ld\tskipped = %ld [byte]\n",
+            st.bytes, st.ubx, st.nmea, st.fixes, st.checksum_errors, st.skipped);
+
+    return 0;
+}
@@ -11,29 +11,55 @@
 #include <sys/stat.h>
 #include <vector>
 #include <algorithm>
+#include "../../common/gnuplot_pool.h"
+#include "../../common/data_reader.h"
+#include "../../common/geodesy.h"
+#include "../../common/gnss_parser.h"
+#include "../../common/simplify.h"
+#include "../../common/savgol.h"
+#include "../../common/resample.h"
+#include "../../common/metrics.h"
 using namespace std;
 FILE *fp;
 mode_t dir_mode = S_IRUSR | S_IWUSR | S_IXUSR | S_IRGRP | S_IWGRP | S_IXGRP | S_IROTH | S_IXOTH | S_IXOTH;
 
 /** パラメータ **/
-const float hz_gps = 1.0;       // サンプリング周期 [Hz]
-const float pi = 4 * atan(1.0); // 円周率 [rad]
+const double gap_factor = 1.5;     // 公称間隔のこの倍率を超える (1 / 倍率 未満の) 間隔を欠測 (不等間隔) とみなす [-]
+const float pi = 4 * atan(1.0);    // 円周率 [rad]
+const float route_tolerance = 1.0; // 描画用の走行経路の許容誤差 [m]
+const int savgol_half = 3;         // 速度計算の窓の半幅 (7点, 遅れ3サンプル) [-]
+const int savgol_order = 2;        // 速度計算の多項式の次数 [-]
 
 /** 変数宣言 **/
-vector<float> x;   // x方向位置 [m]
-vector<float> y;   // y方向位置 [m]
-vector<float> vx;  // x方向速度 [m/s]
-vector<float> vy;  // y方向速度 [m/s]
-vector<float> v;   // 合計速度 [m/s]
-vector<float> lng; // 経度情報 [-]
-vector<float> lat; // 緯度情報 [-]
+vector<double> t_fix;  // 最初の測位からの時刻 [s]
+double dt_fix = 1.0;   // 公称の測位間隔 (間隔の中央値) [s]
+vector<double> x;      // x方向位置 (東) [m]
+vector<double> y;      // y方向位置 (北) [m]
+vector<double> z;      // z方向位置 (上) [m]
+vector<float> vx;      // x方向速度 [m/s]
+vector<float> vy;      // y方向速度 [m/s]
+vector<float> v;       // 合計速度 [m/s]
+vector<float> ax;      // x方向加速度 [m/s2]
+vector<float> ay;      // y方向加速度 [m/s2]
+vector<double> lng;    // 経度情報 [deg]
+vector<double> lat;    // 緯度情報 [deg]
+vector<double> ecef_x; // ECEF X 座標 [m]
+vector<double> ecef_y; // ECEF Y 座標 [m]
+vector<double> ecef_z; // ECEF Z 座標 [m]
+
+Simplify_stream route_stream; // 走行経路の間引き
+vector<int> route_rows;       // 描画用の走行経路に残す点
 
 const char program_name[] = "GNSS position"; // プログラム名
 
 /** プロトタイプ宣言 **/
-int Estimate_position();
-void Distance(float lat1, float lng1, float lat2, float lng2, int n);
-void Velocity(int n, int max);
+int Estimate_position(const char *raw_log);
+int Read_raw_log(const char *filename);
+bool Read_gps_time(const char *filename, int skip, vector<double> &time);
+void Check_interval();
+bool Is_gap(size_t i);
+void Local_position();
+void Velocity();
 void Write_data(int num);
 void Gnuplot(int n);
 int Progress_meter(const char program_name[], int i, int max, int progress_count);
@@ -42,8 +68,10 @@ int Progress_meter(const char program_name[], int i, int max, int progress_count
 // Function name : main
 // Description   : メイン
 /**************************************************************/
-int main()
+int main(int argc, char *argv[])
 {
+    Metrics_start("GNSS_position");
+
     /** ディレクトリの作成 **/
     const char dir_0[] = "GNSS_position";
     const char dir_1[] = "GNSS_position/position";
@@ -58,15 +86,19 @@ int main()
     mkdir(dir_4, dir_mode);
 
     /* データの読み込み */
-    int data_length = Estimate_position();
+    Metrics_timer timer_read("read");
+    int data_length = Estimate_position(argc >= 2 ? argv[1] : NULL); // 引数で受信ログ (UBX / NMEA) を指定可能
+    timer_read.Stop();
+    Check_interval();
+    Metrics_add("samples", data_length);
 
     /* 最大＆最小値の取得 */
-    const float lat_start = lat[0];                             // 緯度の最大値 [-]
-    const float lng_start = lng[0];                             // 経度の最小値 [-]
-    const float lat_max = *max_element(lat.begin(), lat.end()); // 緯度の最大値 [-]
-    const float lat_min = *min_element(lat.begin(), lat.end()); // 緯度の最小値 [-]
-    const float lng_max = *max_element(lng.begin(), lng.end()); // 経度の最大値 [-]
-    const float lng_min = *min_element(lng.begin(), lng.end()); // 経度の最小値 [-]
+    const double lat_start = lat[0];                             // 緯度の最大値 [-]
+    const double lng_start = lng[0];                             // 経度の最小値 [-]
+    const double lat_max = *max_element(lat.begin(), lat.end()); // 緯度の最大値 [-]
+    const double lat_min = *min_element(lat.begin(), lat.end()); // 緯度の最小値 [-]
+    const double lng_max = *max_element(lng.begin(), lng.end()); // 経度の最大値 [-]
+    const double lng_min = *min_element(lng.begin(), lng.end()); // 経度の最小値 [-]
 
     // 書き出し
     const char area[] = "GNSS_position/area/area.dat";
@@ -74,22 +106,21 @@ int main()
     fprintf(fp, "%lf,%lf\n", lat_start, lng_start);
     fprintf(fp, "%lf,%lf\n", lat_min, lng_min);
     fprintf(fp, "%lf,%lf\n", lat_max, lng_max);
-    fclose(fp);
+    Metrics_fclose(fp);
 
     int progress_counter = 0; // 進捗表示用
 
     /* 平面座標系上の変位量計算 */
-    for (int i = 0; i < lat.size(); i++)
-    {
-        Distance(lat[0], lng[0], lat[i], lng[i], i);
-    }
+    Metrics_timer timer_compute("compute");
+    Local_position();
 
     /* 速度の計算 */
-    // for (int i = 0; i < lat.size() - 1; i++)
-    // {
-    //     Velocity(i, data_length);
-    // }
+    Velocity();
+    timer_compute.Stop();
 
+    Metrics_timer timer_write("write");
+    Simplify_stream_init(route_stream, route_tolerance);
+    Gnuplot_pool_start(); // 描画ワーカーの起動
     for (int i = 0; i < lat.size(); i++)
     {
         /* 進捗表示 */
@@ -100,6 +131,8 @@ int main()
             Gnuplot(i);
         }
     }
+    timer_write.Stop();
+    Gnuplot_pool_finish(); // 全フレームの描画完了を待機
 
     return 0;
 }
@@ -108,74 +141,306 @@ int main()
 // Function name : Estimate_position
 // Description   : 自己位置推定
 /**************************************************************/
-int Estimate_position()
+int Estimate_position(const char *raw_log)
 {
-    char str[300];   // 文字列用バッファ [-]
-    float tmp[8];    // 一時保存用バッファ [-]
-    int data_length; // データの長さ [-]
+    if (raw_log != NULL)
+    {
+        return Read_raw_log(raw_log);
+    }
 
     /** ファイルの読み込み **/
+    Data_table<double> table; // 読み込みデータ (Index, GPS time, Lat, Lon, X, Y, Z)
     char filename[] = "GNSS_data/test.csv";
-    fp = fopen(filename, "r");
-
-    // 読み飛ばし
     const int skip = 9; // 読み飛ばす行数
-    for (int i = 0; i < skip; i++)
+    if (!Read_table(filename, table, skip, 7))
     {
-        fgets(str, 256, fp);
+        exit(1);
     }
+    const int data_length = table.rows; // データの長さ [-]
 
-    // 読み込み
-    while ((fscanf(fp, "%f,%[^,],%f,%f,%f,%f,%f", &tmp[0], str, &tmp[1], &tmp[2], &tmp[3], &tmp[4], &tmp[5])) != EOF)
+    lat.assign(table.Column(2), table.Column(2) + data_length);
+    lng.assign(table.Column(3), table.Column(3) + data_length);
+    ecef_x.assign(table.Column(4), table.Column(4) + data_length);
+    ecef_y.assign(table.Column(5), table.Column(5) + data_length);
+    ecef_z.assign(table.Column(6), table.Column(6) + data_length);
+
+    /** 時刻 (GPS time 列 "週番号:週内時刻") **/
+    if (!Read_gps_time(filename, skip, t_fix) || (int)t_fix.size() != data_length)
     {
-        // printf("%.0f\t%f\t%f\n", tmp[0], tmp[1], tmp[2]);
-        lat.push_back(tmp[1]);
-        lng.push_back(tmp[2]);
-        data_length += 1;
+        printf("Cannot read GPS time: %s\n", filename);
+        exit(1);
     }
-    fclose(fp);
-
-    /** 位置の積算 **/
 
     return data_length;
 }
 
 /**************************************************************/
-// Function name : Distance
-// Description   : 距離計算
+// Function name : Read_gps_time
+// Description   : GPS time 列 (2列目, "wno:tow") の読み込み (最初の測位からの時刻 [s])
+//                 Read_table と同じく先頭の列が数値の行だけを対象にする
 /**************************************************************/
-void Distance(float lat1, float lng1, float lat2, float lng2, int n)
+bool Read_gps_time(const char *filename, int skip, vector<double> &time)
 {
-    // 緯度経度をラジアンに変換
-    const double rlat1 = lat1 * pi / 180; // 基準値　[rad]
-    const double rlng1 = lng1 * pi / 180; // 基準値　[rad]
-    const double rlat2 = lat2 * pi / 180; // 移動後の位置 [rad]
-    const double rlng2 = lng2 * pi / 180; // 移動後の位置 [rad]
-
-    // 地球赤道半径 [m]
-    const double earth_radius = 6378140;
-
-    // 地球上での位置の計算 [m]
-    const double earth_x0 = earth_radius * rlng1; // 基準点 (南北方向)
-    const double earth_y0 = earth_radius * rlat1; // 基準点 (東西方向)
-    const double earth_x1 = earth_radius * rlng2; // 基準点 (南北方向)
-    const double earth_y1 = earth_radius * rlat2; // 基準点 (東西方向)
-
-    // 2点間の距離(km)
-    x.push_back(earth_x1 - earth_x0);
-    y.push_back(earth_y1 - earth_y0);
+    Mapped_file file;
+    if (!Map_file(filename, file))
+    {
+        return false;
+    }
+
+    time.clear();
+    const char *p = file.data;
+    const char *end = file.data + file.size;
+    for (int line = 0; p < end; line++)
+    {
+        const char *nl = (const char *)memchr(p, '\n', end - p);
+        const char *line_end = nl != NULL ? nl : end;
+        double index;
+        const char *q = Parse_field(p, line_end, index);
+        if (line >= skip && !isnan(index))
+        {
+            /** 週番号と週内時刻 **/
+            double wno = NAN, tow = NAN;
+            const char *colon = (const char *)memchr(q, ':', line_end - q);
+            if (colon != NULL)
+            {
+                std::from_chars(q, colon, wno);
+                std::from_chars(colon + 1, line_end, tow);
+            }
+            time.push_back(wno * gnss_week + tow);
+        }
+        p = nl != NULL ? nl + 1 : end;
+    }
+    Unmap_file(file);
+
+    for (size_t i = time.size(); i-- > 0;)
+    {
+        if (isnan(time[i]))
+        {
+            return false;
+        }
+        time[i] -= time[0];
+    }
+    return true;
 }
 
 /**************************************************************/
-// Function name : Speed
-// Description   : 速度計算
+// Function name : Read_raw_log
+// Description   : 受信ログ (UBX / NMEA) の読み込み
+//                 UBX と NMEA の時刻を iTOW にそろえて時刻順に並べ、同じエポックに複数のメッセージがある場合は
+//                 HPPOSLLH > NAV-PVT > GGA > RMC の順に優先 (同じ種類は後のもの)
 /**************************************************************/
-void Velocity(int n, int max)
+int Read_raw_log(const char *filename)
 {
-    // 各方向からの速度
-    vx[n] = (x[n + 1] - x[n]) / hz_gps * 3600 / 1000; // x方向速度 [km/h]
-    vy[n] = (y[n + 1] - y[n]) / hz_gps * 3600 / 1000; // y方向速度 [km/h]
-    v[n] = sqrt(vx[n] * vx[n] + vy[n] * vy[n]);
+    Mapped_file file;
+    if (!Map_file(filename, file))
+    {
+        exit(1);
+    }
+
+    /** 有効な測位結果の収集と GPS - UTC の差の取得 **/
+    vector<Gnss_fix> fixes;
+    Gnss_time_base base;
+    Gnss_parser parser;
+    auto output = [&](const Gnss_fix &fix)
+    {
+        if (fix.valid)
+        {
+            fixes.push_back(fix);
+            Gnss_time_learn(base, fix);
+        }
+    };
+    Gnss_parser_feed(parser, file.data, file.size, output);
+    Unmap_file(file);
+
+    /** 共通の時刻 (UBX を含む場合は iTOW, NMEA のみの場合は UTC, 週・日の繰り越しを連続化) **/
+    const bool use_itow = !isnan(base.leap);
+    const double period = use_itow ? gnss_week : gnss_day;
+    vector<double> key(fixes.size());
+    double carry = 0, last = NAN;
+    long untimed = 0; // 時刻を決められない測位結果 [-]
+    for (size_t i = 0; i < fixes.size(); i++)
+    {
+        const double tk = use_itow ? Gnss_fix_time(base, fixes[i]) : fixes[i].utc;
+        if (isnan(tk))
+        {
+            key[i] = NAN;
+            untimed += 1;
+            continue;
+        }
+        if (!isnan(last) && tk + carry < last - period / 2)
+        {
+            carry += period;
+        }
+        key[i] = tk + carry;
+        last = key[i];
+    }
+
+    /** 時刻順に並べ、同じエポック (1 [ms] 以内) は精度の高いメッセージを採用 **/
+    const int rank[] = {2, 3, 1, 0}; // PVT, HPPOSLLH, GGA, RMC の優先度
+    vector<size_t> order;
+    for (size_t i = 0; i < fixes.size(); i++)
+    {
+        if (!isnan(key[i]))
+        {
+            order.push_back(i);
+        }
+    }
+    stable_sort(order.begin(), order.end(), [&](size_t a, size_t b)
+                { return key[a] < key[b]; });
+    vector<double> epoch;
+    vector<size_t> chosen;
+    for (size_t k : order)
+    {
+        if (!epoch.empty() && llround(key[k] * 1000.0) == llround(epoch.back() * 1000.0))
+        {
+            if (rank[fixes[k].source] >= rank[fixes[chosen.back()].source])
+            {
+                chosen.back() = k;
+            }
+            continue;
+        }
+        epoch.push_back(key[k]);
+        chosen.push_back(k);
+    }
+
+    for (size_t e = 0; e < chosen.size(); e++)
+    {
+        const Gnss_fix &fix = fixes[chosen[e]];
+        double ex, ey, ez;
+        Geodetic_to_ecef(fix.lat, fix.lon, isnan(fix.height) ? 0.0 : fix.height, ex, ey, ez);
+        t_fix.push_back(epoch[e] - epoch[0]);
+        lat.push_back(fix.lat);
+        lng.push_back(fix.lon);
+        ecef_x.push_back(ex);
+        ecef_y.push_back(ey);
+        ecef_z.push_back(ez);
+    }
+
+    const Gnss_parser_stats &st = parser.stats;
+    printf("UBX = %ld\tNMEA = %ld\tchecksum errors = %ld\tfixes = %ld\tepochs = %ld\tuntimed = %ld\ttime = %s\n",
+           st.ubx, st.nmea, st.checksum_errors, (long)fixes.size(), (long)lat.size(), untimed, use_itow ? "iTOW" : "UTC");
+    if (lat.empty())
+    {
+        printf("No valid fix: %s\n", filename);
+        exit(1);
+    }
+
+    return lat.size();
+}
+
+/**************************************************************/
+// Function name : Check_interval
+// Description   : 公称の測位間隔 (中央値) の推定と、欠測・不等間隔の区間の報告
+/**************************************************************/
+void Check_interval()
+{
+    const size_t n = t_fix.size();
+    const double dt = Resample_nominal_interval(t_fix.data(), n);
+    dt_fix = dt > 0 ? dt : 1.0;
+
+    long outages = 0, irregular = 0; // 欠測区間・不等間隔の数 [-]
+    double missing = 0;              // 欠測区間の合計時間 [s]
+    for (size_t i = 1; i < n; i++)
+    {
+        if (Is_gap(i))
+        {
+            const double d = t_fix[i] - t_fix[i - 1];
+            if (d > dt_fix)
+            {
+                outages += 1;
+                missing += d - dt_fix;
+            }
+            else
+            {
+                irregular += 1;
+            }
+        }
+    }
+    printf("rate = %.3f [Hz]\tduration = %.3f [s]\toutages = %ld (%.3f [s])\tirregular = %ld\n",
+           1.0 / dt_fix, n > 0 ? t_fix[n - 1] : 0.0, outages, missing, irregular);
+}
+
+/**************************************************************/
+// Function name : Is_gap
+// Description   : i-1 番目から i 番目の間隔が公称間隔から外れているか (速度の計算を区切る)
+/**************************************************************/
+bool Is_gap(size_t i)
+{
+    const double d = t_fix[i] - t_fix[i - 1];
+    return d > gap_factor * dt_fix || d < dt_fix / gap_factor;
+}
+
+/**************************************************************/
+// Function name : Local_position
+// Description   : 最初の測位点を基準とした局所座標 (東: x, 北: y) への一括変換
+/**************************************************************/
+void Local_position()
+{
+    const size_t n = lat.size();
+    x.resize(n);
+    y.resize(n);
+    z.resize(n);
+
+    /** ECEF 座標がある場合は高さを含めて変換 **/
+    bool has_ecef = !ecef_x.empty();
+    for (size_t i = 0; i < ecef_x.size() && has_ecef; i++)
+    {
+        has_ecef = !isnan(ecef_x[i]) && !isnan(ecef_y[i]) && !isnan(ecef_z[i]);
+    }
+
+    Enu_reference ref; // 基準点
+    if (has_ecef)
+    {
+        Enu_reference_init_ecef(ref, ecef_x[0], ecef_y[0], ecef_z[0]);
+        Ecef_to_enu_batch(ref, ecef_x.data(), ecef_y.data(), ecef_z.data(), n, x.data(), y.data(), z.data());
+    }
+    else
+    {
+        Enu_reference_init(ref, lat[0], lng[0], 0.0);
+        Geodetic_to_enu_batch(ref, lat.data(), lng.data(), NULL, n, x.data(), y.data(), z.data());
+    }
+}
+
+/**************************************************************/
+// Function name : Velocity
+// Description   : 速度・加速度の計算 (Savitzky-Golay フィルタで x, y, z をまとめて微分)
+//                 フィルタは等間隔 (公称間隔) を仮定するため、欠測・不等間隔の位置で区切って区間ごとに計算する
+/**************************************************************/
+void Velocity()
+{
+    const size_t n = x.size();
+    vx.assign(n, 0);
+    vy.assign(n, 0);
+    v.assign(n, 0);
+    ax.assign(n, 0);
+    ay.assign(n, 0);
+
+    Savgol_filter filter;
+    size_t begin = 0; // 区間の先頭
+    auto output = [&](long k, const double *, const double *velocity, const double *acceleration)
+    {
+        const size_t i = begin + k;
+        vx[i] = velocity[0];
+        vy[i] = velocity[1];
+        v[i] = sqrt(velocity[0] * velocity[0] + velocity[1] * velocity[1] + velocity[2] * velocity[2]);
+        ax[i] = acceleration[0];
+        ay[i] = acceleration[1];
+    };
+    for (size_t end = 1; end <= n; end++)
+    {
+        if (end < n && !Is_gap(end))
+        {
+            continue;
+        }
+        Savgol_init(filter, savgol_half, savgol_order, 3, dt_fix);
+        for (size_t i = begin; i < end; i++)
+        {
+            const double p[3] = {x[i], y[i], z[i]};
+            Savgol_push(filter, p, output);
+        }
+        Savgol_flush(filter, output);
+        begin = end;
+    }
 }
 
 /**************************************************************/
@@ -184,25 +449,48 @@ void Velocity(int n, int max)
 /**************************************************************/
 void Write_data(int n)
 {
-    const float t = n / hz_gps;
+    const float t = t_fix[n];
 
     /** 走行位置の書き出し **/
     char filename[100];
     sprintf(filename, "GNSS_position/position/%d.dat", n);
     fp = fopen(filename, "w");
-    // fprintf(fp, "%f\t%f\t%f\t%f\t%f\t%f\n", t, x[n], y[n], vx[n], vy[n], v[n]);
-    fprintf(fp, "%f\t%f\t%f\n", t, x[n], y[n]);
-    fclose(fp);
+    fprintf(fp, "%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f\n", t, x[n], y[n], vx[n], vy[n], v[n], ax[n], ay[n]);
+    Metrics_fclose(fp);
+
+    /** 走行経路の書き出し (描画用は許容誤差以内で間引き、最後のファイルは全点) **/
+    auto add = [&](long i)
+    {
+        route_rows.push_back(i);
+    };
+    Simplify_push(route_stream, n, x[n], y[n], add);
+
+    auto write_row = [&](int i)
+    {
+        fprintf(fp, "%f\t%f\t%f\n", t_fix[i], x[i], y[i]);
+    };
 
-    /** 走行経路の書き出し **/
     sprintf(filename, "GNSS_position/route/%d.dat", n);
     fp = fopen(filename, "w");
-    for (int i = 0; i <= n; i++)
+    if (n == (int)x.size() - 1)
+    {
+        for (int i = 0; i <= n; i++)
+        {
+            write_row(i);
+        }
+    }
+    else
     {
-        float t_tmp = i / hz_gps;
-        fprintf(fp, "%f\t%f\t%f\n", t_tmp, x[i], y[i]);
+        for (size_t k = 0; k < route_rows.size(); k++)
+        {
+            write_row(route_rows[k]);
+        }
+        if (route_rows.back() != n)
+        {
+            write_row(n); // 未確定の現在位置
+        }
     }
-    fclose(fp);
+    Metrics_fclose(fp);
 }
 
 /**************************************************************/
@@ -211,10 +499,10 @@ void Write_data(int n)
 /**************************************************************/
 void Gnuplot(int n)
 {
-    FILE *gp;
+    string script; // 描画スクリプト
 
     /** Gnuplot 初期設定 **/
-    const float t = n / hz_gps;
+    const float t = t_fix[n];
     const float x_max = 0;
     const float x_min = -5000;
     const float y_max = 4000;
@@ -226,33 +514,24 @@ void Gnuplot(int n)
     sprintf(filename_2, "GNSS_position/route/%d.dat", n);
     sprintf(graphname, "GNSS_position/graph/%04d.png", n);
 
-    /** Gnuplot 呼び出し **/
-    if ((gp = popen("gnuplot", "w")) == NULL)
-    {
-        printf("gnuplot is not here!\n");
-        exit(0); // gnuplotが無い場合、異常ある場合は終了
-    }
-
     /** Gnuplot 描画設定 **/
-    fprintf(gp, "set terminal png size 600, 600 font 'Times New Roman, 20'\n");
-    fprintf(gp, "set size ratio -1\n");
-    fprintf(gp, "set output '%s'\n", graphname);                                                 // 出力ファイル
-    fprintf(gp, "unset key\n");                                                                  // 凡例非表示
-    fprintf(gp, "set xrange [%.3f:%.3f]\n", x_min, x_max);                                       // x軸の描画範囲
-    fprintf(gp, "set yrange [%.3f:%.3f]\n", y_min, y_max);                                       // y軸の描画範囲
-    fprintf(gp, "set title 'GNSS Position : {/Times-Italic t} = %01.3f [s]'\n", t);              // グラフタイトル
-    fprintf(gp, "set xlabel 'East-West direction : {/Times-Italic x} [m]' offset 0.0, 0.0\n");   // x軸のラベル
-    fprintf(gp, "set ylabel 'North-South direction : {/Times-Italic y} [m]' offset 1.0, 0.0\n"); // y軸のラベル
-    fprintf(gp, "set xtics 1000.0 offset 0.0, 0.0\n");                                           // x軸の間隔
-    fprintf(gp, "set ytics 1000.0 offset 0.0, 0.0\n");                                           // y軸の間隔
+    Gnuplot_printf(script, "set terminal png size 600, 600 font 'Times New Roman, 20'\n");
+    Gnuplot_printf(script, "set size ratio -1\n");
+    Gnuplot_printf(script, "set output '%s'\n", graphname);                                                 // 出力ファイル
+    Gnuplot_printf(script, "unset key\n");                                                                  // 凡例非表示
+    Gnuplot_printf(script, "set xrange [%.3f:%.3f]\n", x_min, x_max);                                       // x軸の描画範囲
+    Gnuplot_printf(script, "set yrange [%.3f:%.3f]\n", y_min, y_max);                                       // y軸の描画範囲
+    Gnuplot_printf(script, "set title 'GNSS Position : {/Times-Italic t} = %01.3f [s]'\n", t);              // グラフタイトル
+    Gnuplot_printf(script, "set xlabel 'East-West direction : {/Times-Italic x} [m]' offset 0.0, 0.0\n");   // x軸のラベル
+    Gnuplot_printf(script, "set ylabel 'North-South direction : {/Times-Italic y} [m]' offset 1.0, 0.0\n"); // y軸のラベル
+    Gnuplot_printf(script, "set xtics 1000.0 offset 0.0, 0.0\n");                                           // x軸の間隔
+    Gnuplot_printf(script, "set ytics 1000.0 offset 0.0, 0.0\n");                                           // y軸の間隔
 
     /** Gnuplot 書き出し **/
-    fprintf(gp, "plot '%s' using 2:3 with lines lw 2 lc 'grey50' notitle, '%s' using 2:3 with points lc 'black' ps 2.0 pt 7 notitle\n", filename_2, filename_1);
+    Gnuplot_printf(script, "plot '%s' using 2:3 with lines lw 2 lc 'grey50' notitle, '%s' using 2:3 with points lc 'black' ps 2.0 pt 7 notitle\n", filename_2, filename_1);
 
-    /** Gnuplot 終了 **/
-    fflush(gp);            // Clean up Data
-    fprintf(gp, "exit\n"); // Quit gnuplot
-    pclose(gp);
+    /** 描画ワーカーへ投入 **/
+    Gnuplot_submit(script);
 }
 
 /******************************************************************************
@@ -1,8 +1,8 @@
-g++ cpp/DFT.cpp -o "out/DFT.out"
+g++ -O2 -std=c++17 -pthread cpp/DFT.cpp -o "out/DFT.out"
 ./out/DFT.out
 
-g++ cpp/bandpass_filter.cpp -o "out/bandpass_filter.out"
+g++ -O2 -std=c++17 -pthread cpp/bandpass_filter.cpp -o "out/bandpass_filter.out"
 ./out/bandpass_filter.out
 
-g++ cpp/IDFT.cpp -o "out/IDFT.out"
+g++ -O2 -std=c++17 -pthread cpp/IDFT.cpp -o "out/IDFT.out"
 ./out/IDFT.out
\ No newline at end of file
@@ -11,6 +11,8 @@
 #include <sys/stat.h>
 #include <time.h>
 #include <vector>
+#include "../../common/data_reader.h"
+#include "../../common/metrics.h"
 using namespace std;
 FILE *fp;
 mode_t dir_mode = S_IRUSR | S_IWUSR | S_IXUSR | S_IRGRP | S_IWGRP | S_IXGRP | S_IROTH | S_IXOTH | S_IXOTH;
@@ -38,6 +40,8 @@ void Gnuplot_DFT(const char filename[], const char graphname[], const char title
 /**************************************************************/
 int main()
 {
+    Metrics_start("DFT");
+
     /** ディレクトリの作成 **/
     const char dir_0[] = "DFT";
     const char dir_1[] = "DFT/data";
@@ -63,29 +67,28 @@ int main()
 /**************************************************************/
 void DFT(const char readfile[], const char writefile[])
 {
-    vector<float> t;
-    vector<float> f;
     vector<float> re;
     vector<float> im;
     vector<float> spectrum;
 
     /** ファイルの読み込み **/
-    float t_tmp, f_tmp;
-    fp = fopen(readfile, "r");
-    while ((fscanf(fp, "%f,%f", &t_tmp, &f_tmp)) != EOF)
+    Metrics_timer timer_read("read");
+    Data_table<float> table; // 読み込みデータ (時刻, 値)
+    if (!Read_table(readfile, table, 0, 2))
     {
-        t.push_back(t_tmp);
-        f.push_back(f_tmp);
+        exit(1);
     }
-    fclose(fp);
+    timer_read.Stop();
+    const float *f = table.Column(1); // 値
+    const int n = table.rows;         // データの長さ [-]
 
     /** 実数部分と虚数部分に分けてフーリエ変換 **/
-    const int n = f.size();
-    for (int i = 0; i < f.size(); i++)
+    Metrics_timer timer_compute("compute");
+    for (int i = 0; i < n; i++)
     {
         float re_tmp = 0;
         float im_tmp = 0;
-        for (int j = 0; j < f.size(); j++)
+        for (int j = 0; j < n; j++)
         {
             re_tmp += f[j] * cos(2.0 * pi * j * i / n);
             im_tmp += -f[j] * sin(2.0 * pi * j * i / n);
@@ -95,14 +98,17 @@ void DFT(const char readfile[], const char writefile[])
         im.push_back(im_tmp);
         spectrum.push_back(spectrum_tmp);
     }
+    timer_compute.Stop();
+    Metrics_add("samples", n);
 
     /** データの書き出し **/
+    Metrics_timer timer_write("write");
     fp = fopen(writefile, "w");
-    for (int i = 0; i < f.size(); i++)
+    for (int i = 0; i < n; i++)
     {
         fprintf(fp, "%f\t%f\t%f\t%f\n", (float)i, spectrum[i], re[i], im[i]);
     }
-    fclose(fp);
+    Metrics_fclose(fp);
 }
 
 /**************************************************************/
@@ -120,6 +126,7 @@ void Gnuplot_DFT(const char filename[], const char graphname[], const char title
     const float y_min = 0;
 
     /** Gnuplot 呼び出し **/
+    Metrics_timer timer_plot("plot");
     if ((gp = popen("gnuplot", "w")) == NULL)
     {
         printf("gnuplot is not here!\n");
@@ -146,4 +153,5 @@ void Gnuplot_DFT(const char filename[], const char graphname[], const char title
     fflush(gp);            // Clean up Data
     fprintf(gp, "exit\n"); // Quit gnuplot
     pclose(gp);
+    Metrics_add("frames", 1);
 }
\ No newline at end of file
@@ -11,6 +11,8 @@
 #include <sys/stat.h>
 #include <time.h>
 #include <vector>
+#include "../../common/data_reader.h"
+#include "../../common/metrics.h"
 using namespace std;
 FILE *fp;
 mode_t dir_mode = S_IRUSR | S_IWUSR | S_IXUSR | S_IRGRP | S_IWGRP | S_IXGRP | S_IROTH | S_IXOTH | S_IXOTH;
@@ -33,6 +35,8 @@ void Gnuplot_DFT(const char filename[], const char filename_2[], const char grap
 /**************************************************************/
 int main()
 {
+    Metrics_start("IDFT");
+
     /** ディレクトリの作成 **/
     const char dir_0[] = "IDFT";
     const char dir_1[] = "IDFT/data";
@@ -59,35 +63,31 @@ int main()
 /**************************************************************/
 void IDFT(const char readfile[], const char writefile[])
 {
-    vector<float> hz_dft;
-    vector<float> re;
-    vector<float> im;
-    vector<float> spectrum;
-
     vector<float> re2;
     vector<float> im2;
     vector<float> f;
 
     /** ファイルの読み込み **/
-    float hz_tmp, spectrum_tmp, re_tmp, im_tmp;
-    fp = fopen(readfile, "r");
-    while (fscanf(fp, "%f\t%f\t%f\t%f\n", &hz_tmp, &spectrum_tmp, &re_tmp, &im_tmp) != EOF)
+    Metrics_timer timer_read("read");
+    Data_table<float> table; // 読み込みデータ (周波数, 振幅スペクトル, 実部, 虚部)
+    if (!Read_table(readfile, table, 0, 4))
     {
-        hz_dft.push_back(hz_tmp);
-        spectrum.push_back(spectrum_tmp);
-        re.push_back(re_tmp);
-        im.push_back(im_tmp);
+        exit(1);
     }
-    fclose(fp);
+    timer_read.Stop();
+    const float *re = table.Column(2); // 実部
+    const float *im = table.Column(3); // 虚部
+    const int n = table.rows;          // データの長さ [-]
+    float re_tmp, im_tmp;
 
     /** 実数部分と虚数部分に分けてフーリエ変換 **/
-    int n = spectrum.size();
-    for (int i = 0; i < spectrum.size(); i++)
+    Metrics_timer timer_compute("compute");
+    for (int i = 0; i < n; i++)
     {
         re_tmp = 0;
         im_tmp = 0;
 
-        for (int j = 0; j < spectrum.size(); j++)
+        for (int j = 0; j < n; j++)
         {
             re_tmp += re[j] * cos(2.0 * pi * j * i / n) - im[j] * sin(2.0 * pi * j * i / n);
             im_tmp += re[j] * sin(2.0 * pi * j * i / n) + im[j] * sin(2.0 * pi * j * i / n);
@@ -98,14 +98,17 @@ void IDFT(const char readfile[], const char writefile[])
         // im2.push_back(im_tmp);
         // spectrum.push_back(spectrum_tmp);
     }
+    timer_compute.Stop();
+    Metrics_add("samples", n);
 
     /** データの書き出し **/
+    Metrics_timer timer_write("write");
     fp = fopen(writefile, "w");
-    for (int i = 0; i < spectrum.size(); i++)
+    for (int i = 0; i < n; i++)
     {
         fprintf(fp, "%f\t%f\n", (float)(1.0 / hz) * i, f[i]);
     }
-    fclose(fp);
+    Metrics_fclose(fp);
 }
 
 /**************************************************************/
@@ -123,6 +126,7 @@ void Gnuplot_DFT(const char filename[], const char filename_2[], const char grap
     const float y_min = 0.0;
 
     /** Gnuplot 呼び出し **/
+    Metrics_timer timer_plot("plot");
     if ((gp = popen("gnuplot", "w")) == NULL)
     {
         printf("gnuplot is not here!\n");
@@ -149,4 +153,5 @@ void Gnuplot_DFT(const char filename[], const char filename_2[], const char grap
     fflush(gp);            // Clean up Data
     fprintf(gp, "exit\n"); // Quit gnuplot
     pclose(gp);
+    Metrics_add("frames", 1);
 }
\ No newline at end of file
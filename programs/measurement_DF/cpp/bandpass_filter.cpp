@@ -11,6 +11,8 @@
 #include <sys/stat.h>
 #include <time.h>
 #include <vector>
+#include "../../common/data_reader.h"
+#include "../../common/metrics.h"
 using namespace std;
 FILE *fp;
 mode_t dir_mode = S_IRUSR | S_IWUSR | S_IXUSR | S_IRGRP | S_IWGRP | S_IXGRP | S_IROTH | S_IXOTH | S_IXOTH;
@@ -34,6 +36,8 @@ void Gnuplot_DFT(const char filename[], const char graphname[], const char title
 /**************************************************************/
 int main()
 {
+    Metrics_start("bandpass_filter");
+
     /** ディレクトリの作成 **/
     const char dir_0[] = "Bandpass";
     const char dir_1[] = "Bandpass/data";
@@ -59,25 +63,23 @@ int main()
 /**************************************************************/
 void Bandpass_Filter(const char readfile[], const char writefile[])
 {
-    vector<float> hz_dft;
-    vector<float> spectrum;
-    vector<float> re;
-    vector<float> im;
-
     /** ファイルの読み込み **/
-    float hz_tmp, spectrum_tmp, re_tmp, im_tmp;
-    fp = fopen(readfile, "r");
-    while ((fscanf(fp, "%f\t%f\t%f\t%f", &hz_tmp, &spectrum_tmp, &re_tmp, &im_tmp)) != EOF)
+    Metrics_timer timer_read("read");
+    Data_table<float> table; // 読み込みデータ (周波数, 振幅スペクトル, 実部, 虚部)
+    if (!Read_table(readfile, table, 0, 4))
     {
-        hz_dft.push_back(hz_tmp);
-        spectrum.push_back(spectrum_tmp);
-        re.push_back(re_tmp);
-        im.push_back(im_tmp);
+        exit(1);
     }
-    fclose(fp);
+    timer_read.Stop();
+    const float *hz_dft = table.Column(0); // 周波数 [Hz]
+    float *spectrum = table.Column(1);     // 振幅スペクトル
+    float *re = table.Column(2);           // 実部
+    float *im = table.Column(3);           // 虚部
+    const int n = table.rows;              // データの長さ [-]
 
     /** バンドパスフィルタの適用 **/
-    for (int i = 0; i < hz_dft.size(); i++)
+    Metrics_timer timer_compute("compute");
+    for (int i = 0; i < n; i++)
     {
         if (upper_threshold > hz_dft[i] || hz_dft[i] > lower_threshold)
         {
@@ -86,14 +88,17 @@ void Bandpass_Filter(const char readfile[], const char writefile[])
             im[i] = 0;
         }
     }
+    timer_compute.Stop();
+    Metrics_add("samples", n);
 
     /** データの書き出し **/
+    Metrics_timer timer_write("write");
     fp = fopen(writefile, "w");
-    for (int i = 0; i < spectrum.size(); i++)
+    for (int i = 0; i < n; i++)
     {
         fprintf(fp, "%f\t%f\t%f\t%f\n", hz_dft[i], spectrum[i], re[i], im[i]);
     }
-    fclose(fp);
+    Metrics_fclose(fp);
 }
 
 /**************************************************************/
@@ -111,6 +116,7 @@ void Gnuplot_DFT(const char filename[], const char graphname[], const char title
     const float y_min = 0;
 
     /** Gnuplot 呼び出し **/
+    Metrics_timer timer_plot("plot");
     if ((gp = popen("gnuplot", "w")) == NULL)
     {
         printf("gnuplot is not here!\n");
@@ -135,4 +141,5 @@ void Gnuplot_DFT(const char filename[], const char graphname[], const char title
     fflush(gp);            // Clean up Data
     fprintf(gp, "exit\n"); // Quit gnuplot
     pclose(gp);
+    Metrics_add("frames", 1);
 }
@@ -1,11 +1,13 @@
-g++ cpp/noise_simulation.cpp -o "out/noise_simulation.out"
+g++ -O2 -std=c++17 -pthread cpp/noise_simulation.cpp -o "out/noise_simulation.out"
 ./out/noise_simulation.out
+# 成分を指定する場合 (例 : 複数の正弦波 + チャープ + ピンク雑音 + 外れ値, 10 [s])
+# ./out/noise_simulation.out -t 10 multitone:0.5,5,10,4 chirp:0.5,1,100,1 pink:0.2 impulse:3,2
 
-g++ cpp/DFT.cpp -o "out/DFT.out"
+g++ -O2 -std=c++17 -pthread cpp/DFT.cpp -o "out/DFT.out"
 ./out/DFT.out
 
-g++ cpp/IDFT.cpp -o "out/IDFT.out"
+g++ -O2 -std=c++17 -pthread cpp/IDFT.cpp -o "out/IDFT.out"
 ./out/IDFT.out
 
-g++ cpp/bandpass_filter.cpp -o "out/bandpass_filter.out"
+g++ -O2 -std=c++17 -pthread cpp/bandpass_filter.cpp -o "out/bandpass_filter.out"
 ./out/bandpass_filter.out
\ No newline at end of file
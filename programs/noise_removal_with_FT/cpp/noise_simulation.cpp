@@ -1,49 +1,93 @@
 /**************************************************************/
-// Program name : Skidpad_simulation
+// Program name : Noise_simulation
 // Author       : Masatsugu Kitadai
 // Date         : 2023/4/22
-// Description  :
+// Description  : 試験信号 (基本データ・ノイズデータ) の作成
+//
+//   ./out/noise_simulation.out [-t 計測時間 [s]] [-hz サンプリング周波数 [Hz]] [-seed 乱数の種] [-no-graph] [成分...]
+//     成分の書式は common/signal_generator.h を参照 (例 : tone:1,10 chirp:0.5,1,100,1 pink:0.2 impulse:5,2)
+//     成分を指定しない場合は tone:1,10 white:0.5 (10 [Hz] の正弦波 + 標準偏差 0.5 の白色雑音)
+//     基本データ (Simulation/data/basic_data.dat) は乱数を使わない成分の和、
+//     ノイズデータ (Simulation/data/noise_data.dat) は全成分の和
+//     ブロック単位で生成しながら書き出すため、計測時間の長さに制限はない
 /**************************************************************/
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 #include <sys/stat.h>
 #include <time.h>
 #include <vector>
+#include "../../common/signal_generator.h"
+#include "../../common/metrics.h"
 using namespace std;
-FILE *fp;
 mode_t dir_mode = S_IRUSR | S_IWUSR | S_IXUSR | S_IRGRP | S_IWGRP | S_IXGRP | S_IROTH | S_IXOTH | S_IXOTH;
 
-/** 物理法則 **/
-const float pi = 4 * atan(1.0); // 円周率 [rad]
-const float g = 9.80665;        // 重力加速度 [m/s2]
-
-/** 各種パラメータ **/
-const float t = 1.0;          // 計測時刻 [s]
-const int hz = 1000;          // サンプリング周波数 [Hz]
-const int hz_sin = 10.0;      // 正弦波の周期 [Hz]
-const float wave_value = 1.0; // 正弦波の大きさ [-]
-const float err_value = 0.5;  // エラーの大きさ [-]
-
-/** グローバル変数 **/
-vector<float> data(t *hz);  // 基本データ
-vector<float> err_1(t *hz); // 乱数配列
-vector<float> err_2(t *hz); // 乱数配列
+/** 各種パラメータ (引数で変更) **/
+double t = 1.0;   // 計測時刻 [s]
+double hz = 1000; // サンプリング周波数 [Hz]
 
 /** プロトタイプ宣言 **/
-void Sin_wave(vector<float> &data);
-void Random_number(vector<float> &err);
-void Box_Mullers_method(vector<float> &x1, vector<float> &x2);
-void Write_data(const char filename[]);
+void Write_data(Signal_generator &gen, const char basic_file[], const char noise_file[]);
 void Gnuplot_noise(const char filename[], const char graphname[], const char title[]);
 
 /**************************************************************/
 // Function name : main
 // Description   : メインプログラム
 /**************************************************************/
-int main()
+int main(int argc, char *argv[])
 {
+    /** 引数の読み取り **/
+    unsigned long seed = (unsigned long)time(NULL); // シード値 (既定は時刻)
+    bool graph = true;
+    vector<const char *> specs;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+        {
+            t = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-hz") == 0 && i + 1 < argc)
+        {
+            hz = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-seed") == 0 && i + 1 < argc)
+        {
+            seed = strtoul(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "-no-graph") == 0)
+        {
+            graph = false;
+        }
+        else
+        {
+            specs.push_back(argv[i]);
+        }
+    }
+    if (specs.empty())
+    {
+        specs = {"tone:1,10", "white:0.5"};
+    }
+    if (t <= 0 || hz <= 0)
+    {
+        printf("-t and -hz must be > 0\n");
+        return 1;
+    }
+
+    /** 信号の成分 **/
+    Signal_generator gen;
+    Signal_init(gen, hz, seed);
+    for (const char *spec : specs)
+    {
+        if (!Signal_add(gen, spec))
+        {
+            return 1;
+        }
+    }
+
+    Metrics_start("noise_simulation");
+
     /** ディレクトリの作成 **/
     const char dir_0[] = "Simulation";
     const char dir_1[] = "Simulation/data";
@@ -52,112 +96,57 @@ int main()
     mkdir(dir_1, dir_mode);
     mkdir(dir_2, dir_mode);
 
-    /** 正弦波の作成 **/
-    Sin_wave(data);
-
-    /** データの書き出し(1) **/
+    /** 信号の作成と書き出し **/
     const char basic_data[] = "Simulation/data/basic_data.dat";
-    Write_data(basic_data);
-
-    /** 誤差データの作成 **/
-    srand((unsigned int)time(NULL)); // シード値の変更
-
-    // 一様乱数の生成
-    Random_number(err_1);
-    Random_number(err_2);
-
-    // 正規分布乱数への変換
-    Box_Mullers_method(err_1, err_2);
-
-    /** 誤差データの足し合わせ **/
-    for (int i = 0; i < data.size(); i++)
-    {
-        data[i] += err_1[i] * err_value;
-    }
-
-    /** データの書き出し(2) **/
     const char noise_data[] = "Simulation/data/noise_data.dat";
-    Write_data(noise_data);
+    Write_data(gen, basic_data, noise_data);
 
     /** グラフの作成 **/
-    const char basic_graph[] = "Simulation/graph/basic_data.svg";
-    const char basic_title[] = "Sin wave : Basic data";
-    const char noise_graph[] = "Simulation/graph/noise_data.svg";
-    const char noise_title[] = "Sin wave : Noise data";
-    Gnuplot_noise(basic_data, basic_graph, basic_title);
-    Gnuplot_noise(noise_data, noise_graph, noise_title);
-
-    return 0;
-}
-
-/**************************************************************/
-// Function name : Sin_wave
-// Description   : 正弦波の作成
-/**************************************************************/
-void Sin_wave(vector<float> &data)
-{
-    for (int i = 0; i < data.size(); i++)
-    {
-        float dt = 1.0 / hz;             // 時間間隔 [s]
-        float omega = 2.0 * pi * hz_sin; // 角速度 [rad/s]
-        float theta = omega * dt * i;    // 角度 [rad]
-        data[i] = wave_value * sin(theta);
-    }
-}
-
-/**************************************************************/
-// Function name : Random_number
-// Description   : 一様乱数の生成
-/**************************************************************/
-void Random_number(vector<float> &err)
-{
-    for (int i = 0; i < err.size(); i++)
+    if (graph)
     {
-        err[i] = (float)rand() / RAND_MAX;
+        const char basic_graph[] = "Simulation/graph/basic_data.svg";
+        const char basic_title[] = "Signal : Basic data";
+        const char noise_graph[] = "Simulation/graph/noise_data.svg";
+        const char noise_title[] = "Signal : Noise data";
+        Gnuplot_noise(basic_data, basic_graph, basic_title);
+        Gnuplot_noise(noise_data, noise_graph, noise_title);
     }
-}
 
-/**************************************************************/
-// Function name : Box_Mullers_method
-// Description   : 正規分布の乱数を与える (x1,x2は互いに独立な一様乱数) | 範囲は -1 <= 1
-/**************************************************************/
-void Box_Mullers_method(vector<float> &x1, vector<float> &x2)
-{
-    const float pi = 4 * atan(1.0); // 円周率 [rad]
-    for (int i = 0; i < x1.size(); i++)
-    {
-        // ボックス=ミュラー法による正規分布乱数の計算
-        float tmp = sqrt(-2.0 * log(x1[i]));
-        float value1 = tmp * cos(2.0 * pi * x2[i]);
-        float value2 = tmp * sin(2.0 * pi * x2[i]);
-
-        // 配列への代入
-        x1[i] = value1; // -1.0 <= x1 <= 1.0
-        x2[i] = value2; // -1.0 <= x2 <= 1.0
-    }
+    return 0;
 }
 
 /**************************************************************/
 // Function name : Write_data
-// Description   : 車両の位置を計算
+// Description   : 信号をブロック単位で生成しながら書き出す
 /**************************************************************/
-void Write_data(const char filename[])
+void Write_data(Signal_generator &gen, const char basic_file[], const char noise_file[])
 {
-    float dt = 1.0 / hz; // 時間間隔 [s]
-
-    /** データの書き出し **/
-    fp = fopen(filename, "w");
-    for (int i = 0; i < data.size(); i++)
+    const double dt = 1.0 / hz;               // 時間間隔 [s]
+    const size_t n = (size_t)llround(t * hz); // 点数 [-]
+    vector<double> clean(gen.block), noise(gen.block);
+
+    Metrics_timer timer_write("write");
+    FILE *fp_basic = fopen(basic_file, "w");
+    FILE *fp_noise = fopen(noise_file, "w");
+    for (size_t i = 0; i < n; i += gen.block)
     {
-        float t_tmp = dt * i;
-        fprintf(fp, "%f\t%f\n", t_tmp, data[i]);
+        const size_t len = min(gen.block, n - i);
+        Signal_block(gen, clean.data(), noise.data(), len);
+        for (size_t k = 0; k < len; k++)
+        {
+            const double t_tmp = dt * (i + k);
+            fprintf(fp_basic, "%f\t%f\n", t_tmp, clean[k]);
+            fprintf(fp_noise, "%f\t%f\n", t_tmp, clean[k] + noise[k]);
+        }
     }
-    fclose(fp);
+    Metrics_fclose(fp_basic);
+    Metrics_fclose(fp_noise);
+    Metrics_add("samples", n);
 }
 
 /**************************************************************/
-// Function name : Gnuplot_y_acc
-// Description  :
+// Function name : Gnuplot_noise
+// Description   : 信号のグラフの作成
 /**************************************************************/
 void Gnuplot_noise(const char filename[], const char graphname[], const char title[])
 {
@@ -170,6 +159,7 @@ void Gnuplot_noise(const char filename[], const char graphname[], const char tit
     const float y_min = -2.0;
 
     /** Gnuplot 呼び出し **/
+    Metrics_timer timer_plot("plot");
     if ((gp = popen("gnuplot", "w")) == NULL)
     {
         printf("gnuplot is not here!\n");
@@ -182,12 +172,12 @@ void Gnuplot_noise(const char filename[], const char graphname[], const char tit
     fprintf(gp, "set output '%s'\n", graphname);                            // 出力ファイル
     fprintf(gp, "unset key\n");                                             // 凡例非表示
     fprintf(gp, "set xrange [%.3f:%.3f]\n", x_min, x_max);                  // x軸の描画範囲
-    fprintf(gp, "set yrange [%.3f:%.3f]\n", y_min, y_max);                  // y軸の描画範囲
+    fprintf(gp, "set yrange [*<%.3f:%.3f<*]\n", y_min, y_max);              // y軸の描画範囲 (成分に合わせて自動, 少なくとも ±2)
     fprintf(gp, "set title '%s'\n", title);                                 // グラフタイトル
     fprintf(gp, "set xlabel '{/Times-Italic t} [s]' offset 0.0, 0.0\n");    // x軸のラベル
     fprintf(gp, "set ylabel '{/Times-Italic F(t)} [-]' offset 1.0, 0.0\n"); // y軸のラベル
-    fprintf(gp, "set xtics 0.1 offset 0.0, 0.0\n");                         // x軸の間隔
-    fprintf(gp, "set ytics 1.0 offset 0.0, 0.0\n");                         // y軸の間隔
+    fprintf(gp, "set xtics %.3f offset 0.0, 0.0\n", x_max / 10);            // x軸の間隔
+    fprintf(gp, "set ytics autofreq offset 0.0, 0.0\n");                    // y軸の間隔
 
     /** Gnuplot 書き出し **/
     fprintf(gp, "plot '%s' using 1:2 with lines lc 'black' notitle\n", filename);
@@ -196,4 +186,5 @@ void Gnuplot_noise(const char filename[], const char graphname[], const char tit
     fflush(gp);            // Clean up Data
     fprintf(gp, "exit\n"); // Quit gnuplot
     pclose(gp);
-}
\ No newline at end of file
+    Metrics_add("frames", 1);
+}
@@ -0,0 +1,118 @@
+/**************************************************************/
+// Program name : Pipeline
+// Author       : Masatsugu Kitadai
+// Date         : 2023/11/12
+// Description  : 定義ファイルに記述した段階 (コンパイル・計算・描画) の差分実行
+//
+//   ./out/Pipeline.out [-j 並列数] [-f] [-n] <定義ファイル> [段階名...]
+//     -j : 同時に実行する段階の数 (省略時は CPU のコア数)
+//     -f : 変更がなくても全段階を実行
+//     -n : 実行せずに、実行される段階の表示のみ (上流の段階の実行による入力の変化は考慮しない)
+//   段階名を指定した場合は、その段階と依存する段階のみを実行する
+//   コマンドは定義ファイルのディレクトリで実行し、前回のハッシュは同じディレクトリの .pipeline_state に保存する
+/**************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+#include <thread>
+#include "../../common/pipeline.h"
+#include "../../common/metrics.h"
+using namespace std;
+
+/** 状態の表示名 **/
+const char *status_name[] = {"pending", "run", "skip", "FAIL", "blocked"};
+
+/**************************************************************/
+// Function name : main
+// Description   : メイン
+/**************************************************************/
+int main(int argc, char *argv[])
+{
+    /** 引数の読み取り **/
+    Pipeline pl;
+    int workers = thread::hardware_concurrency();
+    const char *filename = NULL;
+    vector<string> targets;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+        {
+            workers = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-f") == 0)
+        {
+            pl.force = true;
+        }
+        else if (strcmp(argv[i], "-n") == 0)
+        {
+            pl.dry_run = true;
+        }
+        else if (filename == NULL)
+        {
+            filename = argv[i];
+        }
+        else
+        {
+            targets.push_back(argv[i]);
+        }
+    }
+    if (filename == NULL)
+    {
+        printf("usage: %s [-j workers] [-f] [-n] <pipeline.txt> [stage...]\n", argv[0]);
+        return 1;
+    }
+
+    Metrics_start("Pipeline");
+
+    /** 定義ファイルの読み込み (以降は定義ファイルのディレクトリで実行) **/
+    if (!Pipeline_load(filename, pl) || !Pipeline_select(pl, targets))
+    {
+        return 1;
+    }
+    const char *slash = strrchr(filename, '/');
+    if (slash != NULL && chdir(string(filename, slash - filename + 1).c_str()) != 0)
+    {
+        printf("Cannot change directory: %s\n", filename);
+        return 1;
+    }
+    pl.state_file = ".pipeline_state";
+    Pipeline_read_state(pl);
+
+    /** 実行 (終了した段階から結果を表示) **/
+    const double start = Metrics_time();
+    auto report = [&](const Pipeline_stage &stage)
+    {
+        printf("[%-7s] %-32s %9.3f [s]\n", status_name[stage.status], stage.name.c_str(), stage.seconds);
+        if (!stage.log.empty())
+        {
+            fputs(stage.log.c_str(), stdout);
+        }
+        fflush(stdout);
+    };
+    const bool ok = Pipeline_run(pl, workers, report);
+    const double elapsed = Metrics_time() - start;
+
+    /** 段階ごとの時間 **/
+    double total = 0;
+    int count[5] = {};
+    printf("\n%-32s %-8s %12s\n", "stage", "status", "time [s]");
+    for (const Pipeline_stage &stage : pl.stages)
+    {
+        if (stage.selected)
+        {
+            printf("%-32s %-8s %12.3f\n", stage.name.c_str(), status_name[stage.status], stage.seconds);
+            total += stage.seconds;
+            count[stage.status]++;
+        }
+    }
+    printf("run = %d\tskip = %d\tfail = %d\tblocked = %d\telapsed = %.3f [s] (sum of stages %.3f [s], %d workers)\n",
+           count[pipeline_run], count[pipeline_skip], count[pipeline_fail], count[pipeline_blocked], elapsed, total, workers);
+    Metrics_add("stages_run", count[pipeline_run]);
+    Metrics_add("stages_skipped", count[pipeline_skip]);
+
+    return ok ? 0 : 1;
+}
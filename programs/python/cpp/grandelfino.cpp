@@ -0,0 +1,413 @@
+/**************************************************************/
+// Program name : grandelfino (Python 拡張モジュール)
+// Author       : Masatsugu Kitadai
+// Date         : 2023/11/18
+// Description  : common/kernels.h の数値計算を Python から呼び出す
+//
+//   NumPy 配列 (float64, C 連続) などのバッファをコピーせずに参照し、計算中は GIL を解放する
+//   出力は out 引数 (書き込み可能なバッファ) に書き込み、省略時は新しい配列 (memoryview) を返す
+//   out に入力と同じ配列を渡すと in-place で計算する (ずらして重なる配列は ValueError)
+//   (np.asarray(戻り値) でコピーせずに NumPy 配列として扱える)
+//
+//   cmake -S .. -B _build -DGRANDELFINO_PYTHON=ON && cmake --build _build
+//   PYTHONPATH=_build/python python3 -c "import grandelfino"
+/**************************************************************/
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <string.h>
+#include <math.h>
+#include "../../common/kernels.h"
+
+/** 入力・出力バッファ (終了時に自動で解放) **/
+struct Buffer
+{
+    Py_buffer view;     // バッファ
+    bool valid = false; // 取得済み
+
+    ~Buffer()
+    {
+        if (valid)
+        {
+            PyBuffer_Release(&view);
+        }
+    }
+    double *data() { return (double *)view.buf; }
+    size_t size() { return view.len / sizeof(double); }
+};
+
+/**************************************************************/
+// Function name : Get_buffer
+// Description   : float64 の連続したバッファの取得 (書き込み用は writable)
+/**************************************************************/
+static bool Get_buffer(PyObject *object, Buffer &buffer, bool writable, const char *name)
+{
+    const int flags = PyBUF_C_CONTIGUOUS | PyBUF_FORMAT | (writable ? PyBUF_WRITABLE : 0);
+    if (PyObject_GetBuffer(object, &buffer.view, flags) != 0)
+    {
+        PyErr_Format(PyExc_TypeError, "%s: expected a contiguous%s buffer of float64", name, writable ? " writable" : "");
+        return false;
+    }
+    buffer.valid = true;
+
+    const char *format = buffer.view.format != NULL ? buffer.view.format : "B";
+    if (format[0] == '<' || format[0] == '=' || format[0] == '@')
+    {
+        format++;
+    }
+    if (strcmp(format, "d") != 0 || buffer.view.itemsize != sizeof(double))
+    {
+        PyErr_Format(PyExc_TypeError, "%s: expected float64 data, got format '%s'", name, buffer.view.format);
+        return false;
+    }
+    return true;
+}
+
+/**************************************************************/
+// Function name : Overlaps
+// Description   : 入力と出力のバッファが一部だけ重なっているか (同じ配列の in-place は可)
+/**************************************************************/
+static bool Overlaps(Buffer &input, Buffer &output)
+{
+    const char *a = (const char *)input.view.buf, *b = (const char *)output.view.buf;
+    if (a == b)
+    {
+        return false;
+    }
+    return a < b + output.view.len && b < a + input.view.len;
+}
+
+/**************************************************************/
+// Function name : Get_output
+// Description   : 出力先の取得 (out が None の場合は n 点の配列を新規作成し result に返す)
+//                 inputs は NULL 終端の入力バッファの配列 (一部だけ重なる場合は ValueError)
+/**************************************************************/
+static bool Get_output(PyObject *out, size_t n, Buffer &buffer, PyObject *&result, Buffer *const *inputs)
+{
+    if (out == NULL || out == Py_None)
+    {
+        PyObject *bytes = PyByteArray_FromStringAndSize(NULL, n * sizeof(double));
+        if (bytes == NULL)
+        {
+            return false;
+        }
+        PyObject *view = PyMemoryView_FromObject(bytes);
+        Py_DECREF(bytes);
+        if (view == NULL)
+        {
+            return false;
+        }
+        result = PyObject_CallMethod(view, "cast", "s", "d");
+        Py_DECREF(view);
+        if (result == NULL)
+        {
+            return false;
+        }
+        out = result;
+    }
+    else
+    {
+        Py_INCREF(out);
+        result = out;
+    }
+
+    if (!Get_buffer(out, buffer, true, "out"))
+    {
+        Py_CLEAR(result);
+        return false;
+    }
+    if (buffer.size() != n)
+    {
+        PyErr_Format(PyExc_ValueError, "out: expected %zu elements, got %zu", n, buffer.size());
+        Py_CLEAR(result);
+        return false;
+    }
+    for (; *inputs != NULL; inputs++)
+    {
+        if (Overlaps(**inputs, buffer))
+        {
+            PyErr_SetString(PyExc_ValueError, "out: overlaps an input without being the same array (use out=x for in-place)");
+            Py_CLEAR(result);
+            return false;
+        }
+    }
+    return true;
+}
+
+/**************************************************************/
+// Function name : Py_moving_average
+// Description   : moving_average(x, window, out=None)
+/**************************************************************/
+static PyObject *Py_moving_average(PyObject *, PyObject *args, PyObject *kwargs)
+{
+    static const char *keywords[] = {"x", "window", "out", NULL};
+    PyObject *x_object, *out_object = NULL, *result = NULL;
+    Py_ssize_t window;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "On|O", (char **)keywords, &x_object, &window, &out_object))
+    {
+        return NULL;
+    }
+    if (window < 1)
+    {
+        PyErr_SetString(PyExc_ValueError, "window must be >= 1");
+        return NULL;
+    }
+    Buffer x, out;
+    Buffer *const inputs[] = {&x, NULL};
+    if (!Get_buffer(x_object, x, false, "x") || !Get_output(out_object, x.size(), out, result, inputs))
+    {
+        return NULL;
+    }
+    Py_BEGIN_ALLOW_THREADS;
+    Moving_average(x.data(), x.size(), window, out.data());
+    Py_END_ALLOW_THREADS;
+    return result;
+}
+
+/**************************************************************/
+// Function name : Py_ema
+// Description   : ema(x, span, out=None)
+/**************************************************************/
+static PyObject *Py_ema(PyObject *, PyObject *args, PyObject *kwargs)
+{
+    static const char *keywords[] = {"x", "span", "out", NULL};
+    PyObject *x_object, *out_object = NULL, *result = NULL;
+    double span;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "Od|O", (char **)keywords, &x_object, &span, &out_object))
+    {
+        return NULL;
+    }
+    if (span < 1)
+    {
+        PyErr_SetString(PyExc_ValueError, "span must be >= 1");
+        return NULL;
+    }
+    Buffer x, out;
+    Buffer *const inputs[] = {&x, NULL};
+    if (!Get_buffer(x_object, x, false, "x") || !Get_output(out_object, x.size(), out, result, inputs))
+    {
+        return NULL;
+    }
+    Py_BEGIN_ALLOW_THREADS;
+    Exponential_moving_average(x.data(), x.size(), span, out.data());
+    Py_END_ALLOW_THREADS;
+    return result;
+}
+
+/**************************************************************/
+// Function name : Py_savgol
+// Description   : savgol(x, half=3, order=2, dt=1.0, deriv=0, out=None)
+/**************************************************************/
+static PyObject *Py_savgol(PyObject *, PyObject *args, PyObject *kwargs)
+{
+    static const char *keywords[] = {"x", "half", "order", "dt", "deriv", "out", NULL};
+    PyObject *x_object, *out_object = NULL, *result = NULL;
+    int half = 3, order = 2, deriv = 0;
+    double dt = 1.0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|iidiO", (char **)keywords, &x_object, &half, &order, &dt, &deriv, &out_object))
+    {
+        return NULL;
+    }
+    if (half < 1 || order < 0 || order > 2 * half || deriv < 0 || deriv >= savgol_derivs || dt <= 0)
+    {
+        PyErr_SetString(PyExc_ValueError, "require half >= 1, 0 <= order <= 2*half, 0 <= deriv <= 2 and dt > 0");
+        return NULL;
+    }
+    Buffer x, out;
+    Buffer *const inputs[] = {&x, NULL};
+    if (!Get_buffer(x_object, x, false, "x") || !Get_output(out_object, x.size(), out, result, inputs))
+    {
+        return NULL;
+    }
+    Py_BEGIN_ALLOW_THREADS;
+    Savgol_smooth(x.data(), x.size(), half, order, dt, deriv, out.data());
+    Py_END_ALLOW_THREADS;
+    return result;
+}
+
+/**************************************************************/
+// Function name : Py_fft
+// Description   : fft(re, im, inverse=False) | re・im を in-place で変換
+/**************************************************************/
+static PyObject *Py_fft(PyObject *, PyObject *args, PyObject *kwargs)
+{
+    static const char *keywords[] = {"re", "im", "inverse", NULL};
+    PyObject *re_object, *im_object;
+    int inverse = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "OO|p", (char **)keywords, &re_object, &im_object, &inverse))
+    {
+        return NULL;
+    }
+    Buffer re, im;
+    if (!Get_buffer(re_object, re, true, "re") || !Get_buffer(im_object, im, true, "im"))
+    {
+        return NULL;
+    }
+    if (re.size() != im.size())
+    {
+        PyErr_SetString(PyExc_ValueError, "re and im must have the same length");
+        return NULL;
+    }
+    Py_BEGIN_ALLOW_THREADS;
+    Fft(re.data(), im.data(), re.size(), inverse);
+    Py_END_ALLOW_THREADS;
+    Py_RETURN_NONE;
+}
+
+/**************************************************************/
+// Function name : Py_bandpass
+// Description   : bandpass(x, dt, f_low, f_high, out=None)
+/**************************************************************/
+static PyObject *Py_bandpass(PyObject *, PyObject *args, PyObject *kwargs)
+{
+    static const char *keywords[] = {"x", "dt", "f_low", "f_high", "out", NULL};
+    PyObject *x_object, *out_object = NULL, *result = NULL;
+    double dt, f_low, f_high;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "Oddd|O", (char **)keywords, &x_object, &dt, &f_low, &f_high, &out_object))
+    {
+        return NULL;
+    }
+    if (dt <= 0)
+    {
+        PyErr_SetString(PyExc_ValueError, "dt must be > 0");
+        return NULL;
+    }
+    Buffer x, out;
+    Buffer *const inputs[] = {&x, NULL};
+    if (!Get_buffer(x_object, x, false, "x") || !Get_output(out_object, x.size(), out, result, inputs))
+    {
+        return NULL;
+    }
+    Py_BEGIN_ALLOW_THREADS;
+    Bandpass_fft(x.data(), x.size(), dt, f_low, f_high, out.data());
+    Py_END_ALLOW_THREADS;
+    return result;
+}
+
+/**************************************************************/
+// Function name : Py_integrate
+// Description   : integrate(t, x, out=None) | 台形則の累積積分
+/**************************************************************/
+static PyObject *Py_integrate(PyObject *, PyObject *args, PyObject *kwargs)
+{
+    static const char *keywords[] = {"t", "x", "out", NULL};
+    PyObject *t_object, *x_object, *out_object = NULL, *result = NULL;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "OO|O", (char **)keywords, &t_object, &x_object, &out_object))
+    {
+        return NULL;
+    }
+    Buffer t, x, out;
+    if (!Get_buffer(t_object, t, false, "t") || !Get_buffer(x_object, x, false, "x"))
+    {
+        return NULL;
+    }
+    if (t.size() != x.size())
+    {
+        PyErr_SetString(PyExc_ValueError, "t and x must have the same length");
+        return NULL;
+    }
+    Buffer *const inputs[] = {&t, &x, NULL};
+    if (!Get_output(out_object, x.size(), out, result, inputs))
+    {
+        return NULL;
+    }
+    Py_BEGIN_ALLOW_THREADS;
+    Integrate_trapezoid(t.data(), x.data(), x.size(), out.data());
+    Py_END_ALLOW_THREADS;
+    return result;
+}
+
+/**************************************************************/
+// Function name : Py_stats
+// Description   : stats(x) | {n, mean, std, min, max, rms} (NaN は除外)
+/**************************************************************/
+static PyObject *Py_stats(PyObject *, PyObject *args, PyObject *kwargs)
+{
+    static const char *keywords[] = {"x", NULL};
+    PyObject *x_object;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O", (char **)keywords, &x_object))
+    {
+        return NULL;
+    }
+    Buffer x;
+    if (!Get_buffer(x_object, x, false, "x"))
+    {
+        return NULL;
+    }
+    Kernel_stats s;
+    Py_BEGIN_ALLOW_THREADS;
+    s = Statistics(x.data(), x.size());
+    Py_END_ALLOW_THREADS;
+    return Py_BuildValue("{s:n,s:d,s:d,s:d,s:d,s:d}", "n", (Py_ssize_t)s.n, "mean", s.mean, "std", s.std,
+                         "min", s.min, "max", s.max, "rms", s.rms);
+}
+
+/**************************************************************/
+// Function name : Py_range_mean
+// Description   : range_mean(s, v, lower, upper, nonzero=False) | lower <= s <= upper の v の平均値
+/**************************************************************/
+static PyObject *Py_range_mean(PyObject *, PyObject *args, PyObject *kwargs)
+{
+    static const char *keywords[] = {"s", "v", "lower", "upper", "nonzero", NULL};
+    PyObject *s_object, *v_object;
+    double lower, upper;
+    int nonzero = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "OOdd|p", (char **)keywords, &s_object, &v_object, &lower, &upper, &nonzero))
+    {
+        return NULL;
+    }
+    Buffer s, v;
+    if (!Get_buffer(s_object, s, false, "s") || !Get_buffer(v_object, v, false, "v"))
+    {
+        return NULL;
+    }
+    if (s.size() != v.size())
+    {
+        PyErr_SetString(PyExc_ValueError, "s and v must have the same length");
+        return NULL;
+    }
+    double mean;
+    Py_BEGIN_ALLOW_THREADS;
+    mean = Range_mean(s.data(), v.data(), s.size(), lower, upper, nonzero);
+    Py_END_ALLOW_THREADS;
+    return PyFloat_FromDouble(mean);
+}
+
+/** 関数表 **/
+static PyMethodDef methods[] = {
+    {"moving_average", (PyCFunction)(void (*)(void))Py_moving_average, METH_VARARGS | METH_KEYWORDS,
+     "moving_average(x, window, out=None)\nTrailing moving average (NaN until the window is full), same as pandas rolling(window).mean()."},
+    {"ema", (PyCFunction)(void (*)(void))Py_ema, METH_VARARGS | METH_KEYWORDS,
+     "ema(x, span, out=None)\nExponential moving average with alpha = 2 / (span + 1), same as pandas ewm(span, adjust=False).mean()."},
+    {"savgol", (PyCFunction)(void (*)(void))Py_savgol, METH_VARARGS | METH_KEYWORDS,
+     "savgol(x, half=3, order=2, dt=1.0, deriv=0, out=None)\nSavitzky-Golay smoothing (deriv=0) or derivative (deriv=1, 2) over 2*half+1 points."},
+    {"fft", (PyCFunction)(void (*)(void))Py_fft, METH_VARARGS | METH_KEYWORDS,
+     "fft(re, im, inverse=False)\nIn-place FFT of any length (the inverse is scaled by 1/n)."},
+    {"bandpass", (PyCFunction)(void (*)(void))Py_bandpass, METH_VARARGS | METH_KEYWORDS,
+     "bandpass(x, dt, f_low, f_high, out=None)\nRemove the components outside f_low..f_high [Hz] via FFT."},
+    {"integrate", (PyCFunction)(void (*)(void))Py_integrate, METH_VARARGS | METH_KEYWORDS,
+     "integrate(t, x, out=None)\nCumulative trapezoidal integral of x over t, starting at 0."},
+    {"stats", (PyCFunction)(void (*)(void))Py_stats, METH_VARARGS | METH_KEYWORDS,
+     "stats(x)\nDictionary of n, mean, std, min, max and rms, ignoring NaN."},
+    {"range_mean", (PyCFunction)(void (*)(void))Py_range_mean, METH_VARARGS | METH_KEYWORDS,
+     "range_mean(s, v, lower, upper, nonzero=False)\nMean of v where lower <= s <= upper (optionally skipping zeros); NaN if empty."},
+    {NULL, NULL, 0, NULL},
+};
+
+static struct PyModuleDef module = {
+    PyModuleDef_HEAD_INIT,
+    "grandelfino",
+    "Filter, FFT, integration and statistics kernels over float64 buffers (NumPy arrays are used without copying).\n"
+    "Functions taking out= may be given the input array itself (in-place); a partially overlapping out raises ValueError.",
+    -1,
+    methods,
+    NULL, // m_slots
+    NULL, // m_traverse
+    NULL, // m_clear
+    NULL, // m_free
+};
+
+PyMODINIT_FUNC PyInit_grandelfino(void)
+{
+    return PyModule_Create(&module);
+}
@@ -0,0 +1,10 @@
+# 出力ディレクトリの作成
+mkdir -p out data
+
+# 変換プログラムのコンパイル
+g++ -O2 -std=c++17 -pthread cpp/Convert_log.cpp -o "out/Convert_log.out"
+
+# テキストデータ → バイナリログ (.slog)
+./out/Convert_log.out arduino ../acceleration/data/data.csv data/acceleration.slog
+./out/Convert_log.out gnss ../gnss_data/GNSS_data/test.csv data/gnss.slog
+./out/Convert_log.out sim ../estimate_position/Simulation/data/data.dat data/simulation.slog
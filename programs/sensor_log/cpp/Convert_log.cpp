@@ -0,0 +1,303 @@
+/**************************************************************/
+// Program name : Convert_log
+// Author       : Masatsugu Kitadai
+// Date         : 2023/10/21
+// Description  : テキスト形式のセンサデータを列指向バイナリログ (.slog) へ変換
+//
+//   ./out/Convert_log.out arduino <DATA_XXXX.csv> <output.slog>
+//   ./out/Convert_log.out gnss    <test.csv>      <output.slog>
+//   ./out/Convert_log.out sim     <data.dat>      <output.slog>
+//   ./out/Convert_log.out dump    <input.slog>
+/**************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <charconv>
+#include <vector>
+#include "../../common/data_reader.h"
+#include "../../common/sensor_frame.h"
+#include "../../common/sensor_log.h"
+#include "../../common/metrics.h"
+using namespace std;
+
+/** パラメータ **/
+const float gps_missing = -90; // シミュレーションデータで GPS 未受信を表す値の閾値 [-]
+
+/** プロトタイプ宣言 **/
+bool Convert_arduino(const char *readfile, Sensor_log_data &data);
+bool Convert_gnss(const char *readfile, Sensor_log_data &data);
+bool Convert_simulation(const char *readfile, Sensor_log_data &data);
+void Add_column(Sensor_log_data &data, const char *name, const char *unit, float hz, const double *values, bool is_double = false);
+double Mean_rate(const vector<double> &time);
+void Dump(const char *filename);
+
+/**************************************************************/
+// Function name : main
+// Description   : メインプログラム
+/**************************************************************/
+int main(int argc, char *argv[])
+{
+    if (argc >= 3 && strcmp(argv[1], "dump") == 0)
+    {
+        Dump(argv[2]);
+        return 0;
+    }
+
+    if (argc < 4)
+    {
+        printf("usage: %s <arduino|gnss|sim> <input> <output.slog>\n", argv[0]);
+        printf("       %s dump <input.slog>\n", argv[0]);
+        return 1;
+    }
+
+    Metrics_start("Convert_log");
+
+    /** 読み込みと変換 **/
+    Metrics_timer timer_read("read");
+    Sensor_log_data data;
+    bool ok = false;
+    if (strcmp(argv[1], "arduino") == 0)
+    {
+        ok = Convert_arduino(argv[2], data);
+    }
+    else if (strcmp(argv[1], "gnss") == 0)
+    {
+        ok = Convert_gnss(argv[2], data);
+    }
+    else if (strcmp(argv[1], "sim") == 0)
+    {
+        ok = Convert_simulation(argv[2], data);
+    }
+    else
+    {
+        printf("Unknown input type: %s\n", argv[1]);
+    }
+
+    timer_read.Stop();
+    Metrics_add("samples", data.time.size());
+
+    /** 書き出し **/
+    Metrics_timer timer_write("write");
+    if (!ok || !Write_sensor_log(argv[3], data))
+    {
+        return 1;
+    }
+    timer_write.Stop();
+    printf("Write: %s (%zu samples, %zu channels)\n", argv[3], data.time.size(), data.columns.size());
+
+    return 0;
+}
+
+/**************************************************************/
+// Function name : Convert_arduino
+// Description   : MPU6050 ロガーの CSV (Time, rax, ray, raz, rgx, rgy, rgz)
+/**************************************************************/
+bool Convert_arduino(const char *readfile, Sensor_log_data &data)
+{
+    Data_table<double> table;
+    if (!Read_table(readfile, table, 0, 7))
+    {
+        return false;
+    }
+
+    /** 時刻 [ms] → [s] **/
+    data.time.resize(table.rows);
+    for (size_t i = 0; i < table.rows; i++)
+    {
+        data.time[i] = table.Column(0)[i] / 1000.0;
+    }
+    data.sample_rate = Mean_rate(data.time);
+
+    const float hz = data.sample_rate;
+    Add_column(data, "acc_x", "g", hz, table.Column(1));
+    Add_column(data, "acc_y", "g", hz, table.Column(2));
+    Add_column(data, "acc_z", "g", hz, table.Column(3));
+    Add_column(data, "omega_x", "deg/s", hz, table.Column(4));
+    Add_column(data, "omega_y", "deg/s", hz, table.Column(5));
+    Add_column(data, "omega_z", "deg/s", hz, table.Column(6));
+
+    return true;
+}
+
+/**************************************************************/
+// Function name : Convert_gnss
+// Description   : GNSS ロガーの CSV (Index, GPS time [week:tow], Lat, Lon, X, Y, Z)
+/**************************************************************/
+bool Convert_gnss(const char *readfile, Sensor_log_data &data)
+{
+    /** 数値列の読み込み (GPS time の列は NaN になる) **/
+    const int skip = 9; // 読み飛ばす行数
+    Data_table<double> table;
+    if (!Read_table(readfile, table, skip, 7))
+    {
+        return false;
+    }
+
+    /** GPS time (week:tow) の解析 (Read_table と同じく先頭の列が数値の行だけを対象にする) **/
+    Mapped_file file;
+    if (!Map_file(readfile, file))
+    {
+        return false;
+    }
+
+    data.time.clear();
+    data.time.reserve(table.rows);
+    const char *p = file.data;
+    const char *end = file.data + file.size;
+    for (int line = 0; p < end; line++)
+    {
+        const char *nl = (const char *)memchr(p, '\n', end - p);
+        const char *line_end = nl != NULL ? nl : end;
+        double index;
+        const char *q = Parse_field(p, line_end, index);
+        if (line >= skip && !isnan(index))
+        {
+            double week = NAN, tow = NAN;
+            const char *colon = (const char *)memchr(q, ':', line_end - q);
+            if (colon != NULL)
+            {
+                std::from_chars(q, colon, week);
+                std::from_chars(colon + 1, line_end, tow);
+            }
+            data.time.push_back(week * 604800.0 + tow); // GPS 時刻 [s]
+        }
+        p = nl != NULL ? nl + 1 : end;
+    }
+    Unmap_file(file);
+
+    bool broken = data.time.size() != table.rows;
+    for (size_t i = 0; i < data.time.size() && !broken; i++)
+    {
+        broken = isnan(data.time[i]);
+    }
+    if (broken)
+    {
+        printf("Broken GPS time column: %s\n", readfile);
+        return false;
+    }
+    data.sample_rate = Mean_rate(data.time);
+
+    const float hz = data.sample_rate;
+    Add_column(data, "latitude", "deg", hz, table.Column(2), true);
+    Add_column(data, "longitude", "deg", hz, table.Column(3), true);
+    Add_column(data, "ecef_x", "m", hz, table.Column(4), true);
+    Add_column(data, "ecef_y", "m", hz, table.Column(5), true);
+    Add_column(data, "ecef_z", "m", hz, table.Column(6), true);
+
+    return true;
+}
+
+/**************************************************************/
+// Function name : Convert_simulation
+// Description   : Simulation.cpp の出力 (data.dat)
+//                 常に 0 の acc_z / omega_x / omega_y は保存せず、
+//                 GPS 未受信 (-100) は有効ビットで表す
+/**************************************************************/
+bool Convert_simulation(const char *readfile, Sensor_log_data &data)
+{
+    Sensor_frame<double> frame;
+    if (!Read_sensor_frame(readfile, frame))
+    {
+        return false;
+    }
+
+    data.time.assign(frame.Column(sensor_t), frame.Column(sensor_t) + frame.rows);
+    data.sample_rate = Mean_rate(data.time);
+
+    const float hz = data.sample_rate;
+    for (Sensor_channel c : {sensor_acc_x, sensor_acc_y, sensor_omega_z, sensor_gps_x, sensor_gps_y})
+    {
+        Add_column(data, sensor_channel_name[c], sensor_channel_unit[c], hz, frame.Column(c));
+    }
+
+    /** GPS の有効ビット **/
+    for (int j = 3; j <= 4; j++)
+    {
+        Sensor_log_column &col = data.columns[j];
+        col.valid.resize(frame.rows);
+        size_t n_valid = 0;
+        for (size_t i = 0; i < frame.rows; i++)
+        {
+            col.valid[i] = col.values[i] >= gps_missing;
+            if (!col.valid[i])
+            {
+                col.values[i] = 0;
+            }
+            n_valid += col.valid[i];
+        }
+        col.sample_rate = hz * n_valid / frame.rows;
+    }
+
+    return true;
+}
+
+/**************************************************************/
+// Function name : Add_column
+// Description   : チャンネルの追加
+/**************************************************************/
+void Add_column(Sensor_log_data &data, const char *name, const char *unit, float hz, const double *values, bool is_double)
+{
+    Sensor_log_column col;
+    col.name = name;
+    col.unit = unit;
+    col.sample_rate = hz;
+    col.is_double = is_double;
+    col.values.assign(values, values + data.time.size());
+    data.columns.push_back(col);
+}
+
+/**************************************************************/
+// Function name : Mean_rate
+// Description   : 時刻列から平均サンプリング周波数を求める
+/**************************************************************/
+double Mean_rate(const vector<double> &time)
+{
+    if (time.size() < 2 || time.back() <= time.front())
+    {
+        return 0;
+    }
+    return (time.size() - 1) / (time.back() - time.front());
+}
+
+/**************************************************************/
+// Function name : Dump
+// Description   : バイナリログの内容をテキストで表示
+/**************************************************************/
+void Dump(const char *filename)
+{
+    Sensor_log log;
+    if (!Open_sensor_log(filename, log))
+    {
+        exit(1);
+    }
+
+    const Sensor_log_header &h = *log.header;
+    printf("samples = %llu\tchannels = %u\trate = %.3f [Hz]\n", (unsigned long long)h.n_samples, h.n_channels, h.sample_rate);
+    for (uint32_t j = 0; j < h.n_channels; j++)
+    {
+        const Sensor_log_channel &ch = log.channels[j];
+        printf("  %-12s [%s]\t%.3f [Hz]\t%s\tvalid = %llu\n", ch.name, ch.unit, ch.sample_rate, ch.value_size == 8 ? "double" : "float", (unsigned long long)ch.n_valid);
+    }
+
+    /** 先頭10行の表示 **/
+    for (uint64_t i = 0; i < h.n_samples && i < 10; i++)
+    {
+        printf("%f", log.time[i]);
+        for (uint32_t j = 0; j < h.n_channels; j++)
+        {
+            if (Is_valid(log, j, i))
+            {
+                printf("\t%f", Channel_value(log, j, i));
+            }
+            else
+            {
+                printf("\t-");
+            }
+        }
+        printf("\n");
+    }
+
+    Close_sensor_log(log);
+}